@@ -119,7 +119,7 @@ int config_save(const char *filename)
 	fprintf(fp, "height=%i\n", my_config.height);
 	fprintf(fp, "#video input format\n");
 	fprintf(fp, "v4l2_format=%u\n", my_config.format);
-	fprintf(fp, "#video input capture method\n");
+	fprintf(fp, "#video input capture method (read, mmap, uptr or dmab)\n");
 	fprintf(fp, "capture=%s\n", my_config.capture);
 	fprintf(fp, "#audio api\n");
 	fprintf(fp, "audio=%s\n", my_config.audio);
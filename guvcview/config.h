@@ -32,7 +32,7 @@ typedef struct _config_t
 	char render[5];  /*render api*/
 	char gui[5];     /*gui api*/
 	char audio[6];   /*audio api - none; port; pulse*/
-	char capture[5]; /*capture method: read or mmap*/
+	char capture[5]; /*capture method: read, mmap, uptr or dmab*/
 	char video_codec[5]; /*video codec*/
 	char audio_codec[5]; /*video codec*/
 	char *profile_path;
@@ -495,6 +495,35 @@ void set_profile_path(const char *path)
 	my_config->profile_path = strdup(profile_path);
 }
 
+/*
+ * save the device control values into a profile file
+ *  *.gpfb files are saved as binary profiles (only non default
+ *  controls), everything else as text profiles
+ *  (loading detects the format)
+ * args:
+ *   filename - profile filename
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 -E_OK)
+ */
+int gui_save_control_profile(const char *filename)
+{
+	int ret = 0;
+
+	char *ext = get_file_extension(filename);
+	if(ext != NULL && strcasecmp(ext, "gpfb") == 0)
+		ret = v4l2core_save_control_profile_binary(get_v4l2_device_handler(), filename);
+	else
+		ret = v4l2core_save_control_profile(get_v4l2_device_handler(), filename);
+
+	if(ext)
+		free(ext);
+
+	return ret;
+}
+
 /*
  * gets video sufix flag
  * args:
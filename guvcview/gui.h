@@ -203,6 +203,21 @@ char *get_profile_path();
  */
 void set_profile_path(const char *path);
 
+/*
+ * save the device control values into a profile file
+ *  *.gpfb files are saved as binary profiles (only non default
+ *  controls), everything else as text profiles
+ *  (loading detects the format)
+ * args:
+ *   filename - profile filename
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 -E_OK)
+ */
+int gui_save_control_profile(const char *filename);
+
 /*
  * gets video sufix flag
  * args:
@@ -142,6 +142,10 @@ static void profile_update_extension (GtkComboBox *chooser, GtkWidget *file_dial
 	switch(format)
 	{
 		case 1:
+			gtk_file_filter_add_pattern(filter, "*.gpfb");
+			break;
+
+		case 2:
 			gtk_file_filter_add_pattern(filter, "*.*");
 			break;
 
@@ -217,6 +221,7 @@ void controls_profile_clicked (GtkWidget *item, void *data)
 	gtk_widget_set_hexpand (FileFormat, TRUE);
 
 	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(FileFormat),_("gpfl  (*.gpfl)"));
+	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(FileFormat),_("gpfb binary (*.gpfb)"));
 	gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(FileFormat),_("any (*.*)"));
 
 	gtk_combo_box_set_active(GTK_COMBO_BOX(FileFormat), 0);
@@ -242,7 +247,7 @@ void controls_profile_clicked (GtkWidget *item, void *data)
 
 		if(save_or_load > 0)
 		{
-			v4l2core_save_control_profile(get_v4l2_device_handler(), filename);
+			gui_save_control_profile(filename);
 		}
 		else
 		{
@@ -141,6 +141,8 @@ void MainWindow::load_save_profile_clicked()
 	{
 		QString filter = _("gpfl  (*.gpfl)");
 		filter.append(";;");
+		filter.append(_("gpfb binary (*.gpfb)"));
+		filter.append(";;");
 		filter.append(_("any (*.*)"));
 		QString fileName = QFileDialog::getOpenFileName(this, _("Load Profile"),
 			get_profile_path(), filter);
@@ -172,6 +174,8 @@ void MainWindow::load_save_profile_clicked()
 	{
 		QString filter = _("gpfl  (*.gpfl)");
 		filter.append(";;");
+		filter.append(_("gpfb binary (*.gpfb)"));
+		filter.append(";;");
 		filter.append(_("any (*.*)"));
 		
 		QString profile_name = get_profile_path();
@@ -186,7 +190,7 @@ void MainWindow::load_save_profile_clicked()
 				std::cout << "GUVCVIEW (Qt5): save profile " 
 					<< fileName.toStdString() << std::endl;
 				
-			v4l2core_save_control_profile(get_v4l2_device_handler(), fileName.toStdString().c_str());
+			gui_save_control_profile(fileName.toStdString().c_str());
 			
 			char *basename = get_file_basename(fileName.toStdString().c_str());
 			if(basename)
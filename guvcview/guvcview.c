@@ -216,6 +216,10 @@ int main(int argc, char *argv[])
 	/*set the v4l2 core verbosity*/
 	v4l2core_set_verbosity(debug_level);
 
+	/*pipelined decoding needs a frame in the queue per decoder thread (+1 for the consumer)*/
+	if(my_options->decoder_threads > 1)
+		v4l2core_set_frame_queue_size(my_options->decoder_threads + 1);
+
 	/*set the v4l2core device (redefines language catalog)*/
 	v4l2_dev_t *vd = create_v4l2_device_handler(my_options->device);
 	if(!vd)
@@ -235,9 +239,44 @@ int main(int argc, char *argv[])
 	/*select capture method*/
 	if(strcasecmp(my_config->capture, "read") == 0)
 		v4l2core_set_capture_method(vd, IO_READ);
+	else if(strcasecmp(my_config->capture, "uptr") == 0)
+		v4l2core_set_capture_method(vd, IO_USERPTR);
+	else if(strcasecmp(my_config->capture, "dmab") == 0)
+		v4l2core_set_capture_method(vd, IO_DMABUF);
 	else
 		v4l2core_set_capture_method(vd, IO_MMAP);
 
+	/*set the number of driver buffers to request*/
+	if(my_options->buffers > 0)
+		v4l2core_set_buffer_count(vd, my_options->buffers);
+
+	/*set the number of frame decoder threads*/
+	if(my_options->decoder_threads > 1)
+		v4l2core_set_decoder_threads(vd, my_options->decoder_threads);
+
+	/*
+	 * use yu12, yv12 and nv12 frames directly from the driver buffers
+	 * (read buffers are reused by the next read so always copy them)
+	 */
+	if(strcasecmp(my_config->capture, "read") != 0)
+		v4l2core_set_yuv_passthrough(vd, 1);
+
+	/*
+	 * set the number of frame processing threads
+	 * (v4l2core, render and encoder each have their own pool of
+	 *  nthreads - 1 workers: by default up to ncpu - 1 workers per library)
+	 */
+	if(my_options->worker_threads >= 0)
+	{
+		v4l2core_set_worker_threads(my_options->worker_threads);
+		render_set_worker_threads(my_options->worker_threads);
+		encoder_set_worker_threads(my_options->worker_threads);
+	}
+
+	/*set the libavcodec decoders threads (mjpeg and h264)*/
+	if(my_options->codec_threads >= 0)
+		v4l2core_set_codec_threads(my_options->codec_threads, my_options->codec_thread_type);
+
 	/*set software autofocus sort method*/
 	v4l2core_soft_autofocus_set_sort(AUTOF_SORT_INSERT);
 
@@ -361,6 +400,9 @@ int main(int argc, char *argv[])
 
 		if(ret == E_OK)
 		{
+			if(debug_level > 0)
+				printf("GUVCVIEW: using %i driver buffers\n", v4l2core_get_buffer_count(vd));
+
 			__INIT_COND(&capture_cond);
 			__LOCK_MUTEX(&capture_mutex);
 
@@ -82,7 +82,35 @@ static opt_values_t opt_values[] =
 		.opt_long = "capture",
 		.req_arg = 1,
 		.opt_help_arg = N_("METHOD"),
-		.opt_help = N_("Set capture method [read | mmap (def)]"),
+		.opt_help = N_("Set capture method [read | mmap (def) | uptr | dmab]"),
+	},
+	{
+		.opt_short = 'B',
+		.opt_long = "buffers",
+		.req_arg = 1,
+		.opt_help_arg = N_("NUMBER"),
+		.opt_help = N_("Set number of driver buffers to request (def: 4)"),
+	},
+	{
+		.opt_short = 'D',
+		.opt_long = "decoder_threads",
+		.req_arg = 1,
+		.opt_help_arg = N_("NUMBER"),
+		.opt_help = N_("Set number of frame decoder threads (def: 1)"),
+	},
+	{
+		.opt_short = 'W',
+		.opt_long = "worker_threads",
+		.req_arg = 1,
+		.opt_help_arg = N_("NUMBER"),
+		.opt_help = N_("Set frame processing threads per library (def: 0 - one per cpu)"),
+	},
+	{
+		.opt_short = 'C',
+		.opt_long = "codec_threads",
+		.req_arg = 1,
+		.opt_help_arg = N_("NUMBER[:TYPE]"),
+		.opt_help = N_("Set libavcodec threads (def: 0 - one per cpu), TYPE [slice (def) | frame | all]"),
 	},
 	{
 		.opt_short = 'b',
@@ -126,6 +154,13 @@ static opt_values_t opt_values[] =
 		.opt_help_arg = N_("RENDER_WINDOW_FLAGS"),
 		.opt_help = N_("Set render window flags (e.g none; full; max)")
 	},
+	{
+		.opt_short = 'P',
+		.opt_long = "preview_scale",
+		.req_arg = 1,
+		.opt_help_arg = N_("DIVISOR"),
+		.opt_help = N_("Render a reduced size preview [1 (def) | 2 | 4 | 8]")
+	},
 	{
 		.opt_short = 'a',
 		.opt_long = "audio",
@@ -249,6 +284,11 @@ static options_t my_options =
 	.audio = "",
 	.audio_device = -1, /*use default*/
 	.capture = "",
+	.buffers = 0,
+	.decoder_threads = 0,
+	.worker_threads = -1,
+	.codec_threads = -1,
+	.codec_thread_type = CODEC_THREAD_SLICE,
 	.video_codec = "",
 	.audio_codec = "",
 	.prof_filename = NULL,
@@ -263,6 +303,7 @@ static options_t my_options =
 	.photo_npics = 0,
 	.exit_on_term = 0,
 	.render_flag = "none",
+	.preview_scale = 0,
 };
 
 /*
@@ -489,6 +530,60 @@ int options_parse(int argc, char *argv[])
 					strncpy(my_options.capture, optarg, 4);
 				break;
 			}
+			case 'B':
+				my_options.buffers = atoi(optarg);
+				if(my_options.buffers < 1)
+				{
+					fprintf(stderr, "V4L2_CORE: (options) Error in buffers usage: -B[--buffers] NUMBER (> 0) \n");
+					my_options.buffers = 0;
+				}
+				break;
+			case 'D':
+				my_options.decoder_threads = atoi(optarg);
+				if(my_options.decoder_threads < 1)
+				{
+					fprintf(stderr, "V4L2_CORE: (options) Error in decoder threads usage: -D[--decoder_threads] NUMBER (> 0) \n");
+					my_options.decoder_threads = 0;
+				}
+				break;
+			case 'W':
+				my_options.worker_threads = atoi(optarg);
+				if(my_options.worker_threads < 0)
+				{
+					fprintf(stderr, "V4L2_CORE: (options) Error in worker threads usage: -W[--worker_threads] NUMBER (>= 0) \n");
+					my_options.worker_threads = -1;
+				}
+				break;
+			case 'C':
+			{
+				int codec_threads = (int) strtol(optarg, &stopstring, 10);
+				int codec_thread_type = CODEC_THREAD_SLICE;
+				if(stopstring == optarg) /*no number*/
+					codec_threads = -1;
+				else if(*stopstring == ':')
+				{
+					++stopstring;
+					if(strcasecmp(stopstring, "slice") == 0)
+						codec_thread_type = CODEC_THREAD_SLICE;
+					else if(strcasecmp(stopstring, "frame") == 0)
+						codec_thread_type = CODEC_THREAD_FRAME;
+					else if(strcasecmp(stopstring, "all") == 0)
+						codec_thread_type = CODEC_THREAD_SLICE | CODEC_THREAD_FRAME;
+					else
+						codec_threads = -1;
+				}
+				else if(*stopstring != '\0')
+					codec_threads = -1;
+
+				if(codec_threads < 0)
+				{
+					fprintf(stderr, "V4L2_CORE: (options) Error in codec threads usage: -C[--codec_threads] NUMBER (>= 0)[:slice | frame | all] \n");
+					break;
+				}
+				my_options.codec_threads = codec_threads;
+				my_options.codec_thread_type = codec_thread_type;
+				break;
+			}
 			case 'b':
 			{
 				my_options.disable_libv4l2 = 1;
@@ -550,6 +645,27 @@ int options_parse(int argc, char *argv[])
 					strncpy(my_options.render_flag, optarg, 4);
 				break;
 			}
+			case 'P':
+				switch(atoi(optarg))
+				{
+					case 1:
+						my_options.preview_scale = 0;
+						break;
+					case 2:
+						my_options.preview_scale = 1;
+						break;
+					case 4:
+						my_options.preview_scale = 2;
+						break;
+					case 8:
+						my_options.preview_scale = 3;
+						break;
+					default:
+						fprintf(stderr, "V4L2_CORE: (options) Error in preview scale usage: -P[--preview_scale] [1 | 2 | 4 | 8] \n");
+						my_options.preview_scale = 0;
+						break;
+				}
+				break;
 			case 'g':
 			{
 				int str_size = strlen(optarg);
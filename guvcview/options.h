@@ -37,7 +37,12 @@ typedef struct _options_t
 	char gui[5];     /*gui api*/
 	char audio[6];   /*audio api - none; port; pulse*/
 	int audio_device; /*audio device index 0..N (-1 = default)*/
-	char capture[5]; /*capture method: read or mmap*/
+	char capture[5]; /*capture method: read, mmap, uptr or dmab*/
+	int buffers; /*number of driver buffers to request (0 = default)*/
+	int decoder_threads; /*number of frame decoder threads (0 = default)*/
+	int worker_threads; /*number of frame processing threads (-1 = default, 0 = one per cpu)*/
+	int codec_threads; /*number of libavcodec decoder threads (-1 = default, 0 = one per cpu)*/
+	int codec_thread_type; /*libavcodec threading (CODEC_THREAD_ flags)*/
 	char audio_codec[5]; /*audio codec*/
 	char video_codec[5]; /*video codec*/
 	char *prof_filename; /*profile_filename (if set load it on start)*/
@@ -52,6 +57,7 @@ typedef struct _options_t
 	int photo_npics; /*number of photo captures*/
 	int exit_on_term; /*flag if we should exit after video or image capture ends*/ 
 	char render_flag[5]; /*render window flag => default (none) | FULLSCREEN (full) | MAXIMIZED (max)*/
+	int preview_scale; /*preview decoding scale (0 - 1:1, 1 - 1:2, 2 - 1:4, 3 - 1:8)*/
 } options_t;
 
 /*
@@ -343,7 +343,7 @@ int check_video_timer()
  */
 void set_soft_focus(int value)
 {
-	v4l2core_soft_autofocus_set_focus();
+	v4l2core_soft_autofocus_set_focus(my_vd);
 
 	do_soft_focus = value;
 }
@@ -1010,14 +1010,20 @@ void *capture_loop(void *data)
 
 	render_set_crosshair_color(my_config->crosshair_color);
 	
+	/*reduced size preview (fx are still applied to the full size frame)*/
+	int preview_scale = v4l2core_get_decode_scale(my_vd, my_options->preview_scale);
+
 	if(render_init(
 		render,
-		v4l2core_get_frame_width(my_vd),
-		v4l2core_get_frame_height(my_vd),
+		v4l2core_get_frame_width(my_vd) >> preview_scale,
+		v4l2core_get_frame_height(my_vd) >> preview_scale,
 		render_flags) < 0)
 		render = RENDER_NONE;
 	else
 	{
+		render_set_fx_frame_size(
+			v4l2core_get_frame_width(my_vd),
+			v4l2core_get_frame_height(my_vd));
 		render_set_event_callback(EV_QUIT, &quit_callback, NULL);
 		render_set_event_callback(EV_KEY_V, &key_V_callback, NULL);
 		render_set_event_callback(EV_KEY_I, &key_I_callback, NULL);
@@ -1098,14 +1104,19 @@ void *capture_loop(void *data)
 				render_close();
 
 				/*restart the render with new format*/
+				preview_scale = v4l2core_get_decode_scale(my_vd, my_options->preview_scale);
+
 				if(render_init(
 					render,
-					v4l2core_get_frame_width(my_vd),
-					v4l2core_get_frame_height(my_vd),
+					v4l2core_get_frame_width(my_vd) >> preview_scale,
+					v4l2core_get_frame_height(my_vd) >> preview_scale,
 					render_flags) < 0)
 					render = RENDER_NONE;
 				else
 				{
+					render_set_fx_frame_size(
+						v4l2core_get_frame_width(my_vd),
+						v4l2core_get_frame_height(my_vd));
 					render_set_event_callback(EV_QUIT, &quit_callback, NULL);
 					render_set_event_callback(EV_KEY_V, &key_V_callback, NULL);
 					render_set_event_callback(EV_KEY_I, &key_I_callback, NULL);
@@ -1126,8 +1137,16 @@ void *capture_loop(void *data)
 
 		}
 
-		/*get the frame from v4l2 core*/
-		frame = v4l2core_get_decoded_frame(my_vd);
+		/*
+		 * get the frame from v4l2 core
+		 * with decoder threads frames are decoded ahead (pipelined)
+		 * otherwise they are only decoded if a consumer needs the yuv data
+		 * (v4l2core_frame_get_yuv), e.g. not for raw video without render
+		 */
+		if(my_options->decoder_threads > 1)
+			frame = v4l2core_get_decoded_frame(my_vd);
+		else
+			frame = v4l2core_get_frame(my_vd);
 		if( frame != NULL)
 		{
 			/*run software autofocus (must be called after frame was grabbed and decoded)*/
@@ -1138,7 +1157,8 @@ void *capture_loop(void *data)
 			 * do it before saving the frame
 			 * (we want to store the effects)
 			 */
-			render_frame_fx(frame->yuv_frame, my_render_mask);
+			if(my_render_mask != REND_FX_YUV_NOFILT)
+				render_frame_fx(v4l2core_frame_get_yuv_writable(frame), my_render_mask);
 
 			/*check the timers*/
 			if(check_photo_timer())
@@ -1212,15 +1232,15 @@ void *capture_loop(void *data)
 			/*save the frame (video)*/
 			if(video_capture_get_save_video())
 			{
-				int size = (frame->width * frame->height * 3) / 2;
-
-				uint8_t *input_frame = frame->yuv_frame;
 				/*
 				 * TODO: check codec_id, format and frame flags
 				 * (we may want to store a compressed format
 				 */
-				if(get_video_codec_ind() == 0) //raw frame
+				if(get_video_codec_ind() == 0) //raw frame (no decoding needed)
 				{
+					uint8_t *input_frame = NULL;
+					int size = 0;
+
 					switch(v4l2core_get_requested_frame_format(my_vd))
 					{
 						case  V4L2_PIX_FMT_H264:
@@ -1233,9 +1253,25 @@ void *capture_loop(void *data)
 							break;
 					}
 
+					/*add the frame to the encoder buffer*/
+					if(input_frame != NULL && size > 0)
+						encoder_add_video_frame(input_frame, size, frame->timestamp, frame->isKeyframe);
+				}
+				else
+				{
+					/*
+					 * add the frame planes to the encoder buffer
+					 * (passthrough yv12 and nv12 frames are not converted)
+					 */
+					uint8_t *planes[3];
+					int linesize[3];
+					int i = 0;
+					for(i = 0; i < 3; ++i)
+						planes[i] = v4l2core_frame_get_yuv_plane(frame, i, &linesize[i]);
+
+					encoder_add_video_planes(planes, linesize, frame->yuv_format,
+						frame->timestamp, frame->isKeyframe);
 				}
-				/*add the frame to the encoder buffer*/
-				encoder_add_video_frame(input_frame, size, frame->timestamp, frame->isKeyframe);
 
 				/*
 				 * exponencial scheduler
@@ -1265,23 +1301,58 @@ void *capture_loop(void *data)
 				}
 			}
 
-			/* render the osd
-			 * must be done after saving the frame 
-			 * (we don't want to record the osd effects)
-			 */
-			render_frame_osd(frame->yuv_frame);
+			if(render != RENDER_NONE)
+			{
+				/* reduced size preview
+				 * (mjpeg frames not needed at full size are only
+				 *  decoded at the reduced size)
+				 */
+				uint8_t *preview_frame = NULL;
+				if(preview_scale > 0)
+					preview_frame = v4l2core_frame_get_yuv_scaled(frame, preview_scale, NULL, NULL);
 
-			/* finally render the frame */
-			snprintf(render_caption, 29, "Guvcview  (%2.2f fps)", 
-				v4l2core_get_realfps(my_vd));
-			render_set_caption(render_caption);
-			render_frame(frame->yuv_frame);
+				/* render the osd
+				 * must be done after saving the frame 
+				 * (we don't want to record the osd effects)
+				 */
+				if(render_get_osd_mask() != REND_OSD_NONE)
+				{
+					if(preview_scale > 0)
+					{
+						if(preview_frame != NULL)
+							render_frame_osd(preview_frame);
+					}
+					else
+						render_frame_osd(v4l2core_frame_get_yuv_writable(frame));
+				}
+
+				/* finally render the frame */
+				snprintf(render_caption, 29, "Guvcview  (%2.2f fps)", 
+					v4l2core_get_realfps(my_vd));
+				render_set_caption(render_caption);
+				if(preview_scale > 0)
+				{
+					if(preview_frame != NULL)
+						render_frame(preview_frame);
+				}
+				else
+					render_frame(v4l2core_frame_get_yuv_packed(frame));
+			}
 
 			/*we are done with the frame buffer release it*/
 			v4l2core_release_frame(my_vd, frame);
 		}
 	}
 
+	if(debug_level > 0)
+	{
+		v4l2_stream_stats_t stats;
+		v4l2core_get_stream_stats(my_vd, &stats);
+		printf("GUVCVIEW: stream stats: %"PRIu64" frames (dropped: %"PRIu64" late: %"PRIu64" duplicate: %"PRIu64") %s timestamps\n",
+			stats.frames, stats.dropped, stats.late, stats.duplicate,
+			stats.driver_timestamps ? "driver" : "system");
+	}
+
 	v4l2core_stop_stream(my_vd);
 	
 	/*if we are still saving video then stop it*/
@@ -49,6 +49,7 @@
 #include "encoder.h"
 #include "stream_io.h"
 #include "gview.h"
+#include "thread_pool.h"
 
 #if LIBAVUTIL_VER_AT_LEAST(52,2)
 #include <libavutil/channel_layout.h>
@@ -68,6 +69,8 @@ static int64_t last_audio_pts = 0;
 static int64_t reference_pts  = 0;
 
 static int video_frame_max_size = 0;
+static int video_frame_width = 0;
+static int video_frame_height = 0;
 
 static int video_ring_buffer_size = 0;
 static video_buffer_t *video_ring_buffer = NULL;
@@ -75,6 +78,8 @@ static int video_read_index = 0;
 static int video_write_index = 0;
 static int video_scheduler = 0;
 
+static int encode_video_frame(encoder_context_t *encoder_ctx, void *input_frame, uint32_t format);
+
 /*
  * set verbosity
  * args:
@@ -90,6 +95,26 @@ void encoder_set_verbosity(int value)
 	verbosity = value;
 }
 
+/*
+ * set the number of threads used for frame processing
+ *  (large frame copies are split in blocks processed by a
+ *   thread pool private to the encoder library, the calling thread
+ *   included - each gview library has its own pool)
+ *  must not be called while a frame is being processed
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - no worker threads)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void encoder_set_worker_threads(int nthreads)
+{
+	thread_pool_set_threads(nthreads);
+}
+
 /*
  * allocate video ring buffer
  * args:
@@ -121,6 +146,9 @@ static void encoder_alloc_video_ring_buffer(
 		exit(-1);
 	}
 
+	video_frame_width = video_width;
+	video_frame_height = video_height;
+
 	if(codec_ind > 0)
 		video_frame_max_size = (video_width * video_height * 3) / 2;
 	else
@@ -1065,6 +1093,14 @@ encoder_context_t *encoder_init(
 	encoder_ctx->video_width = video_width;
 	encoder_ctx->video_height = video_height;
 
+	/*tightly packed yu12 input*/
+	encoder_ctx->video_linesize[0] = video_width;
+	encoder_ctx->video_linesize[1] = video_width / 2;
+	encoder_ctx->video_linesize[2] = video_width / 2;
+	encoder_ctx->video_offset[0] = 0;
+	encoder_ctx->video_offset[1] = video_width * video_height;
+	encoder_ctx->video_offset[2] = encoder_ctx->video_offset[1] + ((video_width * video_height) / 4);
+
 	encoder_ctx->fps_num = fps_num;
 	encoder_ctx->fps_den = fps_den;
 
@@ -1091,6 +1127,99 @@ encoder_context_t *encoder_init(
 	return encoder_ctx;
 }
 
+/*
+ * set the plane layout of the yu12 input frames (e.g. frames
+ *  decoded with aligned line sizes - v4l2core_set_frame_alignment)
+ *  must be called before adding the first video frame
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *   linesize - line sizes of the y, u and v planes (bytes)
+ *   offset - offsets of the y, u and v planes (bytes)
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *   linesize is not null
+ *   offset is not null
+ *
+ * returns: none
+ */
+void encoder_set_video_frame_layout(encoder_context_t *encoder_ctx,
+	const int linesize[3], const int offset[3])
+{
+	/*assertions*/
+	assert(encoder_ctx != NULL);
+	assert(linesize != NULL);
+	assert(offset != NULL);
+
+	int i = 0;
+	for(i = 0; i < 3; ++i)
+	{
+		encoder_ctx->video_linesize[i] = linesize[i];
+		encoder_ctx->video_offset[i] = offset[i];
+	}
+
+	/*raw input (no software encoding) is stored as is*/
+	if(encoder_ctx->video_codec_ind == 0 || !video_ring_buffer)
+		return;
+
+	int frame_size = offset[2] + (linesize[2] * ((encoder_ctx->video_height + 1) / 2));
+	if(frame_size <= video_frame_max_size)
+		return;
+
+	/*grow the (still empty) ring buffer frames*/
+	video_frame_max_size = frame_size;
+	for(i = 0; i < video_ring_buffer_size; ++i)
+	{
+		free(video_ring_buffer[i].frame);
+		video_ring_buffer[i].frame = calloc(video_frame_max_size, sizeof(uint8_t));
+		if(video_ring_buffer[i].frame == NULL)
+		{
+			fprintf(stderr, "ENCODER: FATAL memory allocation failure (encoder_set_video_frame_layout): %s\n", strerror(errno));
+			exit(-1);
+		}
+	}
+}
+
+/*
+ * frame copy job (blocks are copied with parallel_for_rows)
+ */
+typedef struct _frame_copy_job_t
+{
+	uint8_t *dst;
+	uint8_t *src;
+	int size;
+} frame_copy_job_t;
+
+/*frame copy block size and minimum number of blocks per thread pool band*/
+#define FRAME_COPY_BLOCK (64 * 1024)
+#define FRAME_COPY_MIN_BLOCKS (16)
+/*minimum number of rows per thread pool band for plane copies*/
+#define FRAME_COPY_MIN_ROWS (64)
+
+/*
+ * copy a range of frame blocks
+ * args:
+ *   data - pointer to copy job (frame_copy_job_t)
+ *   block_start - first block
+ *   block_end - last block (not included)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void frame_copy_blocks(void *data, int block_start, int block_end)
+{
+	frame_copy_job_t *job = (frame_copy_job_t *) data;
+
+	int start = block_start * FRAME_COPY_BLOCK;
+	int end = block_end * FRAME_COPY_BLOCK;
+	if(end > job->size)
+		end = job->size;
+
+	memcpy(job->dst + start, job->src + start, end - start);
+}
+
 /*
  * store unprocessed input video frame in video ring buffer
  * args:
@@ -1136,10 +1265,161 @@ int encoder_add_video_frame(uint8_t *frame, int size, int64_t timestamp, int isK
 
 		size = video_frame_max_size;
 	}
-	memcpy(video_ring_buffer[video_write_index].frame, frame, size);
+	/*large (raw) frames are copied in parallel blocks*/
+	frame_copy_job_t job;
+	job.dst = video_ring_buffer[video_write_index].frame;
+	job.src = frame;
+	job.size = size;
+	parallel_for_rows((size + FRAME_COPY_BLOCK - 1) / FRAME_COPY_BLOCK, 1,
+		FRAME_COPY_MIN_BLOCKS, frame_copy_blocks, &job);
+
+	video_ring_buffer[video_write_index].frame_size = size;
+	video_ring_buffer[video_write_index].timestamp = pts;
+	video_ring_buffer[video_write_index].keyframe = isKeyframe;
+	video_ring_buffer[video_write_index].format = 0; /*encoder frame layout*/
+
+	__LOCK_MUTEX( __PMUTEX );
+	video_ring_buffer[video_write_index].flag = VIDEO_BUFF_USED;
+	NEXT_IND(video_write_index, video_ring_buffer_size);
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	return 0;
+}
+
+/*
+ * plane copy job (luma row bands with the matching chroma rows)
+ */
+typedef struct _plane_copy_job_t
+{
+	uint8_t *out[3];   //packed output planes
+	uint8_t *in[3];    //input planes
+	int linesize[3];   //input line sizes (bytes)
+	int width[3];      //plane line widths (bytes)
+	int nplanes;       //number of planes
+} plane_copy_job_t;
+
+/*
+ * copy a range of frame rows
+ * args:
+ *   data - pointer to copy job (plane_copy_job_t)
+ *   row_start - first luma row (even)
+ *   row_end - last luma row (not included)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void plane_copy_rows(void *data, int row_start, int row_end)
+{
+	plane_copy_job_t *job = (plane_copy_job_t *) data;
+
+	int p = 0;
+	for(p = 0; p < job->nplanes; ++p)
+	{
+		int start = p ? row_start / 2 : row_start;
+		int end = p ? row_end / 2 : row_end;
+
+		int h = 0;
+		for(h = start; h < end; ++h)
+			memcpy(job->out[p] + (h * job->width[p]),
+				job->in[p] + (h * job->linesize[p]), job->width[p]);
+	}
+}
+
+/*
+ * store unprocessed input video planes in video ring buffer
+ *  (e.g. frames passed through from the driver buffer, no conversion
+ *   is done until the frame is encoded)
+ * args:
+ *   planes - pointers to the y, u and v planes (y and uv for nv12)
+ *   linesize - plane line sizes (bytes)
+ *   format - planes pixel format (V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12)
+ *   timestamp - frame timestamp (in nanosec)
+ *   isKeyframe - flag if it's a key(IDR) frame
+ *
+ * asserts:
+ *   planes is not null
+ *   linesize is not null
+ *
+ * returns: error code
+ */
+int encoder_add_video_planes(uint8_t * const planes[3], const int linesize[3],
+	uint32_t format, int64_t timestamp, int isKeyframe)
+{
+	/*assertions*/
+	assert(planes != NULL);
+	assert(linesize != NULL);
+
+	if(!video_ring_buffer || !video_frame_width)
+		return -1;
+
+	if(format != V4L2_PIX_FMT_YUV420 && format != V4L2_PIX_FMT_NV12)
+	{
+		fprintf(stderr, "ENCODER: unsupported video planes format (%x)\n", format);
+		return -1;
+	}
+
+	int width = video_frame_width;
+	int height = video_frame_height;
+	int size = (width * height * 3) / 2;
+
+	if(size > video_frame_max_size)
+	{
+		fprintf(stderr, "ENCODER: frame (%i bytes) larger than buffer (%i bytes): dropping\n",
+			size, video_frame_max_size);
+		return -1;
+	}
+
+	if (reference_pts == 0)
+	{
+		reference_pts = timestamp; /*first frame ts*/
+		if(verbosity > 0)
+			printf("ENCODER: ref ts = %" PRId64 "\n", timestamp);
+	}
+
+	int64_t pts = timestamp - reference_pts;
+
+	__LOCK_MUTEX( __PMUTEX );
+	int flag = video_ring_buffer[video_write_index].flag;
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	if(flag != VIDEO_BUFF_FREE)
+	{
+		fprintf(stderr, "ENCODER: video ring buffer full - dropping frame\n");
+		return -1;
+	}
+
+	/*store the planes packed (in the input format)*/
+	plane_copy_job_t job;
+	uint8_t *frame = video_ring_buffer[video_write_index].frame;
+	job.out[0] = frame;
+	job.out[1] = frame + (width * height);
+	job.in[0] = planes[0];
+	job.in[1] = planes[1];
+	job.linesize[0] = linesize[0];
+	job.linesize[1] = linesize[1];
+	job.width[0] = width;
+	if(format == V4L2_PIX_FMT_NV12)
+	{
+		job.width[1] = width; /*interleaved uv*/
+		job.nplanes = 2;
+	}
+	else
+	{
+		job.width[1] = width / 2;
+		job.out[2] = job.out[1] + ((width * height) / 4);
+		job.in[2] = planes[2];
+		job.linesize[2] = linesize[2];
+		job.width[2] = width / 2;
+		job.nplanes = 3;
+	}
+	parallel_for_rows(height, 2, FRAME_COPY_MIN_ROWS, plane_copy_rows, &job);
+
 	video_ring_buffer[video_write_index].frame_size = size;
 	video_ring_buffer[video_write_index].timestamp = pts;
 	video_ring_buffer[video_write_index].keyframe = isKeyframe;
+	video_ring_buffer[video_write_index].format = format;
 
 	__LOCK_MUTEX( __PMUTEX );
 	video_ring_buffer[video_write_index].flag = VIDEO_BUFF_USED;
@@ -1185,7 +1465,8 @@ int encoder_process_next_video_buffer(encoder_context_t *encoder_ctx)
 			encoder_ctx->enc_video_ctx->flags |= AV_PKT_FLAG_KEY;
 	}
 
-	encoder_encode_video(encoder_ctx, video_ring_buffer[video_read_index].frame);
+	encode_video_frame(encoder_ctx, video_ring_buffer[video_read_index].frame,
+		video_ring_buffer[video_read_index].format);
 
 	/*mux the frame*/
 	__LOCK_MUTEX( __PMUTEX );
@@ -1413,13 +1694,15 @@ static int read_video_df_pts(encoder_video_context_t *enc_video_ctx)
  * args:
  *   encoder_ctx - pointer to encoder context
  *   input_frame - pointer to frame data
+ *   format - frame format (0 - encoder frame layout,
+ *            V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12 - packed planes)
  *
  * asserts:
  *   encoder_ctx is not null
  *
  * returns: encoded buffer size
  */
-int encoder_encode_video(encoder_context_t *encoder_ctx, void *input_frame)
+static int encode_video_frame(encoder_context_t *encoder_ctx, void *input_frame, uint32_t format)
 {
 	/*assertions*/
 	assert(encoder_ctx != NULL);
@@ -1474,7 +1757,37 @@ int encoder_encode_video(encoder_context_t *encoder_ctx, void *input_frame)
 	encoder_codec_data_t *video_codec_data = (encoder_codec_data_t *) enc_video_ctx->codec_data;
 
 	if(input_frame != NULL)
-		prepare_video_frame(video_codec_data, input_frame, encoder_ctx->video_width, encoder_ctx->video_height);
+	{
+		uint8_t *planes[3];
+		int linesize[3];
+		int width = encoder_ctx->video_width;
+		int height = encoder_ctx->video_height;
+		uint8_t *frame = (uint8_t *) input_frame;
+
+		if(format == 0)
+		{
+			/*yu12 in the encoder frame layout*/
+			int i = 0;
+			for(i = 0; i < 3; ++i)
+			{
+				planes[i] = frame + encoder_ctx->video_offset[i];
+				linesize[i] = encoder_ctx->video_linesize[i];
+			}
+			format = V4L2_PIX_FMT_YUV420;
+		}
+		else
+		{
+			/*packed planes (encoder_add_video_planes)*/
+			planes[0] = frame;
+			linesize[0] = width;
+			planes[1] = frame + (width * height);
+			linesize[1] = (format == V4L2_PIX_FMT_NV12) ? width : width / 2;
+			planes[2] = planes[1] + ((width * height) / 4);
+			linesize[2] = width / 2;
+		}
+
+		prepare_video_frame(video_codec_data, planes, linesize, format, width, height);
+	}
 
 	if(!enc_video_ctx->monotonic_pts) //generate a real pts based on the frame timestamp
 	{
@@ -1564,6 +1877,22 @@ int encoder_encode_video(encoder_context_t *encoder_ctx, void *input_frame)
 #endif
 }
 
+/*
+ * encode video frame
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *   input_frame - pointer to frame data
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *
+ * returns: encoded buffer size
+ */
+int encoder_encode_video(encoder_context_t *encoder_ctx, void *input_frame)
+{
+	return encode_video_frame(encoder_ctx, input_frame, 0);
+}
+
 /*
  * encode audio
  * args:
@@ -1744,6 +2073,9 @@ void encoder_close(encoder_context_t *encoder_ctx)
 {
 	encoder_clean_video_ring_buffer();
 
+	/*stop the frame copy worker threads*/
+	thread_pool_close();
+
 	if(!encoder_ctx)
 		return;
 
@@ -1784,6 +2116,7 @@ void encoder_close(encoder_context_t *encoder_ctx)
 				av_freep(&video_codec_data->frame);
 	#endif
 #endif
+			free(video_codec_data->chroma_buffer);
 			free(video_codec_data);		
 		}
 
@@ -1837,6 +2170,8 @@ void encoder_close(encoder_context_t *encoder_ctx)
 	reference_pts  = 0;
 
 	video_frame_max_size = 0;
+	video_frame_width = 0;
+	video_frame_height = 0;
 
 	video_ring_buffer_size = 0;
 	video_ring_buffer = NULL;
@@ -166,6 +166,8 @@ typedef struct _encoder_codec_data_t
 	AVCodecContext *codec_context;
 	AVFrame *frame;
 	AVPacket *outpkt;
+	uint8_t *chroma_buffer;  //split chroma planes (nv12 input)
+	int chroma_buffer_size;  //chroma buffer size (bytes)
 } encoder_codec_data_t;
 
 typedef struct _bmp_info_header_t
@@ -217,20 +219,26 @@ int avpriv_split_xiph_headers(
         int header_len[3]);
 	
 /*
- * set yu12 frame in codec data frame
+ * set yu12 (or nv12) planes in codec data frame
+ *  yu12 planes are used directly, nv12 chroma is
+ *  split to the codec data chroma buffer
  * args:
  *    video_codec_data - pointer to video codec data
- *    inp - input data (yu12)
+ *    planes - pointers to the y, u and v planes (y and uv for nv12)
+ *    linesize - plane line sizes (bytes)
+ *    format - planes pixel format (V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12)
  *    width - frame width
  *    height - frame height 
  *
  * asserts:
  *    video_codec_data is not null
- *    inp is not null
+ *    planes is not null
+ *    linesize is not null
  *
  * returns: none
  */
-void prepare_video_frame(encoder_codec_data_t *encoder_ctx, uint8_t *inp, int width, int height);
+void prepare_video_frame(encoder_codec_data_t *encoder_ctx, uint8_t * const planes[3],
+	const int linesize[3], uint32_t format, int width, int height);
 
 
 /*
@@ -71,6 +71,7 @@ typedef struct _video_buffer_t
 	int64_t timestamp;
 	int keyframe;  /* 1-keyframe; 0-non keyframe (only for direct input)*/
 	int flag;      /*VIDEO_BUFF_FREE | VIDEO_BUFF_USED*/
+	uint32_t format; /*0 - encoder frame layout; V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12 - packed planes*/
 } video_buffer_t;
 
 /*video codec properties*/
@@ -202,6 +203,8 @@ typedef struct _encoder_context_t
 
 	int video_width;
 	int video_height;
+	int video_linesize[3]; //line sizes of the yu12 input planes (bytes)
+	int video_offset[3];   //offsets of the yu12 input planes (bytes)
 
 	int fps_num;
 	int fps_den;
@@ -232,6 +235,23 @@ typedef struct _encoder_context_t
  */
 void encoder_set_verbosity(int value);
 
+/*
+ * set the number of threads used for frame processing
+ *  (large frame copies are split in blocks processed by a
+ *   thread pool private to the encoder library, the calling thread
+ *   included - each gview library has its own pool)
+ *  must not be called while a frame is being processed
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - no worker threads)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void encoder_set_worker_threads(int nthreads);
+
 /*
  * get valid video codec count
  * args:
@@ -336,6 +356,25 @@ encoder_context_t *encoder_init(
 	int audio_channels,
 	int audio_samprate);
 
+/*
+ * set the plane layout of the yu12 input frames (e.g. frames
+ *  decoded with aligned line sizes - v4l2core_set_frame_alignment)
+ *  must be called before adding the first video frame
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *   linesize - line sizes of the y, u and v planes (bytes)
+ *   offset - offsets of the y, u and v planes (bytes)
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *   linesize is not null
+ *   offset is not null
+ *
+ * returns: none
+ */
+void encoder_set_video_frame_layout(encoder_context_t *encoder_ctx,
+	const int linesize[3], const int offset[3]);
+
 /*
  * initialization of the file muxer
  * args:
@@ -593,6 +632,26 @@ double encoder_buff_scheduler(int mode, double thresh, double max_time);
  */
 int encoder_add_video_frame(uint8_t *frame, int size, int64_t timestamp, int isKeyframe);
 
+/*
+ * store unprocessed input video planes in video ring buffer
+ *  (e.g. frames passed through from the driver buffer, no conversion
+ *   is done until the frame is encoded)
+ * args:
+ *   planes - pointers to the y, u and v planes (y and uv for nv12)
+ *   linesize - plane line sizes (bytes)
+ *   format - planes pixel format (V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12)
+ *   timestamp - frame timestamp (in nanosec)
+ *   isKeyframe - flag if it's a key(IDR) frame
+ *
+ * asserts:
+ *   planes is not null
+ *   linesize is not null
+ *
+ * returns: error code
+ */
+int encoder_add_video_planes(uint8_t * const planes[3], const int linesize[3],
+	uint32_t format, int64_t timestamp, int isKeyframe);
+
 /*
  * process next video frame on the ring buffer (encode and mux to file)
  * args:
@@ -29,6 +29,7 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <linux/videodev2.h>
 /* support for internationalization - i18n */
 #include <locale.h>
 #include <libintl.h>
@@ -42,37 +43,84 @@
 
 
 /*
- * set yu12 frame in codec data frame
+ * set yu12 (or nv12) planes in codec data frame
+ *  yu12 planes are used directly, nv12 chroma is
+ *  split to the codec data chroma buffer
  * args:
  *    video_codec_data - pointer to video codec data
- *    inp - input data (yu12)
+ *    planes - pointers to the y, u and v planes (y and uv for nv12)
+ *    linesize - plane line sizes (bytes)
+ *    format - planes pixel format (V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12)
  *    width - frame width
  *    height - frame height 
  *
  * asserts:
  *    video_codec_data is not null
- *    inp is not null
+ *    planes is not null
+ *    linesize is not null
  *
  * returns: none
  */
-void prepare_video_frame(encoder_codec_data_t *video_codec_data, uint8_t *inp, int width, int height)
+void prepare_video_frame(encoder_codec_data_t *video_codec_data, uint8_t * const planes[3],
+	const int linesize[3], uint32_t format, int width, int height)
 {
 	/*assertions*/
 	assert(video_codec_data);
-	assert(inp);
-
-	int size = width * height;
+	assert(planes);
+	assert(linesize);
 
 	video_codec_data->frame->format = AV_PIX_FMT_YUV420P;
 	video_codec_data->frame->width = width;
 	video_codec_data->frame->height = height;
 	
-	video_codec_data->frame->data[0] = inp; //Y
-	video_codec_data->frame->data[1] = inp + size; //U
-	video_codec_data->frame->data[2] = video_codec_data->frame->data[1] + size/4; //V
-	video_codec_data->frame->linesize[0] = width;
-	video_codec_data->frame->linesize[1] = width / 2;
-	video_codec_data->frame->linesize[2] = width / 2;
+	video_codec_data->frame->data[0] = planes[0]; //Y
+	video_codec_data->frame->linesize[0] = linesize[0];
+
+	if(format != V4L2_PIX_FMT_NV12)
+	{
+		video_codec_data->frame->data[1] = planes[1]; //U
+		video_codec_data->frame->data[2] = planes[2]; //V
+		video_codec_data->frame->linesize[1] = linesize[1];
+		video_codec_data->frame->linesize[2] = linesize[2];
+		return;
+	}
+
+	/*split the interleaved nv12 chroma (the codec input is yuv420p)*/
+	int chroma_width = width / 2;
+	int chroma_height = height / 2;
+	int chroma_size = chroma_width * chroma_height;
+
+	if(video_codec_data->chroma_buffer_size < chroma_size * 2)
+	{
+		free(video_codec_data->chroma_buffer);
+		video_codec_data->chroma_buffer_size = chroma_size * 2;
+		video_codec_data->chroma_buffer = calloc(video_codec_data->chroma_buffer_size, sizeof(uint8_t));
+		if(video_codec_data->chroma_buffer == NULL)
+		{
+			fprintf(stderr, "ENCODER: FATAL memory allocation failure (prepare_video_frame): %s\n", strerror(errno));
+			exit(-1);
+		}
+	}
+
+	uint8_t *pu = video_codec_data->chroma_buffer;
+	uint8_t *pv = pu + chroma_size;
+
+	int h = 0;
+	for(h = 0; h < chroma_height; ++h)
+	{
+		uint8_t *puv = planes[1] + (h * linesize[1]);
+		int w = 0;
+		for(w = 0; w < chroma_width; ++w)
+		{
+			*pu++ = *puv++;
+			*pv++ = *puv++;
+		}
+	}
+
+	video_codec_data->frame->data[1] = video_codec_data->chroma_buffer; //U
+	video_codec_data->frame->data[2] = video_codec_data->chroma_buffer + chroma_size; //V
+	video_codec_data->frame->linesize[1] = chroma_width;
+	video_codec_data->frame->linesize[2] = chroma_width;
 }
 
 /*
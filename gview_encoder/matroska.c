@@ -669,60 +669,21 @@ int mkv_write_header(mkv_context_t *mkv_ctx)
     return 0;
 }
 
-static int mkv_processh264_nalu(uint8_t *data, int size)
+static int mkv_processh264_nalu(mkv_context_t* mkv_ctx, uint8_t *data, int size)
 {
 	/*replace 00 00 00 01 (nalu marker) with nalu size*/
-	int last_nalu = 0; /*marks last nalu in buffer*/
-	int tot_nal = 0;
-	uint8_t *nal_start = data;
-	uint8_t *sp = data;
-	uint8_t *ep = NULL;
-	uint32_t nal_size = 0;
-
-	while (!last_nalu)
-	{
-		nal_size = 0;
-
-		/*search for NALU marker*/
-		for(sp = nal_start; sp < data + size - 4; ++sp)
-		{
-			if(sp[0] == 0x00 &&
-			   sp[1] == 0x00 &&
-			   sp[2] == 0x00 &&
-			   sp[3] == 0x01)
-			{
-				nal_start = sp + 4;
-				break;
-			}
-		}
-
-		/*search for end of NALU*/
-		for(ep = nal_start; ep < data + size - 4; ++ep)
-		{
-			if(ep[0] == 0x00 &&
-			   ep[1] == 0x00 &&
-			   ep[2] == 0x00 &&
-			   ep[3] == 0x01)
-			{
-				nal_size = ep - nal_start;
-				nal_start = ep;/*reset for next NALU*/
-				break;
-			}
-		}
+	int tot_nal = h264_nal_index_build(&mkv_ctx->h264_nals, data, size);
 
-		if(!nal_size)
-		{
-			last_nalu = 1;
-			nal_size = data + size - nal_start;
-		}
+	int i = 0;
+	for(i = 0; i < tot_nal; ++i)
+	{
+		uint8_t *sp = data + mkv_ctx->h264_nals.nal[i].offset - 4;
+		uint32_t nal_size = (uint32_t) mkv_ctx->h264_nals.nal[i].size;
 
 		sp[0] = (nal_size >> 24) & 0x000000FF;
 		sp[1] = (nal_size >> 16) & 0x000000FF;
 		sp[2] = (nal_size >> 8) & 0x000000FF;
 		sp[3] = (nal_size) & 0x000000FF;
-
-		tot_nal++;
-
 	}
 
 	return tot_nal;
@@ -749,7 +710,7 @@ static void mkv_write_block(mkv_context_t* mkv_ctx,
 {
 	stream_io_t *stream = get_stream(mkv_ctx->stream_list, stream_index);
 	if(stream->codec_id == AV_CODEC_ID_H264 && stream->h264_process)
-		mkv_processh264_nalu(data, size);
+		mkv_processh264_nalu(mkv_ctx, data, size);
 
 	uint8_t block_flags = 0x00;
 
@@ -1064,6 +1025,7 @@ void mkv_destroy_context(mkv_context_t *mkv_ctx)
 	mkv_ctx->pkt_buffer_list = NULL;
 	mkv_ctx->pkt_buffer_list_size = 0;
 
+	h264_nal_index_free(&mkv_ctx->h264_nals);
 }
 
 stream_io_t *mkv_add_video_stream(mkv_context_t *mkv_ctx,
@@ -30,6 +30,7 @@
 
 #include "stream_io.h"
 #include "file_io.h"
+#include "h264_nal.h"
 
 /* EBML version supported */
 #define EBML_VERSION 1
@@ -298,6 +299,8 @@ typedef struct mkv_context_t
 	
     stream_io_t   *stream_list;
     int stream_list_size;
+
+	h264_nal_index_t h264_nals; /*NAL unit index of the current h264 packet (reused)*/
 } mkv_context_t;
 
 
@@ -88,6 +88,23 @@ typedef struct _render_events_t
  */
 void render_set_verbosity(int value);
 
+/*
+ * set the number of threads used for frame processing
+ *  (fx filters are split in row bands processed by a
+ *   thread pool private to the render library, the calling thread
+ *   included - each gview library has its own pool)
+ *  must not be called while a frame is being processed
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - no worker threads)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void render_set_worker_threads(int nthreads);
+
 /*
  * set the osd mask
  * args:
@@ -160,6 +177,21 @@ int render_get_width();
  */
 int render_get_height();
 
+/*
+ * set the size of the frames passed to render_frame_fx
+ *  (defaults to the render size, set it after render_init
+ *   when rendering a reduced size preview of the frame)
+ * args:
+ *   width - frame width
+ *   height - frame height
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void render_set_fx_frame_size(int width, int height);
+
 /*
  * render initialization
  * args:
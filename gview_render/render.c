@@ -43,6 +43,7 @@
 
 #include "gviewrender.h"
 #include "render.h"
+#include "thread_pool.h"
 #include "../config.h"
 
 #if ENABLE_SDL2
@@ -59,6 +60,10 @@ static int render_api = RENDER_SDL;
 static int my_width = 0;
 static int my_height = 0;
 
+/*fx frame size (differs from the render size with reduced size preview)*/
+static int fx_width = 0;
+static int fx_height = 0;
+
 static uint32_t my_osd_mask = REND_OSD_NONE;
 static uint32_t my_crosshair_color_rgb = 0x0000FF00;
 
@@ -129,6 +134,26 @@ void render_set_verbosity(int value)
 	verbosity = value;
 }
 
+/*
+ * set the number of threads used for frame processing
+ *  (fx filters are split in row bands processed by a
+ *   thread pool private to the render library, the calling thread
+ *   included - each gview library has its own pool)
+ *  must not be called while a frame is being processed
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - no worker threads)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void render_set_worker_threads(int nthreads)
+{
+	thread_pool_set_threads(nthreads);
+}
+
 /*
  * set the osd mask
  * args:
@@ -251,6 +276,25 @@ int render_get_height()
 	return my_height;
 }
 
+/*
+ * set the size of the frames passed to render_frame_fx
+ *  (defaults to the render size, set it after render_init
+ *   when rendering a reduced size preview of the frame)
+ * args:
+ *   width - frame width
+ *   height - frame height
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void render_set_fx_frame_size(int width, int height)
+{
+	fx_width = width;
+	fx_height = height;
+}
+
 /*
  * render initialization
  * args:
@@ -275,6 +319,8 @@ int render_init(int render, int width, int height, int flags)
 	render_api = render;
 	my_width = width;
 	my_height = height;
+	fx_width = width;
+	fx_height = height;
 
 	switch(render_api)
 	{
@@ -313,7 +359,7 @@ void render_frame_fx(uint8_t *frame, uint32_t mask)
 	/*asserts*/
 	assert(frame != NULL);
 
-	render_fx_apply(frame, my_width, my_height, mask);
+	render_fx_apply(frame, fx_width, fx_height, mask);
 }
 
 /*
@@ -436,6 +482,11 @@ void render_close()
 
 	my_width = 0;
 	my_height = 0;
+	fx_width = 0;
+	fx_height = 0;
+
+	/*stop the fx worker threads*/
+	thread_pool_close();
 }
 
 /*
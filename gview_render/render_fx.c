@@ -29,6 +29,7 @@
 
 #include "gviewrender.h"
 #include "gview.h"
+#include "thread_pool.h"
 #include "../config.h"
 
 /*random generator (HAS_GSL is set in ../config.h)*/
@@ -50,6 +51,19 @@ typedef struct _particle_t
 
 static particle_t *particles = NULL;
 
+/*
+ * fx filter job (row bands are processed with parallel_for_rows)
+ */
+typedef struct _fx_job_t
+{
+	uint8_t *frame;
+	int width;
+	int height;
+} fx_job_t;
+
+/*minimum number of rows per thread pool band*/
+#define FX_MIN_ROWS (64)
+
 /*
  * Flip YUYV frame - horizontal
  * args:
@@ -87,26 +101,27 @@ static void fx_yuyv_mirror (uint8_t *frame, int width, int height)
 }
 
 /*
- * Flip yu12 frame - horizontal
+ * Flip a band of yu12 rows - horizontal
  * args:
- *    frame - pointer to frame buffer (yu12=iyuv format)
- *    width - frame width
- *    height- frame height
+ *    data - pointer to fx job (fx_job_t)
+ *    row_start - first row of the band (even)
+ *    row_end - last row of the band (not included)
  *
  * asserts:
- *    frame is not null
+ *    none
  *
  * returns: void
  */
-static void fx_yu12_mirror (uint8_t *frame, int width, int height)
+static void fx_yu12_mirror_rows(void *data, int row_start, int row_end)
 {
-	/*asserts*/
-	assert(frame != NULL);
+	fx_job_t *job = (fx_job_t *) data;
+
+	uint8_t *frame = job->frame;
+	int width = job->width;
+	int height = job->height;
 
 	int h=0;
 	int w=0;
-	int y_sizeline = width;
-	int c_sizeline = width/2;
 
 	uint8_t *end = NULL;
 	uint8_t *end2 = NULL;
@@ -119,7 +134,7 @@ static void fx_yu12_mirror (uint8_t *frame, int width, int height)
 	uint8_t pixel2=0;
 
 	/*mirror y*/
-	for(h = 0; h < height; h++)
+	for(h = row_start; h < row_end; h++)
 	{
 		py = frame + (h * width);
 		end = py + width - 1;
@@ -129,10 +144,10 @@ static void fx_yu12_mirror (uint8_t *frame, int width, int height)
 			*py++ = *end;
 			*end-- = pixel;
 		}
-	}	
+	}
 
 	/*mirror u v*/
-	for(h = 0; h < height; h+=2)
+	for(h = row_start; h < row_end; h+=2)
 	{
 		pu = frame + (width * height) + ((h * width) / 4);
 		pv = pu + ((width * height) / 4);
@@ -147,7 +162,55 @@ static void fx_yu12_mirror (uint8_t *frame, int width, int height)
 			*end-- = pixel;
 			*end2-- = pixel2;
 		}
-	}	
+	}
+}
+
+/*
+ * Flip yu12 frame - horizontal
+ * args:
+ *    frame - pointer to frame buffer (yu12=iyuv format)
+ *    width - frame width
+ *    height- frame height
+ *
+ * asserts:
+ *    frame is not null
+ *
+ * returns: void
+ */
+static void fx_yu12_mirror (uint8_t *frame, int width, int height)
+{
+	/*asserts*/
+	assert(frame != NULL);
+
+	fx_job_t job = {frame, width, height};
+	parallel_for_rows(height, 2, FX_MIN_ROWS, fx_yu12_mirror_rows, &job);
+}
+
+/*
+ * Invert a band of a YUV frame
+ *  the band covers the same fraction of the inverted
+ *  data as its rows do of the frame
+ * args:
+ *    data - pointer to fx job (fx_job_t)
+ *    row_start - first row of the band
+ *    row_end - last row of the band (not included)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: void
+ */
+static void fx_yuv_negative_rows(void *data, int row_start, int row_end)
+{
+	fx_job_t *job = (fx_job_t *) data;
+
+	int64_t size = (job->width * job->height * 5) / 4;
+
+	int i = (int) ((size * row_start) / job->height);
+	int end = (int) ((size * row_end) / job->height);
+
+	for(; i < end; i++)
+		job->frame[i] = ~job->frame[i];
 }
 
 /*
@@ -167,11 +230,8 @@ static void fx_yuv_negative(uint8_t *frame, int width, int height)
 	/*asserts*/
 	assert(frame != NULL);
 
-	int size = (width * height * 5) / 4;
-
-	int i=0;
-	for(i=0; i < size; i++)
-		frame[i] = ~frame[i];
+	fx_job_t job = {frame, width, height};
+	parallel_for_rows(height, 1, FX_MIN_ROWS, fx_yuv_negative_rows, &job);
 }
 
 /*
@@ -206,67 +266,87 @@ static void fx_yuyv_upturn(uint8_t *frame, int width, int height)
 }
 
 /*
- * Flip yu12 frame - vertical
+ * Flip a band of yu12 rows - vertical
+ *  rows in the band (top half of the frame) are swapped
+ *  with the matching rows of the bottom half
  * args:
- *    frame - pointer to frame buffer (yu12 format)
- *    width - frame width
- *    height- frame height
+ *    data - pointer to fx job (fx_job_t)
+ *    row_start - first row of the band (even)
+ *    row_end - last row of the band (not included)
  *
  * asserts:
- *    frame is not null
+ *    none
  *
  * returns: void
  */
-static void fx_yu12_upturn(uint8_t *frame, int width, int height)
+static void fx_yu12_upturn_rows(void *data, int row_start, int row_end)
 {
-	/*asserts*/
-	assert(frame != NULL);
+	fx_job_t *job = (fx_job_t *) data;
+
+	uint8_t *frame = job->frame;
+	int width = job->width;
+	int height = job->height;
 
 	int h = 0;
 
 	uint8_t line[width]; /*line1 buffer*/
-	
-	uint8_t *pi = frame; //begin of first y line
-	uint8_t *pf = pi + (width * (height - 1)); //begin of last y line
-	
+
+	uint8_t *pi = frame + (width * row_start); //begin of first y line
+	uint8_t *pf = frame + (width * (height - 1 - row_start)); //begin of last y line
+
 	/*upturn y*/
-	for ( h = 0; h < height / 2; ++h)
+	for ( h = row_start; h < row_end; ++h)
 	{	/*line iterator*/
 		memcpy(line, pi, width);
 		memcpy(pi, pf, width);
 		memcpy(pf, line, width);
-		
+
 		pi+=width;
 		pf-=width;
-		
 	}
-	
-	/*upturn u*/
-	pi = frame + (width * height); //begin of first u line
-	pf = pi + ((width * height) / 4) - (width / 2); //begin of last u line
-	for ( h = 0; h < height / 2; h += 2) //every two lines = height / 4
-	{	/*line iterator*/
-		memcpy(line, pi, width / 2);
-		memcpy(pi, pf, width / 2);
-		memcpy(pf, line, width / 2);
-		
-		pi+=width/2;
-		pf-=width/2;
-	}
-	
-	/*upturn v*/
-	pi = frame + ((width * height * 5) / 4); //begin of first v line
-	pf = pi + ((width * height) / 4) - (width / 2); //begin of last v line
-	for ( h = 0; h < height / 2; h += 2) //every two lines = height / 4
-	{	/*line iterator*/
-		memcpy(line, pi, width / 2);
-		memcpy(pi, pf, width / 2);
-		memcpy(pf, line, width / 2);
-		
-		pi+=width/2;
-		pf-=width/2;
+
+	/*upturn u and v - one chroma line every two lines*/
+	int c_start = row_start / 2;
+	int c_end = (row_end + 1) / 2;
+
+	int plane = 0;
+	for(plane = 0; plane < 2; ++plane)
+	{
+		uint8_t *pc = frame + (width * height) + (plane * ((width * height) / 4)); //begin of chroma plane
+
+		pi = pc + (c_start * (width / 2)); //begin of first chroma line
+		pf = pc + ((width * height) / 4) - ((c_start + 1) * (width / 2)); //begin of last chroma line
+		for ( h = c_start; h < c_end; ++h)
+		{	/*line iterator*/
+			memcpy(line, pi, width / 2);
+			memcpy(pi, pf, width / 2);
+			memcpy(pf, line, width / 2);
+
+			pi+=width/2;
+			pf-=width/2;
+		}
 	}
-	
+}
+
+/*
+ * Flip yu12 frame - vertical
+ * args:
+ *    frame - pointer to frame buffer (yu12 format)
+ *    width - frame width
+ *    height- frame height
+ *
+ * asserts:
+ *    frame is not null
+ *
+ * returns: void
+ */
+static void fx_yu12_upturn(uint8_t *frame, int width, int height)
+{
+	/*asserts*/
+	assert(frame != NULL);
+
+	fx_job_t job = {frame, width, height};
+	parallel_for_rows(height / 2, 2, FX_MIN_ROWS, fx_yu12_upturn_rows, &job);
 }
 
 /*
@@ -293,6 +373,35 @@ static void fx_yuyv_monochrome(uint8_t* frame, int width, int height)
 	}
 }
 
+/*
+ * Monochromatic effect for a band of a yu12 frame
+ *  the band covers the same fraction of the chroma
+ *  planes as its rows do of the frame
+ * args:
+ *     data - pointer to fx job (fx_job_t)
+ *     row_start - first row of the band
+ *     row_end - last row of the band (not included)
+ *
+ * asserts:
+ *     none
+ *
+ * returns: void
+ */
+static void fx_yu12_monochrome_rows(void *data, int row_start, int row_end)
+{
+	fx_job_t *job = (fx_job_t *) data;
+
+	uint8_t *puv = job->frame + (job->width * job->height); //skip luma
+
+	int64_t size = (job->width * job->height) / 2;
+
+	int start = (int) ((size * row_start) / job->height);
+	int end = (int) ((size * row_end) / job->height);
+
+	/* keep Y - luma */
+	memset(puv + start, 0x80, end - start); /*median (half the max value)=128*/
+}
+
 /*
  * Monochromatic effect for yu12 frame
  * args:
@@ -307,18 +416,10 @@ static void fx_yuyv_monochrome(uint8_t* frame, int width, int height)
  */
 static void fx_yu12_monochrome(uint8_t* frame, int width, int height)
 {
-	
-	uint8_t *puv = frame + (width * height); //skip luma
-	
-	int i = 0;
-	
-	for(i=0; i < (width * height) / 2; ++i)
-	{	/* keep Y - luma */
-		*puv++=0x80;/*median (half the max value)=128*/
-	}
+	fx_job_t job = {frame, width, height};
+	parallel_for_rows(height, 1, FX_MIN_ROWS, fx_yu12_monochrome_rows, &job);
 }
 
-
 #ifdef HAS_GSL
 /*
  * Break yuyv image in little square pieces
@@ -0,0 +1,874 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - builtin MJPEG entropy decoder benchmark                  #
+#                                                                               #
+#  Times decode_mcus over a whole scan (best of N runs) for the current         #
+#  decoder (64 bit reservoir, 11 bit lookups) and for the previous one          #
+#  (32 bit reservoir refilled a byte at a time, 10 bit lookups), and checks     #
+#  that both return the same coefficients.                                      #
+#                                                                               #
+#  usage: bench_jpeg_entropy [runs] [frame.jpg ...]                             #
+#    without frames, two synthetic 1280x720 4:2:2 scans (sparse and dense       #
+#    random coefficients) are entropy coded with the default MJPG tables        #
+#                                                                               #
+#  Not built by default: configure --enable-benchmarks                          #
+#                                                                               #
+********************************************************************************/
+
+/*the entropy decoder is static - build it here*/
+#include "jpeg_decoder.c"
+
+#include "core_time.h"
+
+int verbosity = 0;
+
+#if MJPG_BUILTIN
+
+#define BENCH_RUNS   (15)
+#define BENCH_WIDTH  (1280)
+#define BENCH_HEIGHT (720)
+
+/****************************************************************/
+/**********   previous entropy decoder (reference)     **********/
+/****************************************************************/
+
+struct old_in
+{
+	uint8_t *p;
+	uint32_t bits;
+	int left;
+	int marker;
+	int (*func) __P((void *));
+	void *data;
+};
+
+#define OLD_LEBI_DCL	int le, bi
+
+#define OLD_DECBITS 10
+
+struct old_dec_hufftbl
+{
+	int maxcode[17];
+	int valptr[16];
+	uint8_t vals[256];
+	uint32_t llvals[1 << OLD_DECBITS];
+};
+
+struct old_scan
+{
+	int dc;
+	struct old_dec_hufftbl *hudc;
+	struct old_dec_hufftbl *huac;
+	int next;
+};
+
+/*
+ * build huffman data (previous decoder)
+ * args:
+ *    hu - pointer to old_dec_hufftbl struct
+ *    hufflen - pointer to int with code size
+ *    huffvals - pointer to uint8_t with huffman values
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void old_dec_makehuff(struct old_dec_hufftbl *hu, int *hufflen, uint8_t *huffvals)
+{
+	int code, k, i, j, d, x, c, v;
+	for (i = 0; i < (1 << OLD_DECBITS); i++)
+		hu->llvals[i] = 0;
+
+	code = 0;
+	k = 0;
+	for (i = 0; i < 16; i++, code <<= 1)
+	{	/* sizes */
+		hu->valptr[i] = k;
+		for (j = 0; j < hufflen[i]; j++)
+		{
+			hu->vals[k] = *huffvals++;
+			if (i < OLD_DECBITS)
+			{
+				c = code << (OLD_DECBITS - 1 - i);
+				v = hu->vals[k] & 0x0f;	/* size */
+				for (d = 1 << (OLD_DECBITS - 1 - i); --d >= 0;)
+				{
+					if (v + i < OLD_DECBITS)
+					{	/* both fit in table */
+						x = d >> (OLD_DECBITS - 1 - v - i);
+						if (v && x < (1 << (v - 1)))
+							x += (-1 << v) + 1;
+						x = x << 16 | (hu->vals[k] & 0xf0) << 4 |
+							(OLD_DECBITS - (i + 1 + v)) | 128;
+					}
+					else
+						x = v << 16 | (hu->vals[k] & 0xf0) << 4 |
+							(OLD_DECBITS - (i + 1));
+					hu->llvals[c | d] = x;
+				}
+			}
+			code++;
+			k++;
+		}
+		hu->maxcode[i] = code;
+	}
+	hu->maxcode[16] = 0x20000;	/* always terminate decode */
+}
+
+/*
+ * fillbits (previous decoder - byte at a time)
+ * args:
+ *    inp - pointer to struct old_in
+ *    le - left
+ *    bi - bits
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of valid bits in reservoir (left)
+ */
+static int old_fillbits(struct old_in *inp, int le, unsigned int bi)
+{
+	if (inp->marker)
+	{
+		if (le <= 16)
+			inp->bits = bi << 16, le += 16;
+		return le;
+	}
+	while (le <= 24)
+	{
+		int b = *inp->p++;
+		int m = 0;
+
+		if (b == 0xff && (m = *inp->p++) != 0)
+		{
+			if (m == M_EOF)
+			{
+				if (inp->func && (m = inp->func(inp->data)) == 0)
+					continue;
+			}
+			inp->marker = m;
+			if (le <= 16)
+				bi = bi << 16, le += 16;
+			break;
+		}
+		bi = bi << 8 | b;
+		le += 8;
+	}
+	inp->bits = bi;
+	return le;
+}
+
+#define OLD_GETBITS(in, n) (					\
+  (le < (n) ? le = old_fillbits(in, le, bi), bi = in->bits : 0),	\
+  (le -= (n)),							\
+  bi >> le & ((1 << (n)) - 1)					\
+)
+
+/*
+ * decode a code longer than OLD_DECBITS or with a value that
+ *  doesn't fit the table (previous decoder)
+ * args:
+ *    see dec_rec2
+ *
+ * asserts:
+ *    none
+ *
+ * returns: coefficient value
+ */
+static int old_dec_rec2(struct old_in *inp, struct old_dec_hufftbl *hu, int *runp, int c, int i)
+{
+	OLD_LEBI_DCL;
+
+	LEBI_GET(inp);
+	if (i)
+	{
+		UNGETBITS(inp, i & 127);
+		*runp = i >> 8 & 15;
+		i >>= 16;
+	}
+	else
+	{
+		for (i = OLD_DECBITS;
+		(c = ((c << 1) | OLD_GETBITS(inp, 1))) >= (hu->maxcode[i]); i++);
+		if (i >= 16)
+		{
+			inp->marker = M_BADHUFF;
+			return 0;
+		}
+		i = hu->vals[hu->valptr[i] + c - hu->maxcode[i - 1] * 2];
+		*runp = i >> 4;
+		i &= 15;
+	}
+	if (i == 0)
+	{	/* sigh, 0xf0 is 11 bit */
+		LEBI_PUT(inp);
+		return 0;
+	}
+	/* receive part */
+	c = OLD_GETBITS(inp, i);
+	if (c < (1 << (i - 1)))
+		c += (-1 << i) + 1;
+	LEBI_PUT(inp);
+	return c;
+}
+
+#define OLD_DEC_REC(in, hu, r, i)	 (	\
+  r = OLD_GETBITS(in, OLD_DECBITS),		\
+  i = hu->llvals[r],			\
+  i & 128 ?				\
+    (					\
+      UNGETBITS(in, i & 127),		\
+      r = i >> 8 & 15,			\
+      i >> 16				\
+    )					\
+  :					\
+    (					\
+      LEBI_PUT(in),			\
+      i = old_dec_rec2(in, hu, &r, r, i),	\
+      LEBI_GET(in),			\
+      i					\
+    )					\
+)
+
+/*
+ * mcus decoder (previous decoder)
+ * args:
+ *    see decode_mcus
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void old_decode_mcus(struct old_in *inp, int *dct, int n, struct old_scan *sc, int *maxp)
+{
+	struct old_dec_hufftbl *hu;
+	int r = 0, t = 0;
+	OLD_LEBI_DCL;
+
+	memset(dct, 0, n * 64 * sizeof(*dct));
+	LEBI_GET(inp);
+	while (n-- > 0)
+	{
+		hu = sc->hudc;
+		*dct++ = (sc->dc += OLD_DEC_REC(inp, hu, r, t));
+
+		hu = sc->huac;
+		int i = 63;
+
+		while (i > 0)
+		{
+			t = OLD_DEC_REC(inp, hu, r, t);
+			if (t == 0 && r == 0)
+			{
+				dct += i;
+				break;
+			}
+			dct += r;
+			*dct++ = t;
+			i -= r + 1;
+		}
+		*maxp++ = 64 - i;
+		if (n == sc->next)
+		sc++;
+	}
+	LEBI_PUT(inp);
+}
+
+/****************************************************************/
+/**************          benchmark                ***************/
+/****************************************************************/
+
+/*
+ * entropy coded scan of a frame (tables for both decoders)
+ */
+typedef struct _bench_scan_t
+{
+	codec_data_t codec_data;
+	struct old_dec_hufftbl old_dhuff[4];
+	uint8_t *data;  //entropy coded data (padded)
+	int size;       //entropy coded data size
+	int mb;         //blocks per mcu
+	int nmcus;      //mcus in frame
+} bench_scan_t;
+
+/*
+ * build the previous decoder tables (code lengths from the current tables)
+ * args:
+ *    bench - pointer to bench scan
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void bench_old_tables(bench_scan_t *bench)
+{
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < 4; i++)
+	{
+		struct dec_hufftbl *hu = bench->codec_data.dhuff + i;
+		int hufflen[16];
+		for (j = 0; j < 16; j++)
+			hufflen[j] = hu->maxcode[j] - (j ? hu->maxcode[j - 1] * 2 : 0);
+		old_dec_makehuff(bench->old_dhuff + i, hufflen, hu->vals);
+	}
+}
+
+/*
+ * parse the frame headers up to the scan data
+ *  (same as jpeg_decode_context)
+ * args:
+ *    bench - pointer to bench scan
+ *    jpeg - pointer to jpeg frame
+ *    size - jpeg frame size
+ *
+ * asserts:
+ *    none
+ *
+ * returns: error code (0 - OK)
+ */
+static int bench_parse(bench_scan_t *bench, uint8_t *jpeg, int size)
+{
+	codec_data_t *codec_data = &bench->codec_data;
+	int isDHT = 0;
+	int i = 0;
+	int j = 0;
+
+	memset(bench, 0, sizeof(bench_scan_t));
+	codec_data->datap = jpeg;
+
+	if (getbyte(codec_data) != 0xff || getbyte(codec_data) != M_SOI)
+		return E_NO_SOI_ERR;
+	if (readtables(codec_data, M_SOF0, &isDHT))
+		return E_BAD_TABLES_ERR;
+	getword(codec_data);
+	if (getbyte(codec_data) != 8)
+		return E_NOT_8BIT_ERR;
+	int height = getword(codec_data);
+	int width = getword(codec_data);
+	codec_data->info.nc = getbyte(codec_data);
+	if (codec_data->info.nc > MAXCOMP)
+		return E_TOO_MANY_COMPPS_ERR;
+	for (i = 0; i < codec_data->info.nc; i++)
+	{
+		codec_data->comps[i].cid = getbyte(codec_data);
+		codec_data->comps[i].hv = getbyte(codec_data);
+		codec_data->comps[i].tq = getbyte(codec_data);
+	}
+	if (readtables(codec_data, M_SOS, &isDHT))
+		return E_BAD_TABLES_ERR;
+	if (codec_data->info.dri)
+	{
+		fprintf(stderr, "V4L2_CORE: (bench_jpeg_entropy) restart markers are not supported\n");
+		return E_BAD_TABLES_ERR;
+	}
+	if (!isDHT && huffman_init(codec_data) < 0)
+		return E_BAD_TABLES_ERR;
+
+	getword(codec_data);
+	codec_data->info.ns = getbyte(codec_data);
+	if (codec_data->info.ns != 1 && codec_data->info.ns != 3)
+		return E_NOT_YCBCR_ERR;
+	for (i = 0; i < codec_data->info.ns; i++)
+	{
+		int cid = getbyte(codec_data);
+		int tdc = getbyte(codec_data);
+		int tac = tdc & 15;
+		tdc >>= 4;
+		if (tdc > 1 || tac > 1)
+			return E_QUANT_TBL_SEL_ERR;
+		for (j = 0; j < codec_data->info.nc; j++)
+			if (codec_data->comps[j].cid == cid)
+				break;
+		if (j == codec_data->info.nc)
+			return E_UNKNOWN_CID_ERR;
+		codec_data->dscans[i].hv = codec_data->comps[j].hv;
+		codec_data->dscans[i].hudc.dhuff = dec_huffdc(codec_data) + tdc;
+		codec_data->dscans[i].huac.dhuff = dec_huffac(codec_data) + tac;
+	}
+	codec_data->datap += 3; /*0 63 0*/
+
+	switch (codec_data->dscans[0].hv)
+	{
+		case 0x22:
+			bench->mb = 6;
+			bench->nmcus = (width >> 4) * (height >> 4);
+			break;
+		case 0x21:
+			bench->mb = 4;
+			bench->nmcus = (width >> 4) * (height >> 3);
+			break;
+		case 0x11:
+			bench->mb = (codec_data->info.ns == 1) ? 1 : 3;
+			bench->nmcus = (width >> 3) * (height >> 3);
+			break;
+		default:
+			return E_NOT_YCBCR_ERR;
+	}
+
+	bench_old_tables(bench);
+
+	bench->size = size - (codec_data->datap - jpeg);
+	bench->data = calloc(bench->size + JPEG_INPUT_PADDING, sizeof(uint8_t));
+	if (bench->data == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (bench_parse): %s\n", strerror(errno));
+		exit(-1);
+	}
+	memcpy(bench->data, codec_data->datap, bench->size);
+
+	return E_OK;
+}
+
+/*
+ * decode the scan with the current decoder
+ * args:
+ *    bench - pointer to bench scan
+ *    dcts - pointer to coefficients (mb * 64 per mcu)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: decoding time in ns
+ */
+static uint64_t bench_decode(bench_scan_t *bench, int *dcts)
+{
+	struct scan *dscans = bench->codec_data.dscans;
+	struct in inp;
+	int max[6];
+	int mcu = 0;
+
+	memset(&inp, 0, sizeof(struct in));
+	setinput(&inp, bench->data);
+	dscans[0].dc = dscans[1].dc = dscans[2].dc = 0;
+	dscans[0].next = 2;
+	dscans[1].next = 1;
+	dscans[2].next = 0;
+
+	uint64_t start = ns_time_monotonic();
+	for (mcu = 0; mcu < bench->nmcus; mcu++)
+		decode_mcus(&inp, dcts + mcu * bench->mb * 64, bench->mb, dscans, max);
+	return ns_time_monotonic() - start;
+}
+
+/*
+ * decode the scan with the previous decoder
+ * args:
+ *    bench - pointer to bench scan
+ *    dcts - pointer to coefficients (mb * 64 per mcu)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: decoding time in ns
+ */
+static uint64_t bench_old_decode(bench_scan_t *bench, int *dcts)
+{
+	struct old_scan dscans[3];
+	struct old_in inp;
+	int max[6];
+	int mcu = 0;
+	int i = 0;
+
+	memset(&inp, 0, sizeof(struct old_in));
+	memset(dscans, 0, sizeof(dscans));
+	inp.p = bench->data;
+	for (i = 0; i < bench->codec_data.info.ns; i++)
+	{
+		int tdc = bench->codec_data.dscans[i].hudc.dhuff - bench->codec_data.dhuff;
+		int tac = bench->codec_data.dscans[i].huac.dhuff - bench->codec_data.dhuff;
+		dscans[i].dc = 0;
+		dscans[i].hudc = bench->old_dhuff + tdc;
+		dscans[i].huac = bench->old_dhuff + tac;
+		dscans[i].next = 2 - i;
+	}
+
+	uint64_t start = ns_time_monotonic();
+	for (mcu = 0; mcu < bench->nmcus; mcu++)
+		old_decode_mcus(&inp, dcts + mcu * bench->mb * 64, bench->mb, dscans, max);
+	return ns_time_monotonic() - start;
+}
+
+/*
+ * run the benchmark for a scan
+ * args:
+ *    name - frame name
+ *    bench - pointer to bench scan
+ *    runs - number of runs (best is reported)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: 0 if both decoders return the same coefficients, 1 otherwise
+ */
+static int bench_frame(const char *name, bench_scan_t *bench, int runs)
+{
+	size_t ndcts = (size_t) bench->nmcus * bench->mb * 64;
+	int *dcts = calloc(ndcts, sizeof(int));
+	int *old_dcts = calloc(ndcts, sizeof(int));
+	if (dcts == NULL || old_dcts == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (bench_frame): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	uint64_t best = UINT64_MAX;
+	uint64_t old_best = UINT64_MAX;
+	int i = 0;
+	for (i = 0; i < runs; i++)
+	{
+		uint64_t t = bench_old_decode(bench, old_dcts);
+		if (t < old_best)
+			old_best = t;
+		t = bench_decode(bench, dcts);
+		if (t < best)
+			best = t;
+	}
+
+	int match = (memcmp(dcts, old_dcts, ndcts * sizeof(int)) == 0);
+
+	/*luma pixels in mcu: 16x16 (4:2:0), 16x8 (4:2:2) or 8x8*/
+	int mcu_pixels = (bench->mb == 6) ? 256 : (bench->mb == 4) ? 128 : 64;
+	double bpp = (bench->size * 8.0) / ((double) bench->nmcus * mcu_pixels);
+
+	printf("%s: %i bytes (%.2f bpp) previous %.3f ms current %.3f ms (%.2fx) %s\n",
+		name, bench->size, bpp, old_best / 1e6, best / 1e6,
+		best ? (double) old_best / best : 0,
+		match ? "coefficients match" : "COEFFICIENTS DIFFER");
+
+	free(dcts);
+	free(old_dcts);
+
+	return match ? 0 : 1;
+}
+
+/*
+ * huffman encoder table (synthetic scans)
+ */
+typedef struct _bench_enc_hufftbl_t
+{
+	uint16_t code[256];
+	uint8_t size[256];
+} bench_enc_hufftbl_t;
+
+/*
+ * entropy coded data writer (synthetic scans)
+ */
+typedef struct _bench_writer_t
+{
+	uint8_t *p;
+	uint64_t bits;
+	int n;
+} bench_writer_t;
+
+/*
+ * build the encoder tables from the default (MJPG) huffman tables
+ * args:
+ *    ehuff - pointer to 4 encoder tables (same index as codec_data->dhuff)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void bench_enc_makehuff(bench_enc_hufftbl_t *ehuff)
+{
+	const uint8_t *ptr = jpeg_huffman_table;
+	int l = JPG_HUFFMAN_TABLE_LENGTH;
+
+	while (l > 0)
+	{
+		int tc = *ptr++;
+		int tt = (tc >> 4) * 2 + (tc & 15);
+		const uint8_t *hufflen = ptr;
+		ptr += 16;
+		l -= 1 + 16;
+
+		int code = 0;
+		int i = 0;
+		int j = 0;
+		for (i = 0; i < 16; i++, code <<= 1)
+		{
+			for (j = 0; j < hufflen[i]; j++)
+			{
+				int v = *ptr++;
+				ehuff[tt].code[v] = code++;
+				ehuff[tt].size[v] = i + 1;
+			}
+			l -= hufflen[i];
+		}
+	}
+}
+
+/*
+ * write bits (0xff bytes are stuffed)
+ * args:
+ *    wr - pointer to writer
+ *    code - bits to write
+ *    n - number of bits
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void bench_put_bits(bench_writer_t *wr, int code, int n)
+{
+	wr->bits = (wr->bits << n) | (code & ((1 << n) - 1));
+	wr->n += n;
+	while (wr->n >= 8)
+	{
+		wr->n -= 8;
+		uint8_t b = wr->bits >> wr->n;
+		*wr->p++ = b;
+		if (b == 0xff)
+			*wr->p++ = 0;
+	}
+}
+
+/*
+ * write a huffman symbol and its value bits
+ * args:
+ *    wr - pointer to writer
+ *    hu - pointer to encoder table
+ *    rs - run/size symbol
+ *    v - coefficient value (size is rs & 15)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void bench_put_coef(bench_writer_t *wr, bench_enc_hufftbl_t *hu, int rs, int v)
+{
+	int s = rs & 15;
+
+	bench_put_bits(wr, hu->code[rs], hu->size[rs]);
+	if (s)
+		bench_put_bits(wr, (v < 0) ? v - 1 : v, s);
+}
+
+/*
+ * random coefficient value of a given size (bits)
+ * args:
+ *    s - size (1-11)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: coefficient value
+ */
+static int bench_rand_coef(int s)
+{
+	int v = (1 << (s - 1)) + (rand() % (1 << (s - 1)));
+	return (rand() & 1) ? v : -v;
+}
+
+/*
+ * entropy code a synthetic 1280x720 4:2:2 scan with the default tables
+ * args:
+ *    bench - pointer to bench scan
+ *    density - probability (x/256) of a non zero ac coefficient
+ *              (decreases with the frequency)
+ *    maxbits - maximum coefficient size in bits (1-10)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void bench_synthetic_scan(bench_scan_t *bench, int density, int maxbits)
+{
+	codec_data_t *codec_data = &bench->codec_data;
+	bench_enc_hufftbl_t ehuff[4];
+
+	memset(bench, 0, sizeof(bench_scan_t));
+	memset(ehuff, 0, sizeof(ehuff));
+	huffman_init(codec_data);
+	bench_enc_makehuff(ehuff);
+	bench_old_tables(bench);
+
+	codec_data->info.ns = 3;
+	codec_data->dscans[0].hudc.dhuff = dec_huffdc(codec_data);
+	codec_data->dscans[0].huac.dhuff = dec_huffac(codec_data);
+	codec_data->dscans[1].hudc.dhuff = dec_huffdc(codec_data) + 1;
+	codec_data->dscans[1].huac.dhuff = dec_huffac(codec_data) + 1;
+	codec_data->dscans[2].hudc.dhuff = dec_huffdc(codec_data) + 1;
+	codec_data->dscans[2].huac.dhuff = dec_huffac(codec_data) + 1;
+	bench->mb = 4;
+	bench->nmcus = (BENCH_WIDTH >> 4) * (BENCH_HEIGHT >> 3);
+
+	/*worst case: 64 coefficients of 26 bits, all bytes stuffed*/
+	bench->data = calloc((size_t) bench->nmcus * bench->mb * 512 + JPEG_INPUT_PADDING, sizeof(uint8_t));
+	if (bench->data == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (bench_synthetic_scan): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	bench_writer_t wr;
+	wr.p = bench->data;
+	wr.bits = 0;
+	wr.n = 0;
+
+	int blk = 0;
+	for (blk = 0; blk < bench->nmcus * bench->mb; blk++)
+	{
+		/*Y Y Cb Cr*/
+		int t = ((blk % bench->mb) < 2) ? 0 : 1;
+
+		int s = rand() % (maxbits + 2); /*dc difference size (0-11)*/
+		bench_put_coef(&wr, ehuff + t, s, s ? bench_rand_coef(s) : 0);
+
+		int run = 0;
+		int k = 0;
+		for (k = 1; k < 64; k++)
+		{
+			if ((rand() & 255) >= (density * (64 - k)) / 64)
+			{
+				run++;
+				continue;
+			}
+			for (; run > 15; run -= 16)
+				bench_put_coef(&wr, ehuff + 2 + t, 0xf0, 0); /*ZRL*/
+			s = 1 + rand() % maxbits;
+			bench_put_coef(&wr, ehuff + 2 + t, (run << 4) | s, bench_rand_coef(s));
+			run = 0;
+		}
+		if (run)
+			bench_put_coef(&wr, ehuff + 2 + t, 0x00, 0); /*EOB*/
+	}
+	/*pad the last byte with 1 bits*/
+	if (wr.n)
+		bench_put_bits(&wr, 0x7f, 8 - wr.n);
+
+	bench->size = wr.p - bench->data;
+}
+
+/*
+ * read a jpeg file and parse it
+ * args:
+ *    bench - pointer to bench scan
+ *    filename - jpeg file name
+ *
+ * asserts:
+ *    none
+ *
+ * returns: error code (0 - OK)
+ */
+static int bench_read_frame(bench_scan_t *bench, const char *filename)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: (bench_jpeg_entropy) couldn't open %s: %s\n", filename, strerror(errno));
+		return E_FILE_IO_ERR;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	uint8_t *jpeg = calloc(size + JPEG_INPUT_PADDING, sizeof(uint8_t));
+	if (jpeg == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (bench_read_frame): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	int ret = E_FILE_IO_ERR;
+	if (fread(jpeg, 1, size, fp) == (size_t) size)
+		ret = bench_parse(bench, jpeg, size);
+	if (ret != E_OK)
+		fprintf(stderr, "V4L2_CORE: (bench_jpeg_entropy) %s: unsupported jpeg frame\n", filename);
+
+	fclose(fp);
+	free(jpeg);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	int runs = (argc > 1) ? atoi(argv[1]) : BENCH_RUNS;
+	if (runs < 1)
+	{
+		fprintf(stderr, "usage: bench_jpeg_entropy [runs] [frame.jpg ...]\n");
+		return 1;
+	}
+
+	bench_scan_t bench;
+	int fail = 0;
+	int i = 0;
+
+	if (argc > 2)
+	{
+		for (i = 2; i < argc; i++)
+		{
+			if (bench_read_frame(&bench, argv[i]) != E_OK)
+			{
+				fail++;
+				continue;
+			}
+			fail += bench_frame(argv[i], &bench, runs);
+			free(bench.data);
+		}
+		return fail ? 1 : 0;
+	}
+
+	/*synthetic scans: sparse (low bpp) and dense (high bpp)*/
+	static const struct
+	{
+		const char *name;
+		int density;
+		int maxbits;
+	} scans[] =
+	{
+		{"sparse", 6, 2},
+		{"dense", 96, 4},
+	};
+
+	srand(4242);
+	for (i = 0; i < (int) (sizeof(scans) / sizeof(scans[0])); i++)
+	{
+		bench_synthetic_scan(&bench, scans[i].density, scans[i].maxbits);
+		fail += bench_frame(scans[i].name, &bench, runs);
+		free(bench.data);
+	}
+
+	return fail ? 1 : 0;
+}
+
+#else /*!MJPG_BUILTIN*/
+
+int main(int argc, char *argv[])
+{
+	printf("SKIP: the builtin MJPEG decoder is disabled (configure --enable-builtin-mjpg)\n");
+	return 0;
+}
+
+#endif
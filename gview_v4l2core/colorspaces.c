@@ -27,396 +27,331 @@
 #include <assert.h>
 
 #include "gview.h"
+#include "gviewv4l2core.h"
+#include "colorspaces.h"
+#include "colorspaces_simd.h"
+#include "thread_pool.h"
 #include "../config.h"
 
+/*minimum number of rows per thread pool band*/
+#define CONVERT_MIN_ROWS (64)
+
 extern int verbosity;
 
 /*------------------------------- Color space conversions --------------------*/
 
-/*---------------- raw bayer -------------*/
+/*------------------ YU12 ----------------------*/
 
-/* raw bayer functions
- *  from libv4l bayer.c, (C) 2008 Hans de Goede <j.w.r.degoede@hhs.nl>
- *  Note: original bayer_to_bgr24 code from :
- *     1394-Based Digital Camera Control Library
+/*
+ * get the planes and line sizes of a tightly packed yu12 buffer
+ * args:
+ *    buf - pointer to yu12 planar data buffer
+ *    width - frame width
+ *    height - frame height
+ *    planes - pointers to the y, u and v planes (to be filled)
+ *    stride - y, u and v line sizes in bytes (to be filled)
  *
- * Bayer pattern decoding functions
- *  Written by Damien Douxchamps and Frederic Devernay
+ * asserts:
+ *    none
  *
+ * returns: none
  */
-static void convert_border_bayer_line_to_bgr24( uint8_t* bayer, uint8_t* adjacent_bayer,
-	uint8_t *bgr, int width, uint8_t start_with_green, uint8_t blue_line)
+void yu12_get_planes(uint8_t *buf, int width, int height, uint8_t *planes[3], int stride[3])
 {
-	int t0, t1;
+	planes[0] = buf;
+	planes[1] = buf + (width * height);
+	planes[2] = planes[1] + ((width * height) / 4);
 
-	if (start_with_green)
-	{
-	/* First pixel */
-		if (blue_line)
-		{
-			*bgr++ = bayer[1];
-			*bgr++ = bayer[0];
-			*bgr++ = adjacent_bayer[0];
-		}
-		else
-		{
-			*bgr++ = adjacent_bayer[0];
-			*bgr++ = bayer[0];
-			*bgr++ = bayer[1];
-		}
-		/* Second pixel */
-		t0 = (bayer[0] + bayer[2] + adjacent_bayer[1] + 1) / 3;
-		t1 = (adjacent_bayer[0] + adjacent_bayer[2] + 1) >> 1;
-		if (blue_line)
-		{
-			*bgr++ = bayer[1];
-			*bgr++ = t0;
-			*bgr++ = t1;
-		}
-		else
-		{
-			*bgr++ = t1;
-			*bgr++ = t0;
-			*bgr++ = bayer[1];
-		}
-		bayer++;
-		adjacent_bayer++;
-		width -= 2;
-	}
-	else
-	{
-		/* First pixel */
-		t0 = (bayer[1] + adjacent_bayer[0] + 1) >> 1;
-		if (blue_line)
-		{
-			*bgr++ = bayer[0];
-			*bgr++ = t0;
-			*bgr++ = adjacent_bayer[1];
-		}
-		else
-		{
-			*bgr++ = adjacent_bayer[1];
-			*bgr++ = t0;
-			*bgr++ = bayer[0];
-		}
-		width--;
-	}
+	stride[0] = width;
+	stride[1] = width / 2;
+	stride[2] = width / 2;
+}
 
-	if (blue_line)
-	{
-		for ( ; width > 2; width -= 2)
-		{
-			t0 = (bayer[0] + bayer[2] + 1) >> 1;
-			*bgr++ = t0;
-			*bgr++ = bayer[1];
-			*bgr++ = adjacent_bayer[1];
-			bayer++;
-			adjacent_bayer++;
-
-			t0 = (bayer[0] + bayer[2] + adjacent_bayer[1] + 1) / 3;
-			t1 = (adjacent_bayer[0] + adjacent_bayer[2] + 1) >> 1;
-			*bgr++ = bayer[1];
-			*bgr++ = t0;
-			*bgr++ = t1;
-			bayer++;
-			adjacent_bayer++;
-		}
-	}
-	else
+/*
+ * copy yu12 planes between buffers with different line sizes
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointers to input y, u and v planes
+ *    in_stride - input y, u and v line sizes (bytes)
+ *    width - frame width
+ *    height - frame height
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void yu12_copy_planes(uint8_t * const out[3], const int out_stride[3],
+	uint8_t * const in[3], const int in_stride[3], int width, int height)
+{
+	int plane = 0;
+	for(plane = 0; plane < 3; ++plane)
 	{
-		for ( ; width > 2; width -= 2)
-		{
-			t0 = (bayer[0] + bayer[2] + 1) >> 1;
-			*bgr++ = adjacent_bayer[1];
-			*bgr++ = bayer[1];
-			*bgr++ = t0;
-			bayer++;
-			adjacent_bayer++;
-
-			t0 = (bayer[0] + bayer[2] + adjacent_bayer[1] + 1) / 3;
-			t1 = (adjacent_bayer[0] + adjacent_bayer[2] + 1) >> 1;
-			*bgr++ = t1;
-			*bgr++ = t0;
-			*bgr++ = bayer[1];
-			bayer++;
-			adjacent_bayer++;
-		}
-	}
+		int w = plane ? width / 2 : width;
+		int h = plane ? height / 2 : height;
 
-	if (width == 2)
-	{
-		/* Second to last pixel */
-		t0 = (bayer[0] + bayer[2] + 1) >> 1;
-		if (blue_line)
-		{
-			*bgr++ = t0;
-			*bgr++ = bayer[1];
-			*bgr++ = adjacent_bayer[1];
-		}
-		else
-		{
-			*bgr++ = adjacent_bayer[1];
-			*bgr++ = bayer[1];
-			*bgr++ = t0;
-		}
-		/* Last pixel */
-		t0 = (bayer[1] + adjacent_bayer[2] + 1) >> 1;
-		if (blue_line)
-		{
-			*bgr++ = bayer[2];
-			*bgr++ = t0;
-			*bgr++ = adjacent_bayer[1];
-		}
-		else
-		{
-			*bgr++ = adjacent_bayer[1];
-			*bgr++ = t0;
-			*bgr++ = bayer[2];
-		}
-	}
-	else
-	{
-		/* Last pixel */
-		if (blue_line)
-		{
-			*bgr++ = bayer[0];
-			*bgr++ = bayer[1];
-			*bgr++ = adjacent_bayer[1];
-		}
-		else
+		if(out_stride[plane] == w && in_stride[plane] == w)
 		{
-			*bgr++ = adjacent_bayer[1];
-			*bgr++ = bayer[1];
-			*bgr++ = bayer[0];
+			memcpy(out[plane], in[plane], w * h);
+			continue;
 		}
+
+		int line = 0;
+		for(line = 0; line < h; ++line)
+			memcpy(out[plane] + (line * out_stride[plane]),
+				in[plane] + (line * in_stride[plane]), w);
 	}
 }
 
 /*
- * From libdc1394, which on turn was based on OpenCV's Bayer decoding
+ * planar yuv to yu12 conversion job
  */
-static void bayer_to_rgbbgr24(uint8_t *bayer,
-	uint8_t *bgr, int width, int height,
-	uint8_t start_with_green, uint8_t blue_line)
+typedef struct _planar_job_t
 {
-	/* render the first line */
-	convert_border_bayer_line_to_bgr24(bayer, bayer + width, bgr, width,
-		start_with_green, blue_line);
-	bgr += width * 3;
+	uint8_t *out[3];    //output y, u and v planes
+	int out_stride[3];  //output y, u and v line sizes (bytes)
+	uint8_t *in[3];     //input y, u and v planes
+	int in_stride[3];   //input y, u and v line sizes (bytes)
+	int width;
+	int hshift;         //input chroma horizontal subsampling (log2)
+	int vshift;         //input chroma vertical subsampling (log2)
+} planar_job_t;
 
-	/* reduce height by 2 because of the special case top/bottom line */
-	for (height -= 2; height; height--)
-	{
-		int t0, t1;
-		/* (width - 2) because of the border */
-		uint8_t *bayerEnd = bayer + (width - 2);
+/*
+ * convert a band of planar yuv rows to 420 planar (yu12)
+ * args:
+ *    data - pointer to conversion job (planar_job_t)
+ *    row_start - first row of the band (even)
+ *    row_end - last row of the band (not included)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void yuv_planar_to_yu12_rows(void *data, int row_start, int row_end)
+{
+	planar_job_t *job = (planar_job_t *) data;
 
-		if (start_with_green)
-		{
-			/* OpenCV has a bug in the next line, which was
-			t0 = (bayer[0] + bayer[width * 2] + 1) >> 1; */
-			t0 = (bayer[1] + bayer[width * 2 + 1] + 1) >> 1;
-			/* Write first pixel */
-			t1 = (bayer[0] + bayer[width * 2] + bayer[width + 1] + 1) / 3;
-			if (blue_line)
-			{
-				*bgr++ = t0;
-				*bgr++ = t1;
-				*bgr++ = bayer[width];
-			}
-			else
-			{
-				*bgr++ = bayer[width];
-				*bgr++ = t1;
-				*bgr++ = t0;
-			}
+	int cw = job->width / 2;
+	int h = 0, w = 0, plane = 0;
 
-			/* Write second pixel */
-			t1 = (bayer[width] + bayer[width + 2] + 1) >> 1;
-			if (blue_line)
-			{
-				*bgr++ = t0;
-				*bgr++ = bayer[width + 1];
-				*bgr++ = t1;
-			}
-			else
-			{
-				*bgr++ = t1;
-				*bgr++ = bayer[width + 1];
-				*bgr++ = t0;
-			}
-			bayer++;
-		}
-		else
-		{
-			/* Write first pixel */
-			t0 = (bayer[0] + bayer[width * 2] + 1) >> 1;
-			if (blue_line)
-			{
-				*bgr++ = t0;
-				*bgr++ = bayer[width];
-				*bgr++ = bayer[width + 1];
-			}
-			else
-			{
-				*bgr++ = bayer[width + 1];
-				*bgr++ = bayer[width];
-				*bgr++ = t0;
-			}
-		}
+	for(h = row_start; h < row_end; ++h)
+		memcpy(job->out[0] + (h * job->out_stride[0]),
+			job->in[0] + (h * job->in_stride[0]), job->width);
 
-		if (blue_line)
-		{
-			for (; bayer <= bayerEnd - 2; bayer += 2)
-			{
-				t0 = (bayer[0] + bayer[2] + bayer[width * 2] +
-					bayer[width * 2 + 2] + 2) >> 2;
-				t1 = (bayer[1] + bayer[width] +
-					bayer[width + 2] + bayer[width * 2 + 1] +
-					2) >> 2;
-				*bgr++ = t0;
-				*bgr++ = t1;
-				*bgr++ = bayer[width + 1];
-
-				t0 = (bayer[2] + bayer[width * 2 + 2] + 1) >> 1;
-				t1 = (bayer[width + 1] + bayer[width + 3] +
-					1) >> 1;
-				*bgr++ = t0;
-				*bgr++ = bayer[width + 2];
-				*bgr++ = t1;
-			}
-		}
-		else
-		{
-			for (; bayer <= bayerEnd - 2; bayer += 2)
-			{
-				t0 = (bayer[0] + bayer[2] + bayer[width * 2] +
-					bayer[width * 2 + 2] + 2) >> 2;
-				t1 = (bayer[1] + bayer[width] +
-					bayer[width + 2] + bayer[width * 2 + 1] +
-					2) >> 2;
-				*bgr++ = bayer[width + 1];
-				*bgr++ = t1;
-				*bgr++ = t0;
-
-				t0 = (bayer[2] + bayer[width * 2 + 2] + 1) >> 1;
-				t1 = (bayer[width + 1] + bayer[width + 3] +
-					1) >> 1;
-				*bgr++ = t1;
-				*bgr++ = bayer[width + 2];
-				*bgr++ = t0;
-			}
-		}
+	for(plane = 1; plane < 3; ++plane)
+	{
+		int in_stride = job->in_stride[plane];
 
-		if (bayer < bayerEnd)
-		{
-			/* write second to last pixel */
-			t0 = (bayer[0] + bayer[2] + bayer[width * 2] +
-				bayer[width * 2 + 2] + 2) >> 2;
-			t1 = (bayer[1] + bayer[width] +
-				bayer[width + 2] + bayer[width * 2 + 1] +
-				2) >> 2;
-			if (blue_line)
-			{
-				*bgr++ = t0;
-				*bgr++ = t1;
-				*bgr++ = bayer[width + 1];
-			}
-			else
-			{
-				*bgr++ = bayer[width + 1];
-				*bgr++ = t1;
-				*bgr++ = t0;
-			}
-			/* write last pixel */
-			t0 = (bayer[2] + bayer[width * 2 + 2] + 1) >> 1;
-			if (blue_line)
-			{
-				*bgr++ = t0;
-				*bgr++ = bayer[width + 2];
-				*bgr++ = bayer[width + 1];
-			}
-			else
-			{
-				*bgr++ = bayer[width + 1];
-				*bgr++ = bayer[width + 2];
-				*bgr++ = t0;
-			}
-			bayer++;
-		}
-		else
+		for(h = row_start / 2; h < row_end / 2; ++h)
 		{
-			/* write last pixel */
-			t0 = (bayer[0] + bayer[width * 2] + 1) >> 1;
-			t1 = (bayer[1] + bayer[width * 2 + 1] + bayer[width] + 1) / 3;
-			if (blue_line)
+			uint8_t *po = job->out[plane] + (h * job->out_stride[plane]);
+			/*first and second input lines of the output line*/
+			uint8_t *in1 = job->in[plane] + ((h << (1 - job->vshift)) * in_stride);
+			uint8_t *in2 = job->vshift ? in1 : in1 + in_stride;
+
+			if(job->hshift)
 			{
-				*bgr++ = t0;
-				*bgr++ = t1;
-				*bgr++ = bayer[width + 1];
+				if(job->vshift)
+					memcpy(po, in1, cw);
+				else
+					for(w = 0; w < cw; ++w)
+						po[w] = (in1[w] + in2[w]) / 2; //average the two lines
 			}
 			else
 			{
-				*bgr++ = bayer[width + 1];
-				*bgr++ = t1;
-				*bgr++ = t0;
+				for(w = 0; w < cw; ++w)
+					po[w] = (in1[2 * w] + in1[2 * w + 1] +
+						in2[2 * w] + in2[2 * w + 1]) / 4;
 			}
 		}
+	}
+}
 
-		/* skip 2 border pixels */
-		bayer += 2;
+/*
+ * convert planar yuv (4:2:0, 4:2:2, 4:4:0 or 4:4:4) to yu12 with line strides
+ *  4:2:0 planes are copied as they are
+ *  row bands are converted in parallel by the thread pool
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointers to input y, u and v planes
+ *    in_stride - input y, u and v line sizes (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    hshift - input chroma horizontal subsampling (log2: 0 or 1)
+ *    vshift - input chroma vertical subsampling (log2: 0 or 1)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void yuv_planar_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t * const in[3], const int in_stride[3], int width, int height,
+	int hshift, int vshift)
+{
+	if(hshift && vshift)
+	{
+		yu12_copy_planes(out, out_stride, in, in_stride, width, height);
+		return;
+	}
 
-		blue_line = !blue_line;
-		start_with_green = !start_with_green;
+	planar_job_t job;
+	int i = 0;
+	for(i = 0; i < 3; ++i)
+	{
+		job.out[i] = out[i];
+		job.out_stride[i] = out_stride[i];
+		job.in[i] = in[i];
+		job.in_stride[i] = in_stride[i];
 	}
+	job.width = width;
+	job.hshift = hshift ? 1 : 0;
+	job.vshift = vshift ? 1 : 0;
 
-	/* render the last line */
-	convert_border_bayer_line_to_bgr24(bayer + width, bayer, bgr, width,
-		!start_with_green, !blue_line);
+	parallel_for_rows(height, 2, CONVERT_MIN_ROWS, yuv_planar_to_yu12_rows, &job);
 }
 
 /*
- * convert bayer raw data to rgb24
+ * packed 422 to yu12 conversion job
+ */
+typedef struct _packed422_job_t
+{
+	uint8_t *out[3];    //output y, u and v planes
+	int out_stride[3];  //output y, u and v line sizes (bytes)
+	uint8_t *in;
+	int in_stride;      //input line size (bytes)
+	int width;
+	int layout;         //packed byte layout (PACKED422_ flags)
+} packed422_job_t;
+
+/*
+ * convert a band of packed 422 yuv rows to 420 planar (yu12)
+ *  lines are converted by the SIMD kernel for the running cpu (if any),
+ *  the scalar loop is the reference and converts the remaining pixels
  * args:
- *   pBay: pointer to buffer containing Raw bayer data
- *   pRGB24: pointer to buffer containing rgb24 data
- *   width: picture width
- *   height: picture height
- *   pix_order: bayer pixel order (0=gb/rg   1=gr/bg  2=bg/gr  3=rg/bg)
+ *    data - pointer to conversion job (packed422_job_t)
+ *    row_start - first row of the band (even)
+ *    row_end - last row of the band (not included)
  *
  * asserts:
- *   none
+ *    none
  *
  * returns: none
  */
-void bayer_to_rgb24(uint8_t *pBay, uint8_t *pRGB24, int width, int height, int pix_order)
+static void packed422_to_yu12_rows(void *data, int row_start, int row_end)
 {
-	switch (pix_order)
+	packed422_job_t *job = (packed422_job_t *) data;
+
+	int width = job->width;
+	int layout = job->layout;
+
+	int w = 0, h = 0;
+
+	int y0 = (layout & PACKED422_Y_ODD) ? 1 : 0; //first luma byte
+	int c0 = 1 - y0; //first chroma byte
+	int u0 = (layout & PACKED422_V_FIRST) ? c0 + 2 : c0; //u byte
+	int v0 = (layout & PACKED422_V_FIRST) ? c0 : c0 + 2; //v byte
+
+	int in_stride = job->in_stride;
+	int y_stride = job->out_stride[0];
+
+	uint8_t *in1 = job->in + (row_start * in_stride); //first line
+	uint8_t *in2 = in1 + in_stride; //second line in packed buffer
+
+	uint8_t *py1 = job->out[0] + (row_start * y_stride); // first line
+	uint8_t *py2 = py1 + y_stride; //second line
+	uint8_t *pu = job->out[1] + ((row_start / 2) * job->out_stride[1]);
+	uint8_t *pv = job->out[2] + ((row_start / 2) * job->out_stride[2]);
+
+	packed422_kernel_t kernel = get_packed422_to_yu12_kernel();
+
+	for(h = row_start; h < row_end; h+=2)
 	{
-		//conversion functions are build for bgr, by switching b and r lines we get rgb
-		case 0: /* gbgbgb... | rgrgrg... (V4L2_PIX_FMT_SGBRG8)*/
-			bayer_to_rgbbgr24(pBay, pRGB24, width, height, TRUE, FALSE);
-			break;
+		in2 = in1 + in_stride;
+		py2 = py1 + y_stride;
 
-		case 1: /* grgrgr... | bgbgbg... (V4L2_PIX_FMT_SGRBG8)*/
-			bayer_to_rgbbgr24(pBay, pRGB24, width, height, TRUE, TRUE);
-			break;
+		w = kernel ? kernel(py1, py2, pu, pv, in1, in2, width, layout) : 0;
 
-		case 2: /* bgbgbg... | grgrgr... (V4L2_PIX_FMT_SBGGR8)*/
-			bayer_to_rgbbgr24(pBay, pRGB24, width, height, FALSE, FALSE);
-			break;
+		for(; w < width; w+=2) //2 bytes per sample
+		{
+			uint8_t *s1 = in1 + (w * 2);
+			uint8_t *s2 = in2 + (w * 2);
 
-		case 3: /* rgrgrg... ! gbgbgb... (V4L2_PIX_FMT_SRGGB8)*/
-			bayer_to_rgbbgr24(pBay, pRGB24, width, height, FALSE, TRUE);
-			break;
+			py1[w] = s1[y0];
+			py1[w + 1] = s1[y0 + 2];
+			py2[w] = s2[y0];
+			py2[w + 1] = s2[y0 + 2];
+			pu[w / 2] = (s1[u0] + s2[u0]) /2; //average u samples
+			pv[w / 2] = (s1[v0] + s2[v0]) /2; //average v samples
+		}
+		in1 = in2 + in_stride;
+		py1 = py2 + y_stride;
+		pu += job->out_stride[1];
+		pv += job->out_stride[2];
+	}
+}
 
-		default: /* default is 0*/
-			bayer_to_rgbbgr24(pBay, pRGB24, width, height, TRUE, FALSE);
-			break;
+/*
+ *convert from packed 422 yuv to 420 planar (yu12) with line strides
+ *  row bands are converted in parallel by the thread pool
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointer to input packed data buffer
+ *    in_stride - input line size (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    layout - packed byte layout (PACKED422_ flags)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void packed422_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t *in, int in_stride, int width, int height, int layout)
+{
+	packed422_job_t job;
+	int i = 0;
+	for(i = 0; i < 3; ++i)
+	{
+		job.out[i] = out[i];
+		job.out_stride[i] = out_stride[i];
 	}
+	job.in = in;
+	job.in_stride = in_stride;
+	job.width = width;
+	job.layout = layout;
+
+	parallel_for_rows(height, 2, CONVERT_MIN_ROWS, packed422_to_yu12_rows, &job);
 }
 
-/*------------------ YU12 ----------------------*/
+/*
+ *convert from packed 422 yuv to 420 planar (yu12)
+ * args:
+ *    out - pointer to output yu12 planar data buffer
+ *    in - pointer to input packed data buffer
+ *    width - frame width
+ *    height - frame height
+ *    layout - packed byte layout (PACKED422_ flags)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void packed422_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int layout)
+{
+	uint8_t *planes[3];
+	int stride[3];
+	yu12_get_planes(out, width, height, planes, stride);
+
+	packed422_to_yu12_stride(planes, stride, in, width * 2, width, height, layout);
+}
 
 /*
  *convert from packed 422 yuv (yuyv) to 420 planar (yu12)
@@ -438,34 +373,7 @@ void yuyv_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
 	assert(in);
 	assert(out);
 
-	int w = 0, h = 0;
-
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in1 + (width * 2); //second line in yuyv buffer
-
-	uint8_t *py1 = out; // first line
-	uint8_t *py2 = py1 + width; //second line
-	uint8_t *pu = py1 + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-
-	for(h = 0; h < height; h+=2)
-	{
-		in2 = in1 + (width * 2);
-		py2 = py1 + width;
-		for(w = 0; w < width; w+=2) //yuyv 2 bytes per sample
-		{
-			//printf("decoding: h:%i w:%i\n", h, w);
-			*py1++ = *in1++;
-			*py2++ = *in2++;
-			*pu++ = ((*in1++) + (*in2++)) /2; //average u samples
-			*py1++ = *in1++;
-			*py2++ = *in2++;
-			*pv++ = ((*in1++) + (*in2++)) /2; //average v samples
-		}
-		in1 = in2;
-		py1 = py2;
-	}
-
+	packed422_to_yu12(out, in, width, height, 0);
 }
 
 /*
@@ -488,33 +396,7 @@ void yvyu_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
 	assert(in);
 	assert(out);
 
-	int w = 0, h = 0;
-
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in1 + (width * 2); //second line in yvyu buffer
-
-	uint8_t *py1 = out; // first line
-	uint8_t *py2 = py1 + width; //second line
-	uint8_t *pu = py1 + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-
-	for(h = 0; h < height; h+=2)
-	{
-		in2 = in1 + (width * 2);
-		py2 = py1 + width;
-		for(w = 0; w < width; w+=2) //yuyv 2 bytes per sample
-		{
-			//printf("decoding: h:%i w:%i\n", h, w);
-			*py1++ = *in1++;
-			*py2++ = *in2++;
-			*pv++ = ((*in1++) + (*in2++)) /2; //average v samples
-			*py1++ = *in1++;
-			*py2++ = *in2++;
-			*pu++ = ((*in1++) + (*in2++)) /2; //average u samples
-		}
-		in1 = in2;
-		py1 = py2;
-	}
+	packed422_to_yu12(out, in, width, height, PACKED422_V_FIRST);
 }
 
 /*
@@ -537,32 +419,7 @@ void uyvy_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
 	assert(in);
 	assert(out);
 
-	int w = 0, h = 0;
-
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in1 + (width * 2); //second line in yuyv buffer
-
-	uint8_t *py1 = out; // first line
-	uint8_t *py2 = py1 + width; //second line
-	uint8_t *pu = py1 + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-
-	for(h = 0; h < height; h+=2)
-	{
-		in2 = in1 + (width * 2);
-		py2 = py1 + width;
-		for(w = 0; w < width; w+=2) //yuyv 2 bytes per sample
-		{
-			*pu++ = ((*in1++) + (*in2++)) /2; //average u samples
-			*py1++ = *in1++;
-			*py2++ = *in2++;
-			*pv++ = ((*in1++) + (*in2++)) /2; //average v samples
-			*py1++ = *in1++;
-			*py2++ = *in2++;
-		}
-		in1 = in2;
-		py1 = py2;
-	}
+	packed422_to_yu12(out, in, width, height, PACKED422_Y_ODD);
 }
 
 /*
@@ -585,34 +442,7 @@ void vyuy_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
 	assert(in);
 	assert(out);
 
-	int w = 0, h = 0;
-	int y_sizeline = width;
-	int c_sizeline = width/2;
-	
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in1 + (width * 2); //second line in yuyv buffer
-
-	uint8_t *py1 = out; // first line
-	uint8_t *py2 = py1 + y_sizeline; //second line
-	uint8_t *pu = py1 + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-
-	for(h = 0; h < height; h+=2)
-	{
-		in2 = in1 + (width * 2);
-		py2 = py1 +  width;
-		for(w = 0; w < width; w+=2) //yuyv 2 bytes per sample
-		{
-			*pv++ = ((*in1++) + (*in2++)) /2; //average v samples
-			*py1++ = *in1++;
-			*py2++ = *in2++;
-			*pu++ = ((*in1++) + (*in2++)) /2; //average u samples
-			*py1++ = *in1++;
-			*py2++ = *in2++;
-		}
-		in1 = in2;
-		py1 = py2;
-	}
+	packed422_to_yu12(out, in, width, height, PACKED422_Y_ODD | PACKED422_V_FIRST);
 }
 
 
@@ -1029,6 +859,57 @@ void yv12_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
 	memcpy(out+((width * height * 5) / 4), in+(width * height), width * height / 4);
 }
 
+/*
+ * downscale a 420 planar (yu12) frame by a power of two (box filter)
+ * args:
+ *    out - pointer to output yu12 planar data buffer
+ *          (width >> shift x height >> shift)
+ *    in - pointer to input yu12 planar data buffer
+ *    width - input frame width
+ *    height - input frame height
+ *    shift - scale factor (1 << shift)
+ *
+ * asserts:
+ *    in is not null
+ *    out is not null
+ *
+ * returns: none
+ */
+void yu12_downscale(uint8_t *out, uint8_t *in, int width, int height, int shift)
+{
+	/*assertions*/
+	assert(in);
+	assert(out);
+
+	int f = 1 << shift;
+	int plane = 0;
+
+	for(plane = 0; plane < 3; plane++)
+	{
+		int pw = (plane == 0) ? width : width / 2;
+		int ph = (plane == 0) ? height : height / 2;
+		int ow = pw >> shift;
+		int oh = ph >> shift;
+		int round = (f * f) / 2;
+		int w = 0, h = 0, i = 0, j = 0;
+
+		for(h = 0; h < oh; h++)
+		{
+			for(w = 0; w < ow; w++)
+			{
+				int sum = 0;
+				uint8_t *pin = in + (h * f) * pw + w * f;
+				for(j = 0; j < f; j++, pin += pw)
+					for(i = 0; i < f; i++)
+						sum += pin[i];
+				*out++ = (uint8_t) ((sum + round) >> (2 * shift));
+			}
+		}
+
+		in += pw * ph;
+	}
+}
+
 /*
  * convert nv12 planar (uv interleaved) to yuv420 planar (yu12)
  * args:
@@ -1750,221 +1631,382 @@ void s508_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
 }
 
 /*
- * convert rgb24 to yu12
+ * fixed point rgb to yuv matrices (Q14)
+ *  BT.601 keeps the coefficients of the original floating point code
+ */
+static const yuv_matrix_t yuv_matrix_bt601 =
+{
+	{  4899,  9617,  1868 }, /*  0.299    0.587    0.114  */
+	{ -2408, -4735,  7143 }, /* -0.147   -0.289    0.436  */
+	{ 10076, -8438, -1638 }  /*  0.615   -0.515   -0.100  */
+};
+
+static const yuv_matrix_t yuv_matrix_bt709 =
+{
+	{  3483, 11718,  1183 }, /*  0.2126   0.7152   0.0722 */
+	{ -1637, -5506,  7143 }, /* -0.09991 -0.33609  0.436  */
+	{ 10076, -9152,  -924 }  /*  0.615   -0.55861 -0.05639 */
+};
+
+/*
+ * get the fixed point rgb to yuv matrix
  * args:
- *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing rgb24 data
- *   width: picture width
- *   height: picture height
+ *    matrix - YUV_MATRIX_BT601 or YUV_MATRIX_BT709
  *
  * asserts:
- *   out is not null
- *   in is not null
+ *    none
  *
- * returns: none
+ * returns: pointer to fixed point matrix
  */
-void rgb24_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+const yuv_matrix_t *get_yuv_matrix(int matrix)
 {
-	/*assertions*/
-	assert(out);
-	assert(in);
+	return (matrix == YUV_MATRIX_BT709) ? &yuv_matrix_bt709 : &yuv_matrix_bt601;
+}
 
-	uint8_t *py = out;
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
+/*
+ * unpack a line of pixels into r, g and b planes
+ * args:
+ *    in - pointer to packed input line
+ *    r - pointer to red plane line
+ *    g - pointer to green plane line
+ *    b - pointer to blue plane line
+ *    width - line width in pixels
+ */
+typedef void (*rgb_unpack_t)(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width);
 
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 3); //second line
+static void unpack_rgb24(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	static const int offset[3] = {0, 1, 2};
+	rgb_deinterleave_kernel_t kernel = get_rgb_deinterleave_kernel();
 
-	int i=0;
-	for(i = 0; i < (width * height * 3); i += 3)
+	int w = kernel ? kernel(in, r, g, b, width, 3, offset) : 0;
+	for(in += w * 3; w < width; w++, in += 3)
 	{
-		/* y */
-		*py++ =CLIP(0.299 * (in1[i] - 128) + 0.587 * (in1[i+1] - 128) + 0.114 * (in1[i+2] - 128) + 128);
+		r[w] = in[offset[0]];
+		g[w] = in[offset[1]];
+		b[w] = in[offset[2]];
 	}
+}
 
-	int h = 0;
-	for(h = 0; h < height; h += 2)
+static void unpack_bgr24(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	static const int offset[3] = {2, 1, 0};
+	rgb_deinterleave_kernel_t kernel = get_rgb_deinterleave_kernel();
+
+	int w = kernel ? kernel(in, r, g, b, width, 3, offset) : 0;
+	for(in += w * 3; w < width; w++, in += 3)
 	{
-		in1 = in + (h * width * 3);
-		in2 = in1 + (width * 3);
+		r[w] = in[offset[0]];
+		g[w] = in[offset[1]];
+		b[w] = in[offset[2]];
+	}
+}
 
-		for(i = 0; i < (width * 3); i += 6)
-		{
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (in1[i] - 128) - 0.289 * (in1[i+1] - 128) + 0.436 * (in1[i+2] - 128) + 128) +
-				(- 0.147 * (in1[i+3] - 128) - 0.289 * (in1[i+4] - 128) + 0.436 * (in1[i+5] - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (in1[i] - 128) - 0.515 * (in1[i+1] - 128) - 0.100 * (in1[i+2] - 128) + 128) +
-				(0.615 * (in1[i+3] - 128) - 0.515 * (in1[i+4] - 128) - 0.100 * (in1[i+5] - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (in2[i] - 128) - 0.289 * (in2[i+1] - 128) + 0.436 * (in2[i+2] - 128) + 128) +
-				(- 0.147 * (in2[i+3] - 128) - 0.289 * (in2[i+4] - 128) + 0.436 * (in2[i+5] - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (in2[i] - 128) - 0.515 * (in2[i+1] - 128) - 0.100 * (in2[i+2] - 128) + 128) +
-				(0.615 * (in2[i+3] - 128) - 0.515 * (in2[i+4] - 128) - 0.100 * (in2[i+5] - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
+/*rgb332*/
+static void unpack_rgb1(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	int w = 0;
+	for(w = 0; w < width; w++)
+	{
+		r[w] = in[w] & 0xE0;
+		g[w] = (in[w] << 3) & 0xE0;
+		b[w] = (in[w] << 6) & 0xC0;
+	}
+}
+
+/*argb444*/
+static void unpack_ar12(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	int w = 0;
+	for(w = 0; w < width; w++, in += 2)
+	{
+		r[w] = (in[1] << 4) & 0xF0;
+		g[w] = in[0] & 0xF0;
+		b[w] = (in[0] << 4) & 0xF0;
+	}
+}
+
+/*argb555*/
+static void unpack_ar15(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	int w = 0;
+	for(w = 0; w < width; w++, in += 2)
+	{
+		r[w] = (in[1] << 1) & 0xF8;
+		g[w] = ((in[1] << 6) & 0xC0) | ((in[0] >> 2) & 0x38);
+		b[w] = (in[0] << 3) & 0xF8;
+	}
+}
+
+/*argb555 (big endian)*/
+static void unpack_ar15x(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	int w = 0;
+	for(w = 0; w < width; w++, in += 2)
+	{
+		r[w] = (in[0] << 1) & 0xF8;
+		g[w] = ((in[0] << 6) & 0xC0) | ((in[1] >> 2) & 0x38);
+		b[w] = (in[1] << 3) & 0xF8;
+	}
+}
+
+/*rgb565*/
+static void unpack_rgbp(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	int w = 0;
+	for(w = 0; w < width; w++, in += 2)
+	{
+		r[w] = in[1] & 0xF8;
+		g[w] = ((in[1] << 5) & 0xE0) | ((in[0] >> 3) & 0x1C);
+		b[w] = (in[0] << 3) & 0xF8;
+	}
+}
+
+/*rgb565 (big endian)*/
+static void unpack_rgbr(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	int w = 0;
+	for(w = 0; w < width; w++, in += 2)
+	{
+		r[w] = in[0] & 0xF8;
+		g[w] = ((in[0] << 5) & 0xE0) | ((in[1] >> 3) & 0x1C);
+		b[w] = (in[1] << 3) & 0xF8;
+	}
+}
+
+/*bgr666*/
+static void unpack_bgrh(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	int w = 0;
+	for(w = 0; w < width; w++, in += 4)
+	{
+		r[w] = ((in[2] >> 4) & 0x0C) | ((in[1] << 4) & 0xF0);
+		g[w] = ((in[1] >> 2) & 0x3C) | ((in[0] << 6) & 0xC0);
+		b[w] = in[0] & 0xFC;
+	}
+}
+
+/*bgra32*/
+static void unpack_ar24(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	static const int offset[3] = {2, 1, 0};
+	rgb_deinterleave_kernel_t kernel = get_rgb_deinterleave_kernel();
+
+	int w = kernel ? kernel(in, r, g, b, width, 4, offset) : 0;
+	for(in += w * 4; w < width; w++, in += 4)
+	{
+		r[w] = in[offset[0]];
+		g[w] = in[offset[1]];
+		b[w] = in[offset[2]];
+	}
+}
+
+/*argb32*/
+static void unpack_ba24(const uint8_t *in, uint8_t *r, uint8_t *g, uint8_t *b, int width)
+{
+	static const int offset[3] = {1, 2, 3};
+	rgb_deinterleave_kernel_t kernel = get_rgb_deinterleave_kernel();
+
+	int w = kernel ? kernel(in, r, g, b, width, 4, offset) : 0;
+	for(in += w * 4; w < width; w++, in += 4)
+	{
+		r[w] = in[offset[0]];
+		g[w] = in[offset[1]];
+		b[w] = in[offset[2]];
 	}
 }
 
 /*
- * convert bgr24 to yu12
+ * convert a pair of planar rgb lines to yu12 (scalar reference)
  * args:
- *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing bgr24 data
- *   width: picture width
- *   height: picture height
+ *    py1 - pointer to first output luma line
+ *    py2 - pointer to second output luma line
+ *    pu - pointer to output u line
+ *    pv - pointer to output v line
+ *    rgb1 - pointers to the r, g and b planes of the first line
+ *    rgb2 - pointers to the r, g and b planes of the second line
+ *    w - first pixel to convert
+ *    width - line width in pixels
+ *    m - pointer to fixed point matrix
  *
  * asserts:
- *   out is not null
- *   in is not null
+ *    none
  *
  * returns: none
  */
-void bgr24_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
-{	
-	/*assertions*/
-	assert(out);
-	assert(in);
-
-	uint8_t *py = out;
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
+static void rgb_planes_to_yu12(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	uint8_t * const rgb1[3], uint8_t * const rgb2[3],
+	int w, int width, const yuv_matrix_t *m)
+{
+	const int y_round = 1 << (YUV_MATRIX_SHIFT - 1);
+	const int c_round = (128 << (YUV_MATRIX_SHIFT + 2)) + (1 << (YUV_MATRIX_SHIFT + 1));
 
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 3); //second line
+	uint8_t *r1 = rgb1[0], *g1 = rgb1[1], *b1 = rgb1[2];
+	uint8_t *r2 = rgb2[0], *g2 = rgb2[1], *b2 = rgb2[2];
 
-	int i = 0;
-	for(i = 0; i < (width * height * 3); i += 3)
+	for(; w < width; w += 2)
 	{
 		/* y */
-		*py++ =CLIP(0.299 * (in1[i+2] - 128) + 0.587 * (in1[i+1] - 128) + 0.114 * (in1[i] - 128) + 128);
-	}
+		py1[w] = (m->y[0] * r1[w] + m->y[1] * g1[w] + m->y[2] * b1[w] + y_round) >> YUV_MATRIX_SHIFT;
+		py1[w+1] = (m->y[0] * r1[w+1] + m->y[1] * g1[w+1] + m->y[2] * b1[w+1] + y_round) >> YUV_MATRIX_SHIFT;
+		py2[w] = (m->y[0] * r2[w] + m->y[1] * g2[w] + m->y[2] * b2[w] + y_round) >> YUV_MATRIX_SHIFT;
+		py2[w+1] = (m->y[0] * r2[w+1] + m->y[1] * g2[w+1] + m->y[2] * b2[w+1] + y_round) >> YUV_MATRIX_SHIFT;
 
-	int h = 0;
-	for(h = 0; h < height; h += 2)
-	{
-		in1 = in + (h * width * 3);
-		in2 = in1 + (width * 3);
+		/* u v (2x2 block) */
+		int rs = r1[w] + r1[w+1] + r2[w] + r2[w+1];
+		int gs = g1[w] + g1[w+1] + g2[w] + g2[w+1];
+		int bs = b1[w] + b1[w+1] + b2[w] + b2[w+1];
 
-		for(i = 0; i < (width * 3); i += 6)
-		{
-			/* u */
-			uint8_t u1 = CLIP(((- 0.147 * (in1[i+2] - 128) - 0.289 * (in1[i+1] - 128) + 0.436 * (in1[i] - 128) + 128) +
-				(- 0.147 * (in1[i+5] - 128) - 0.289 * (in1[i+4] - 128) + 0.436 * (in1[i+3] - 128) + 128))/2);
-			uint8_t u2 = CLIP(((- 0.147 * (in2[i+2] - 128) - 0.289 * (in2[i+1] - 128) + 0.436 * (in2[i] - 128) + 128) +
-				(- 0.147 * (in2[i+5] - 128) - 0.289 * (in2[i+4] - 128) + 0.436 * (in2[i+3] - 128) + 128))/2);
-
-			/* v*/
-			uint8_t v1 =CLIP(((0.615 * (in1[i+2] - 128) - 0.515 * (in1[i+1] - 128) - 0.100 * (in1[i] - 128) + 128) +
-				(0.615 * (in1[i+5] - 128) - 0.515 * (in1[i+4] - 128) - 0.100 * (in1[i+3] - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (in2[i+2] - 128) - 0.515 * (in2[i+1] - 128) - 0.100 * (in2[i] - 128) + 128) +
-				(0.615 * (in2[i+5] - 128) - 0.515 * (in2[i+4] - 128) - 0.100 * (in2[i+3] - 128) + 128))/2);
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
+		int u = (m->u[0] * rs + m->u[1] * gs + m->u[2] * bs + c_round) >> (YUV_MATRIX_SHIFT + 2);
+		int v = (m->v[0] * rs + m->v[1] * gs + m->v[2] * bs + c_round) >> (YUV_MATRIX_SHIFT + 2);
+
+		pu[w / 2] = CLIP(u);
+		pv[w / 2] = CLIP(v);
 	}
 }
 
 /*
- * convert rgb1 (rgb332) to yu12
+ * packed rgb to yu12 conversion job
+ */
+typedef struct _rgb_job_t
+{
+	uint8_t *out[3];      //output y, u and v planes
+	int out_stride[3];    //output y, u and v line sizes (bytes)
+	uint8_t *in;
+	int width;
+	int linesize;         //input line size in bytes
+	rgb_unpack_t unpack;  //line unpack function for the packing
+	const yuv_matrix_t *matrix; //fixed point rgb to yuv matrix
+} rgb_job_t;
+
+/*
+ * convert a band of packed rgb rows to yu12
+ *  each line pair is unpacked to r, g and b planes and converted with
+ *  the fixed point matrix (SIMD kernel for the running cpu, if any)
  * args:
- *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing rgb332 data
- *   width: picture width
- *   height: picture height
+ *    data - pointer to conversion job (rgb_job_t)
+ *    row_start - first row of the band (even)
+ *    row_end - last row of the band (not included)
  *
  * asserts:
- *   out is not null
- *   in is not null
+ *    none
  *
  * returns: none
  */
-void rgb1_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+static void rgb_to_yu12_rows(void *data, int row_start, int row_end)
 {
-	/*assertions*/
-	assert(out);
-	assert(in);
+	rgb_job_t *job = (rgb_job_t *) data;
 
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
+	int width = job->width;
+	int y_stride = job->out_stride[0];
 
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + width; //second line (1 byte per pixel)
+	uint8_t *planes = malloc(width * 6);
+	if(planes == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (rgb_to_yu12_rows): %s\n", strerror(errno));
+		exit(-1);
+	}
 
-	int h = 0;
-	int w = 0;
+	uint8_t * const rgb1[3] = {planes, planes + width, planes + (width * 2)};
+	uint8_t * const rgb2[3] = {planes + (width * 3), planes + (width * 4), planes + (width * 5)};
 
-	for(h = 0; h < height; h += 2)
+	uint8_t *py1 = job->out[0] + (row_start * y_stride);
+	uint8_t *pu = job->out[1] + ((row_start / 2) * job->out_stride[1]);
+	uint8_t *pv = job->out[2] + ((row_start / 2) * job->out_stride[2]);
+
+	const yuv_matrix_t *matrix = job->matrix;
+	rgb_planes_kernel_t kernel = get_rgb_planes_to_yu12_kernel();
+
+	int h = 0;
+	for(h = row_start; h < row_end; h += 2)
 	{
-		in2 = in1 + width;
-		py2 = py1 + width;
+		job->unpack(job->in + (h * job->linesize), rgb1[0], rgb1[1], rgb1[2], width);
+		job->unpack(job->in + ((h + 1) * job->linesize), rgb2[0], rgb2[1], rgb2[2], width);
 
-		for(w = 0; w < width; w +=2)
-		{
-			uint8_t px00 = *in1++;
-			uint8_t r00 = px00 & 0xE0;
-			uint8_t g00 = (px00 << 3) & 0xE0;
-			uint8_t b00 = (px00 << 6) & 0xC0;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			uint8_t px01 = *in1++;
-			uint8_t r01 = px01 & 0xE0;
-			uint8_t g01 = (px01 << 3) & 0xE0;
-			uint8_t b01 = (px01 << 6) & 0xC0;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			uint8_t px10 = *in2++;
-			uint8_t r10 = px10 & 0xE0;
-			uint8_t g10 = (px10 << 3) & 0xE0;
-			uint8_t b10 = (px10 << 6) & 0xC0;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			uint8_t px11 = *in2++;
-			uint8_t r11 = px11 & 0xE0;
-			uint8_t g11 = (px11 << 3) & 0xE0;
-			uint8_t b11 = (px11 << 6) & 0xC0;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
+		int w = kernel ? kernel(py1, py1 + y_stride, pu, pv, rgb1, rgb2, width, matrix) : 0;
+		rgb_planes_to_yu12(py1, py1 + y_stride, pu, pv, rgb1, rgb2, w, width, matrix);
 
-		in1 = in2;
-		py1 = py2;
+		py1 += y_stride * 2;
+		pu += job->out_stride[1];
+		pv += job->out_stride[2];
 	}
+
+	free(planes);
 }
 
 /*
- * convert ar12 (argb444) to yu12
+ * convert packed rgb to yu12 with line strides
+ *  row bands are converted in parallel by the thread pool
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointer to input packed rgb data buffer
+ *    linesize - input line size in bytes
+ *    width - frame width
+ *    height - frame height
+ *    unpack - line unpack function for the packing
+ *    matrix - pointer to fixed point matrix
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void rgb_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t *in, int linesize, int width, int height, rgb_unpack_t unpack,
+	const yuv_matrix_t *matrix)
+{
+	rgb_job_t job;
+	int i = 0;
+	for(i = 0; i < 3; ++i)
+	{
+		job.out[i] = out[i];
+		job.out_stride[i] = out_stride[i];
+	}
+	job.in = in;
+	job.width = width;
+	job.linesize = linesize;
+	job.unpack = unpack;
+	job.matrix = matrix;
+
+	parallel_for_rows(height, 2, CONVERT_MIN_ROWS, rgb_to_yu12_rows, &job);
+}
+
+/*
+ * convert packed rgb to yu12
+ * args:
+ *    out - pointer to output yu12 planar data buffer
+ *    in - pointer to input packed rgb data buffer
+ *    width - frame width
+ *    height - frame height
+ *    linesize - input line size in bytes
+ *    unpack - line unpack function for the packing
+ *    matrix - pointer to fixed point matrix
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void rgb_to_yu12(uint8_t *out, uint8_t *in, int width, int height,
+	int linesize, rgb_unpack_t unpack, const yuv_matrix_t *matrix)
+{
+	uint8_t *planes[3];
+	int stride[3];
+	yu12_get_planes(out, width, height, planes, stride);
+
+	rgb_to_yu12_stride(planes, stride, in, linesize, width, height, unpack, matrix);
+}
+
+/*
+ * convert rgb24 to yu12
  * args:
  *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing argb444 data
+ *   in: pointer to input buffer containing rgb24 data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -1972,93 +2014,23 @@ void rgb1_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
  *
  * returns: none
  */
-void ar12_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+void rgb24_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
 {
 	/*assertions*/
 	assert(out);
 	assert(in);
 
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 2); //second line (2 byte per pixel)
-
-	int h = 0;
-	int w = 0;
-
-	for(h = 0; h < height; h += 2)
-	{
-		in2 = in1 + (width * 2);
-		py2 = py1 + width;
-
-		for(w = 0; w < (width * 2); w +=4)
-		{
-			uint8_t px000 = *in1++;
-			uint8_t px001 = *in1++;
-			uint8_t r00 = (px001 << 4) & 0xF0;
-			uint8_t g00 = px000 & 0xF0;
-			uint8_t b00 = (px000 << 4) & 0xF0;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			uint8_t px010 = *in1++;
-			uint8_t px011 = *in1++;
-			uint8_t r01 = (px011 << 4) & 0xF0;
-			uint8_t g01 = px010 & 0xF0;
-			uint8_t b01 = (px010 << 4) & 0xF0;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			uint8_t px100 = *in2++;
-			uint8_t px101 = *in2++;
-			uint8_t r10 = (px101 << 4) & 0xF0;
-			uint8_t g10 = px100 & 0xF0;
-			uint8_t b10 = (px100 << 4) & 0xF0;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			uint8_t px110 = *in2++;
-			uint8_t px111 = *in2++;
-			uint8_t r11 = (px111 << 4) & 0xF0;
-			uint8_t g11 = px110 & 0xF0;
-			uint8_t b11 = (px110 << 4) & 0xF0;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
-
-		in1 = in2;
-		py1 = py2;
-	}
+	rgb_to_yu12(out, in, width, height, width * 3, unpack_rgb24, get_yuv_matrix(matrix));
 }
 
 /*
- * convert ar15 (argb555) to yu12
+ * convert bgr24 to yu12
  * args:
  *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing argb555 data
+ *   in: pointer to input buffer containing bgr24 data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -2066,84 +2038,85 @@ void ar12_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
  *
  * returns: none
  */
-void ar15_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+void bgr24_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
 {
 	/*assertions*/
 	assert(out);
 	assert(in);
 
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
+	rgb_to_yu12(out, in, width, height, width * 3, unpack_bgr24, get_yuv_matrix(matrix));
+}
 
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 2); //second line (2 byte per pixel)
+/*
+ * convert rgb1 (rgb332) to yu12
+ * args:
+ *   out: pointer to output buffer containing yu12 data
+ *   in: pointer to input buffer containing rgb332 data
+ *   width: picture width
+ *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *
+ * asserts:
+ *   out is not null
+ *   in is not null
+ *
+ * returns: none
+ */
+void rgb1_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
 
-	int h = 0;
-	int w = 0;
+	rgb_to_yu12(out, in, width, height, width, unpack_rgb1, get_yuv_matrix(matrix));
+}
 
-	for(h = 0; h < height; h += 2)
-	{
-		in2 = in1 + (width * 2);
-		py2 = py1 + width;
+/*
+ * convert ar12 (argb444) to yu12
+ * args:
+ *   out: pointer to output buffer containing yu12 data
+ *   in: pointer to input buffer containing argb444 data
+ *   width: picture width
+ *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *
+ * asserts:
+ *   out is not null
+ *   in is not null
+ *
+ * returns: none
+ */
+void ar12_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
 
-		for(w = 0; w < (width * 2); w +=4)
-		{
-			uint8_t px000 = *in1++;
-			uint8_t px001 = *in1++;
-			uint8_t r00 = (px001 << 1) & 0xF8;
-			uint8_t g00 = ((px001 << 6) & 0xC0) | ((px000 >> 2) & 0x38);
-			uint8_t b00 = (px000 << 3) & 0xF8;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			uint8_t px010 = *in1++;
-			uint8_t px011 = *in1++;
-			uint8_t r01 = (px011 << 1) & 0xF8;
-			uint8_t g01 = ((px011 << 6) & 0xC0) | ((px010 >> 2) & 0x38);
-			uint8_t b01 = (px010 << 3) & 0xF8;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			uint8_t px100 = *in2++;
-			uint8_t px101 = *in2++;
-			uint8_t r10 = (px101 << 1) & 0xF8;
-			uint8_t g10 = ((px101 << 6) & 0xC0) | ((px100 >> 2) & 0x38);
-			uint8_t b10 = (px100 << 3) & 0xF8;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			uint8_t px110 = *in2++;
-			uint8_t px111 = *in2++;
-			uint8_t r11 = (px111 << 1) & 0xF8;
-			uint8_t g11 = ((px111 << 6) & 0xC0) | ((px110 >> 2) & 0x38);
-			uint8_t b11 = (px110 << 3) & 0xF8;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
+	rgb_to_yu12(out, in, width, height, width * 2, unpack_ar12, get_yuv_matrix(matrix));
+}
 
-		in1 = in2;
-		py1 = py2;
-	}
+/*
+ * convert ar15 (argb555) to yu12
+ * args:
+ *   out: pointer to output buffer containing yu12 data
+ *   in: pointer to input buffer containing argb555 data
+ *   width: picture width
+ *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *
+ * asserts:
+ *   out is not null
+ *   in is not null
+ *
+ * returns: none
+ */
+void ar15_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
+
+	rgb_to_yu12(out, in, width, height, width * 2, unpack_ar15, get_yuv_matrix(matrix));
 }
 
 /*
@@ -2153,6 +2126,7 @@ void ar15_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
  *   in: pointer to input buffer containing argb555X (be) data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -2160,560 +2134,1016 @@ void ar15_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
  *
  * returns: none
  */
-void ar15x_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+void ar15x_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
 {
 	/*assertions*/
 	assert(out);
 	assert(in);
 
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
+	rgb_to_yu12(out, in, width, height, width * 2, unpack_ar15x, get_yuv_matrix(matrix));
+}
 
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 2); //second line (2 byte per pixel)
+/*
+ * convert rgbp (rgb565) to yu12
+ * args:
+ *   out: pointer to output buffer containing yu12 data
+ *   in: pointer to input buffer containing argb555 data
+ *   width: picture width
+ *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *
+ * asserts:
+ *   out is not null
+ *   in is not null
+ *
+ * returns: none
+ */
+void rgbp_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
+
+	rgb_to_yu12(out, in, width, height, width * 2, unpack_rgbp, get_yuv_matrix(matrix));
+}
+
+/*
+ * convert rgbr (rgb565X) to yu12
+ * args:
+ *   out: pointer to output buffer containing yu12 data
+ *   in: pointer to input buffer containing rgb565 bigendian data
+ *   width: picture width
+ *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *
+ * asserts:
+ *   out is not null
+ *   in is not null
+ *
+ * returns: none
+ */
+void rgbr_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
+
+	rgb_to_yu12(out, in, width, height, width * 2, unpack_rgbr, get_yuv_matrix(matrix));
+}
 
+/*
+ * convert bgrh to yu12
+ * args:
+ *   out: pointer to output buffer containing yu12 data
+ *   in: pointer to input buffer containing bgrh (bgr666) data
+ *   width: picture width
+ *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *
+ * asserts:
+ *   out is not null
+ *   in is not null
+ *
+ * returns: none
+ */
+void bgrh_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
+
+	rgb_to_yu12(out, in, width, height, width * 4, unpack_bgrh, get_yuv_matrix(matrix));
+}
+
+/*
+ * convert ar24 to yu12
+ * args:
+ *   out: pointer to output buffer containing yu12 data
+ *   in: pointer to input buffer containing ar24 (bgr32) data
+ *   width: picture width
+ *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *
+ * asserts:
+ *   out is not null
+ *   in is not null
+ *
+ * returns: none
+ */
+void ar24_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
+
+	rgb_to_yu12(out, in, width, height, width * 4, unpack_ar24, get_yuv_matrix(matrix));
+}
+
+/*
+ * convert ba24 to yu12
+ * args:
+ *   out: pointer to output buffer containing yu12 data
+ *   in: pointer to input buffer containing ba24 (rgb32) data
+ *   width: picture width
+ *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *
+ * asserts:
+ *   out is not null
+ *   in is not null
+ *
+ * returns: none
+ */
+void ba24_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
+
+	rgb_to_yu12(out, in, width, height, width * 4, unpack_ba24, get_yuv_matrix(matrix));
+}
+
+/*
+ * copy a 420 planar frame (yu12 or yv12) with line strides
+ *  the input chroma planes follow the luma plane with half its line size
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointer to input planar data buffer
+ *    in_stride - input luma line size (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    swap_uv - if set the v plane comes first (yv12)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void planar420_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t *in, int in_stride, int width, int height, int swap_uv)
+{
+	uint8_t *in_planes[3];
+	int in_strides[3] = {in_stride, in_stride / 2, in_stride / 2};
+
+	in_planes[0] = in;
+	in_planes[swap_uv ? 2 : 1] = in + (in_stride * height);
+	in_planes[swap_uv ? 1 : 2] = in + (in_stride * height) + ((in_stride / 2) * (height / 2));
+
+	yu12_copy_planes(out, out_stride, in_planes, in_strides, width, height);
+}
+
+/*
+ * convert nv12 or nv21 (uv interleaved) to yu12 with line strides
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointer to input planar data buffer
+ *    in_stride - input luma and chroma line size (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    swap_uv - if set v samples come first (nv21)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void nv_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t *in, int in_stride, int width, int height, int swap_uv)
+{
 	int h = 0;
 	int w = 0;
 
-	for(h = 0; h < height; h += 2)
+	for(h = 0; h < height; ++h)
+		memcpy(out[0] + (h * out_stride[0]), in + (h * in_stride), width);
+
+	uint8_t *puv = in + (in_stride * height);
+	int u0 = swap_uv ? 1 : 0;
+
+	for(h = 0; h < height / 2; ++h)
 	{
-		in2 = in1 + (width * 2);
-		py2 = py1 + width;
+		uint8_t *pu = out[1] + (h * out_stride[1]);
+		uint8_t *pv = out[2] + (h * out_stride[2]);
+		uint8_t *uv = puv + (h * in_stride);
 
-		for(w = 0; w < (width * 2); w +=4)
+		for(w = 0; w < width / 2; ++w)
 		{
-			uint8_t px000 = *in1++;
-			uint8_t px001 = *in1++;
-			uint8_t r00 = (px000 << 1) & 0xF8;
-			uint8_t g00 = ((px000 << 6) & 0xC0) | ((px001 >> 2) & 0x38);
-			uint8_t b00 = (px001 << 3) & 0xF8;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			uint8_t px010 = *in1++;
-			uint8_t px011 = *in1++;
-			uint8_t r01 = (px010 << 1) & 0xF8;
-			uint8_t g01 = ((px010 << 6) & 0xC0) | ((px011 >> 2) & 0x38);
-			uint8_t b01 = (px011 << 3) & 0xF8;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			uint8_t px100 = *in2++;
-			uint8_t px101 = *in2++;
-			uint8_t r10 = (px100 << 1) & 0xF8;
-			uint8_t g10 = ((px100 << 6) & 0xC0) | ((px101 >> 2) & 0x38);
-			uint8_t b10 = (px101 << 3) & 0xF8;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			uint8_t px110 = *in2++;
-			uint8_t px111 = *in2++;
-			uint8_t r11 = (px110 << 1) & 0xF8;
-			uint8_t g11 = ((px110 << 6) & 0xC0) | ((px111 >> 2) & 0x38);
-			uint8_t b11 = (px111 << 3) & 0xF8;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
+			pu[w] = uv[(w * 2) + u0];
+			pv[w] = uv[(w * 2) + 1 - u0];
 		}
+	}
+}
+
+/*---------------- fused bayer demosaic to yu12 -------------*/
+
+/*number of cached (unpacked) bayer lines: 5 tap filter + line pair*/
+#define BAYER_CACHE_LINES (6)
+/*border pixels on each side of a cached line (5 tap filter)*/
+#define BAYER_BORDER (2)
+
+/*
+ * bayer to yu12 conversion job
+ */
+typedef struct _bayer_job_t
+{
+	uint8_t *out[3];      //output y, u and v planes
+	int out_stride[3];    //output y, u and v line sizes (bytes)
+	uint8_t *in;
+	int in_stride;        //input line size in bytes
+	int width;
+	int height;
+	int pix_order;        //bayer pixel order (0=gb/rg 1=gr/bg 2=bg/gr 3=rg/gb)
+	int sample;           //input sample format (BAYER_SAMPLE_)
+	int mode;             //demosaic filter (DEMOSAIC_)
+	const yuv_matrix_t *matrix; //fixed point rgb to yuv matrix
+} bayer_job_t;
+
+/*
+ * mirror a coordinate into [0, size[ (reflection keeps the cfa parity)
+ * args:
+ *    i - coordinate
+ *    size - line or column size
+ *
+ * asserts:
+ *    none
+ *
+ * returns: mirrored coordinate
+ */
+static inline int bayer_reflect(int i, int size)
+{
+	if(i < 0)
+		i = -i;
+	if(i >= size)
+		i = (2 * size) - 2 - i;
+	/*only for tiny frames*/
+	if(i < 0)
+		i = 0;
+	if(i >= size)
+		i = size - 1;
+	return i;
+}
+
+/*
+ * unpack a bayer line to 8 bit samples and mirror the borders
+ * args:
+ *    in - pointer to input line
+ *    out - pointer to output line (width + 2 * BAYER_BORDER)
+ *    width - line width in pixels
+ *    sample - input sample format (BAYER_SAMPLE_)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void bayer_unpack_line(const uint8_t *in, uint8_t *out, int width, int sample)
+{
+	uint8_t *po = out + BAYER_BORDER;
+	int shift = 0;
+	int w = 0;
+
+	switch(sample)
+	{
+		case BAYER_SAMPLE_10:
+			shift = 2;
+			break;
+		case BAYER_SAMPLE_12:
+			shift = 4;
+			break;
+		case BAYER_SAMPLE_16:
+			shift = 8;
+			break;
+	}
+
+	switch(sample)
+	{
+		case BAYER_SAMPLE_10:
+		case BAYER_SAMPLE_12:
+		case BAYER_SAMPLE_16:
+			/*little endian 16 bit words, keep the 8 most significant bits*/
+			for(w = 0; w < width; ++w, in += 2)
+			{
+				int v = (in[0] | (in[1] << 8)) >> shift;
+				po[w] = (v > 255) ? 255 : v;
+			}
+			break;
+
+		case BAYER_SAMPLE_10P:
+			/*4 pixels in 5 bytes: 4 msb bytes + 1 byte with the 2 lsb of each*/
+			for(w = 0; w < width; ++w)
+				po[w] = in[((w >> 2) * 5) + (w & 3)];
+			break;
+
+		case BAYER_SAMPLE_12P:
+			/*2 pixels in 3 bytes: 2 msb bytes + 1 byte with the 4 lsb of each*/
+			for(w = 0; w < width; ++w)
+				po[w] = in[((w >> 1) * 3) + (w & 1)];
+			break;
+
+		default:
+			memcpy(po, in, width);
+			break;
+	}
+
+	for(w = 1; w <= BAYER_BORDER; ++w)
+	{
+		po[-w] = po[bayer_reflect(-w, width)];
+		po[width - 1 + w] = po[bayer_reflect(width - 1 + w, width)];
+	}
+}
+
+#define BAYER_CLIP16(v) CLIP(((v) + 8) >> 4)
+
+/*
+ * bayer line neighbourhood: lines y-2 to y+2 and the r, g and b output planes
+ *  c - colour of the non green samples in the line, o - the other colour
+ */
+typedef struct _bayer_lines_t
+{
+	const uint8_t *n2, *n1, *p0, *s1, *s2;
+	uint8_t *pc, *po, *pg;
+} bayer_lines_t;
+
+/*bilinear interpolation at a green sample*/
+static inline void bilinear_green(const bayer_lines_t *l, int w)
+{
+	l->pg[w] = l->p0[w];
+	l->pc[w] = (l->p0[w-1] + l->p0[w+1] + 1) >> 1;
+	l->po[w] = (l->n1[w] + l->s1[w] + 1) >> 1;
+}
+
+/*bilinear interpolation at a red or blue sample*/
+static inline void bilinear_colour(const bayer_lines_t *l, int w)
+{
+	l->pc[w] = l->p0[w];
+	l->pg[w] = (l->p0[w-1] + l->p0[w+1] + l->n1[w] + l->s1[w] + 2) >> 2;
+	l->po[w] = (l->n1[w-1] + l->n1[w+1] + l->s1[w-1] + l->s1[w+1] + 2) >> 2;
+}
+
+/*
+ * Malvar-He-Cutler interpolation at a green sample
+ *  (filter coefficients x16)
+ */
+static inline void mhc_green(const bayer_lines_t *l, int w)
+{
+	const uint8_t *p0 = l->p0;
+	int c = p0[w] * 10;
+	int diag = l->n1[w-1] + l->n1[w+1] + l->s1[w-1] + l->s1[w+1];
+	int vert2 = l->n2[w] + l->s2[w];
+	int horz2 = p0[w-2] + p0[w+2];
+
+	/*line colour (horizontal neighbours) and column colour (vertical)*/
+	int h = c + (8 * (p0[w-1] + p0[w+1])) - (2 * horz2) - (2 * diag) + vert2;
+	int v = c + (8 * (l->n1[w] + l->s1[w])) - (2 * vert2) - (2 * diag) + horz2;
+
+	l->pg[w] = p0[w];
+	l->pc[w] = BAYER_CLIP16(h);
+	l->po[w] = BAYER_CLIP16(v);
+}
+
+/*
+ * Malvar-He-Cutler interpolation at a red or blue sample
+ *  (filter coefficients x16)
+ */
+static inline void mhc_colour(const bayer_lines_t *l, int w)
+{
+	const uint8_t *p0 = l->p0;
+	int c = p0[w];
+	int cross = p0[w-1] + p0[w+1] + l->n1[w] + l->s1[w];
+	int cross2 = l->n2[w] + l->s2[w] + p0[w-2] + p0[w+2];
+	int diag = l->n1[w-1] + l->n1[w+1] + l->s1[w-1] + l->s1[w+1];
+
+	int g = (8 * c) + (4 * cross) - (2 * cross2);
+	int o = (12 * c) + (4 * diag) - (3 * cross2);
+
+	l->pc[w] = c;
+	l->pg[w] = BAYER_CLIP16(g);
+	l->po[w] = BAYER_CLIP16(o);
+}
+
+/*
+ * demosaic a bayer line into r, g and b planes
+ *  bilinear: 3x3 neighbourhood
+ *  mhc: Malvar-He-Cutler 5x5 gradient corrected filters
+ * args:
+ *    rows - pointers to the unpacked lines y-2 to y+2 (first pixel)
+ *    rgb - pointers to the r, g and b output planes
+ *    width - line width in pixels (even)
+ *    red_line - the non green samples of the line are red
+ *    green_odd - green samples are on odd columns
+ *    mode - demosaic filter (DEMOSAIC_)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void demosaic_line(uint8_t * const rows[5], uint8_t * const rgb[3],
+	int width, int red_line, int green_odd, int mode)
+{
+	bayer_lines_t l;
+	l.n2 = rows[0];
+	l.n1 = rows[1];
+	l.p0 = rows[2];
+	l.s1 = rows[3];
+	l.s2 = rows[4];
+	l.pc = rgb[red_line ? 0 : 2];
+	l.po = rgb[red_line ? 2 : 0];
+	l.pg = rgb[1];
+
+	int w = 0;
+
+	/*the cfa phase is fixed for the line: no per pixel branches*/
+	if(mode == DEMOSAIC_MHC)
+	{
+		if(green_odd)
+			for(w = 0; w < width; w += 2)
+			{
+				mhc_colour(&l, w);
+				mhc_green(&l, w + 1);
+			}
+		else
+			for(w = 0; w < width; w += 2)
+			{
+				mhc_green(&l, w);
+				mhc_colour(&l, w + 1);
+			}
+	}
+	else
+	{
+		if(green_odd)
+			for(w = 0; w < width; w += 2)
+			{
+				bilinear_colour(&l, w);
+				bilinear_green(&l, w + 1);
+			}
+		else
+			for(w = 0; w < width; w += 2)
+			{
+				bilinear_green(&l, w);
+				bilinear_colour(&l, w + 1);
+			}
+	}
+}
+
+/*
+ * convert a band of bayer rows to yu12
+ *  the bayer lines around each line pair are unpacked to a small line cache,
+ *  demosaiced to r, g and b planes and converted with the fixed point matrix
+ *  (SIMD kernel for the running cpu, if any) - no full frame rgb buffer
+ * args:
+ *    data - pointer to conversion job (bayer_job_t)
+ *    row_start - first row of the band (even)
+ *    row_end - last row of the band (not included)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void bayer_to_yu12_rows(void *data, int row_start, int row_end)
+{
+	bayer_job_t *job = (bayer_job_t *) data;
+
+	int width = job->width;
+	int line_size = width + (2 * BAYER_BORDER);
+	int y_stride = job->out_stride[0];
+
+	uint8_t *buffer = malloc((width * 6) + (line_size * BAYER_CACHE_LINES));
+	if(buffer == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (bayer_to_yu12_rows): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	uint8_t * const rgb1[3] = {buffer, buffer + width, buffer + (width * 2)};
+	uint8_t * const rgb2[3] = {buffer + (width * 3), buffer + (width * 4), buffer + (width * 5)};
+	uint8_t *cache = buffer + (width * 6);
+
+	/*source line held by each cache slot*/
+	int cache_line[BAYER_CACHE_LINES];
+	int i = 0;
+	for(i = 0; i < BAYER_CACHE_LINES; ++i)
+		cache_line[i] = -1;
+
+	/*
+	 * pix_order: 0=gb/rg 1=gr/bg 2=bg/gr 3=rg/gb
+	 * first line: green on odd columns for 2 and 3, red samples for 1 and 3
+	 */
+	int green_odd = (job->pix_order == 2 || job->pix_order == 3) ? 1 : 0;
+	int red_line = (job->pix_order == 1 || job->pix_order == 3) ? 1 : 0;
+
+	uint8_t *py1 = job->out[0] + (row_start * y_stride);
+	uint8_t *pu = job->out[1] + ((row_start / 2) * job->out_stride[1]);
+	uint8_t *pv = job->out[2] + ((row_start / 2) * job->out_stride[2]);
+
+	const yuv_matrix_t *matrix = job->matrix;
+	rgb_planes_kernel_t kernel = get_rgb_planes_to_yu12_kernel();
+
+	int h = 0;
+	for(h = row_start; h < row_end; h += 2)
+	{
+		uint8_t *rows[BAYER_CACHE_LINES];
+
+		/*
+		 * lines h-2 to h+3 (mirrored at the frame borders):
+		 * any 6 consecutive lines map to distinct slots
+		 */
+		for(i = 0; i < BAYER_CACHE_LINES; ++i)
+		{
+			int line = bayer_reflect(h - BAYER_BORDER + i, job->height);
+			int slot = line % BAYER_CACHE_LINES;
+
+			uint8_t *pl = cache + (slot * line_size);
+			if(cache_line[slot] != line)
+			{
+				bayer_unpack_line(job->in + (line * job->in_stride), pl, width, job->sample);
+				cache_line[slot] = line;
+			}
+			rows[i] = pl + BAYER_BORDER;
+		}
+
+		/*h is even: same cfa phase as the first line*/
+		demosaic_line(rows, rgb1, width, red_line, green_odd, job->mode);
+		demosaic_line(rows + 1, rgb2, width, !red_line, !green_odd, job->mode);
+
+		int w = kernel ? kernel(py1, py1 + y_stride, pu, pv, rgb1, rgb2, width, matrix) : 0;
+		rgb_planes_to_yu12(py1, py1 + y_stride, pu, pv, rgb1, rgb2, w, width, matrix);
+
+		py1 += y_stride * 2;
+		pu += job->out_stride[1];
+		pv += job->out_stride[2];
+	}
+
+	free(buffer);
+}
+
+/*
+ * convert raw bayer data to yu12 with line strides (single pass)
+ *  row bands are converted in parallel by the thread pool
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointer to input bayer data
+ *    in_stride - input line size (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    pix_order - bayer pixel order (0=gb/rg 1=gr/bg 2=bg/gr 3=rg/gb)
+ *    sample - input sample format (BAYER_SAMPLE_)
+ *    matrix - rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *    demosaic - demosaic filter (DEMOSAIC_BILINEAR or DEMOSAIC_MHC)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void bayer_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t *in, int in_stride, int width, int height, int pix_order, int sample,
+	int matrix, int demosaic)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
+
+	bayer_job_t job;
+	int i = 0;
+	for(i = 0; i < 3; ++i)
+	{
+		job.out[i] = out[i];
+		job.out_stride[i] = out_stride[i];
+	}
+	job.in = in;
+	job.in_stride = in_stride;
+	job.width = width;
+	job.height = height;
+	job.pix_order = pix_order;
+	job.sample = sample;
+	job.mode = (demosaic == DEMOSAIC_MHC) ? DEMOSAIC_MHC : DEMOSAIC_BILINEAR;
+	job.matrix = get_yuv_matrix(matrix);
+
+	parallel_for_rows(height, 2, CONVERT_MIN_ROWS, bayer_to_yu12_rows, &job);
+}
+
+/*
+ * get the bayer pixel order and sample format of a v4l2 bayer format
+ * args:
+ *    format - v4l2 pixel format
+ *    pix_order - pointer to bayer pixel order (to be filled)
+ *    sample - pointer to sample format (to be filled)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: 1 if format is a supported bayer format, 0 otherwise
+ */
+static int get_bayer_format(uint32_t format, int *pix_order, int *sample)
+{
+	switch(format)
+	{
+		case V4L2_PIX_FMT_SGBRG8:
+			*pix_order = 0; *sample = BAYER_SAMPLE_8; break;
+		case V4L2_PIX_FMT_SGRBG8:
+			*pix_order = 1; *sample = BAYER_SAMPLE_8; break;
+		case V4L2_PIX_FMT_SBGGR8:
+			*pix_order = 2; *sample = BAYER_SAMPLE_8; break;
+		case V4L2_PIX_FMT_SRGGB8:
+			*pix_order = 3; *sample = BAYER_SAMPLE_8; break;
+
+		case V4L2_PIX_FMT_SGBRG10:
+			*pix_order = 0; *sample = BAYER_SAMPLE_10; break;
+		case V4L2_PIX_FMT_SGRBG10:
+			*pix_order = 1; *sample = BAYER_SAMPLE_10; break;
+		case V4L2_PIX_FMT_SBGGR10:
+			*pix_order = 2; *sample = BAYER_SAMPLE_10; break;
+		case V4L2_PIX_FMT_SRGGB10:
+			*pix_order = 3; *sample = BAYER_SAMPLE_10; break;
+
+		case V4L2_PIX_FMT_SGBRG12:
+			*pix_order = 0; *sample = BAYER_SAMPLE_12; break;
+		case V4L2_PIX_FMT_SGRBG12:
+			*pix_order = 1; *sample = BAYER_SAMPLE_12; break;
+		case V4L2_PIX_FMT_SBGGR12:
+			*pix_order = 2; *sample = BAYER_SAMPLE_12; break;
+		case V4L2_PIX_FMT_SRGGB12:
+			*pix_order = 3; *sample = BAYER_SAMPLE_12; break;
+
+		case V4L2_PIX_FMT_SBGGR16:
+			*pix_order = 2; *sample = BAYER_SAMPLE_16; break;
+#ifdef V4L2_PIX_FMT_SGBRG16
+		case V4L2_PIX_FMT_SGBRG16:
+			*pix_order = 0; *sample = BAYER_SAMPLE_16; break;
+		case V4L2_PIX_FMT_SGRBG16:
+			*pix_order = 1; *sample = BAYER_SAMPLE_16; break;
+		case V4L2_PIX_FMT_SRGGB16:
+			*pix_order = 3; *sample = BAYER_SAMPLE_16; break;
+#endif
+
+#ifdef V4L2_PIX_FMT_SBGGR10P
+		case V4L2_PIX_FMT_SGBRG10P:
+			*pix_order = 0; *sample = BAYER_SAMPLE_10P; break;
+		case V4L2_PIX_FMT_SGRBG10P:
+			*pix_order = 1; *sample = BAYER_SAMPLE_10P; break;
+		case V4L2_PIX_FMT_SBGGR10P:
+			*pix_order = 2; *sample = BAYER_SAMPLE_10P; break;
+		case V4L2_PIX_FMT_SRGGB10P:
+			*pix_order = 3; *sample = BAYER_SAMPLE_10P; break;
+#endif
+
+#ifdef V4L2_PIX_FMT_SBGGR12P
+		case V4L2_PIX_FMT_SGBRG12P:
+			*pix_order = 0; *sample = BAYER_SAMPLE_12P; break;
+		case V4L2_PIX_FMT_SGRBG12P:
+			*pix_order = 1; *sample = BAYER_SAMPLE_12P; break;
+		case V4L2_PIX_FMT_SBGGR12P:
+			*pix_order = 2; *sample = BAYER_SAMPLE_12P; break;
+		case V4L2_PIX_FMT_SRGGB12P:
+			*pix_order = 3; *sample = BAYER_SAMPLE_12P; break;
+#endif
+
+		default:
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * convert a raw frame to yu12 with line strides
+ *  honors the driver line size (bytesperline) of the input
+ *  and the (aligned) line sizes of the output planes
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointer to input frame data
+ *    in_stride - input line size of the first plane (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    format - v4l2 pixel format of the input
+ *    matrix - rgb to yuv matrix for rgb and bayer formats
+ *             (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *    demosaic - demosaic filter for bayer formats
+ *               (DEMOSAIC_BILINEAR or DEMOSAIC_MHC)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: error code (E_OK, E_FORMAT_ERR if the format has
+ *          no stride aware converter)
+ */
+int raw_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t *in, int in_stride, int width, int height, uint32_t format,
+	int matrix, int demosaic)
+{
+	/*assertions*/
+	assert(out);
+	assert(in);
+
+	int h = 0;
+	int pix_order = 0;
+	int sample = 0;
+
+	if(get_bayer_format(format, &pix_order, &sample))
+	{
+		bayer_to_yu12_stride(out, out_stride, in, in_stride, width, height, pix_order, sample, matrix, demosaic);
+		return E_OK;
+	}
+
+	const yuv_matrix_t *yuv_matrix = get_yuv_matrix(matrix);
+
+	switch(format)
+	{
+		case V4L2_PIX_FMT_YUYV:
+			packed422_to_yu12_stride(out, out_stride, in, in_stride, width, height, 0);
+			break;
+
+		case V4L2_PIX_FMT_YVYU:
+			packed422_to_yu12_stride(out, out_stride, in, in_stride, width, height, PACKED422_V_FIRST);
+			break;
+
+		case V4L2_PIX_FMT_UYVY:
+			packed422_to_yu12_stride(out, out_stride, in, in_stride, width, height, PACKED422_Y_ODD);
+			break;
+
+		case V4L2_PIX_FMT_VYUY:
+			packed422_to_yu12_stride(out, out_stride, in, in_stride, width, height, PACKED422_Y_ODD | PACKED422_V_FIRST);
+			break;
+
+		case V4L2_PIX_FMT_YUV420:
+			planar420_to_yu12_stride(out, out_stride, in, in_stride, width, height, 0);
+			break;
+
+		case V4L2_PIX_FMT_YVU420:
+			planar420_to_yu12_stride(out, out_stride, in, in_stride, width, height, 1);
+			break;
+
+		case V4L2_PIX_FMT_NV12:
+			nv_to_yu12_stride(out, out_stride, in, in_stride, width, height, 0);
+			break;
+
+		case V4L2_PIX_FMT_NV21:
+			nv_to_yu12_stride(out, out_stride, in, in_stride, width, height, 1);
+			break;
+
+		case V4L2_PIX_FMT_GREY:
+			for(h = 0; h < height; ++h)
+				memcpy(out[0] + (h * out_stride[0]), in + (h * in_stride), width);
+			for(h = 0; h < height / 2; ++h)
+			{
+				memset(out[1] + (h * out_stride[1]), 0x80, width / 2);
+				memset(out[2] + (h * out_stride[2]), 0x80, width / 2);
+			}
+			break;
+
+		case V4L2_PIX_FMT_RGB24:
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_rgb24, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_BGR24:
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_bgr24, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_RGB332:
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_rgb1, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_RGB565:
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_rgbp, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_RGB565X:
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_rgbr, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_RGB444:
+#ifdef V4L2_PIX_FMT_ARGB444
+		case V4L2_PIX_FMT_ARGB444:
+		case V4L2_PIX_FMT_XRGB444:
+#endif
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_ar12, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_RGB555:
+#ifdef V4L2_PIX_FMT_ARGB555
+		case V4L2_PIX_FMT_ARGB555:
+		case V4L2_PIX_FMT_XRGB555:
+#endif
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_ar15, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_RGB555X:
+#ifdef V4L2_PIX_FMT_ARGB555X
+		case V4L2_PIX_FMT_ARGB555X:
+		case V4L2_PIX_FMT_XRGB555X:
+#endif
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_ar15x, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_BGR666:
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_bgrh, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_BGR32:
+#ifdef V4L2_PIX_FMT_ABGR32
+		case V4L2_PIX_FMT_ABGR32:
+		case V4L2_PIX_FMT_XBGR32:
+#endif
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_ar24, yuv_matrix);
+			break;
+
+		case V4L2_PIX_FMT_RGB32:
+#ifdef V4L2_PIX_FMT_ARGB32
+		case V4L2_PIX_FMT_ARGB32:
+		case V4L2_PIX_FMT_XRGB32:
+#endif
+			rgb_to_yu12_stride(out, out_stride, in, in_stride, width, height, unpack_ba24, yuv_matrix);
+			break;
 
-		in1 = in2;
-		py1 = py2;
+		default:
+			return E_FORMAT_ERR;
 	}
+
+	return E_OK;
 }
 
 /*
- * convert rgbp (rgb565) to yu12
+ * convert a yu12 line to rgb (scalar reference)
  * args:
- *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing argb555 data
- *   width: picture width
- *   height: picture height
+ *    out - pointer to output line
+ *    py - pointer to luma line
+ *    pu - pointer to u line
+ *    pv - pointer to v line
+ *    w - first pixel to convert (even)
+ *    width - line width in pixels
+ *    layout - output layout (RGB_LAYOUT_)
  *
  * asserts:
- *   out is not null
- *   in is not null
+ *    none
  *
  * returns: none
  */
-void rgbp_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+static void yu12_to_rgb_line(uint8_t *out,
+	const uint8_t *py, const uint8_t *pu, const uint8_t *pv,
+	int w, int width, int layout)
 {
-	/*assertions*/
-	assert(out);
-	assert(in);
-
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
+	const int round = 1 << (YUV_MATRIX_SHIFT - 1);
 
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 2); //second line (2 byte per pixel)
+	int swap_rb = (layout == RGB_LAYOUT_BGR24 || layout == RGB_LAYOUT_BGRA32);
+	int bpp = (layout == RGB_LAYOUT_RGB24 || layout == RGB_LAYOUT_BGR24) ? 3 : 4;
 
-	int h = 0;
-	int w = 0;
+	uint8_t *po = out + (w * bpp);
 
-	for(h = 0; h < height; h += 2)
+	for(; w < width; w++)
 	{
-		in2 = in1 + (width * 2);
-		py2 = py1 + width;
+		int u = pu[w / 2] - 128;
+		int v = pv[w / 2] - 128;
 
-		for(w = 0; w < (width * 2); w +=4)
-		{
-			uint8_t px000 = *in1++;
-			uint8_t px001 = *in1++;
-			uint8_t r00 = px001 & 0xF8;
-			uint8_t g00 = ((px001 << 5) & 0xE0) | ((px000 >> 3) & 0x1C);
-			uint8_t b00 = (px000 << 3) & 0xF8;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			uint8_t px010 = *in1++;
-			uint8_t px011 = *in1++;
-			uint8_t r01 = px011 & 0xF8;
-			uint8_t g01 = ((px011 << 5) & 0xE0) | ((px010 >> 3) & 0x1C);
-			uint8_t b01 = (px010 << 3) & 0xF8;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			uint8_t px100 = *in2++;
-			uint8_t px101 = *in2++;
-			uint8_t r10 = px101 & 0xF8;
-			uint8_t g10 = ((px101 << 5) & 0xE0) | ((px100 >> 3) & 0x1C);
-			uint8_t b10 = (px100 << 3) & 0xF8;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			uint8_t px110 = *in2++;
-			uint8_t px111 = *in2++;
-			uint8_t r11 = px111 & 0xF8;
-			uint8_t g11 = ((px111 << 5) & 0xE0) | ((px110 >> 3) & 0x1C);
-			uint8_t b11 = (px110 << 3) & 0xF8;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
+		int r = py[w] + ((YUV2RGB_VR * v + round) >> YUV_MATRIX_SHIFT);
+		int g = py[w] + ((YUV2RGB_UG * u + YUV2RGB_VG * v + round) >> YUV_MATRIX_SHIFT);
+		int b = py[w] + ((YUV2RGB_UB * u + round) >> YUV_MATRIX_SHIFT);
 
-		in1 = in2;
-		py1 = py2;
+		po[0] = CLIP(swap_rb ? b : r);
+		po[1] = CLIP(g);
+		po[2] = CLIP(swap_rb ? r : b);
+		if(bpp == 4)
+			po[3] = 0xFF;
+
+		po += bpp;
 	}
 }
 
 /*
- * convert rgbr (rgb565X) to yu12
+ * yu12 to rgb conversion job
+ */
+typedef struct _yu12_rgb_job_t
+{
+	uint8_t *out;
+	uint8_t *in;
+	int width;
+	int height;
+	int layout;  //output layout (RGB_LAYOUT_)
+	int flip;    //bottom-up output
+} yu12_rgb_job_t;
+
+/*
+ * convert a band of yu12 rows to rgb
  * args:
- *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing rgb565 bigendian data
- *   width: picture width
- *   height: picture height
+ *    data - pointer to conversion job (yu12_rgb_job_t)
+ *    row_start - first row of the band
+ *    row_end - last row of the band (not included)
  *
  * asserts:
- *   out is not null
- *   in is not null
+ *    none
  *
  * returns: none
  */
-void rgbr_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+static void yu12_to_rgb_rows(void *data, int row_start, int row_end)
 {
-	/*assertions*/
-	assert(out);
-	assert(in);
+	yu12_rgb_job_t *job = (yu12_rgb_job_t *) data;
 
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
+	int width = job->width;
+	int bpp = (job->layout == RGB_LAYOUT_RGB24 || job->layout == RGB_LAYOUT_BGR24) ? 3 : 4;
 
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 2); //second line (2 byte per pixel)
+	uint8_t *pu_plane = job->in + (width * job->height);
+	uint8_t *pv_plane = pu_plane + ((width * job->height) / 4);
 
-	int h = 0;
-	int w = 0;
+	yu12_to_rgb_kernel_t kernel = get_yu12_to_rgb_kernel();
 
-	for(h = 0; h < height; h += 2)
+	int h = 0;
+	for(h = row_start; h < row_end; ++h)
 	{
-		in2 = in1 + (width * 2);
-		py2 = py1 + width;
+		uint8_t *py = job->in + (h * width);
+		uint8_t *pu = pu_plane + ((h / 2) * (width / 2));
+		uint8_t *pv = pv_plane + ((h / 2) * (width / 2));
 
-		for(w = 0; w < (width * 2); w +=4)
-		{
-			uint8_t px000 = *in1++;
-			uint8_t px001 = *in1++;
-			uint8_t r00 = px000 & 0xF8;
-			uint8_t g00 = ((px000 << 5) & 0xE0) | ((px001 >> 3) & 0x1C);
-			uint8_t b00 = (px001 << 3) & 0xF8;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			uint8_t px010 = *in1++;
-			uint8_t px011 = *in1++;
-			uint8_t r01 = px010 & 0xF8;
-			uint8_t g01 = ((px010 << 5) & 0xE0) | ((px011 >> 3) & 0x1C);
-			uint8_t b01 = (px011 << 3) & 0xF8;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			uint8_t px100 = *in2++;
-			uint8_t px101 = *in2++;
-			uint8_t r10 = px100 & 0xF8;
-			uint8_t g10 = ((px100 << 5) & 0xE0) | ((px101 >> 3) & 0x1C);
-			uint8_t b10 = (px101 << 3) & 0xF8;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			uint8_t px110 = *in2++;
-			uint8_t px111 = *in2++;
-			uint8_t r11 = px110 & 0xF8;
-			uint8_t g11 = ((px110 << 5) & 0xE0) | ((px111 >> 3) & 0x1C);
-			uint8_t b11 = (px111 << 3) & 0xF8;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
+		int out_row = job->flip ? (job->height - 1 - h) : h;
+		uint8_t *out = job->out + (out_row * width * bpp);
 
-		in1 = in2;
-		py1 = py2;
+		int w = kernel ? kernel(out, py, pu, pv, width, job->layout) : 0;
+		yu12_to_rgb_line(out, py, pu, pv, w, width, job->layout);
 	}
 }
 
 /*
- * convert bgrh to yu12
+ * convert yu12 to rgb
+ *  row bands are converted in parallel by the thread pool
  * args:
- *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing bgrh (bgr666) data
- *   width: picture width
- *   height: picture height
+ *    out - pointer to output rgb data buffer
+ *    in - pointer to input yu12 data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *    layout - output layout (RGB_LAYOUT_)
+ *    flip - if set output lines are bottom-up
  *
  * asserts:
- *   out is not null
- *   in is not null
+ *    none
  *
  * returns: none
  */
-void bgrh_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+static void yu12_to_rgb(uint8_t *out, uint8_t *in, int width, int height, int layout, int flip)
 {
-	/*assertions*/
-	assert(out);
-	assert(in);
-
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 4); //second line (4 byte per pixel)
-
-	int h = 0;
-	int w = 0;
-
-	for(h = 0; h < height; h += 2)
-	{
-		in2 = in1 + (width * 4);
-		py2 = py1 + width;
-
-		for(w = 0; w < (width * 4); w +=8)
-		{
-			uint8_t px000 = *in1++;
-			uint8_t px001 = *in1++;
-			uint8_t px002 = *in1++;
-			in1++; //last byte has empty data
-			uint8_t r00 = ((px002 >> 4) & 0x0C) | ((px001 << 4)  & 0xF0);
-			uint8_t g00 = ((px001 >> 2) & 0x3C) | ((px000 << 6) & 0xC0);
-			uint8_t b00 = px000  & 0xFC;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			uint8_t px010 = *in1++;
-			uint8_t px011 = *in1++;
-			uint8_t px012 = *in1++;
-			in1++; //last byte has empty data
-			uint8_t r01 = ((px012 >> 4) & 0x0C) | ((px011 << 4)  & 0xF0);
-			uint8_t g01 = ((px011 >> 2) & 0x3C) | ((px010 << 6) & 0xC0);
-			uint8_t b01 = px010  & 0xFC;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			uint8_t px100 = *in2++;
-			uint8_t px101 = *in2++;
-			uint8_t px102 = *in2++;
-			in2++; //last byte has empty data
-			uint8_t r10 = ((px102 >> 4) & 0x0C) | ((px101 << 4)  & 0xF0);
-			uint8_t g10 = ((px101 >> 2) & 0x3C) | ((px100 << 6) & 0xC0);
-			uint8_t b10 = px100  & 0xFC;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			uint8_t px110 = *in2++;
-			uint8_t px111 = *in2++;
-			uint8_t px112 = *in2++;
-			in2++; //last byte has empty data
-			uint8_t r11 = ((px112 >> 4) & 0x0C) | ((px111 << 4)  & 0xF0);
-			uint8_t g11 = ((px111 >> 2) & 0x3C) | ((px110 << 6) & 0xC0);
-			uint8_t b11 = px110  & 0xFC;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
-
-		in1 = in2;
-		py1 = py2;
-	}
+	yu12_rgb_job_t job;
+	job.out = out;
+	job.in = in;
+	job.width = width;
+	job.height = height;
+	job.layout = layout;
+	job.flip = flip;
+
+	parallel_for_rows(height, 2, CONVERT_MIN_ROWS, yu12_to_rgb_rows, &job);
 }
 
 /*
- * convert ar24 to yu12
+ * yu12 to rgb24
  * args:
- *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing ar24 (bgr32) data
- *   width: picture width
- *   height: picture height
+ *    out - pointer to output rgb data buffer
+ *    in - pointer to input yu12 data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
  *
  * asserts:
- *   out is not null
- *   in is not null
+ *    none
  *
  * returns: none
  */
-void ar24_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+void yu12_to_rgb24 (uint8_t *out, uint8_t *in, int width, int height)
 {
 	/*assertions*/
 	assert(out);
 	assert(in);
 
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 4); //second line (4 byte per pixel)
-
-	int h = 0;
-	int w = 0;
-
-	for(h = 0; h < height; h += 2)
-	{
-		in2 = in1 + (width * 4);
-		py2 = py1 + width;
-
-		for(w = 0; w < (width * 4); w +=8)
-		{
-			uint8_t b00 = *in1++;
-			uint8_t g00 = *in1++;
-			uint8_t r00 = *in1++;
-			in1++; //last byte has alpha data
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			uint8_t b01 = *in1++;
-			uint8_t g01 = *in1++;
-			uint8_t r01 = *in1++;
-			in1++; //last byte has alpha data
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			uint8_t b10 = *in2++;
-			uint8_t g10 = *in2++;
-			uint8_t r10 = *in2++;
-			in2++; //last byte has alpha data
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			uint8_t b11 = *in2++;
-			uint8_t g11 = *in2++;
-			uint8_t r11 = *in2++;
-			in2++; //last byte has alpha data
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
-
-		in1 = in2;
-		py1 = py2;
-	}
+	yu12_to_rgb(out, in, width, height, RGB_LAYOUT_RGB24, 0);
 }
 
 /*
- * convert ba24 to yu12
+ * yu12 to bgr24
  * args:
- *   out: pointer to output buffer containing yu12 data
- *   in: pointer to input buffer containing ba24 (rgb32) data
- *   width: picture width
- *   height: picture height
+ *    out - pointer to output bgr data buffer
+ *    in - pointer to input yu12 data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
  *
  * asserts:
- *   out is not null
- *   in is not null
+ *    none
  *
  * returns: none
  */
-void ba24_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
+void yu12_to_bgr24 (uint8_t *out, uint8_t *in, int width, int height)
 {
 	/*assertions*/
 	assert(out);
 	assert(in);
 
-	uint8_t *py1 = out;//first line
-	uint8_t *py2 = py1 + width;//second line
-	uint8_t *pu = out + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-
-	uint8_t *in1 = in; //first line
-	uint8_t *in2 = in + (width * 4); //second line (4 byte per pixel)
-
-	int h = 0;
-	int w = 0;
-
-	for(h = 0; h < height; h += 2)
-	{
-		in2 = in1 + (width * 4);
-		py2 = py1 + width;
-
-		for(w = 0; w < (width * 4); w +=8)
-		{
-			in1++; //first byte has alpha data
-			uint8_t r00 = *in1++;
-			uint8_t g00 = *in1++;
-			uint8_t b00 = *in1++;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r00 - 128) + 0.587 * (g00 - 128) + 0.114 * (b00 - 128) + 128);
-
-			in1++; //first byte has alpha data
-			uint8_t r01 = *in1++;
-			uint8_t g01 = *in1++;
-			uint8_t b01 = *in1++;
-
-			/* y */
-			*py1++ = CLIP(0.299 * (r01 - 128) + 0.587 * (g01 - 128) + 0.114 * (b01 - 128) + 128);
-
-			in2++; //first byte has alpha data
-			uint8_t r10 = *in2++;
-			uint8_t g10 = *in2++;
-			uint8_t b10 = *in2++;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r10 - 128) + 0.587 * (g10 - 128) + 0.114 * (b10 - 128) + 128);
-
-			in2++; //first byte has alpha data
-			uint8_t r11 = *in2++;
-			uint8_t g11 = *in2++;
-			uint8_t b11 = *in2++;
-
-			/* y */
-			*py2++ = CLIP(0.299 * (r11 - 128) + 0.587 * (g11 - 128) + 0.114 * (b11 - 128) + 128);
-
-			/* u v */
-			uint8_t u1 = CLIP(((- 0.147 * (r00 - 128) - 0.289 * (g00 - 128) + 0.436 * (b00 - 128) + 128) +
-				(- 0.147 * (r01 - 128) - 0.289 * (g01 - 128) + 0.436 * (b01 - 128) + 128))/2);
-			uint8_t v1 =CLIP(((0.615 * (r00 - 128) - 0.515 * (g00 - 128) - 0.100 * (b00 - 128) + 128) +
-				(0.615 * (r01 - 128) - 0.515 * (g01 - 128) - 0.100 * (b01 - 128) + 128))/2);
-
-			uint8_t u2 = CLIP(((- 0.147 * (r10 - 128) - 0.289 * (g10 - 128) + 0.436 * (b10 - 128) + 128) +
-				(- 0.147 * (r11 - 128) - 0.289 * (g11 - 128) + 0.436 * (b11 - 128) + 128))/2);
-			uint8_t v2 =CLIP(((0.615 * (r10 - 128) - 0.515 * (g10 - 128) - 0.100 * (b10 - 128) + 128) +
-				(0.615 * (r11 - 128) - 0.515 * (g11 - 128) - 0.100 * (b11 - 128) + 128))/2);	
-
-			*pu++ = (u1 + u2) / 2;
-			*pv++ = (v1 + v2) / 2;
-		}
-
-		in1 = in2;
-		py1 = py2;
-	}
+	yu12_to_rgb(out, in, width, height, RGB_LAYOUT_BGR24, 0);
 }
 
 /*
- * yu12 to rgb24
+ * yu12 to rgba32 (alpha set to 0xFF)
  * args:
- *    out - pointer to output rgb data buffer
+ *    out - pointer to output rgba data buffer
  *    in - pointer to input yu12 data buffer
  *    width - buffer width (in pixels)
  *    height - buffer height (in pixels)
@@ -2723,71 +3153,17 @@ void ba24_to_yu12(uint8_t *out, uint8_t *in, int width, int height)
  *
  * returns: none
  */
-void yu12_to_rgb24 (uint8_t *out, uint8_t *in, int width, int height)
+void yu12_to_rgba32 (uint8_t *out, uint8_t *in, int width, int height)
 {
 	/*assertions*/
 	assert(out);
 	assert(in);
-	
-	uint8_t *py1 = in; //line 1
-	uint8_t *py2 = py1 + width; //line 2
-	uint8_t *pu = in + (width * height);
-	uint8_t *pv = pu + ((width * height) / 4);
-	
-	uint8_t *pout1 = out; //first line
-	uint8_t *pout2 = out + (width * 3); //second line
-	
-	int h=0, w=0;
-	
-	for(h=0; h < height; h+=2) //every two lines
-	{
-		py1 = in + (h * width);
-		py2 = py1 + width;
-		
-		pout1 = out + (h * width * 3);
-		pout2 = pout1 + (width * 3);
-		
-		for(w=0; w<width; w+=2) //every 2 pixels
-		{
-			/* standart: r = y0 + 1.402 (v-128) */
-			/* logitech: r = y0 + 1.370705 (v-128) */
-			*pout1++=CLIP(*py1 + 1.402 * (*pv-128));
-			*pout2++=CLIP(*py2 + 1.402 * (*pv-128));	
-			/* standart: g = y0 - 0.34414 (u-128) - 0.71414 (v-128)*/
-			/* logitech: g = y0 - 0.337633 (u-128)- 0.698001 (v-128)*/
-			*pout1++=CLIP(*py1 - 0.34414 * (*pu-128) -0.71414*(*pv-128));
-			*pout2++=CLIP(*py2 - 0.34414 * (*pu-128) -0.71414*(*pv-128));
-			/* standart: b = y0 + 1.772 (u-128) */
-			/* logitech: b = y0 + 1.732446 (u-128) */
-			*pout1++=CLIP(*py1 + 1.772 *( *pu-128));
-			*pout2++=CLIP(*py2 + 1.772 *( *pu-128));
-			
-			py1++;
-			py2++;
-			
-			/* standart: r1 =y1 + 1.402 (v-128) */
-			/* logitech: r1 = y1 + 1.370705 (v-128) */
-			*pout1++=CLIP(*py1 + 1.402 * (*pv-128));
-			*pout2++=CLIP(*py2 + 1.402 * (*pv-128));
-			/* standart: g1 = y1 - 0.34414 (u-128) - 0.71414 (v-128)*/
-			/* logitech: g1 = y1 - 0.337633 (u-128)- 0.698001 (v-128)*/
-			*pout1++=CLIP(*py1 - 0.34414 * (*pu-128) -0.71414 * (*pv-128));
-			*pout2++=CLIP(*py2 - 0.34414 * (*pu-128) -0.71414 * (*pv-128));
-			/* standart: b1 = y1 + 1.772 (u-128) */
-			/* logitech: b1 = y1 + 1.732446 (u-128) */
-			*pout1++=CLIP(*py1 + 1.772 * (*pu-128));
-			*pout2++=CLIP(*py2 + 1.772 * (*pu-128));
-			
-			py1++;
-			py2++;
-			pu++;
-			pv++;
-		}
-	}
+
+	yu12_to_rgb(out, in, width, height, RGB_LAYOUT_RGBA32, 0);
 }
 
 /*
- * FIXME:  yu12 to bgr24 with lines upsidedown
+ * yu12 to bgr24 with lines upsidedown
  *   used for bitmap files (DIB24)
  * args:
  *    out - pointer to output bgr data buffer
@@ -2805,69 +3181,8 @@ void yu12_to_dib24 (uint8_t *out, uint8_t *in, int width, int height)
 	/*assertions*/
 	assert(out);
 	assert(in);
-	
-	uint8_t *py1 = in + (height * width) - width; //begin of last line
-	uint8_t *py2 = py1 - width; //last line -1
-	
-	uint8_t *pu = in + ((width * height * 5) / 4) - (width/2); //begin of last line
-	uint8_t *pv = pu + ((width * height) / 4); //begin of last line
-	
-	uint8_t *pout1 = out; //first line
-	uint8_t *pout2 = pout1 + (width * 3); //second line
-	
-	int h=0, w=0;
-	int uvline = height/2;
-	
-	for(h=height; h >0 ; h-=2) //every two lines
-	{
-		uvline--; //begin of uv line
-		
-		py1 = in + ((h-1) * width);
-		py2 = py1 - width;
-		
-		pu = in + (width * height) + ((uvline * width)/2);
-		pv = pu + ((width * height) / 4);
-		
-		pout1 = out + ((height-h) * width * 3);
-		pout2 = pout1 + (width * 3);
-		
-		for(w=0; w<width; w+=2) //every 2 pixels
-		{
-			/* standart: b = y0 + 1.772 (u-128) */
-			/* logitech: b = y0 + 1.732446 (u-128) */
-			*pout1++=CLIP(*py1 + 1.772 *( *pu-128));
-			*pout2++=CLIP(*py2 + 1.772 *( *pu-128));	
-			/* standart: g = y0 - 0.34414 (u-128) - 0.71414 (v-128)*/
-			/* logitech: g = y0 - 0.337633 (u-128)- 0.698001 (v-128)*/
-			*pout1++=CLIP(*py1 - 0.34414 * (*pu-128) -0.71414*(*pv-128));
-			*pout2++=CLIP(*py2 - 0.34414 * (*pu-128) -0.71414*(*pv-128));
-			/* standart: r = y0 + 1.402 (v-128) */
-			/* logitech: r = y0 + 1.370705 (v-128) */
-			*pout1++=CLIP(*py1 + 1.402 * (*pv-128));
-			*pout2++=CLIP(*py2 + 1.402 * (*pv-128));
-			
-			py1++;
-			py2++;
-			
-			/* standart: b = y0 + 1.772 (u-128) */
-			/* logitech: b = y0 + 1.732446 (u-128) */
-			*pout1++=CLIP(*py1 + 1.772 *( *pu-128));
-			*pout2++=CLIP(*py2 + 1.772 *( *pu-128));	
-			/* standart: g = y0 - 0.34414 (u-128) - 0.71414 (v-128)*/
-			/* logitech: g = y0 - 0.337633 (u-128)- 0.698001 (v-128)*/
-			*pout1++=CLIP(*py1 - 0.34414 * (*pu-128) -0.71414*(*pv-128));
-			*pout2++=CLIP(*py2 - 0.34414 * (*pu-128) -0.71414*(*pv-128));
-			/* standart: r = y0 + 1.402 (v-128) */
-			/* logitech: r = y0 + 1.370705 (v-128) */
-			*pout1++=CLIP(*py1 + 1.402 * (*pv-128));
-			*pout2++=CLIP(*py2 + 1.402 * (*pv-128));
-
-			py1++;
-			py2++;
-			pu++;
-			pv++;
-		}
-	}
+
+	yu12_to_rgb(out, in, width, height, RGB_LAYOUT_BGR24, 1);
 }
 
 /*
@@ -2937,217 +3252,3 @@ void yu12_to_yuyv (uint8_t *out, uint8_t *in, int width, int height)
 		huv++;
 	}
 }
-
-#if MJPG_BUILTIN //use internal jpeg decoder
-/*
- * used for internal jpeg decoding  420 planar to 422
- * args:
- *   out: pointer to data output of idct (macroblocks yyyy u v)
- *   pic: pointer to picture buffer (yuyv)
- *   width: picture width
- *
- * asserts:
- *   none
- *
- * returns: none
- */
-void yuv420pto422(int *out, uint8_t *pic, int width)
-{
-	int j = 0;
-	int outy1 = 0;
-	int outy2 = 8;
-	//yyyyuv
-	uint8_t *pic0 = pic;
-	uint8_t *pic1 = pic + width;
-	int *outy = out;
-	int *outu = out + 64 * 4;
-	int *outv = out + 64 * 5;
-
-	for (j = 0; j < 8; j++)
-	{
-		int k = 0;
-		for (k = 0; k < 8; k++)
-		{
-			if( k == 4)
-			{
-				outy1 += 56;
-				outy2 += 56;
-			}
-			*pic0++ = CLIP(outy[outy1]);   //y1 line 1
-			*pic0++ = CLIP(128 + *outu);   //u  line 1-2
-			*pic0++ = CLIP(outy[outy1+1]); //y2 line 1
-			*pic0++ = CLIP(128 + *outv);   //v  line 1-2
-			*pic1++ = CLIP(outy[outy2]);   //y1 line 2
-			*pic1++ = CLIP(128 + *outu);   //u  line 1-2
-			*pic1++ = CLIP(outy[outy2+1]); //y2 line 2
-			*pic1++ = CLIP(128 + *outv);   //v  line 1-2
-			outy1 +=2; outy2 += 2; outu++; outv++;
-		}
-		if(j==3)
-		{
-			outy = out + 128;
-		}
-		else
-		{
-			outy += 16;
-		}
-		outy1 = 0;
-		outy2 = 8;
-		pic0 += 2 * (width -16);
-		pic1 += 2 * (width -16);
-	}
-}
-
-/*
- * used for internal jpeg decoding 422 planar to 422
- * args:
- *   out: pointer to data output of idct (macroblocks yyyy u v)
- *   pic: pointer to picture buffer (yuyv)
- *   width: picture width
- *
- * asserts:
- *   none
- *
- * returns: none
- */
-void yuv422pto422(int *out, uint8_t *pic, int width)
-{
-	int j = 0;
-	int outy1 = 0;
-	int outy2 = 8;
-	int outu1 = 0;
-	int outv1 = 0;
-	//yyyyuv
-	uint8_t *pic0 = pic;
-	uint8_t *pic1 = pic + width;
-	int *outy = out;
-	int *outu = out + 64 * 4;
-	int *outv = out + 64 * 5;
-
-	for (j = 0; j < 4; j++)
-	{
-		int k = 0;
-		for (k = 0; k < 8; k++)
-		{
-			if( k == 4)
-			{
-				outy1 += 56;
-				outy2 += 56;
-			}
-			*pic0++ = CLIP(outy[outy1]);        //y1 line 1
-			*pic0++ = CLIP(128 + outu[outu1]);  //u  line 1
-			*pic0++ = CLIP(outy[outy1+1]);      //y2 line 1
-			*pic0++ = CLIP(128 + outv[outv1]);  //v  line 1
-			*pic1++ = CLIP(outy[outy2]);        //y1 line 2
-			*pic1++ = CLIP(128 + outu[outu1+8]);//u  line 2
-			*pic1++ = CLIP(outy[outy2+1]);      //y2 line 2
-			*pic1++ = CLIP(128 + outv[outv1+8]);//v  line 2
-			outv1 += 1; outu1 += 1;
-			outy1 +=2; outy2 +=2;
-		}
-		outy += 16;outu +=8; outv +=8;
-		outv1 = 0; outu1=0;
-		outy1 = 0;
-		outy2 = 8;
-		pic0 += 2 * (width -16);
-		pic1 += 2 * (width -16);
-	}
-}
-
-/*
- * used for internal jpeg decoding 444 planar to 422
- * args:
- *   out: pointer to data output of idct (macroblocks yyyy u v)
- *   pic: pointer to picture buffer (yuyv)
- *   width: picture width
- *
- * asserts:
- *   none
- *
- * returns: none
- */
-void yuv444pto422(int *out, uint8_t *pic, int width)
-{
-	int j = 0;
-	int outy1 = 0;
-	int outy2 = 8;
-	int outu1 = 0;
-	int outv1 = 0;
-	//yyyyuv
-	uint8_t *pic0 = pic;
-	uint8_t *pic1 = pic + width;
-	int *outy = out;
-	int *outu = out + 64 * 4; // Ooops where did i invert ??
-	int *outv = out + 64 * 5;
-
-	for (j = 0; j < 4; j++)
-	{
-		int k = 0;
-		for (k = 0; k < 4; k++)
-		{
-			*pic0++ =CLIP( outy[outy1]);        //y1 line 1
-			*pic0++ =CLIP( 128 + outu[outu1]);  //u  line 1
-			*pic0++ =CLIP( outy[outy1+1]);      //y2 line 1
-			*pic0++ =CLIP( 128 + outv[outv1]);  //v  line 1
-			*pic1++ =CLIP( outy[outy2]);        //y1 line 2
-			*pic1++ =CLIP( 128 + outu[outu1+8]);//u  line 2
-			*pic1++ =CLIP( outy[outy2+1]);      //y2 line 2
-			*pic1++ =CLIP( 128 + outv[outv1+8]);//v  line 2
-			outv1 += 2; outu1 += 2;
-			outy1 +=2; outy2 +=2;
-		}
-		outy += 16;outu +=16; outv +=16;
-		outv1 = 0; outu1=0;
-		outy1 = 0;
-		outy2 = 8;
-		pic0 += 2 * (width -8);
-		pic1 += 2 * (width -8);
-	}
-}
-
-/*
- * used for internal jpeg decoding 400 planar to 422
- * args:
- *   out: pointer to data output of idct (macroblocks yyyy )
- *   pic: pointer to picture buffer (yuyv)
- *   width: picture width
- *
- * asserts:
- *   none
- *
- * returns: none
- */
-void yuv400pto422(int *out, uint8_t *pic, int width)
-{
-	int j = 0;
-	int outy1 = 0;
-	int outy2 = 8;
-	uint8_t *pic0 = pic;
-	uint8_t *pic1 = pic + width;
-	int *outy = out;
-
-	//yyyy
-	for (j = 0; j < 4; j++)
-	{
-		int k = 0;
-		for (k = 0; k < 4; k++)
-		{
-			*pic0++ = CLIP(outy[outy1]);  //y1 line 1
-			*pic0++ = 128 ;               //u
-			*pic0++ = CLIP(outy[outy1+1]);//y2 line 1
-			*pic0++ = 128 ;               //v
-			*pic1++ = CLIP(outy[outy2]);  //y1 line 2
-			*pic1++ = 128 ;               //u
-			*pic1++ = CLIP(outy[outy2+1]);//y2 line 2
-			*pic1++ = 128 ;               //v
-			outy1 +=2; outy2 +=2;
-		}
-		outy += 16;
-		outy1 = 0;
-		outy2 = 8;
-		pic0 += 2 * (width -8);
-		pic1 += 2 * (width -8);
-	}
-}
-
-#endif
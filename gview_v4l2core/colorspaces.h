@@ -23,8 +23,140 @@
 #define COLORSPACES_H
 
 #include "gview.h"
+#include "colorspaces_simd.h"
 #include "../config.h"
 
+/*
+ * get the fixed point rgb to yuv matrix
+ * args:
+ *    matrix - YUV_MATRIX_BT601 or YUV_MATRIX_BT709
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to fixed point matrix
+ */
+const yuv_matrix_t *get_yuv_matrix(int matrix);
+
+/*
+ * bayer input sample formats (bayer_to_yu12_stride)
+ */
+#define BAYER_SAMPLE_8   (0) /*8 bit samples*/
+#define BAYER_SAMPLE_10  (1) /*10 bit samples in 16 bit little endian words*/
+#define BAYER_SAMPLE_12  (2) /*12 bit samples in 16 bit little endian words*/
+#define BAYER_SAMPLE_16  (3) /*16 bit little endian samples*/
+#define BAYER_SAMPLE_10P (4) /*mipi packed 10 bit: 4 pixels in 5 bytes*/
+#define BAYER_SAMPLE_12P (5) /*mipi packed 12 bit: 2 pixels in 3 bytes*/
+
+/*
+ * convert raw bayer data to yu12 with line strides (single pass)
+ *  row bands are converted in parallel by the thread pool
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointer to input bayer data
+ *    in_stride - input line size (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    pix_order - bayer pixel order (0=gb/rg 1=gr/bg 2=bg/gr 3=rg/gb)
+ *    sample - input sample format (BAYER_SAMPLE_)
+ *    matrix - rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *    demosaic - demosaic filter (DEMOSAIC_BILINEAR or DEMOSAIC_MHC)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void bayer_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t *in, int in_stride, int width, int height, int pix_order, int sample,
+	int matrix, int demosaic);
+
+/*
+ * get the planes and line sizes of a tightly packed yu12 buffer
+ * args:
+ *    buf - pointer to yu12 planar data buffer
+ *    width - frame width
+ *    height - frame height
+ *    planes - pointers to the y, u and v planes (to be filled)
+ *    stride - y, u and v line sizes in bytes (to be filled)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void yu12_get_planes(uint8_t *buf, int width, int height, uint8_t *planes[3], int stride[3]);
+
+/*
+ * copy yu12 planes between buffers with different line sizes
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointers to input y, u and v planes
+ *    in_stride - input y, u and v line sizes (bytes)
+ *    width - frame width
+ *    height - frame height
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void yu12_copy_planes(uint8_t * const out[3], const int out_stride[3],
+	uint8_t * const in[3], const int in_stride[3], int width, int height);
+
+/*
+ * convert planar yuv (4:2:0, 4:2:2, 4:4:0 or 4:4:4) to yu12 with line strides
+ *  4:2:0 planes are copied as they are
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointers to input y, u and v planes
+ *    in_stride - input y, u and v line sizes (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    hshift - input chroma horizontal subsampling (log2: 0 or 1)
+ *    vshift - input chroma vertical subsampling (log2: 0 or 1)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void yuv_planar_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t * const in[3], const int in_stride[3], int width, int height,
+	int hshift, int vshift);
+
+/*
+ * convert a raw frame to yu12 with line strides
+ *  honors the driver line size (bytesperline) of the input
+ *  and the (aligned) line sizes of the output planes
+ * args:
+ *    out - pointers to output y, u and v planes
+ *    out_stride - output y, u and v line sizes (bytes)
+ *    in - pointer to input frame data
+ *    in_stride - input line size of the first plane (bytes)
+ *    width - frame width
+ *    height - frame height
+ *    format - v4l2 pixel format of the input
+ *    matrix - rgb to yuv matrix for rgb and bayer formats
+ *             (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
+ *    demosaic - demosaic filter for bayer formats
+ *               (DEMOSAIC_BILINEAR or DEMOSAIC_MHC)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: error code (E_OK, E_FORMAT_ERR if the format has
+ *          no stride aware converter)
+ */
+int raw_to_yu12_stride(uint8_t * const out[3], const int out_stride[3],
+	uint8_t *in, int in_stride, int width, int height, uint32_t format,
+	int matrix, int demosaic);
+
 /*
  *convert from packed 422 yuv (yuyv) to 420 planar (yu12)
  * args:
@@ -201,6 +333,24 @@ void yuv4_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  */
 void yv12_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
 
+/*
+ * downscale a 420 planar (yu12) frame by a power of two (box filter)
+ * args:
+ *    out - pointer to output yu12 planar data buffer
+ *          (width >> shift x height >> shift)
+ *    in - pointer to input yu12 planar data buffer
+ *    width - input frame width
+ *    height - input frame height
+ *    shift - scale factor (1 << shift)
+ *
+ * asserts:
+ *    in is not null
+ *    out is not null
+ *
+ * returns: none
+ */
+void yu12_downscale(uint8_t *out, uint8_t *in, int width, int height, int shift);
+
 /*
  * convert nv12 planar (uv interleaved) to yuv420 planar (yu12)
  * args:
@@ -437,6 +587,7 @@ void s508_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing rgb24 data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -444,7 +595,7 @@ void s508_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void rgb24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void rgb24_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert bgr24 to yu12
@@ -453,6 +604,7 @@ void rgb24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing bgr24 data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -460,7 +612,7 @@ void rgb24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void bgr24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void bgr24_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert rgb1 (rgb332) to yu12
@@ -469,6 +621,7 @@ void bgr24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing rgb332 data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -476,7 +629,7 @@ void bgr24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void rgb1_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void rgb1_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert ar12 (argb444) to yu12
@@ -485,6 +638,7 @@ void rgb1_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing argb444 data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -492,7 +646,7 @@ void rgb1_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void ar12_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void ar12_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert ar15 (argb555) to yu12
@@ -501,6 +655,7 @@ void ar12_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing argb555 data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -508,7 +663,7 @@ void ar12_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void ar15_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void ar15_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert ar15_be (argb555X) to yu12
@@ -517,6 +672,7 @@ void ar15_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing argb555X (be) data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -524,7 +680,7 @@ void ar15_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void ar15x_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void ar15x_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert rgbp (rgb565) to yu12
@@ -533,6 +689,7 @@ void ar15x_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing argb555 data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -540,7 +697,7 @@ void ar15x_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void rgbp_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void rgbp_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert rgbr (rgb565X) to yu12
@@ -549,6 +706,7 @@ void rgbp_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing rgb565 bigendian data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -556,7 +714,7 @@ void rgbp_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void rgbr_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void rgbr_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert bgrh to yu12
@@ -565,6 +723,7 @@ void rgbr_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing bgrh (bgr666) data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -572,7 +731,7 @@ void rgbr_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void bgrh_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void bgrh_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert ar24 to yu12
@@ -581,6 +740,7 @@ void bgrh_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing ar24 (bgr32) data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -588,7 +748,7 @@ void bgrh_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void ar24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void ar24_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * convert ba24 to yu12
@@ -597,6 +757,7 @@ void ar24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *   in: pointer to input buffer containing ba24 (rgb32) data
  *   width: picture width
  *   height: picture height
+ *   matrix: rgb to yuv matrix (YUV_MATRIX_BT601 or YUV_MATRIX_BT709)
  *
  * asserts:
  *   out is not null
@@ -604,7 +765,7 @@ void ar24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void ba24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
+void ba24_to_yu12(uint8_t *out, uint8_t *in, int width, int height, int matrix);
 
 /*
  * yu12 to rgb24
@@ -622,8 +783,7 @@ void ba24_to_yu12(uint8_t *out, uint8_t *in, int width, int height);
 void yu12_to_rgb24 (uint8_t *out, uint8_t *in, int width, int height);
 
 /*
- * FIXME:  yu12 to bgr24 with lines upsidedown
- *   used for bitmap files (DIB24)
+ * yu12 to bgr24
  * args:
  *    out - pointer to output bgr data buffer
  *    in - pointer to input yu12 data buffer
@@ -635,99 +795,55 @@ void yu12_to_rgb24 (uint8_t *out, uint8_t *in, int width, int height);
  *
  * returns: none
  */
-void yu12_to_dib24 (uint8_t *out, uint8_t *in, int width, int height);
+void yu12_to_bgr24 (uint8_t *out, uint8_t *in, int width, int height);
 
 /*
- * convert yuv 420 planar (yu12) to yuv 422 (save_image_jpeg)
+ * yu12 to rgba32 (alpha set to 0xFF)
  * args:
- *    out- pointer to output buffer (yuyv)
- *    in- pointer to input buffer (yuv420 planar data frame (yu12))
- *    width- picture width
- *    height- picture height
- *
- * asserts:
- *    out is not null
- *    in is not null
- *
- * returns: none
- */
-void yu12_to_yuyv (uint8_t *out, uint8_t *in, int width, int height);
-
-/*
- * convert bayer raw data to rgb24
- * args:
- *   pBay: pointer to buffer containing Raw bayer data
- *   pRGB24: pointer to buffer containing rgb24 data
- *   width: picture width
- *   height: picture height
- *   pix_order: bayer pixel order (0=gb/rg   1=gr/bg  2=bg/gr  3=rg/bg)
- *
- * asserts:
- *   none
- *
- * returns: none
- */
-void bayer_to_rgb24(uint8_t *pBay, uint8_t *pRGB24, int width, int height, int pix_order);
-
-#if MJPG_BUILTIN
-
-/*
- * used for internal jpeg decoding  420 planar to 422
- * args:
- *   out: pointer to data output of idct (macroblocks yyyy u v)
- *   pic: pointer to picture buffer (yuyv)
- *   width: picture width
- *
- * asserts:
- *   none
- *
- * returns: none
- */
-void yuv420pto422(int *out, uint8_t *pic, int width);
-
-/*
- * used for internal jpeg decoding 422 planar to 422
- * args:
- *   out: pointer to data output of idct (macroblocks yyyy u v)
- *   pic: pointer to picture buffer (yuyv)
- *   width: picture width
+ *    out - pointer to output rgba data buffer
+ *    in - pointer to input yu12 data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
  *
  * asserts:
- *   none
+ *    none
  *
  * returns: none
  */
-void yuv422pto422(int *out, uint8_t *pic, int width);
+void yu12_to_rgba32 (uint8_t *out, uint8_t *in, int width, int height);
 
 /*
- * used for internal jpeg decoding 444 planar to 422
+ * yu12 to bgr24 with lines upsidedown
+ *   used for bitmap files (DIB24)
  * args:
- *   out: pointer to data output of idct (macroblocks yyyy u v)
- *   pic: pointer to picture buffer (yuyv)
- *   width: picture width
+ *    out - pointer to output bgr data buffer
+ *    in - pointer to input yu12 data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
  *
  * asserts:
- *   none
+ *    none
  *
  * returns: none
  */
-void yuv444pto422(int *out, uint8_t *pic, int width);
+void yu12_to_dib24 (uint8_t *out, uint8_t *in, int width, int height);
 
 /*
- * used for internal jpeg decoding 400 planar to 422
+ * convert yuv 420 planar (yu12) to yuv 422 (save_image_jpeg)
  * args:
- *   out: pointer to data output of idct (macroblocks yyyy )
- *   pic: pointer to picture buffer (yuyv)
- *   width: picture width
+ *    out- pointer to output buffer (yuyv)
+ *    in- pointer to input buffer (yuv420 planar data frame (yu12))
+ *    width- picture width
+ *    height- picture height
  *
  * asserts:
- *   none
+ *    out is not null
+ *    in is not null
  *
  * returns: none
  */
-void yuv400pto422(int *out, uint8_t *pic, int width);
+void yu12_to_yuyv (uint8_t *out, uint8_t *in, int width, int height);
 
-#endif
 
 #endif
 
@@ -0,0 +1,1233 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - SIMD colorspace conversion and idct kernels              #
+#                                                                               #
+#  Kernels are selected at runtime from the cpu features, the scalar code in    #
+#  colorspaces.c is the reference and converts any remaining pixels (the idct   #
+#  reference is in jpeg_decoder.c).                                             #
+#                                                                               #
+********************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "colorspaces_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define SIMD_X86 1
+  #include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define SIMD_NEON 1
+  #include <arm_neon.h>
+#endif
+
+extern int verbosity;
+
+static packed422_kernel_t packed422_kernel = NULL;
+static rgb_planes_kernel_t rgb_planes_kernel = NULL;
+static rgb_deinterleave_kernel_t rgb_deinterleave_kernel = NULL;
+static yu12_to_rgb_kernel_t yu12_to_rgb_kernel = NULL;
+static idct_kernel_t idct_kernel = NULL;
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+
+/*two int16 coefficients packed in a 32 bit word (pmaddwd operand)*/
+#define PAIR16(a, b) ((int32_t) (((uint32_t) (uint16_t) (a)) | (((uint32_t) (uint16_t) (b)) << 16)))
+
+#ifdef SIMD_X86
+
+/*
+ * truncating byte average (a + b) / 2 - matches the scalar code
+ *  (pavgb rounds up so the carry bit is removed)
+ */
+__attribute__((target("sse2")))
+static inline __m128i avg_floor_sse2(__m128i a, __m128i b)
+{
+	const __m128i one = _mm_set1_epi8(1);
+	return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avg_floor_avx2(__m256i a, __m256i b)
+{
+	const __m256i one = _mm256_set1_epi8(1);
+	return _mm256_sub_epi8(_mm256_avg_epu8(a, b), _mm256_and_si256(_mm256_xor_si256(a, b), one));
+}
+
+/*
+ * packed 4:2:2 to yu12 (SSE2 - 16 pixels per iteration)
+ * args:
+ *    see packed422_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels converted
+ */
+__attribute__((target("sse2")))
+static int packed422_to_yu12_sse2(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	const uint8_t *in1, const uint8_t *in2,
+	int width, int layout)
+{
+	const __m128i mask = _mm_set1_epi16(0x00ff);
+	const __m128i zero = _mm_setzero_si128();
+
+	int y_odd = layout & PACKED422_Y_ODD;
+	/*chroma destinations in packed order*/
+	uint8_t *pc0 = (layout & PACKED422_V_FIRST) ? pv : pu;
+	uint8_t *pc1 = (layout & PACKED422_V_FIRST) ? pu : pv;
+
+	int w = 0;
+	for(w = 0; w + 16 <= width; w += 16)
+	{
+		__m128i a1 = _mm_loadu_si128((const __m128i *) (in1 + w * 2));
+		__m128i b1 = _mm_loadu_si128((const __m128i *) (in1 + w * 2 + 16));
+		__m128i a2 = _mm_loadu_si128((const __m128i *) (in2 + w * 2));
+		__m128i b2 = _mm_loadu_si128((const __m128i *) (in2 + w * 2 + 16));
+
+		/*split even and odd bytes*/
+		__m128i even1 = _mm_packus_epi16(_mm_and_si128(a1, mask), _mm_and_si128(b1, mask));
+		__m128i odd1 = _mm_packus_epi16(_mm_srli_epi16(a1, 8), _mm_srli_epi16(b1, 8));
+		__m128i even2 = _mm_packus_epi16(_mm_and_si128(a2, mask), _mm_and_si128(b2, mask));
+		__m128i odd2 = _mm_packus_epi16(_mm_srli_epi16(a2, 8), _mm_srli_epi16(b2, 8));
+
+		_mm_storeu_si128((__m128i *) (py1 + w), y_odd ? odd1 : even1);
+		_mm_storeu_si128((__m128i *) (py2 + w), y_odd ? odd2 : even2);
+
+		/*average the chroma of both lines and split the two components*/
+		__m128i c = y_odd ? avg_floor_sse2(even1, even2) : avg_floor_sse2(odd1, odd2);
+
+		_mm_storel_epi64((__m128i *) (pc0 + w / 2),
+			_mm_packus_epi16(_mm_and_si128(c, mask), zero));
+		_mm_storel_epi64((__m128i *) (pc1 + w / 2),
+			_mm_packus_epi16(_mm_srli_epi16(c, 8), zero));
+	}
+
+	return w;
+}
+
+/*
+ * packed 4:2:2 to yu12 (AVX2 - 32 pixels per iteration)
+ * args:
+ *    see packed422_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels converted
+ */
+__attribute__((target("avx2")))
+static int packed422_to_yu12_avx2(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	const uint8_t *in1, const uint8_t *in2,
+	int width, int layout)
+{
+	const __m256i mask = _mm256_set1_epi16(0x00ff);
+	const __m128i mask128 = _mm_set1_epi16(0x00ff);
+
+	int y_odd = layout & PACKED422_Y_ODD;
+	/*chroma destinations in packed order*/
+	uint8_t *pc0 = (layout & PACKED422_V_FIRST) ? pv : pu;
+	uint8_t *pc1 = (layout & PACKED422_V_FIRST) ? pu : pv;
+
+	int w = 0;
+	for(w = 0; w + 32 <= width; w += 32)
+	{
+		__m256i a1 = _mm256_loadu_si256((const __m256i *) (in1 + w * 2));
+		__m256i b1 = _mm256_loadu_si256((const __m256i *) (in1 + w * 2 + 32));
+		__m256i a2 = _mm256_loadu_si256((const __m256i *) (in2 + w * 2));
+		__m256i b2 = _mm256_loadu_si256((const __m256i *) (in2 + w * 2 + 32));
+
+		/*split even and odd bytes (packus works per 128 bit lane - reorder the quads)*/
+		__m256i even1 = _mm256_permute4x64_epi64(
+			_mm256_packus_epi16(_mm256_and_si256(a1, mask), _mm256_and_si256(b1, mask)),
+			_MM_SHUFFLE(3, 1, 2, 0));
+		__m256i odd1 = _mm256_permute4x64_epi64(
+			_mm256_packus_epi16(_mm256_srli_epi16(a1, 8), _mm256_srli_epi16(b1, 8)),
+			_MM_SHUFFLE(3, 1, 2, 0));
+		__m256i even2 = _mm256_permute4x64_epi64(
+			_mm256_packus_epi16(_mm256_and_si256(a2, mask), _mm256_and_si256(b2, mask)),
+			_MM_SHUFFLE(3, 1, 2, 0));
+		__m256i odd2 = _mm256_permute4x64_epi64(
+			_mm256_packus_epi16(_mm256_srli_epi16(a2, 8), _mm256_srli_epi16(b2, 8)),
+			_MM_SHUFFLE(3, 1, 2, 0));
+
+		_mm256_storeu_si256((__m256i *) (py1 + w), y_odd ? odd1 : even1);
+		_mm256_storeu_si256((__m256i *) (py2 + w), y_odd ? odd2 : even2);
+
+		/*average the chroma of both lines and split the two components*/
+		__m256i c = y_odd ? avg_floor_avx2(even1, even2) : avg_floor_avx2(odd1, odd2);
+		__m128i lo = _mm256_castsi256_si128(c);
+		__m128i hi = _mm256_extracti128_si256(c, 1);
+
+		_mm_storeu_si128((__m128i *) (pc0 + w / 2),
+			_mm_packus_epi16(_mm_and_si128(lo, mask128), _mm_and_si128(hi, mask128)));
+		_mm_storeu_si128((__m128i *) (pc1 + w / 2),
+			_mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+	}
+
+	return w;
+}
+
+/*
+ * luma for 8 pixels (int16 r, g, b) - pmaddwd on (r,g) and (b,1) pairs
+ */
+__attribute__((target("sse2")))
+static inline __m128i rgb_to_y_sse2(__m128i r, __m128i g, __m128i b,
+	__m128i crg, __m128i cb1)
+{
+	const __m128i one = _mm_set1_epi16(1);
+
+	__m128i lo = _mm_add_epi32(
+		_mm_madd_epi16(_mm_unpacklo_epi16(r, g), crg),
+		_mm_madd_epi16(_mm_unpacklo_epi16(b, one), cb1));
+	__m128i hi = _mm_add_epi32(
+		_mm_madd_epi16(_mm_unpackhi_epi16(r, g), crg),
+		_mm_madd_epi16(_mm_unpackhi_epi16(b, one), cb1));
+
+	return _mm_packs_epi32(_mm_srai_epi32(lo, YUV_MATRIX_SHIFT), _mm_srai_epi32(hi, YUV_MATRIX_SHIFT));
+}
+
+/*
+ * chroma for 8 blocks (int16 2x2 sums of r, g, b)
+ */
+__attribute__((target("sse2")))
+static inline __m128i rgb_to_c_sse2(__m128i rs, __m128i gs, __m128i bs,
+	__m128i crg, __m128i cb0)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i offset = _mm_set1_epi32((128 << (YUV_MATRIX_SHIFT + 2)) + (1 << (YUV_MATRIX_SHIFT + 1)));
+
+	__m128i lo = _mm_add_epi32(
+		_mm_madd_epi16(_mm_unpacklo_epi16(rs, gs), crg),
+		_mm_madd_epi16(_mm_unpacklo_epi16(bs, zero), cb0));
+	__m128i hi = _mm_add_epi32(
+		_mm_madd_epi16(_mm_unpackhi_epi16(rs, gs), crg),
+		_mm_madd_epi16(_mm_unpackhi_epi16(bs, zero), cb0));
+
+	lo = _mm_srai_epi32(_mm_add_epi32(lo, offset), YUV_MATRIX_SHIFT + 2);
+	hi = _mm_srai_epi32(_mm_add_epi32(hi, offset), YUV_MATRIX_SHIFT + 2);
+
+	return _mm_packs_epi32(lo, hi);
+}
+
+/*
+ * planar rgb to yu12 (SSE2 - 16 pixels per iteration)
+ * args:
+ *    see rgb_planes_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels converted
+ */
+__attribute__((target("sse2")))
+static int rgb_planes_to_yu12_sse2(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	uint8_t * const rgb1[3], uint8_t * const rgb2[3],
+	int width, const yuv_matrix_t *matrix)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+
+	const __m128i yrg = _mm_set1_epi32(PAIR16(matrix->y[0], matrix->y[1]));
+	const __m128i yb1 = _mm_set1_epi32(PAIR16(matrix->y[2], 1 << (YUV_MATRIX_SHIFT - 1)));
+	const __m128i urg = _mm_set1_epi32(PAIR16(matrix->u[0], matrix->u[1]));
+	const __m128i ub0 = _mm_set1_epi32(PAIR16(matrix->u[2], 0));
+	const __m128i vrg = _mm_set1_epi32(PAIR16(matrix->v[0], matrix->v[1]));
+	const __m128i vb0 = _mm_set1_epi32(PAIR16(matrix->v[2], 0));
+
+	int w = 0;
+	for(w = 0; w + 16 <= width; w += 16)
+	{
+		__m128i r1 = _mm_loadu_si128((const __m128i *) (rgb1[0] + w));
+		__m128i g1 = _mm_loadu_si128((const __m128i *) (rgb1[1] + w));
+		__m128i b1 = _mm_loadu_si128((const __m128i *) (rgb1[2] + w));
+		__m128i r2 = _mm_loadu_si128((const __m128i *) (rgb2[0] + w));
+		__m128i g2 = _mm_loadu_si128((const __m128i *) (rgb2[1] + w));
+		__m128i b2 = _mm_loadu_si128((const __m128i *) (rgb2[2] + w));
+
+		__m128i r1l = _mm_unpacklo_epi8(r1, zero);
+		__m128i r1h = _mm_unpackhi_epi8(r1, zero);
+		__m128i g1l = _mm_unpacklo_epi8(g1, zero);
+		__m128i g1h = _mm_unpackhi_epi8(g1, zero);
+		__m128i b1l = _mm_unpacklo_epi8(b1, zero);
+		__m128i b1h = _mm_unpackhi_epi8(b1, zero);
+		__m128i r2l = _mm_unpacklo_epi8(r2, zero);
+		__m128i r2h = _mm_unpackhi_epi8(r2, zero);
+		__m128i g2l = _mm_unpacklo_epi8(g2, zero);
+		__m128i g2h = _mm_unpackhi_epi8(g2, zero);
+		__m128i b2l = _mm_unpacklo_epi8(b2, zero);
+		__m128i b2h = _mm_unpackhi_epi8(b2, zero);
+
+		_mm_storeu_si128((__m128i *) (py1 + w), _mm_packus_epi16(
+			rgb_to_y_sse2(r1l, g1l, b1l, yrg, yb1),
+			rgb_to_y_sse2(r1h, g1h, b1h, yrg, yb1)));
+		_mm_storeu_si128((__m128i *) (py2 + w), _mm_packus_epi16(
+			rgb_to_y_sse2(r2l, g2l, b2l, yrg, yb1),
+			rgb_to_y_sse2(r2h, g2h, b2h, yrg, yb1)));
+
+		/*2x2 block sums: add the lines then the pixel pairs*/
+		__m128i rs = _mm_packs_epi32(
+			_mm_madd_epi16(_mm_add_epi16(r1l, r2l), one),
+			_mm_madd_epi16(_mm_add_epi16(r1h, r2h), one));
+		__m128i gs = _mm_packs_epi32(
+			_mm_madd_epi16(_mm_add_epi16(g1l, g2l), one),
+			_mm_madd_epi16(_mm_add_epi16(g1h, g2h), one));
+		__m128i bs = _mm_packs_epi32(
+			_mm_madd_epi16(_mm_add_epi16(b1l, b2l), one),
+			_mm_madd_epi16(_mm_add_epi16(b1h, b2h), one));
+
+		_mm_storel_epi64((__m128i *) (pu + w / 2),
+			_mm_packus_epi16(rgb_to_c_sse2(rs, gs, bs, urg, ub0), zero));
+		_mm_storel_epi64((__m128i *) (pv + w / 2),
+			_mm_packus_epi16(rgb_to_c_sse2(rs, gs, bs, vrg, vb0), zero));
+	}
+
+	return w;
+}
+
+/*
+ * packed 24/32 bit rgb to planes (SSSE3 - 16 pixels per iteration)
+ *  each 4 pixel group is gathered with pshufb into r, g and b
+ *  dwords that are then transposed into the planes
+ * args:
+ *    see rgb_deinterleave_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels unpacked
+ */
+__attribute__((target("ssse3")))
+static int rgb_deinterleave_ssse3(const uint8_t *in,
+	uint8_t *r, uint8_t *g, uint8_t *b,
+	int width, int bpp, const int offset[3])
+{
+	int8_t shuffle[16];
+	int i = 0, j = 0;
+
+	for(i = 0; i < 3; ++i)
+		for(j = 0; j < 4; ++j)
+			shuffle[(i * 4) + j] = (j * bpp) + offset[i];
+	for(j = 12; j < 16; ++j)
+		shuffle[j] = (int8_t) 0x80; /*zero*/
+
+	const __m128i mask = _mm_loadu_si128((const __m128i *) shuffle);
+	const int group = 4 * bpp; /*bytes in 4 pixels*/
+
+	/*16 byte loads of 24 bit groups read 4 bytes past the group*/
+	int end = (bpp == 3) ? width - 2 : width;
+
+	int w = 0;
+	for(w = 0; w + 16 <= end; w += 16)
+	{
+		const uint8_t *p = in + (w * bpp);
+
+		__m128i v0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) p), mask);
+		__m128i v1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + group)), mask);
+		__m128i v2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 2 * group)), mask);
+		__m128i v3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 3 * group)), mask);
+
+		__m128i rg01 = _mm_unpacklo_epi32(v0, v1);
+		__m128i rg23 = _mm_unpacklo_epi32(v2, v3);
+		__m128i b01 = _mm_unpackhi_epi32(v0, v1);
+		__m128i b23 = _mm_unpackhi_epi32(v2, v3);
+
+		_mm_storeu_si128((__m128i *) (r + w), _mm_unpacklo_epi64(rg01, rg23));
+		_mm_storeu_si128((__m128i *) (g + w), _mm_unpackhi_epi64(rg01, rg23));
+		_mm_storeu_si128((__m128i *) (b + w), _mm_unpacklo_epi64(b01, b23));
+	}
+
+	return w;
+}
+
+/*
+ * chroma offsets for 8 u, v samples (int16, already minus 128)
+ */
+__attribute__((target("ssse3")))
+static inline void yuv_to_rgb_offsets_ssse3(__m128i u, __m128i v,
+	__m128i *dr, __m128i *dg, __m128i *db)
+{
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i vr = _mm_set1_epi32(PAIR16(YUV2RGB_VR, 1 << (YUV_MATRIX_SHIFT - 1)));
+	const __m128i ub = _mm_set1_epi32(PAIR16(YUV2RGB_UB, 1 << (YUV_MATRIX_SHIFT - 1)));
+	const __m128i uvg = _mm_set1_epi32(PAIR16(YUV2RGB_UG, YUV2RGB_VG));
+	const __m128i round = _mm_set1_epi32(1 << (YUV_MATRIX_SHIFT - 1));
+
+	*dr = _mm_packs_epi32(
+		_mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(v, one), vr), YUV_MATRIX_SHIFT),
+		_mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(v, one), vr), YUV_MATRIX_SHIFT));
+	*db = _mm_packs_epi32(
+		_mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(u, one), ub), YUV_MATRIX_SHIFT),
+		_mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(u, one), ub), YUV_MATRIX_SHIFT));
+	*dg = _mm_packs_epi32(
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(u, v), uvg), round), YUV_MATRIX_SHIFT),
+		_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(u, v), uvg), round), YUV_MATRIX_SHIFT));
+}
+
+/*
+ * yu12 to rgb for a line (SSSE3 - 16 pixels per iteration)
+ *  pixels are interleaved as 32 bit words and 24 bit layouts
+ *  drop the alpha byte with pshufb
+ * args:
+ *    see yu12_to_rgb_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels converted
+ */
+__attribute__((target("ssse3")))
+static int yu12_to_rgb_ssse3(uint8_t *out,
+	const uint8_t *py, const uint8_t *pu, const uint8_t *pv,
+	int width, int layout)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c128 = _mm_set1_epi16(128);
+	const __m128i alpha = _mm_set1_epi8((char) 0xFF);
+	const __m128i drop_alpha = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+		-128, -128, -128, -128);
+
+	int swap_rb = (layout == RGB_LAYOUT_BGR24 || layout == RGB_LAYOUT_BGRA32);
+	int bpp = (layout == RGB_LAYOUT_RGB24 || layout == RGB_LAYOUT_BGR24) ? 3 : 4;
+
+	int w = 0;
+	for(w = 0; w + 16 <= width; w += 16)
+	{
+		__m128i u = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (pu + w / 2)), zero), c128);
+		__m128i v = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (pv + w / 2)), zero), c128);
+
+		__m128i dr, dg, db;
+		yuv_to_rgb_offsets_ssse3(u, v, &dr, &dg, &db);
+
+		__m128i y = _mm_loadu_si128((const __m128i *) (py + w));
+		__m128i yl = _mm_unpacklo_epi8(y, zero);
+		__m128i yh = _mm_unpackhi_epi8(y, zero);
+
+		/*each chroma offset is shared by 2 pixels*/
+		__m128i r = _mm_packus_epi16(
+			_mm_add_epi16(yl, _mm_unpacklo_epi16(dr, dr)),
+			_mm_add_epi16(yh, _mm_unpackhi_epi16(dr, dr)));
+		__m128i g = _mm_packus_epi16(
+			_mm_add_epi16(yl, _mm_unpacklo_epi16(dg, dg)),
+			_mm_add_epi16(yh, _mm_unpackhi_epi16(dg, dg)));
+		__m128i b = _mm_packus_epi16(
+			_mm_add_epi16(yl, _mm_unpacklo_epi16(db, db)),
+			_mm_add_epi16(yh, _mm_unpackhi_epi16(db, db)));
+
+		if(swap_rb)
+		{
+			__m128i tmp = r;
+			r = b;
+			b = tmp;
+		}
+
+		/*interleave to 32 bit pixels*/
+		__m128i rg_lo = _mm_unpacklo_epi8(r, g);
+		__m128i rg_hi = _mm_unpackhi_epi8(r, g);
+		__m128i ba_lo = _mm_unpacklo_epi8(b, alpha);
+		__m128i ba_hi = _mm_unpackhi_epi8(b, alpha);
+
+		__m128i p0 = _mm_unpacklo_epi16(rg_lo, ba_lo);
+		__m128i p1 = _mm_unpackhi_epi16(rg_lo, ba_lo);
+		__m128i p2 = _mm_unpacklo_epi16(rg_hi, ba_hi);
+		__m128i p3 = _mm_unpackhi_epi16(rg_hi, ba_hi);
+
+		uint8_t *po = out + (w * bpp);
+
+		if(bpp == 4)
+		{
+			_mm_storeu_si128((__m128i *) po, p0);
+			_mm_storeu_si128((__m128i *) (po + 16), p1);
+			_mm_storeu_si128((__m128i *) (po + 32), p2);
+			_mm_storeu_si128((__m128i *) (po + 48), p3);
+		}
+		else
+		{
+			/*12 valid bytes per vector*/
+			p0 = _mm_shuffle_epi8(p0, drop_alpha);
+			p1 = _mm_shuffle_epi8(p1, drop_alpha);
+			p2 = _mm_shuffle_epi8(p2, drop_alpha);
+			p3 = _mm_shuffle_epi8(p3, drop_alpha);
+
+			_mm_storeu_si128((__m128i *) po,
+				_mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+			_mm_storeu_si128((__m128i *) (po + 16),
+				_mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+			_mm_storeu_si128((__m128i *) (po + 32),
+				_mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+		}
+	}
+
+	return w;
+}
+
+/*
+ * transpose a 8x8 int16 block (one row per register)
+ */
+__attribute__((target("sse2")))
+static inline void transpose8x8_sse2(__m128i r[8])
+{
+	/*2x2 blocks*/
+	__m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+	__m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+	__m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+	__m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+	__m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+	__m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+	__m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+	__m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+	/*4x4 blocks*/
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2);
+	__m128i b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3);
+	__m128i b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6);
+	__m128i b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7);
+	__m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+	r[0] = _mm_unpacklo_epi64(b0, b4);
+	r[1] = _mm_unpackhi_epi64(b0, b4);
+	r[2] = _mm_unpacklo_epi64(b1, b5);
+	r[3] = _mm_unpackhi_epi64(b1, b5);
+	r[4] = _mm_unpacklo_epi64(b2, b6);
+	r[5] = _mm_unpackhi_epi64(b2, b6);
+	r[6] = _mm_unpacklo_epi64(b3, b7);
+	r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/*
+ * 8 point idct of 4 lanes (islow, see idct() in jpeg_decoder.c)
+ *  the inputs are interleaved pairs of int16 so that every product
+ *  sum is a single pmaddwd (same integer results as the scalar code)
+ * args:
+ *    o - pointer to the 8 int32 outputs (shifted)
+ *    s04 - inputs 0 and 4 (interleaved)
+ *    s26 - inputs 2 and 6 (interleaved)
+ *    s13 - inputs 1 and 3 (interleaved)
+ *    s57 - inputs 5 and 7 (interleaved)
+ *    bias - rounding bias (added before the shift)
+ *    shift - output shift
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+__attribute__((target("sse2")))
+static inline void idct_1d_sse2(__m128i o[8],
+	__m128i s04, __m128i s26, __m128i s13, __m128i s57,
+	__m128i bias, int shift)
+{
+	/*even part*/
+	__m128i t0 = _mm_madd_epi16(s04, _mm_set1_epi32(PAIR16(1 << IDCT_CONST_BITS, 1 << IDCT_CONST_BITS)));
+	__m128i t1 = _mm_madd_epi16(s04, _mm_set1_epi32(PAIR16(1 << IDCT_CONST_BITS, -(1 << IDCT_CONST_BITS))));
+	__m128i t2 = _mm_madd_epi16(s26, _mm_set1_epi32(PAIR16(IDCT_FIX_0_541196100,
+		IDCT_FIX_0_541196100 - IDCT_FIX_1_847759065)));
+	__m128i t3 = _mm_madd_epi16(s26, _mm_set1_epi32(PAIR16(IDCT_FIX_0_541196100 + IDCT_FIX_0_765366865,
+		IDCT_FIX_0_541196100)));
+
+	t0 = _mm_add_epi32(t0, bias);
+	t1 = _mm_add_epi32(t1, bias);
+
+	__m128i x0 = _mm_add_epi32(t0, t3);
+	__m128i x3 = _mm_sub_epi32(t0, t3);
+	__m128i x1 = _mm_add_epi32(t1, t2);
+	__m128i x2 = _mm_sub_epi32(t1, t2);
+
+	/*odd part (the shared products expanded for each output)*/
+	__m128i y3 = _mm_add_epi32(
+		_mm_madd_epi16(s13, _mm_set1_epi32(PAIR16(
+			IDCT_FIX_1_501321110 + IDCT_FIX_1_175875602 - IDCT_FIX_0_899976223 - IDCT_FIX_0_390180644,
+			IDCT_FIX_1_175875602))),
+		_mm_madd_epi16(s57, _mm_set1_epi32(PAIR16(
+			IDCT_FIX_1_175875602 - IDCT_FIX_0_390180644,
+			IDCT_FIX_1_175875602 - IDCT_FIX_0_899976223))));
+	__m128i y2 = _mm_add_epi32(
+		_mm_madd_epi16(s13, _mm_set1_epi32(PAIR16(
+			IDCT_FIX_1_175875602,
+			IDCT_FIX_3_072711026 + IDCT_FIX_1_175875602 - IDCT_FIX_2_562915447 - IDCT_FIX_1_961570560))),
+		_mm_madd_epi16(s57, _mm_set1_epi32(PAIR16(
+			IDCT_FIX_1_175875602 - IDCT_FIX_2_562915447,
+			IDCT_FIX_1_175875602 - IDCT_FIX_1_961570560))));
+	__m128i y1 = _mm_add_epi32(
+		_mm_madd_epi16(s13, _mm_set1_epi32(PAIR16(
+			IDCT_FIX_1_175875602 - IDCT_FIX_0_390180644,
+			IDCT_FIX_1_175875602 - IDCT_FIX_2_562915447))),
+		_mm_madd_epi16(s57, _mm_set1_epi32(PAIR16(
+			IDCT_FIX_2_053119869 + IDCT_FIX_1_175875602 - IDCT_FIX_2_562915447 - IDCT_FIX_0_390180644,
+			IDCT_FIX_1_175875602))));
+	__m128i y0 = _mm_add_epi32(
+		_mm_madd_epi16(s13, _mm_set1_epi32(PAIR16(
+			IDCT_FIX_1_175875602 - IDCT_FIX_0_899976223,
+			IDCT_FIX_1_175875602 - IDCT_FIX_1_961570560))),
+		_mm_madd_epi16(s57, _mm_set1_epi32(PAIR16(
+			IDCT_FIX_1_175875602,
+			IDCT_FIX_0_298631336 + IDCT_FIX_1_175875602 - IDCT_FIX_0_899976223 - IDCT_FIX_1_961570560))));
+
+	o[0] = _mm_srai_epi32(_mm_add_epi32(x0, y3), shift);
+	o[7] = _mm_srai_epi32(_mm_sub_epi32(x0, y3), shift);
+	o[1] = _mm_srai_epi32(_mm_add_epi32(x1, y2), shift);
+	o[6] = _mm_srai_epi32(_mm_sub_epi32(x1, y2), shift);
+	o[2] = _mm_srai_epi32(_mm_add_epi32(x2, y1), shift);
+	o[5] = _mm_srai_epi32(_mm_sub_epi32(x2, y1), shift);
+	o[3] = _mm_srai_epi32(_mm_add_epi32(x3, y0), shift);
+	o[4] = _mm_srai_epi32(_mm_sub_epi32(x3, y0), shift);
+}
+
+/*
+ * 8 point idct of the 8 columns of a block (one row per register)
+ * args:
+ *    r - pointer to the 8 rows (replaced by the results)
+ *    bias - rounding bias
+ *    shift - output shift
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+__attribute__((target("sse2")))
+static inline void idct_pass_sse2(__m128i r[8], __m128i bias, int shift)
+{
+	__m128i lo[8];
+	__m128i hi[8];
+	int i = 0;
+
+	idct_1d_sse2(lo,
+		_mm_unpacklo_epi16(r[0], r[4]), _mm_unpacklo_epi16(r[2], r[6]),
+		_mm_unpacklo_epi16(r[1], r[3]), _mm_unpacklo_epi16(r[5], r[7]),
+		bias, shift);
+	idct_1d_sse2(hi,
+		_mm_unpackhi_epi16(r[0], r[4]), _mm_unpackhi_epi16(r[2], r[6]),
+		_mm_unpackhi_epi16(r[1], r[3]), _mm_unpackhi_epi16(r[5], r[7]),
+		bias, shift);
+
+	for(i = 0; i < 8; i++)
+		r[i] = _mm_packs_epi32(lo[i], hi[i]);
+}
+
+/*
+ * 8x8 inverse dct (SSE2)
+ * args:
+ *    see idct_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+__attribute__((target("sse2")))
+static void idct_8x8_sse2(uint8_t *out, int stride, const int16_t *coef)
+{
+	__m128i r[8];
+	int i = 0;
+
+	for(i = 0; i < 8; i++)
+		r[i] = _mm_loadu_si128((const __m128i *) (coef + i * 8));
+
+	/*columns*/
+	idct_pass_sse2(r, _mm_set1_epi32(1 << (IDCT_PASS1_SHIFT - 1)), IDCT_PASS1_SHIFT);
+	transpose8x8_sse2(r);
+
+	/*rows (level shift by 128)*/
+	idct_pass_sse2(r, _mm_set1_epi32((1 << (IDCT_PASS2_SHIFT - 1)) + (128 << IDCT_PASS2_SHIFT)),
+		IDCT_PASS2_SHIFT);
+	transpose8x8_sse2(r);
+
+	for(i = 0; i < 8; i += 2)
+	{
+		__m128i px = _mm_packus_epi16(r[i], r[i + 1]);
+		_mm_storel_epi64((__m128i *) (out + i * stride), px);
+		_mm_storel_epi64((__m128i *) (out + (i + 1) * stride), _mm_srli_si128(px, 8));
+	}
+}
+
+#endif /*SIMD_X86*/
+
+#ifdef SIMD_NEON
+
+/*
+ * packed 4:2:2 to yu12 (NEON - 32 pixels per iteration)
+ * args:
+ *    see packed422_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels converted
+ */
+static int packed422_to_yu12_neon(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	const uint8_t *in1, const uint8_t *in2,
+	int width, int layout)
+{
+	int y0 = (layout & PACKED422_Y_ODD) ? 1 : 0; /*first luma byte*/
+	int c0 = 1 - y0; /*first chroma byte*/
+	/*chroma destinations in packed order*/
+	uint8_t *pc0 = (layout & PACKED422_V_FIRST) ? pv : pu;
+	uint8_t *pc1 = (layout & PACKED422_V_FIRST) ? pu : pv;
+
+	int w = 0;
+	for(w = 0; w + 32 <= width; w += 32)
+	{
+		/*deinterleave the 4 bytes of each pixel pair*/
+		uint8x16x4_t r1 = vld4q_u8(in1 + w * 2);
+		uint8x16x4_t r2 = vld4q_u8(in2 + w * 2);
+
+		uint8x16x2_t y;
+		y.val[0] = r1.val[y0];
+		y.val[1] = r1.val[y0 + 2];
+		vst2q_u8(py1 + w, y);
+		y.val[0] = r2.val[y0];
+		y.val[1] = r2.val[y0 + 2];
+		vst2q_u8(py2 + w, y);
+
+		/*vhadd truncates like the scalar (a + b) / 2*/
+		vst1q_u8(pc0 + w / 2, vhaddq_u8(r1.val[c0], r2.val[c0]));
+		vst1q_u8(pc1 + w / 2, vhaddq_u8(r1.val[c0 + 2], r2.val[c0 + 2]));
+	}
+
+	return w;
+}
+
+/*
+ * luma for 8 pixels (int16 r, g, b)
+ */
+static inline uint8x8_t rgb_to_y_neon(int16x8_t r, int16x8_t g, int16x8_t b,
+	const yuv_matrix_t *matrix)
+{
+	int32x4_t lo = vmull_n_s16(vget_low_s16(r), matrix->y[0]);
+	lo = vmlal_n_s16(lo, vget_low_s16(g), matrix->y[1]);
+	lo = vmlal_n_s16(lo, vget_low_s16(b), matrix->y[2]);
+	int32x4_t hi = vmull_n_s16(vget_high_s16(r), matrix->y[0]);
+	hi = vmlal_n_s16(hi, vget_high_s16(g), matrix->y[1]);
+	hi = vmlal_n_s16(hi, vget_high_s16(b), matrix->y[2]);
+
+	/*rounding shift with saturation - same as the scalar code*/
+	return vqmovn_u16(vcombine_u16(
+		vqrshrun_n_s32(lo, YUV_MATRIX_SHIFT),
+		vqrshrun_n_s32(hi, YUV_MATRIX_SHIFT)));
+}
+
+/*
+ * chroma for 8 blocks (int16 2x2 sums of r, g, b)
+ */
+static inline uint8x8_t rgb_to_c_neon(int16x8_t rs, int16x8_t gs, int16x8_t bs,
+	const int16_t c[3])
+{
+	const int32x4_t offset = vdupq_n_s32(128 << (YUV_MATRIX_SHIFT + 2));
+
+	int32x4_t lo = vmull_n_s16(vget_low_s16(rs), c[0]);
+	lo = vmlal_n_s16(lo, vget_low_s16(gs), c[1]);
+	lo = vmlal_n_s16(lo, vget_low_s16(bs), c[2]);
+	int32x4_t hi = vmull_n_s16(vget_high_s16(rs), c[0]);
+	hi = vmlal_n_s16(hi, vget_high_s16(gs), c[1]);
+	hi = vmlal_n_s16(hi, vget_high_s16(bs), c[2]);
+
+	return vqmovn_u16(vcombine_u16(
+		vqrshrun_n_s32(vaddq_s32(lo, offset), YUV_MATRIX_SHIFT + 2),
+		vqrshrun_n_s32(vaddq_s32(hi, offset), YUV_MATRIX_SHIFT + 2)));
+}
+
+/*
+ * planar rgb to yu12 (NEON - 16 pixels per iteration)
+ * args:
+ *    see rgb_planes_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels converted
+ */
+static int rgb_planes_to_yu12_neon(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	uint8_t * const rgb1[3], uint8_t * const rgb2[3],
+	int width, const yuv_matrix_t *matrix)
+{
+	int w = 0;
+	for(w = 0; w + 16 <= width; w += 16)
+	{
+		uint8x16_t r1 = vld1q_u8(rgb1[0] + w);
+		uint8x16_t g1 = vld1q_u8(rgb1[1] + w);
+		uint8x16_t b1 = vld1q_u8(rgb1[2] + w);
+		uint8x16_t r2 = vld1q_u8(rgb2[0] + w);
+		uint8x16_t g2 = vld1q_u8(rgb2[1] + w);
+		uint8x16_t b2 = vld1q_u8(rgb2[2] + w);
+
+		vst1q_u8(py1 + w, vcombine_u8(
+			rgb_to_y_neon(
+				vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(r1))),
+				vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(g1))),
+				vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(b1))), matrix),
+			rgb_to_y_neon(
+				vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(r1))),
+				vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(g1))),
+				vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(b1))), matrix)));
+		vst1q_u8(py2 + w, vcombine_u8(
+			rgb_to_y_neon(
+				vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(r2))),
+				vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(g2))),
+				vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(b2))), matrix),
+			rgb_to_y_neon(
+				vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(r2))),
+				vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(g2))),
+				vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(b2))), matrix)));
+
+		/*2x2 block sums (pairwise add of each line)*/
+		int16x8_t rs = vreinterpretq_s16_u16(vaddq_u16(vpaddlq_u8(r1), vpaddlq_u8(r2)));
+		int16x8_t gs = vreinterpretq_s16_u16(vaddq_u16(vpaddlq_u8(g1), vpaddlq_u8(g2)));
+		int16x8_t bs = vreinterpretq_s16_u16(vaddq_u16(vpaddlq_u8(b1), vpaddlq_u8(b2)));
+
+		vst1_u8(pu + w / 2, rgb_to_c_neon(rs, gs, bs, matrix->u));
+		vst1_u8(pv + w / 2, rgb_to_c_neon(rs, gs, bs, matrix->v));
+	}
+
+	return w;
+}
+
+/*
+ * packed 24/32 bit rgb to planes (NEON - 16 pixels per iteration)
+ * args:
+ *    see rgb_deinterleave_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels unpacked
+ */
+static int rgb_deinterleave_neon(const uint8_t *in,
+	uint8_t *r, uint8_t *g, uint8_t *b,
+	int width, int bpp, const int offset[3])
+{
+	int w = 0;
+
+	if(bpp == 3)
+	{
+		for(w = 0; w + 16 <= width; w += 16)
+		{
+			uint8x16x3_t px = vld3q_u8(in + (w * 3));
+			vst1q_u8(r + w, px.val[offset[0]]);
+			vst1q_u8(g + w, px.val[offset[1]]);
+			vst1q_u8(b + w, px.val[offset[2]]);
+		}
+	}
+	else
+	{
+		for(w = 0; w + 16 <= width; w += 16)
+		{
+			uint8x16x4_t px = vld4q_u8(in + (w * 4));
+			vst1q_u8(r + w, px.val[offset[0]]);
+			vst1q_u8(g + w, px.val[offset[1]]);
+			vst1q_u8(b + w, px.val[offset[2]]);
+		}
+	}
+
+	return w;
+}
+
+/*
+ * color offset for 4 chroma samples (int16, already minus 128)
+ */
+static inline int16x4_t yuv_to_rgb_offset_neon(int16x4_t a, int16_t ca, int16x4_t b, int16_t cb)
+{
+	int32x4_t acc = vmull_n_s16(a, ca);
+	acc = vmlal_n_s16(acc, b, cb);
+	acc = vaddq_s32(acc, vdupq_n_s32(1 << (YUV_MATRIX_SHIFT - 1)));
+
+	return vshrn_n_s32(acc, YUV_MATRIX_SHIFT);
+}
+
+/*
+ * yu12 to rgb for a line (NEON - 16 pixels per iteration)
+ * args:
+ *    see yu12_to_rgb_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of pixels converted
+ */
+static int yu12_to_rgb_neon(uint8_t *out,
+	const uint8_t *py, const uint8_t *pu, const uint8_t *pv,
+	int width, int layout)
+{
+	const int16x8_t c128 = vdupq_n_s16(128);
+	const int16x4_t zero = vdup_n_s16(0);
+
+	int swap_rb = (layout == RGB_LAYOUT_BGR24 || layout == RGB_LAYOUT_BGRA32);
+	int bpp = (layout == RGB_LAYOUT_RGB24 || layout == RGB_LAYOUT_BGR24) ? 3 : 4;
+
+	int w = 0;
+	for(w = 0; w + 16 <= width; w += 16)
+	{
+		int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pu + w / 2))), c128);
+		int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pv + w / 2))), c128);
+
+		int16x8_t dr = vcombine_s16(
+			yuv_to_rgb_offset_neon(vget_low_s16(v), YUV2RGB_VR, zero, 0),
+			yuv_to_rgb_offset_neon(vget_high_s16(v), YUV2RGB_VR, zero, 0));
+		int16x8_t dg = vcombine_s16(
+			yuv_to_rgb_offset_neon(vget_low_s16(u), YUV2RGB_UG, vget_low_s16(v), YUV2RGB_VG),
+			yuv_to_rgb_offset_neon(vget_high_s16(u), YUV2RGB_UG, vget_high_s16(v), YUV2RGB_VG));
+		int16x8_t db = vcombine_s16(
+			yuv_to_rgb_offset_neon(vget_low_s16(u), YUV2RGB_UB, zero, 0),
+			yuv_to_rgb_offset_neon(vget_high_s16(u), YUV2RGB_UB, zero, 0));
+
+		/*each chroma offset is shared by 2 pixels*/
+		int16x8x2_t dr2 = vzipq_s16(dr, dr);
+		int16x8x2_t dg2 = vzipq_s16(dg, dg);
+		int16x8x2_t db2 = vzipq_s16(db, db);
+
+		uint8x16_t y = vld1q_u8(py + w);
+		int16x8_t yl = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y)));
+		int16x8_t yh = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y)));
+
+		uint8x16_t r = vcombine_u8(vqmovun_s16(vaddq_s16(yl, dr2.val[0])), vqmovun_s16(vaddq_s16(yh, dr2.val[1])));
+		uint8x16_t g = vcombine_u8(vqmovun_s16(vaddq_s16(yl, dg2.val[0])), vqmovun_s16(vaddq_s16(yh, dg2.val[1])));
+		uint8x16_t b = vcombine_u8(vqmovun_s16(vaddq_s16(yl, db2.val[0])), vqmovun_s16(vaddq_s16(yh, db2.val[1])));
+
+		if(bpp == 4)
+		{
+			uint8x16x4_t px;
+			px.val[0] = swap_rb ? b : r;
+			px.val[1] = g;
+			px.val[2] = swap_rb ? r : b;
+			px.val[3] = vdupq_n_u8(0xFF);
+			vst4q_u8(out + (w * 4), px);
+		}
+		else
+		{
+			uint8x16x3_t px;
+			px.val[0] = swap_rb ? b : r;
+			px.val[1] = g;
+			px.val[2] = swap_rb ? r : b;
+			vst3q_u8(out + (w * 3), px);
+		}
+	}
+
+	return w;
+}
+
+/*
+ * transpose a 8x8 int16 block (one row per register)
+ */
+static inline void transpose8x8_neon(int16x8_t r[8])
+{
+	int16x8x2_t t01 = vtrnq_s16(r[0], r[1]);
+	int16x8x2_t t23 = vtrnq_s16(r[2], r[3]);
+	int16x8x2_t t45 = vtrnq_s16(r[4], r[5]);
+	int16x8x2_t t67 = vtrnq_s16(r[6], r[7]);
+
+	int32x4x2_t u02 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[0]), vreinterpretq_s32_s16(t23.val[0]));
+	int32x4x2_t u13 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[1]), vreinterpretq_s32_s16(t23.val[1]));
+	int32x4x2_t u46 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[0]), vreinterpretq_s32_s16(t67.val[0]));
+	int32x4x2_t u57 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[1]), vreinterpretq_s32_s16(t67.val[1]));
+
+	r[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u02.val[0]), vget_low_s32(u46.val[0])));
+	r[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u13.val[0]), vget_low_s32(u57.val[0])));
+	r[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u02.val[1]), vget_low_s32(u46.val[1])));
+	r[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u13.val[1]), vget_low_s32(u57.val[1])));
+	r[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u02.val[0]), vget_high_s32(u46.val[0])));
+	r[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u13.val[0]), vget_high_s32(u57.val[0])));
+	r[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u02.val[1]), vget_high_s32(u46.val[1])));
+	r[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u13.val[1]), vget_high_s32(u57.val[1])));
+}
+
+/*
+ * a * ca + b * cb (int32)
+ */
+static inline int32x4_t mul2_neon(int16x4_t a, int16_t ca, int16x4_t b, int16_t cb)
+{
+	return vmlal_n_s16(vmull_n_s16(a, ca), b, cb);
+}
+
+/*
+ * 8 point idct of 4 lanes (islow, see idct() in jpeg_decoder.c)
+ * args:
+ *    o - pointer to the 8 int32 outputs (shifted)
+ *    s - pointer to the 8 inputs
+ *    bias - rounding bias (added before the shift)
+ *    shift - negative output shift (vshl count)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static inline void idct_1d_neon(int32x4_t o[8], const int16x4_t s[8],
+	int32x4_t bias, int32x4_t shift)
+{
+	/*even part*/
+	int32x4_t t0 = vaddq_s32(vshll_n_s16(s[0], IDCT_CONST_BITS), vshll_n_s16(s[4], IDCT_CONST_BITS));
+	int32x4_t t1 = vsubq_s32(vshll_n_s16(s[0], IDCT_CONST_BITS), vshll_n_s16(s[4], IDCT_CONST_BITS));
+	int32x4_t t2 = mul2_neon(s[2], IDCT_FIX_0_541196100,
+		s[6], IDCT_FIX_0_541196100 - IDCT_FIX_1_847759065);
+	int32x4_t t3 = mul2_neon(s[2], IDCT_FIX_0_541196100 + IDCT_FIX_0_765366865,
+		s[6], IDCT_FIX_0_541196100);
+
+	t0 = vaddq_s32(t0, bias);
+	t1 = vaddq_s32(t1, bias);
+
+	int32x4_t x0 = vaddq_s32(t0, t3);
+	int32x4_t x3 = vsubq_s32(t0, t3);
+	int32x4_t x1 = vaddq_s32(t1, t2);
+	int32x4_t x2 = vsubq_s32(t1, t2);
+
+	/*odd part (the shared products expanded for each output)*/
+	int32x4_t y3 = vaddq_s32(
+		mul2_neon(s[1], IDCT_FIX_1_501321110 + IDCT_FIX_1_175875602 - IDCT_FIX_0_899976223 - IDCT_FIX_0_390180644,
+			s[3], IDCT_FIX_1_175875602),
+		mul2_neon(s[5], IDCT_FIX_1_175875602 - IDCT_FIX_0_390180644,
+			s[7], IDCT_FIX_1_175875602 - IDCT_FIX_0_899976223));
+	int32x4_t y2 = vaddq_s32(
+		mul2_neon(s[1], IDCT_FIX_1_175875602,
+			s[3], IDCT_FIX_3_072711026 + IDCT_FIX_1_175875602 - IDCT_FIX_2_562915447 - IDCT_FIX_1_961570560),
+		mul2_neon(s[5], IDCT_FIX_1_175875602 - IDCT_FIX_2_562915447,
+			s[7], IDCT_FIX_1_175875602 - IDCT_FIX_1_961570560));
+	int32x4_t y1 = vaddq_s32(
+		mul2_neon(s[1], IDCT_FIX_1_175875602 - IDCT_FIX_0_390180644,
+			s[3], IDCT_FIX_1_175875602 - IDCT_FIX_2_562915447),
+		mul2_neon(s[5], IDCT_FIX_2_053119869 + IDCT_FIX_1_175875602 - IDCT_FIX_2_562915447 - IDCT_FIX_0_390180644,
+			s[7], IDCT_FIX_1_175875602));
+	int32x4_t y0 = vaddq_s32(
+		mul2_neon(s[1], IDCT_FIX_1_175875602 - IDCT_FIX_0_899976223,
+			s[3], IDCT_FIX_1_175875602 - IDCT_FIX_1_961570560),
+		mul2_neon(s[5], IDCT_FIX_1_175875602,
+			s[7], IDCT_FIX_0_298631336 + IDCT_FIX_1_175875602 - IDCT_FIX_0_899976223 - IDCT_FIX_1_961570560));
+
+	o[0] = vshlq_s32(vaddq_s32(x0, y3), shift);
+	o[7] = vshlq_s32(vsubq_s32(x0, y3), shift);
+	o[1] = vshlq_s32(vaddq_s32(x1, y2), shift);
+	o[6] = vshlq_s32(vsubq_s32(x1, y2), shift);
+	o[2] = vshlq_s32(vaddq_s32(x2, y1), shift);
+	o[5] = vshlq_s32(vsubq_s32(x2, y1), shift);
+	o[3] = vshlq_s32(vaddq_s32(x3, y0), shift);
+	o[4] = vshlq_s32(vsubq_s32(x3, y0), shift);
+}
+
+/*
+ * 8 point idct of the 8 columns of a block (one row per register)
+ * args:
+ *    r - pointer to the 8 rows (replaced by the results)
+ *    bias - rounding bias
+ *    shift - output shift
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static inline void idct_pass_neon(int16x8_t r[8], int32_t bias, int shift)
+{
+	int16x4_t lo[8];
+	int16x4_t hi[8];
+	int32x4_t olo[8];
+	int32x4_t ohi[8];
+	int i = 0;
+
+	for(i = 0; i < 8; i++)
+	{
+		lo[i] = vget_low_s16(r[i]);
+		hi[i] = vget_high_s16(r[i]);
+	}
+
+	idct_1d_neon(olo, lo, vdupq_n_s32(bias), vdupq_n_s32(-shift));
+	idct_1d_neon(ohi, hi, vdupq_n_s32(bias), vdupq_n_s32(-shift));
+
+	for(i = 0; i < 8; i++)
+		r[i] = vcombine_s16(vqmovn_s32(olo[i]), vqmovn_s32(ohi[i]));
+}
+
+/*
+ * 8x8 inverse dct (NEON)
+ * args:
+ *    see idct_kernel_t
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void idct_8x8_neon(uint8_t *out, int stride, const int16_t *coef)
+{
+	int16x8_t r[8];
+	int i = 0;
+
+	for(i = 0; i < 8; i++)
+		r[i] = vld1q_s16(coef + i * 8);
+
+	/*columns*/
+	idct_pass_neon(r, 1 << (IDCT_PASS1_SHIFT - 1), IDCT_PASS1_SHIFT);
+	transpose8x8_neon(r);
+
+	/*rows (level shift by 128)*/
+	idct_pass_neon(r, (1 << (IDCT_PASS2_SHIFT - 1)) + (128 << IDCT_PASS2_SHIFT), IDCT_PASS2_SHIFT);
+	transpose8x8_neon(r);
+
+	for(i = 0; i < 8; i++)
+		vst1_u8(out + i * stride, vqmovun_s16(r[i]));
+}
+
+#endif /*SIMD_NEON*/
+
+/*
+ * select the SIMD kernels for the running cpu (once)
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void select_simd_kernels()
+{
+	const char *name = "scalar";
+
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse2"))
+	{
+		packed422_kernel = packed422_to_yu12_sse2;
+		rgb_planes_kernel = rgb_planes_to_yu12_sse2;
+		idct_kernel = idct_8x8_sse2;
+		name = "sse2";
+	}
+	if(__builtin_cpu_supports("ssse3"))
+	{
+		rgb_deinterleave_kernel = rgb_deinterleave_ssse3;
+		yu12_to_rgb_kernel = yu12_to_rgb_ssse3;
+	}
+	if(__builtin_cpu_supports("avx2"))
+	{
+		packed422_kernel = packed422_to_yu12_avx2;
+		name = "avx2";
+	}
+#endif
+
+#ifdef SIMD_NEON
+	packed422_kernel = packed422_to_yu12_neon;
+	rgb_planes_kernel = rgb_planes_to_yu12_neon;
+	rgb_deinterleave_kernel = rgb_deinterleave_neon;
+	yu12_to_rgb_kernel = yu12_to_rgb_neon;
+	idct_kernel = idct_8x8_neon;
+	name = "neon";
+#endif
+
+	if(verbosity > 1)
+		printf("V4L2_CORE: using %s colorspace conversion kernels\n", name);
+}
+
+/*
+ * get the best packed 4:2:2 to yu12 kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+packed422_kernel_t get_packed422_to_yu12_kernel()
+{
+	pthread_once(&simd_once, select_simd_kernels);
+
+	return packed422_kernel;
+}
+
+/*
+ * get the best planar rgb to yu12 kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+rgb_planes_kernel_t get_rgb_planes_to_yu12_kernel()
+{
+	pthread_once(&simd_once, select_simd_kernels);
+
+	return rgb_planes_kernel;
+}
+
+/*
+ * get the best packed rgb deinterleave kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+rgb_deinterleave_kernel_t get_rgb_deinterleave_kernel()
+{
+	pthread_once(&simd_once, select_simd_kernels);
+
+	return rgb_deinterleave_kernel;
+}
+
+/*
+ * get the best yu12 to rgb kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+yu12_to_rgb_kernel_t get_yu12_to_rgb_kernel()
+{
+	pthread_once(&simd_once, select_simd_kernels);
+
+	return yu12_to_rgb_kernel;
+}
+
+/*
+ * get the best 8x8 inverse dct kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+idct_kernel_t get_idct_kernel()
+{
+	pthread_once(&simd_once, select_simd_kernels);
+
+	return idct_kernel;
+}
@@ -0,0 +1,238 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - SIMD colorspace conversion and idct kernels              #
+#                                                                               #
+********************************************************************************/
+
+#ifndef COLORSPACES_SIMD_H
+#define COLORSPACES_SIMD_H
+
+#include <inttypes.h>
+
+/*packed 4:2:2 byte layouts (4 bytes per 2 pixels)*/
+#define PACKED422_Y_ODD    (1) /*luma in odd bytes (uyvy, vyuy)*/
+#define PACKED422_V_FIRST  (2) /*v before u (yvyu, vyuy)*/
+
+/*
+ * packed 4:2:2 to yu12 kernel for a pair of lines
+ * args:
+ *    py1 - pointer to first output luma line
+ *    py2 - pointer to second output luma line
+ *    pu - pointer to output u line
+ *    pv - pointer to output v line
+ *    in1 - pointer to first packed input line
+ *    in2 - pointer to second packed input line
+ *    width - line width in pixels
+ *    layout - packed byte layout (PACKED422_ flags)
+ *
+ * returns: number of pixels converted (the caller converts the remaining pixels)
+ */
+typedef int (*packed422_kernel_t)(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	const uint8_t *in1, const uint8_t *in2,
+	int width, int layout);
+
+/*
+ * fixed point (Q14) rgb to yuv matrix
+ *   y = (y[0]*r + y[1]*g + y[2]*b + 2^13) >> 14
+ *   u = (u[0]*rs + u[1]*gs + u[2]*bs + 128*2^16 + 2^15) >> 16
+ *   (rs, gs, bs - sums of the 2x2 pixel block)
+ */
+#define YUV_MATRIX_SHIFT (14)
+
+typedef struct _yuv_matrix_t
+{
+	int16_t y[3];
+	int16_t u[3];
+	int16_t v[3];
+} yuv_matrix_t;
+
+/*
+ * planar rgb to yu12 kernel for a pair of lines
+ * args:
+ *    py1 - pointer to first output luma line
+ *    py2 - pointer to second output luma line
+ *    pu - pointer to output u line
+ *    pv - pointer to output v line
+ *    rgb1 - pointers to the r, g and b planes of the first line
+ *    rgb2 - pointers to the r, g and b planes of the second line
+ *    width - line width in pixels
+ *    matrix - pointer to fixed point matrix
+ *
+ * returns: number of pixels converted (the caller converts the remaining pixels)
+ */
+typedef int (*rgb_planes_kernel_t)(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	uint8_t * const rgb1[3], uint8_t * const rgb2[3],
+	int width, const yuv_matrix_t *matrix);
+
+/*
+ * packed 24/32 bit rgb to r, g and b planes kernel for a line
+ * args:
+ *    in - pointer to packed input line
+ *    r - pointer to red plane line
+ *    g - pointer to green plane line
+ *    b - pointer to blue plane line
+ *    width - line width in pixels
+ *    bpp - bytes per pixel (3 or 4)
+ *    offset - byte offsets of r, g and b in the pixel
+ *
+ * returns: number of pixels unpacked (the caller unpacks the remaining pixels)
+ */
+typedef int (*rgb_deinterleave_kernel_t)(const uint8_t *in,
+	uint8_t *r, uint8_t *g, uint8_t *b,
+	int width, int bpp, const int offset[3]);
+
+/*
+ * yu12 to rgb output layouts
+ */
+#define RGB_LAYOUT_RGB24   (0)
+#define RGB_LAYOUT_BGR24   (1)
+#define RGB_LAYOUT_RGBA32  (2)
+#define RGB_LAYOUT_BGRA32  (3)
+
+/*
+ * fixed point (Q14) yuv to rgb coefficients (full range BT.601)
+ *   r = y + ((YUV2RGB_VR*(v-128) + 2^13) >> 14)
+ *   g = y + ((YUV2RGB_UG*(u-128) + YUV2RGB_VG*(v-128) + 2^13) >> 14)
+ *   b = y + ((YUV2RGB_UB*(u-128) + 2^13) >> 14)
+ */
+#define YUV2RGB_VR  (22970)  /* 1.402   */
+#define YUV2RGB_UG  (-5638)  /* -0.34414 */
+#define YUV2RGB_VG  (-11700) /* -0.71414 */
+#define YUV2RGB_UB  (29032)  /* 1.772   */
+
+/*
+ * yu12 to rgb kernel for a line
+ * args:
+ *    out - pointer to output line
+ *    py - pointer to luma line
+ *    pu - pointer to u line
+ *    pv - pointer to v line
+ *    width - line width in pixels
+ *    layout - output layout (RGB_LAYOUT_)
+ *
+ * returns: number of pixels converted (the caller converts the remaining pixels)
+ */
+typedef int (*yu12_to_rgb_kernel_t)(uint8_t *out,
+	const uint8_t *py, const uint8_t *pu, const uint8_t *pv,
+	int width, int layout);
+
+/*
+ * fixed point (Q12) 8x8 inverse dct constants (jidctint "islow" algorithm)
+ *   IDCT_FIX(x) = x * 2^12
+ *   the first (column) pass keeps 2 extra bits of precision,
+ *   the two passes scale the output by 2^3 (8x8 dct normalization)
+ */
+#define IDCT_FIX_0_298631336 (1223)
+#define IDCT_FIX_0_390180644 (1598)
+#define IDCT_FIX_0_541196100 (2217)
+#define IDCT_FIX_0_765366865 (3135)
+#define IDCT_FIX_0_899976223 (3686)
+#define IDCT_FIX_1_175875602 (4816)
+#define IDCT_FIX_1_501321110 (6149)
+#define IDCT_FIX_1_847759065 (7568)
+#define IDCT_FIX_1_961570560 (8035)
+#define IDCT_FIX_2_053119869 (8410)
+#define IDCT_FIX_2_562915447 (10498)
+#define IDCT_FIX_3_072711026 (12586)
+
+#define IDCT_CONST_BITS  (12)
+#define IDCT_PASS1_SHIFT (IDCT_CONST_BITS - 2)
+#define IDCT_PASS2_SHIFT (IDCT_CONST_BITS + 2 + 3)
+
+/*
+ * 8x8 inverse dct kernel
+ *  the column pass results are kept in 16 bits
+ *  (always the case for coefficients of 8 bit jpeg images)
+ * args:
+ *    out - pointer to output block (level shifted and clipped samples)
+ *    stride - output line size in bytes
+ *    coef - pointer to the 64 dequantized coefficients (natural order)
+ *
+ * returns: none
+ */
+typedef void (*idct_kernel_t)(uint8_t *out, int stride, const int16_t *coef);
+
+/*
+ * get the best packed 4:2:2 to yu12 kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+packed422_kernel_t get_packed422_to_yu12_kernel();
+
+/*
+ * get the best planar rgb to yu12 kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+rgb_planes_kernel_t get_rgb_planes_to_yu12_kernel();
+
+/*
+ * get the best packed rgb deinterleave kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+rgb_deinterleave_kernel_t get_rgb_deinterleave_kernel();
+
+/*
+ * get the best yu12 to rgb kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+yu12_to_rgb_kernel_t get_yu12_to_rgb_kernel();
+
+/*
+ * get the best 8x8 inverse dct kernel for the running cpu
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to kernel or NULL if no SIMD kernel is available
+ */
+idct_kernel_t get_idct_kernel();
+
+#endif
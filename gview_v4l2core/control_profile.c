@@ -28,6 +28,7 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <inttypes.h>
 
 #include "gviewv4l2core.h"
 #include "v4l2_controls.h"
@@ -36,6 +37,325 @@
 
 extern int verbosity;
 
+/*
+ * binary profile format:
+ *   header (device identity and checksum of the entry data)
+ *   entries for the controls with non default values
+ *   (string controls are followed by the string data)
+ */
+#define CTRL_PROFILE_MAGIC    "GVCTRLB"
+#define CTRL_PROFILE_VERSION  (1)
+#define CTRL_PROFILE_MAX_DATA (1024 * 1024)
+
+typedef struct _ctrl_profile_header_t
+{
+	char magic[8];          //CTRL_PROFILE_MAGIC
+	uint32_t version;       //CTRL_PROFILE_VERSION
+	uint32_t vendor;        //usb vendor id (0 if unknown)
+	uint32_t product;       //usb product id (0 if unknown)
+	uint32_t firmware;      //usb bcdDevice (0 if unknown)
+	char card[32];          //device name (v4l2 capability card)
+	uint32_t num_entries;   //number of control entries
+	uint32_t data_size;     //size of entry data in bytes
+	uint32_t checksum;      //FNV-1a checksum of entry data
+} ctrl_profile_header_t;
+
+typedef struct _ctrl_profile_entry_t
+{
+	int32_t id;             //control id
+	int32_t type;           //control type
+	int32_t minimum;        //control range (must match on load)
+	int32_t maximum;
+	int32_t step;
+	int32_t default_value;
+	int64_t value;          //control value (value64 for 64 bit controls)
+	uint32_t size;          //string data size (including terminator)
+	uint32_t reserved;
+} ctrl_profile_entry_t;
+
+/*
+ * FNV-1a checksum
+ * args:
+ *   data - pointer to data
+ *   size - data size in bytes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: checksum
+ */
+static uint32_t profile_checksum(const uint8_t *data, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	size_t i = 0;
+
+	for(i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/*
+ * fill the device identity in the binary profile header
+ * args:
+ *   vd - pointer to video device data
+ *   header - pointer to profile header
+ *
+ * asserts:
+ *   none
+ *
+ * returns: void
+ */
+static void get_profile_identity(v4l2_dev_t *vd, ctrl_profile_header_t *header)
+{
+	v4l2_dev_sys_data_t *sys_data = NULL;
+
+	if(vd->this_device >= 0 &&
+		vd->this_device < v4l2core_get_num_devices())
+		sys_data = v4l2core_get_device_sys_data(vd->this_device);
+
+	if(sys_data &&
+		sys_data->device &&
+		strcmp(sys_data->device, vd->videodevice) == 0)
+	{
+		header->vendor = sys_data->vendor;
+		header->product = sys_data->product;
+		header->firmware = sys_data->firmware;
+	}
+
+	snprintf(header->card, sizeof(header->card), "%s", (char *) vd->cap.card);
+}
+
+/*
+ * check if the control can be stored in/restored from a binary profile
+ * args:
+ *   control - pointer to control
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if control is usable, 0 otherwise
+ */
+static int profile_control_usable(v4l2_ctrl_t *control)
+{
+	if((control->control.flags & V4L2_CTRL_FLAG_WRITE_ONLY) ||
+	   (control->control.flags & V4L2_CTRL_FLAG_READ_ONLY))
+		return 0;
+
+	switch(control->control.type)
+	{
+		case V4L2_CTRL_TYPE_BUTTON:
+		case V4L2_CTRL_TYPE_CTRL_CLASS:
+			return 0;
+		default:
+			return 1;
+	}
+}
+
+/*
+ * read the next entry of the binary profile data
+ *  (bounds are checked before the offset is advanced)
+ * args:
+ *   data - pointer to entry data
+ *   data_size - entry data size in bytes
+ *   offset - pointer to offset of the entry (advanced to the next one)
+ *   entry - pointer to entry (filled)
+ *   str - pointer to string data of the entry (set, NULL if none)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 if the entry is valid, -1 otherwise
+ */
+static int read_profile_entry(const uint8_t *data, size_t data_size,
+	size_t *offset, ctrl_profile_entry_t *entry, const char **str)
+{
+	size_t pos = *offset;
+
+	if(pos > data_size || data_size - pos < sizeof(ctrl_profile_entry_t))
+		return -1;
+	memcpy(entry, data + pos, sizeof(ctrl_profile_entry_t));
+	pos += sizeof(ctrl_profile_entry_t);
+
+	if((size_t) entry->size > data_size - pos)
+		return -1;
+	/*strings must be null terminated*/
+	if(entry->size > 0 && data[pos + entry->size - 1] != 0)
+		return -1;
+
+	*str = (entry->size > 0) ? (const char *) (data + pos) : NULL;
+	*offset = pos + entry->size;
+	return 0;
+}
+
+/*
+ * load a binary control profile and apply the differences
+ *  to the current control values
+ * args:
+ *   vd - pointer to video device data
+ *   fp - pointer to open profile file (at start)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 -E_OK)
+ */
+static int load_binary_control_profile(v4l2_dev_t *vd, FILE *fp)
+{
+	ctrl_profile_header_t header;
+	ctrl_profile_header_t identity;
+
+	if(fread(&header, sizeof(ctrl_profile_header_t), 1, fp) != 1 ||
+		memcmp(header.magic, CTRL_PROFILE_MAGIC, sizeof(CTRL_PROFILE_MAGIC)) != 0 ||
+		header.version != CTRL_PROFILE_VERSION ||
+		header.data_size > CTRL_PROFILE_MAX_DATA)
+	{
+		fprintf(stderr, "V4L2_CORE: (load_control_profile) no valid binary header found\n");
+		return(E_NO_DATA);
+	}
+
+	memset(&identity, 0, sizeof(ctrl_profile_header_t));
+	get_profile_identity(vd, &identity);
+
+	if(header.vendor && identity.vendor &&
+		(header.vendor != identity.vendor || header.product != identity.product))
+	{
+		fprintf(stderr, "V4L2_CORE: (load_control_profile) profile is for device %04x:%04x (not %04x:%04x)\n",
+			header.vendor, header.product, identity.vendor, identity.product);
+		return(E_NO_DATA);
+	}
+
+	if(verbosity > 0 && header.firmware != identity.firmware)
+		printf("V4L2_CORE: (load_control_profile) profile firmware %04x differs from device (%04x)\n",
+			header.firmware, identity.firmware);
+
+	uint8_t *data = NULL;
+	if(header.data_size > 0)
+	{
+		data = calloc(header.data_size, sizeof(uint8_t));
+		if(data == NULL)
+		{
+			fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (load_binary_control_profile): %s\n", strerror(errno));
+			exit(-1);
+		}
+
+		if(fread(data, header.data_size, 1, fp) != 1)
+		{
+			fprintf(stderr, "V4L2_CORE: (load_control_profile) truncated binary profile\n");
+			free(data);
+			return(E_NO_DATA);
+		}
+	}
+
+	if(profile_checksum(data, header.data_size) != header.checksum)
+	{
+		fprintf(stderr, "V4L2_CORE: (load_control_profile) binary profile checksum mismatch\n");
+		free(data);
+		return(E_NO_DATA);
+	}
+
+	/*validate the entries before touching the control values*/
+	size_t offset = 0;
+	uint32_t i = 0;
+	for(i = 0; i < header.num_entries; ++i)
+	{
+		ctrl_profile_entry_t entry;
+		const char *str = NULL;
+
+		if(read_profile_entry(data, header.data_size, &offset, &entry, &str) != 0)
+			break;
+	}
+
+	if(i < header.num_entries || offset != header.data_size)
+	{
+		fprintf(stderr, "V4L2_CORE: (load_control_profile) corrupted binary profile\n");
+		free(data);
+		return(E_NO_DATA);
+	}
+
+	/*
+	 * target values: profile entries or the default value
+	 * (strings have no default and are only set if stored)
+	 */
+	v4l2_ctrl_t *list[vd->num_controls];
+	int n = 0;
+
+	v4l2_ctrl_t *current = vd->list_device_controls;
+	for( ; current != NULL && n < vd->num_controls; current = current->next)
+	{
+		if(!profile_control_usable(current) ||
+			current->control.type == V4L2_CTRL_TYPE_STRING)
+			continue;
+
+		if(current->control.type == V4L2_CTRL_TYPE_INTEGER64)
+			current->value64 = current->control.default_value;
+		else
+			current->value = current->control.default_value;
+
+		list[n++] = current;
+	}
+
+	offset = 0;
+	for(i = 0; i < header.num_entries; ++i)
+	{
+		ctrl_profile_entry_t entry;
+		const char *str = NULL;
+
+		if(read_profile_entry(data, header.data_size, &offset, &entry, &str) != 0)
+			break;
+
+		current = v4l2core_get_control_by_id(vd, entry.id);
+
+		/*check values*/
+		if(current == NULL ||
+			!profile_control_usable(current) ||
+			(int32_t) current->control.type != entry.type ||
+			current->control.minimum != entry.minimum ||
+			current->control.maximum != entry.maximum ||
+			current->control.step != entry.step ||
+			current->control.default_value != entry.default_value)
+		{
+			if(verbosity > 0)
+				printf("V4L2_CORE: (load_control_profile) skiping control 0x%08x\n", entry.id);
+			continue;
+		}
+
+		switch(current->control.type)
+		{
+			case V4L2_CTRL_TYPE_STRING:
+				if(str == NULL || n >= vd->num_controls)
+					break;
+				if(current->string)
+					free(current->string);
+				current->string = strndup(str, current->control.maximum);
+				list[n++] = current;
+				break;
+
+			case V4L2_CTRL_TYPE_INTEGER64:
+				current->value64 = entry.value;
+				break;
+
+			default:
+				current->value = (int32_t) entry.value;
+				break;
+		}
+	}
+
+	free(data);
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: (load_control_profile) binary profile with %u entries\n",
+			header.num_entries);
+
+	/*only the controls that differ from the device values are written*/
+	set_control_values_ordered(vd, list, n);
+
+	return (E_OK);
+}
+
 /*
  * save the device control values into a profile file
  * args:
@@ -123,8 +443,125 @@ int save_control_profile(v4l2_dev_t *vd, const char *filename)
 	return (E_OK);
 }
 
+/*
+ * save the device control values into a binary profile file
+ *  (only controls with non default values are stored)
+ * args:
+ *   vd - pointer to video device data
+ *   filename - profile filename
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (0 -E_OK)
+ */
+int save_control_profile_binary(v4l2_dev_t *vd, const char *filename)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	ctrl_profile_header_t header;
+	memset(&header, 0, sizeof(ctrl_profile_header_t));
+	memcpy(header.magic, CTRL_PROFILE_MAGIC, sizeof(CTRL_PROFILE_MAGIC));
+	header.version = CTRL_PROFILE_VERSION;
+	get_profile_identity(vd, &header);
+
+	uint8_t *data = NULL;
+	uint32_t data_max_size = 0;
+
+	v4l2_ctrl_t *current = vd->list_device_controls;
+	for( ; current != NULL; current = current->next)
+	{
+		if(!profile_control_usable(current) ||
+		   (current->control.flags & V4L2_CTRL_FLAG_GRABBED))
+			continue;
+
+		ctrl_profile_entry_t entry;
+		memset(&entry, 0, sizeof(ctrl_profile_entry_t));
+		entry.id = current->control.id;
+		entry.type = current->control.type;
+		entry.minimum = current->control.minimum;
+		entry.maximum = current->control.maximum;
+		entry.step = current->control.step;
+		entry.default_value = current->control.default_value;
+
+		switch(current->control.type)
+		{
+			case V4L2_CTRL_TYPE_STRING:
+				if(current->string == NULL || current->string[0] == 0)
+					continue;
+				entry.size = strlen(current->string) + 1;
+				break;
+
+			case V4L2_CTRL_TYPE_INTEGER64:
+				if(current->value64 == current->control.default_value)
+					continue;
+				entry.value = current->value64;
+				break;
+
+			default:
+				if(current->value == current->control.default_value)
+					continue;
+				entry.value = current->value;
+				break;
+		}
+
+		uint32_t size = sizeof(ctrl_profile_entry_t) + entry.size;
+		if(header.data_size + size > data_max_size)
+		{
+			data_max_size = (header.data_size + size) * 2;
+			data = realloc(data, data_max_size);
+			if(data == NULL)
+			{
+				fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (save_control_profile_binary): %s\n", strerror(errno));
+				exit(-1);
+			}
+		}
+
+		memcpy(data + header.data_size, &entry, sizeof(ctrl_profile_entry_t));
+		if(entry.size > 0)
+			memcpy(data + header.data_size + sizeof(ctrl_profile_entry_t),
+				current->string, entry.size);
+
+		header.data_size += size;
+		header.num_entries++;
+	}
+
+	header.checksum = profile_checksum(data, header.data_size);
+
+	FILE *fp = fopen(filename, "wb");
+	if( fp == NULL )
+	{
+		fprintf(stderr, "V4L2_CORE: (save_control_profile_binary) Could not open %s for write: %s\n",
+			filename, strerror(errno));
+		free(data);
+		return (E_FILE_IO_ERR);
+	}
+
+	int ret = E_OK;
+	if(fwrite(&header, sizeof(ctrl_profile_header_t), 1, fp) != 1 ||
+		(header.data_size > 0 && fwrite(data, header.data_size, 1, fp) != 1))
+		ret = E_FILE_IO_ERR;
+
+	free(data);
+
+	fflush(fp); /*flush stream buffers to filesystem*/
+	if(fsync(fileno(fp)) ||	fclose(fp) || ret != E_OK)
+	{
+		fprintf(stderr, "V4L2_CORE: (save_control_profile_binary) write to file failed: %s\n", strerror(errno));
+		return(E_FILE_IO_ERR);
+	}
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: (save_control_profile_binary) saved %u non default controls\n",
+			header.num_entries);
+
+	return (E_OK);
+}
+
 /*
  * load the device control values from a profile file
+ *  (text or binary profile)
  * args:
  *   vd - pointer to video device data
  *   filename - profile filename
@@ -147,7 +584,14 @@ int load_control_profile(v4l2_dev_t *vd, const char *filename)
 		char line[200];
 		if(fgets(line, sizeof(line), fp) != NULL)
 		{
-			if(sscanf(line,"#V4L2/CTRL/%3i.%3i.%3i", &major, &minor, &rev) == 3)
+			if(strncmp(line, CTRL_PROFILE_MAGIC, sizeof(CTRL_PROFILE_MAGIC) - 1) == 0)
+			{
+				rewind(fp);
+				int ret = load_binary_control_profile(vd, fp);
+				fclose(fp);
+				return ret;
+			}
+			else if(sscanf(line,"#V4L2/CTRL/%3i.%3i.%3i", &major, &minor, &rev) == 3)
 			{
                 //check standard version if needed
 			}
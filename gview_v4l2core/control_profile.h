@@ -24,6 +24,17 @@
 
 #include "v4l2_core.h"
 
+/*
+ * internal to the library (the public api is v4l2core_*_control_profile),
+ *  keep the symbols private so that they can't be interposed by
+ *  functions with the same name in the application
+ */
+#if defined(__GNUC__) && __GNUC__ >= 4
+  #define CONTROL_PROFILE_API __attribute__((visibility("hidden")))
+#else
+  #define CONTROL_PROFILE_API
+#endif
+
 /*
  * save the device control values into a profile file
  * args:
@@ -35,10 +46,25 @@
  *
  * returns: error code (0 -E_OK)
  */
-int save_control_profile(v4l2_dev_t *vd, const char *filename);
+CONTROL_PROFILE_API int save_control_profile(v4l2_dev_t *vd, const char *filename);
+
+/*
+ * save the device control values into a binary profile file
+ *  (only controls with non default values are stored)
+ * args:
+ *   vd - pointer to video device data
+ *   filename - profile filename
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (0 -E_OK)
+ */
+CONTROL_PROFILE_API int save_control_profile_binary(v4l2_dev_t *vd, const char *filename);
 
 /*
  * load the device control values from a profile file
+ *  (text or binary profile)
  * args:
  *   vd - pointer to video device data
  *   filename - profile filename
@@ -48,7 +74,7 @@ int save_control_profile(v4l2_dev_t *vd, const char *filename);
  *
  * returns: error code (0 -E_OK)
  */
-int load_control_profile(v4l2_dev_t *vd, const char *filename);
+CONTROL_PROFILE_API int load_control_profile(v4l2_dev_t *vd, const char *filename);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,472 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - pipelined multi-threaded frame decoding                  #
+#                                                                               #
+********************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "gview.h"
+#include "gviewv4l2core.h"
+#include "v4l2_core.h"
+#include "frame_decoder.h"
+#include "jpeg_decoder.h"
+#include "decode_pool.h"
+
+extern int verbosity;
+
+#define JOB_PENDING   (0)
+#define JOB_DECODING  (1)
+#define JOB_DONE      (2)
+
+/*
+ * frame in flight
+ */
+typedef struct _decode_job_t
+{
+	v4l2_frame_buff_t *frame; //dequeued frame
+	int status;               //JOB_PENDING; JOB_DECODING; JOB_DONE
+	int ret;                  //decoder return code
+} decode_job_t;
+
+/*
+ * decoder thread data
+ */
+typedef struct _decode_worker_t
+{
+	struct _decode_pool_t *pool;
+	__THREAD_TYPE thread;
+	jpeg_decoder_context_t *jpeg_ctx; //private (m)jpeg decoder context
+	int width;                        //jpeg_ctx width
+	int height;                       //jpeg_ctx height
+} decode_worker_t;
+
+/*
+ * decoder pool
+ *  jobs are kept in capture order in a circular list, workers
+ *  pick the oldest pending job and results are delivered from
+ *  the head of the list, so frames finishing out of order are
+ *  held back until all previous frames are done
+ */
+struct _decode_pool_t
+{
+	v4l2_dev_t *vd;
+	decode_worker_t *workers;
+	int nworkers;
+
+	decode_job_t *jobs;       //jobs in flight (circular list)
+	int first;                //oldest job (next to deliver)
+	int njobs;                //number of jobs in flight
+
+	int quit;                 //stop the workers
+
+	__MUTEX_TYPE mutex;
+	__COND_TYPE work_cond;    //new job or quit
+	__COND_TYPE done_cond;    //job done
+};
+
+typedef struct _decode_pool_t decode_pool_t;
+
+#define __PMUTEX &(pool->mutex)
+
+/*
+ * get the oldest pending job
+ * args:
+ *   pool - pointer to decoder pool (locked)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to job or NULL if none pending
+ */
+static decode_job_t *get_pending_job(decode_pool_t *pool)
+{
+	int i = 0;
+	for(i = 0; i < pool->njobs; ++i)
+	{
+		decode_job_t *job = &pool->jobs[(pool->first + i) % pool->nworkers];
+		if(job->status == JOB_PENDING)
+			return job;
+	}
+
+	return NULL;
+}
+
+/*
+ * decode a frame with the worker private decoder context
+ * args:
+ *   worker - pointer to worker data
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (E_OK)
+ */
+static int worker_decode(decode_worker_t *worker, v4l2_frame_buff_t *frame)
+{
+	v4l2_dev_t *vd = worker->pool->vd;
+
+	if(vd->requested_fmt == V4L2_PIX_FMT_JPEG ||
+	   vd->requested_fmt == V4L2_PIX_FMT_MJPEG)
+	{
+		int width = vd->format.fmt.pix.width;
+		int height = vd->format.fmt.pix.height;
+
+		/*(re)create the decoder context on resolution changes*/
+		if(worker->jpeg_ctx == NULL ||
+		   worker->width != width ||
+		   worker->height != height)
+		{
+			jpeg_destroy_context(worker->jpeg_ctx);
+			worker->jpeg_ctx = jpeg_create_context(width, height);
+			worker->width = width;
+			worker->height = height;
+		}
+
+		if(worker->jpeg_ctx == NULL)
+			return E_NO_CODEC;
+	}
+
+	return decode_v4l2_frame_ctx(vd, frame, worker->jpeg_ctx);
+}
+
+/*
+ * decoder thread loop
+ * args:
+ *   data - pointer to worker data
+ *
+ * asserts:
+ *   none
+ *
+ * returns: NULL
+ */
+static void *decode_worker_loop(void *data)
+{
+	decode_worker_t *worker = (decode_worker_t *) data;
+	decode_pool_t *pool = worker->pool;
+
+	__LOCK_MUTEX( __PMUTEX );
+	while(!pool->quit)
+	{
+		decode_job_t *job = get_pending_job(pool);
+		if(job == NULL)
+		{
+			__COND_WAIT(&pool->work_cond, __PMUTEX);
+			continue;
+		}
+
+		job->status = JOB_DECODING;
+		__UNLOCK_MUTEX( __PMUTEX );
+
+		int ret = worker_decode(worker, job->frame);
+
+		__LOCK_MUTEX( __PMUTEX );
+		job->ret = ret;
+		job->status = JOB_DONE;
+		__COND_BCAST(&pool->done_cond);
+	}
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	jpeg_destroy_context(worker->jpeg_ctx);
+	worker->jpeg_ctx = NULL;
+
+	return NULL;
+}
+
+/*
+ * number of frames the pipeline can hold in flight
+ *  each frame in flight holds a frame queue entry and a driver
+ *  buffer, so keep one of each for the consumer and the driver
+ * args:
+ *   pool - pointer to decoder pool
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pipeline depth (< 2 means decode synchronously)
+ */
+static int get_pipeline_depth(decode_pool_t *pool)
+{
+	v4l2_dev_t *vd = pool->vd;
+
+	/*H264 frames depend on the previous ones*/
+	if(vd->requested_fmt == V4L2_PIX_FMT_H264)
+		return 1;
+
+	/*read method uses a single buffer for all frames*/
+	if(vd->cap_meth == IO_READ)
+		return 1;
+
+	int depth = pool->nworkers;
+
+	if(depth > vd->frame_queue_size - 1)
+		depth = vd->frame_queue_size - 1;
+
+	if(vd->buff_count > 0 && depth > vd->buff_count - 1)
+		depth = vd->buff_count - 1;
+
+	return depth;
+}
+
+/*
+ * create the decoder worker pool for the device
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   nthreads - number of decoder threads
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int decode_pool_init(v4l2_dev_t *vd, int nthreads)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	if(vd->decode_pool != NULL)
+		decode_pool_close(vd);
+
+	if(nthreads < 2)
+		return E_OK;
+
+	decode_pool_t *pool = calloc(1, sizeof(decode_pool_t));
+	if(pool == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (decode_pool_init): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	pool->vd = vd;
+	pool->nworkers = nthreads;
+
+	pool->jobs = calloc(nthreads, sizeof(decode_job_t));
+	pool->workers = calloc(nthreads, sizeof(decode_worker_t));
+	if(pool->jobs == NULL || pool->workers == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (decode_pool_init): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	__INIT_MUTEX( __PMUTEX );
+	__INIT_COND(&pool->work_cond);
+	__INIT_COND(&pool->done_cond);
+
+	int i = 0;
+	for(i = 0; i < nthreads; ++i)
+	{
+		pool->workers[i].pool = pool;
+
+		if(__THREAD_CREATE(&pool->workers[i].thread, decode_worker_loop, &pool->workers[i]))
+		{
+			fprintf(stderr, "V4L2_CORE: couldn't create decoder thread %i: %s\n", i, strerror(errno));
+			break;
+		}
+	}
+
+	pool->nworkers = i;
+	vd->decode_pool = pool;
+
+	if(pool->nworkers < 2)
+	{
+		decode_pool_close(vd);
+		return E_ALLOC_ERR;
+	}
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: started %i decoder threads\n", pool->nworkers);
+
+	return E_OK;
+}
+
+/*
+ * get the next decoded frame (in capture order)
+ *  keeps up to one frame per worker in flight
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->decode_pool is not null
+ *
+ * returns: pointer to decoded frame buffer (NULL on error)
+ */
+v4l2_frame_buff_t *decode_pool_get_frame(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+	assert(vd->decode_pool != NULL);
+
+	decode_pool_t *pool = vd->decode_pool;
+	int depth = get_pipeline_depth(pool);
+
+	__LOCK_MUTEX( __PMUTEX );
+	int njobs = pool->njobs;
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	if(depth < 2 && njobs == 0)
+	{
+		/*nothing to pipeline - decode in the calling thread*/
+		v4l2_frame_buff_t *frame = v4l2core_get_frame(vd);
+		if(frame != NULL && decode_v4l2_frame(vd, frame) != E_OK)
+			fprintf(stderr, "V4L2_CORE: Error - Couldn't decode frame\n");
+		return frame;
+	}
+
+	/*fill the pipeline*/
+	while(njobs < depth)
+	{
+		v4l2_frame_buff_t *frame = v4l2core_get_frame(vd);
+		if(frame == NULL)
+			break; /*deliver what we have*/
+
+		__LOCK_MUTEX( __PMUTEX );
+		decode_job_t *job = &pool->jobs[(pool->first + pool->njobs) % pool->nworkers];
+		job->frame = frame;
+		job->ret = E_OK;
+		job->status = JOB_PENDING;
+		njobs = ++pool->njobs;
+		__COND_SIGNAL(&pool->work_cond);
+		__UNLOCK_MUTEX( __PMUTEX );
+	}
+
+	if(njobs == 0)
+		return NULL;
+
+	/*deliver the oldest frame once it's decoded*/
+	__LOCK_MUTEX( __PMUTEX );
+	decode_job_t *job = &pool->jobs[pool->first];
+	while(job->status != JOB_DONE)
+		__COND_WAIT(&pool->done_cond, __PMUTEX);
+
+	v4l2_frame_buff_t *frame = job->frame;
+	int ret = job->ret;
+	job->frame = NULL;
+	pool->first = (pool->first + 1) % pool->nworkers;
+	pool->njobs--;
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	if(ret != E_OK)
+		fprintf(stderr, "V4L2_CORE: Error - Couldn't decode frame\n");
+
+	return frame;
+}
+
+/*
+ * drop all frames in flight (waits for running decodes)
+ *  frames are released back to the driver
+ *  (called before stream off)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void decode_pool_flush(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	decode_pool_t *pool = vd->decode_pool;
+	if(pool == NULL)
+		return;
+
+	__LOCK_MUTEX( __PMUTEX );
+
+	/*cancel pending jobs*/
+	int i = 0;
+	for(i = 0; i < pool->njobs; ++i)
+	{
+		decode_job_t *job = &pool->jobs[(pool->first + i) % pool->nworkers];
+		if(job->status == JOB_PENDING)
+			job->status = JOB_DONE;
+	}
+
+	while(pool->njobs > 0)
+	{
+		decode_job_t *job = &pool->jobs[pool->first];
+		while(job->status != JOB_DONE)
+			__COND_WAIT(&pool->done_cond, __PMUTEX);
+
+		v4l2core_release_frame(vd, job->frame);
+		job->frame = NULL;
+
+		pool->first = (pool->first + 1) % pool->nworkers;
+		pool->njobs--;
+	}
+
+	pool->first = 0;
+
+	__UNLOCK_MUTEX( __PMUTEX );
+}
+
+/*
+ * stop the decoder threads and free the pool
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void decode_pool_close(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	decode_pool_t *pool = vd->decode_pool;
+	if(pool == NULL)
+		return;
+
+	decode_pool_flush(vd);
+
+	__LOCK_MUTEX( __PMUTEX );
+	pool->quit = 1;
+	__COND_BCAST(&pool->work_cond);
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	int i = 0;
+	for(i = 0; i < pool->nworkers; ++i)
+		__THREAD_JOIN(pool->workers[i].thread);
+
+	__CLOSE_COND(&pool->work_cond);
+	__CLOSE_COND(&pool->done_cond);
+	__CLOSE_MUTEX( __PMUTEX );
+
+	free(pool->jobs);
+	free(pool->workers);
+	free(pool);
+
+	vd->decode_pool = NULL;
+}
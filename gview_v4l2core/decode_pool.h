@@ -0,0 +1,87 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - pipelined multi-threaded frame decoding                  #
+#                                                                               #
+********************************************************************************/
+
+#ifndef DECODE_POOL_H
+#define DECODE_POOL_H
+
+#include "gviewv4l2core.h"
+#include "v4l2_core.h"
+
+/*
+ * create the decoder worker pool for the device
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   nthreads - number of decoder threads
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int decode_pool_init(v4l2_dev_t *vd, int nthreads);
+
+/*
+ * get the next decoded frame (in capture order)
+ *  keeps up to one frame per worker in flight
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->decode_pool is not null
+ *
+ * returns: pointer to decoded frame buffer (NULL on error)
+ */
+v4l2_frame_buff_t *decode_pool_get_frame(v4l2_dev_t *vd);
+
+/*
+ * drop all frames in flight (waits for running decodes)
+ *  frames are released back to the driver
+ *  (called before stream off)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void decode_pool_flush(v4l2_dev_t *vd);
+
+/*
+ * stop the decoder threads and free the pool
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void decode_pool_close(v4l2_dev_t *vd);
+
+#endif
@@ -36,10 +36,536 @@
 #include "frame_decoder.h"
 #include "jpeg_decoder.h"
 #include "colorspaces.h"
+#include "h264_nal.h"
 #include "../config.h"
 
 extern int verbosity;
 
+/*align x to a (power of 2)*/
+#define ALIGN_SIZE(x, a) (((x) + (a) - 1) & ~((a) - 1))
+
+/*
+ * raw frame plane (for repacking padded lines)
+ */
+typedef struct _raw_plane_t
+{
+	int lines;      //number of lines
+	int line_size;  //packed line size (bytes)
+	int stride;     //line size in the raw frame (bytes)
+} raw_plane_t;
+
+/*
+ * set the plane layout of the yuv frame
+ *  tightly packed for an alignment of 1, otherwise the line
+ *  sizes (and so the plane offsets) are multiples of the alignment
+ * args:
+ *   frame - pointer to frame buffer
+ *   width - frame width
+ *   height - frame height
+ *   align - line size alignment (bytes, power of 2)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: yuv frame size (bytes)
+ */
+static size_t set_yuv_frame_layout(v4l2_frame_buff_t *frame, int width, int height, int align)
+{
+	size_t packed_size = (width * height * 3) / 2;
+
+	if(align <= 1)
+	{
+		frame->yuv_stride[0] = width;
+		frame->yuv_stride[1] = width / 2;
+		frame->yuv_stride[2] = width / 2;
+		frame->yuv_offset[0] = 0;
+		frame->yuv_offset[1] = width * height;
+		frame->yuv_offset[2] = frame->yuv_offset[1] + ((width * height) / 4);
+		return packed_size;
+	}
+
+	frame->yuv_stride[0] = ALIGN_SIZE(width, align);
+	frame->yuv_stride[1] = ALIGN_SIZE(width / 2, align);
+	frame->yuv_stride[2] = frame->yuv_stride[1];
+	frame->yuv_offset[0] = 0;
+	frame->yuv_offset[1] = frame->yuv_stride[0] * height;
+	frame->yuv_offset[2] = frame->yuv_offset[1] + (frame->yuv_stride[1] * ((height + 1) / 2));
+
+	size_t size = frame->yuv_offset[2] + (frame->yuv_stride[2] * ((height + 1) / 2));
+
+	/*decoders without stride support write the packed layout first*/
+	return (size > packed_size) ? size : packed_size;
+}
+
+/*
+ * check if the yuv frame is tightly packed
+ * args:
+ *   frame - pointer to frame buffer
+ *   width - frame width
+ *   height - frame height
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if packed, 0 otherwise
+ */
+static int is_yuv_frame_packed(v4l2_frame_buff_t *frame, int width, int height)
+{
+	return (frame->yuv_format == V4L2_PIX_FMT_YUV420 &&
+		frame->yuv_stride[0] == width &&
+		frame->yuv_stride[1] == width / 2 &&
+		frame->yuv_stride[2] == width / 2 &&
+		frame->yuv_offset[1] == width * height &&
+		frame->yuv_offset[2] == frame->yuv_offset[1] + ((width * height) / 4));
+}
+
+/*
+ * alloc the yuv frame (64 byte aligned for the simd converters)
+ * args:
+ *   vd - pointer to video device data
+ *   frame - pointer to frame buffer
+ *   width - frame width
+ *   height - frame height
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void alloc_yuv_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, int width, int height)
+{
+	frame->yuv_buffer_align = vd->frame_alignment;
+	frame->yuv_frame_size = set_yuv_frame_layout(frame, width, height, frame->yuv_buffer_align);
+	frame->yuv_format = V4L2_PIX_FMT_YUV420;
+	frame->raw_stride = vd->format.fmt.pix.bytesperline;
+
+	/*released with free (clean_v4l2_frames)*/
+	void *buffer = NULL;
+	if(posix_memalign(&buffer, 64, frame->yuv_frame_size) != 0)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
+		exit(-1);
+	}
+	frame->yuv_buffer = (uint8_t *) buffer;
+	frame->yuv_frame = frame->yuv_buffer;
+}
+
+/*
+ * get the frame stride buffer (grows it if needed)
+ * args:
+ *   frame - pointer to frame buffer
+ *   size - minimum buffer size (bytes)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to stride buffer
+ */
+static uint8_t *get_stride_buffer(v4l2_frame_buff_t *frame, size_t size)
+{
+	if(frame->stride_buffer_max_size < size)
+	{
+		free(frame->stride_buffer);
+		frame->stride_buffer = calloc(size, sizeof(uint8_t));
+		if(frame->stride_buffer == NULL)
+		{
+			fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (get_stride_buffer): %s\n", strerror(errno));
+			exit(-1);
+		}
+		frame->stride_buffer_max_size = size;
+	}
+
+	return frame->stride_buffer;
+}
+
+/*
+ * get the plane layout of a raw frame
+ * args:
+ *   format - v4l2 pixel format
+ *   width - frame width
+ *   height - frame height
+ *   stride - line size of the first plane (bytes, <= 0 for packed lines)
+ *   planes - raw frame planes (to be filled)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of planes (0 if the format has no fixed line size)
+ */
+static int get_raw_layout(uint32_t format, int width, int height, int stride, raw_plane_t planes[3])
+{
+	int line_size = 0;
+	int nplanes = 1;
+
+	switch(format)
+	{
+		case V4L2_PIX_FMT_GREY:
+		case V4L2_PIX_FMT_RGB332:
+		case V4L2_PIX_FMT_SGBRG8:
+		case V4L2_PIX_FMT_SGRBG8:
+		case V4L2_PIX_FMT_SBGGR8:
+		case V4L2_PIX_FMT_SRGGB8:
+			line_size = width;
+			break;
+
+		case V4L2_PIX_FMT_YUV420:
+		case V4L2_PIX_FMT_YVU420:
+		case V4L2_PIX_FMT_YUV422P:
+			line_size = width;
+			nplanes = 3;
+			break;
+
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+		case V4L2_PIX_FMT_NV16:
+		case V4L2_PIX_FMT_NV61:
+		case V4L2_PIX_FMT_NV24:
+		case V4L2_PIX_FMT_NV42:
+			line_size = width;
+			nplanes = 2;
+			break;
+
+		case V4L2_PIX_FMT_Y41P:
+#ifdef V4L2_PIX_FMT_SBGGR12P
+		case V4L2_PIX_FMT_SGBRG12P:
+		case V4L2_PIX_FMT_SGRBG12P:
+		case V4L2_PIX_FMT_SBGGR12P:
+		case V4L2_PIX_FMT_SRGGB12P:
+#endif
+			line_size = (width * 3) / 2;
+			break;
+
+		case V4L2_PIX_FMT_Y10BPACK:
+#ifdef V4L2_PIX_FMT_SBGGR10P
+		case V4L2_PIX_FMT_SGBRG10P:
+		case V4L2_PIX_FMT_SGRBG10P:
+		case V4L2_PIX_FMT_SBGGR10P:
+		case V4L2_PIX_FMT_SRGGB10P:
+#endif
+			line_size = (width * 10) / 8;
+			break;
+
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_YVYU:
+		case V4L2_PIX_FMT_UYVY:
+		case V4L2_PIX_FMT_VYUY:
+		case V4L2_PIX_FMT_YYUV:
+		case V4L2_PIX_FMT_YUV444:
+		case V4L2_PIX_FMT_YUV555:
+		case V4L2_PIX_FMT_YUV565:
+		case V4L2_PIX_FMT_Y16:
+#ifdef V4L2_PIX_FMT_Y16_BE
+		case V4L2_PIX_FMT_Y16_BE:
+#endif
+		case V4L2_PIX_FMT_SGBRG10:
+		case V4L2_PIX_FMT_SGRBG10:
+		case V4L2_PIX_FMT_SBGGR10:
+		case V4L2_PIX_FMT_SRGGB10:
+		case V4L2_PIX_FMT_SGBRG12:
+		case V4L2_PIX_FMT_SGRBG12:
+		case V4L2_PIX_FMT_SBGGR12:
+		case V4L2_PIX_FMT_SRGGB12:
+		case V4L2_PIX_FMT_SBGGR16:
+#ifdef V4L2_PIX_FMT_SGBRG16
+		case V4L2_PIX_FMT_SGBRG16:
+		case V4L2_PIX_FMT_SGRBG16:
+		case V4L2_PIX_FMT_SRGGB16:
+#endif
+		case V4L2_PIX_FMT_RGB565:
+		case V4L2_PIX_FMT_RGB565X:
+		case V4L2_PIX_FMT_RGB444:
+		case V4L2_PIX_FMT_RGB555:
+		case V4L2_PIX_FMT_RGB555X:
+#ifdef V4L2_PIX_FMT_ARGB444
+		case V4L2_PIX_FMT_ARGB444:
+		case V4L2_PIX_FMT_XRGB444:
+#endif
+#ifdef V4L2_PIX_FMT_ARGB555
+		case V4L2_PIX_FMT_ARGB555:
+		case V4L2_PIX_FMT_XRGB555:
+#endif
+#ifdef V4L2_PIX_FMT_ARGB555X
+		case V4L2_PIX_FMT_ARGB555X:
+		case V4L2_PIX_FMT_XRGB555X:
+#endif
+			line_size = width * 2;
+			break;
+
+		case V4L2_PIX_FMT_RGB24:
+		case V4L2_PIX_FMT_BGR24:
+			line_size = width * 3;
+			break;
+
+		case V4L2_PIX_FMT_YUV32:
+		case V4L2_PIX_FMT_BGR666:
+		case V4L2_PIX_FMT_BGR32:
+		case V4L2_PIX_FMT_RGB32:
+#ifdef V4L2_PIX_FMT_ABGR32
+		case V4L2_PIX_FMT_ABGR32:
+		case V4L2_PIX_FMT_XBGR32:
+#endif
+#ifdef V4L2_PIX_FMT_ARGB32
+		case V4L2_PIX_FMT_ARGB32:
+		case V4L2_PIX_FMT_XRGB32:
+#endif
+			line_size = width * 4;
+			break;
+
+		default:
+			/*compressed or vendor specific formats (spca50x)*/
+			return 0;
+	}
+
+	if(stride < line_size)
+		stride = line_size;
+
+	planes[0].lines = height;
+	planes[0].line_size = line_size;
+	planes[0].stride = stride;
+
+	switch(format)
+	{
+		case V4L2_PIX_FMT_YUV420:
+		case V4L2_PIX_FMT_YVU420:
+			planes[1].lines = height / 2;
+			planes[1].line_size = width / 2;
+			planes[1].stride = stride / 2;
+			planes[2] = planes[1];
+			break;
+
+		case V4L2_PIX_FMT_YUV422P:
+			planes[1].lines = height;
+			planes[1].line_size = width / 2;
+			planes[1].stride = stride / 2;
+			planes[2] = planes[1];
+			break;
+
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			planes[1].lines = height / 2;
+			planes[1].line_size = width;
+			planes[1].stride = stride;
+			break;
+
+		case V4L2_PIX_FMT_NV16:
+		case V4L2_PIX_FMT_NV61:
+			planes[1].lines = height;
+			planes[1].line_size = width;
+			planes[1].stride = stride;
+			break;
+
+		case V4L2_PIX_FMT_NV24:
+		case V4L2_PIX_FMT_NV42:
+			planes[1].lines = height;
+			planes[1].line_size = width * 2;
+			planes[1].stride = stride * 2;
+			break;
+	}
+
+	return nplanes;
+}
+
+/*
+ * get the raw frame size for a plane layout
+ * args:
+ *   planes - raw frame planes
+ *   nplanes - number of planes
+ *   packed - use the packed line sizes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: frame size (bytes)
+ */
+static size_t get_raw_layout_size(raw_plane_t planes[3], int nplanes, int packed)
+{
+	size_t size = 0;
+	int i = 0;
+	for(i = 0; i < nplanes; ++i)
+		size += (size_t) planes[i].lines * (packed ? planes[i].line_size : planes[i].stride);
+
+	return size;
+}
+
+/*
+ * repack a raw frame with padded lines (driver bytesperline)
+ *  for the converters that expect packed lines
+ * args:
+ *   frame - pointer to frame buffer
+ *   planes - raw frame planes
+ *   nplanes - number of planes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to the repacked raw frame (stride buffer)
+ */
+static uint8_t *repack_raw_frame(v4l2_frame_buff_t *frame, raw_plane_t planes[3], int nplanes)
+{
+	uint8_t *out = get_stride_buffer(frame, get_raw_layout_size(planes, nplanes, 1));
+	uint8_t *pout = out;
+	uint8_t *pin = frame->raw_frame;
+
+	int i = 0;
+	for(i = 0; i < nplanes; ++i)
+	{
+		int line = 0;
+		for(line = 0; line < planes[i].lines; ++line)
+		{
+			memcpy(pout, pin, planes[i].line_size);
+			pout += planes[i].line_size;
+			pin += planes[i].stride;
+		}
+	}
+
+	return out;
+}
+
+/*
+ * move the lines of a packed yuv frame to the aligned layout (in place)
+ *  the aligned offsets are never smaller than the packed ones so
+ *  moving from the last line backwards doesn't overwrite unmoved data
+ * args:
+ *   frame - pointer to frame buffer
+ *   width - frame width
+ *   height - frame height
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void unpack_yuv_frame(v4l2_frame_buff_t *frame, int width, int height)
+{
+	int packed_offset[3];
+	packed_offset[0] = 0;
+	packed_offset[1] = width * height;
+	packed_offset[2] = packed_offset[1] + ((width * height) / 4);
+
+	int plane = 0;
+	for(plane = 2; plane >= 0; --plane)
+	{
+		int w = plane ? width / 2 : width;
+		int h = plane ? height / 2 : height;
+
+		int line = 0;
+		for(line = h - 1; line >= 0; --line)
+			memmove(frame->yuv_frame + frame->yuv_offset[plane] + (line * frame->yuv_stride[plane]),
+				frame->yuv_frame + packed_offset[plane] + (line * w), w);
+	}
+}
+
+/*
+ * copy the yuv frame planes to yu12 planes (converts nv12 passthrough frames)
+ * args:
+ *   frame - pointer to frame buffer
+ *   out - pointers to output y, u and v planes
+ *   out_stride - output y, u and v line sizes (bytes)
+ *   width - frame width
+ *   height - frame height
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void copy_yuv_planes(v4l2_frame_buff_t *frame, uint8_t * const out[3],
+	const int out_stride[3], int width, int height)
+{
+	if(frame->yuv_format == V4L2_PIX_FMT_NV12)
+	{
+		/*uv plane follows the y plane (raw frame layout)*/
+		raw_to_yu12_stride(out, out_stride, frame->yuv_frame,
+			frame->yuv_stride[0], width, height, V4L2_PIX_FMT_NV12,
+			YUV_MATRIX_BT601, DEMOSAIC_BILINEAR);
+		return;
+	}
+
+	uint8_t *in[3];
+	int i = 0;
+	for(i = 0; i < 3; ++i)
+		in[i] = frame->yuv_frame + frame->yuv_offset[i];
+
+	yu12_copy_planes(out, out_stride, in, frame->yuv_stride, width, height);
+}
+
+/*
+ * get the decoded (yu12) frame tightly packed
+ *  (frames with aligned line sizes are copied to the stride buffer)
+ * args:
+ *    frame - pointer to (decoded) frame buffer
+ *
+ * asserts:
+ *    frame is not null
+ *
+ * returns: pointer to packed yu12 frame data
+ */
+uint8_t *pack_yuv_frame(v4l2_frame_buff_t *frame)
+{
+	/*asserts*/
+	assert(frame != NULL);
+
+	int width = frame->vd->format.fmt.pix.width;
+	int height = frame->vd->format.fmt.pix.height;
+
+	if(is_yuv_frame_packed(frame, width, height))
+		return frame->yuv_frame;
+
+	uint8_t *packed = get_stride_buffer(frame, (width * height * 3) / 2);
+
+	uint8_t *out[3];
+	int out_stride[3];
+	yu12_get_planes(packed, width, height, out, out_stride);
+
+	copy_yuv_planes(frame, out, out_stride, width, height);
+
+	return packed;
+}
+
+/*
+ * make the decoded (yu12) frame writable
+ *  (passthrough frames are copied from the raw frame to the frame buffer)
+ * args:
+ *    frame - pointer to (decoded) frame buffer
+ *
+ * asserts:
+ *    frame is not null
+ *
+ * returns: pointer to yu12 frame data (frame buffer)
+ */
+uint8_t *own_yuv_frame(v4l2_frame_buff_t *frame)
+{
+	/*asserts*/
+	assert(frame != NULL);
+
+	if(frame->yuv_frame == frame->yuv_buffer)
+		return frame->yuv_frame;
+
+	int width = frame->vd->format.fmt.pix.width;
+	int height = frame->vd->format.fmt.pix.height;
+
+	/*the frame buffer layout*/
+	v4l2_frame_buff_t buffer_layout;
+	set_yuv_frame_layout(&buffer_layout, width, height, frame->yuv_buffer_align);
+
+	uint8_t *out[3];
+	int i = 0;
+	for(i = 0; i < 3; ++i)
+		out[i] = frame->yuv_buffer + buffer_layout.yuv_offset[i];
+
+	copy_yuv_planes(frame, out, buffer_layout.yuv_stride, width, height);
+
+	for(i = 0; i < 3; ++i)
+	{
+		frame->yuv_stride[i] = buffer_layout.yuv_stride[i];
+		frame->yuv_offset[i] = buffer_layout.yuv_offset[i];
+	}
+	frame->yuv_format = V4L2_PIX_FMT_YUV420;
+	frame->yuv_frame = frame->yuv_buffer;
+
+	return frame->yuv_frame;
+}
+
 /*
  * Alloc image buffers for decoding video stream
  * args:
@@ -63,7 +589,6 @@ int alloc_v4l2_frames(v4l2_dev_t *vd)
 	int ret = E_OK;
 
 	int i = 0;
-	size_t framebuf_size = 0;
 
 	int width = vd->format.fmt.pix.width;
 	int height = vd->format.fmt.pix.height;
@@ -71,13 +596,11 @@ int alloc_v4l2_frames(v4l2_dev_t *vd)
 	if(width <= 0 || height <= 0)
 		return E_ALLOC_ERR;
 
-	int framesizeIn = (width * height * 3/2); /* 3/2 bytes per pixel*/
-
 	switch (vd->requested_fmt)
 	{
 		case V4L2_PIX_FMT_H264:
 			/*init h264 context*/
-			ret = h264_init_decoder(width, height);
+			ret = h264_init_decoder(vd, width, height);
 
 			if(ret)
 			{
@@ -90,21 +613,28 @@ int alloc_v4l2_frames(v4l2_dev_t *vd)
 			for(i=0; i<vd->frame_queue_size; ++i)
 			{
 				vd->frame_queue[i].h264_frame_max_size = width * height; /*1 byte per pixel*/
-				vd->frame_queue[i].h264_frame = calloc(vd->frame_queue[i].h264_frame_max_size, sizeof(uint8_t));
-			
-				if(vd->frame_queue[i].h264_frame == NULL)
+				vd->frame_queue[i].h264_frame = NULL;
+
+				/*only muxed streams need a demux buffer (else h264_frame aliases raw_frame)*/
+				if(h264_get_support(vd) == H264_MUXED)
 				{
-					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
-					exit(-1);
+					vd->frame_queue[i].h264_buffer = calloc(vd->frame_queue[i].h264_frame_max_size, sizeof(uint8_t));
+					if(vd->frame_queue[i].h264_buffer == NULL)
+					{
+						fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
+						exit(-1);
+					}
 				}
-				
-				vd->frame_queue[i].yuv_frame = calloc(framesizeIn, sizeof(uint8_t));
-				if(vd->frame_queue[i].yuv_frame == NULL)
+
+				vd->frame_queue[i].h264_nals = calloc(1, sizeof(h264_nal_index_t));
+				if(vd->frame_queue[i].h264_nals == NULL)
 				{
 					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
 					exit(-1);
 				}
 
+				alloc_yuv_frame(vd, &vd->frame_queue[i], width, height);
+
 			}
 			
 			vd->h264_last_IDR = calloc(width * height, sizeof(uint8_t));
@@ -113,14 +643,16 @@ int alloc_v4l2_frames(v4l2_dev_t *vd)
 				fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
 				exit(-1);
 			}
+			vd->h264_last_IDR_max_size = width * height;
 			vd->h264_last_IDR_size = 0; /*reset (no frame stored)*/
+			vd->h264_last_decoded_seq = -1; /*reset (no frame decoded)*/
 						
 			break;
 
 		case V4L2_PIX_FMT_JPEG:
 		case V4L2_PIX_FMT_MJPEG:
 			/*init jpeg decoder*/
-			ret = jpeg_init_decoder(width, height);
+			ret = jpeg_init_decoder(vd, width, height);
 
 			if(ret)
 			{
@@ -131,12 +663,7 @@ int alloc_v4l2_frames(v4l2_dev_t *vd)
 			/*frame queue*/
 			for(i=0; i<vd->frame_queue_size; ++i)
 			{
-				vd->frame_queue[i].yuv_frame = calloc(framesizeIn, sizeof(uint8_t));
-				if(vd->frame_queue[i].yuv_frame == NULL)
-				{
-					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
-					exit(-1);
-				}
+				alloc_yuv_frame(vd, &vd->frame_queue[i], width, height);
 			}
 			break;
 
@@ -198,35 +725,23 @@ int alloc_v4l2_frames(v4l2_dev_t *vd)
 		case V4L2_PIX_FMT_ARGB555X:
 		case V4L2_PIX_FMT_XRGB555X:
 #endif
-			framebuf_size = framesizeIn;
 			/*frame queue*/
 			for(i=0; i<vd->frame_queue_size; ++i)
 			{
-				vd->frame_queue[i].yuv_frame = calloc(framebuf_size, sizeof(uint8_t));
-				if(vd->frame_queue[i].yuv_frame == NULL)
-				{
-					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
-					exit(-1);
-				}
+				alloc_yuv_frame(vd, &vd->frame_queue[i], width, height);
 			}
 			break;
 
 		case V4L2_PIX_FMT_YUYV:
 			/*
-			 * YUYV doesn't need a temp buffer but we will set it if/when
-			 *  video processing disable is set (bayer processing).
-			 *            (logitech cameras only)
+			 * YUYV doesn't need a temp buffer, bayer data
+			 *  (video processing disabled - logitech cameras only)
+			 *  is demosaiced straight to the yuv frame
 			 */
-			framebuf_size = framesizeIn;
 			/*frame queue*/
 			for(i=0; i<vd->frame_queue_size; ++i)
 			{
-				vd->frame_queue[i].yuv_frame = calloc(framebuf_size, sizeof(uint8_t));
-				if(vd->frame_queue[i].yuv_frame == NULL)
-				{
-					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
-					exit(-1);
-				}
+				alloc_yuv_frame(vd, &vd->frame_queue[i], width, height);
 			}
 			break;
 
@@ -234,75 +749,194 @@ int alloc_v4l2_frames(v4l2_dev_t *vd)
 		case V4L2_PIX_FMT_SGRBG8: /*1*/
 		case V4L2_PIX_FMT_SBGGR8: /*2*/
 		case V4L2_PIX_FMT_SRGGB8: /*3*/
+		case V4L2_PIX_FMT_SGBRG10:
+		case V4L2_PIX_FMT_SGRBG10:
+		case V4L2_PIX_FMT_SBGGR10:
+		case V4L2_PIX_FMT_SRGGB10:
+		case V4L2_PIX_FMT_SGBRG12:
+		case V4L2_PIX_FMT_SGRBG12:
+		case V4L2_PIX_FMT_SBGGR12:
+		case V4L2_PIX_FMT_SRGGB12:
+		case V4L2_PIX_FMT_SBGGR16:
+#ifdef V4L2_PIX_FMT_SGBRG16
+		case V4L2_PIX_FMT_SGBRG16:
+		case V4L2_PIX_FMT_SGRBG16:
+		case V4L2_PIX_FMT_SRGGB16:
+#endif
+#ifdef V4L2_PIX_FMT_SBGGR10P
+		case V4L2_PIX_FMT_SGBRG10P:
+		case V4L2_PIX_FMT_SGRBG10P:
+		case V4L2_PIX_FMT_SBGGR10P:
+		case V4L2_PIX_FMT_SRGGB10P:
+#endif
+#ifdef V4L2_PIX_FMT_SBGGR12P
+		case V4L2_PIX_FMT_SGBRG12P:
+		case V4L2_PIX_FMT_SGRBG12P:
+		case V4L2_PIX_FMT_SBGGR12P:
+		case V4L2_PIX_FMT_SRGGB12P:
+#endif
 			/*
-			 * Raw 8 bit bayer
+			 * Raw bayer (8, 10, 12 and 16 bit)
 			 * when grabbing use:
-			 *    bayer_to_rgb24(bayer_data, RGB24_data, width, height, 0..3)
-			 *    rgb2yuyv(RGB24_data, vd->framebuffer, width, height)
+			 *    bayer_to_yu12_stride(yuv_planes, strides, bayer_data, ...)
+			 *    (fused demosaic, no intermediate rgb buffer)
 			 */
-			framebuf_size = framesizeIn;
 			/*frame queue*/
 			for(i=0; i<vd->frame_queue_size; ++i)
 			{
-				/* alloc a temp buffer for converting to YUYV*/
-				/* rgb buffer for decoding bayer data*/
-				vd->frame_queue[i].tmp_buffer_max_size = width * height * 3;
-				vd->frame_queue[i].tmp_buffer = calloc(vd->frame_queue[i].tmp_buffer_max_size, sizeof(uint8_t));
-				if(vd->frame_queue[i].tmp_buffer == NULL)
-				{
-					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
-					exit(-1);
-				}
-				vd->frame_queue[i].yuv_frame = calloc(framebuf_size, sizeof(uint8_t));
-				if(vd->frame_queue[i].yuv_frame == NULL)
+				alloc_yuv_frame(vd, &vd->frame_queue[i], width, height);
+			}
+			break;
+
+		default:
+			/*
+			 * we check formats against a support formats list
+			 * so we should never have to alloc for a unknown format
+			 */
+			fprintf(stderr, "V4L2_CORE: (v4l2uvc.c) should never arrive (1)- exit fatal !!\n");
+			ret = E_UNKNOWN_ERR;
+			
+			if(vd->h264_last_IDR)
+				free(vd->h264_last_IDR);
+			vd->h264_last_IDR = NULL;
+			vd->h264_last_IDR_max_size = 0;
+			/*frame queue*/
+			for(i=0; i<vd->frame_queue_size; ++i)
+			{
+				vd->frame_queue[i].raw_frame = NULL;
+				if(vd->frame_queue[i].yuv_buffer)
+					free(vd->frame_queue[i].yuv_buffer);
+				vd->frame_queue[i].yuv_buffer = NULL;
+				vd->frame_queue[i].yuv_frame = NULL;
+				if(vd->frame_queue[i].tmp_buffer)
+					free(vd->frame_queue[i].tmp_buffer);
+				vd->frame_queue[i].tmp_buffer = NULL;
+				if(vd->frame_queue[i].h264_buffer)
+					free(vd->frame_queue[i].h264_buffer);
+				vd->frame_queue[i].h264_buffer = NULL;
+				vd->frame_queue[i].h264_frame = NULL;
+				if(vd->frame_queue[i].h264_nals)
 				{
-					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): %s\n", strerror(errno));
-					exit(-1);
+					h264_nal_index_free(vd->frame_queue[i].h264_nals);
+					free(vd->frame_queue[i].h264_nals);
 				}
+				vd->frame_queue[i].h264_nals = NULL;
 			}
-			break;
+			return (ret);
+	}
+
+	for(i=0; i<vd->frame_queue_size; ++i)
+	{
+		/* set framebuffer to black (y=0x00 u=0x80 v=0x80) by default*/
+		v4l2_frame_buff_t *frame = &vd->frame_queue[i];
+		memset(frame->yuv_frame, 0x00, frame->yuv_offset[1]); //Y
+		memset(frame->yuv_frame + frame->yuv_offset[1], 0x80,
+			frame->yuv_frame_size - frame->yuv_offset[1]); //U V
+	}
+	return (ret);
+}
+
+/*
+ * decode a reduced size (yu12) image of the frame
+ *  (m)jpeg frames are downscaled in the DCT domain, other
+ *  formats are decoded at full size and box filtered
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *    scale - requested scale (DECODE_SCALE_1_2 to DECODE_SCALE_1_8)
+ *
+ * asserts:
+ *    vd is not null
+ *    frame is not null
+ *
+ * returns: error code (E_OK)
+ */
+int decode_v4l2_frame_scaled(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, int scale)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(frame != NULL);
+
+	int width = vd->format.fmt.pix.width;
+	int height = vd->format.fmt.pix.height;
+
+	scale = jpeg_clamp_scale(width, height, scale);
+
+	frame->scaled_width = width >> scale;
+	frame->scaled_height = height >> scale;
+
+	if(frame->scaled_decoded == scale)
+		return E_OK;
+
+	size_t scaled_size = (frame->scaled_width * frame->scaled_height * 3) / 2;
+	if(frame->yuv_scaled_max_size < scaled_size)
+	{
+		free(frame->yuv_scaled_frame);
+		frame->yuv_scaled_frame = calloc(scaled_size, sizeof(uint8_t));
+		if(frame->yuv_scaled_frame == NULL)
+		{
+			fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (decode_v4l2_frame_scaled): %s\n", strerror(errno));
+			exit(-1);
+		}
+		frame->yuv_scaled_max_size = scaled_size;
+	}
+
+	if(scale == 0)
+	{
+		/*full size - just copy the decoded frame*/
+		if(decode_v4l2_frame(vd, frame) != E_OK)
+			return E_DECODE_ERR;
+		memcpy(frame->yuv_scaled_frame, pack_yuv_frame(frame), scaled_size);
+		frame->scaled_decoded = scale;
+		return E_OK;
+	}
 
-		default:
-			/*
-			 * we check formats against a support formats list
-			 * so we should never have to alloc for a unknown format
-			 */
-			fprintf(stderr, "V4L2_CORE: (v4l2uvc.c) should never arrive (1)- exit fatal !!\n");
-			ret = E_UNKNOWN_ERR;
-			
-			if(vd->h264_last_IDR)
-				free(vd->h264_last_IDR);
-			vd->h264_last_IDR = NULL;
-			/*frame queue*/
-			for(i=0; i<vd->frame_queue_size; ++i)
+	/*
+	 * (m)jpeg frames with no full size decode (done or in progress)
+	 * are decoded directly at the reduced size
+	 */
+	if((vd->requested_fmt == V4L2_PIX_FMT_JPEG ||
+		vd->requested_fmt == V4L2_PIX_FMT_MJPEG) &&
+		__atomic_load_n(&frame->status, __ATOMIC_ACQUIRE) == FRAME_DECODING)
+	{
+		if(!frame->raw_frame || frame->raw_frame_size <= HEADERFRAME1)
+		{
+			fprintf(stderr, "V4L2_CORE: (jpeg decoder) Ignoring empty buffer\n");
+			return E_DECODE_ERR;
+		}
+
+		if(vd->jpeg_scaled_ctx == NULL || vd->jpeg_scaled_shift != scale)
+		{
+			jpeg_destroy_context(vd->jpeg_scaled_ctx);
+			vd->jpeg_scaled_ctx = jpeg_create_scaled_context(width, height, scale);
+			vd->jpeg_scaled_shift = scale;
+			if(vd->jpeg_scaled_ctx == NULL)
 			{
-				vd->frame_queue[i].raw_frame = NULL;
-				if(vd->frame_queue[i].yuv_frame)
-					free(vd->frame_queue[i].yuv_frame);
-				vd->frame_queue[i].yuv_frame = NULL;
-				if(vd->frame_queue[i].tmp_buffer)
-					free(vd->frame_queue[i].tmp_buffer);
-				vd->frame_queue[i].tmp_buffer = NULL;
-				if(vd->frame_queue[i].h264_frame)
-					free(vd->frame_queue[i].h264_frame);
-				vd->frame_queue[i].h264_frame = NULL;
+				fprintf(stderr, "V4L2_CORE: couldn't create reduced size jpeg decoder (1/%i)\n", 1 << scale);
+				return E_DECODE_ERR;
 			}
-			return (ret);
-	}
+		}
 
-	for(i=0; i<vd->frame_queue_size; ++i)
-	{
-		int j = 0;
-		/* set framebuffer to black (y=0x00 u=0x80 v=0x80) by default*/
-		uint8_t *pframe = vd->frame_queue[i].yuv_frame;
-		for (j=0; j<width*height; j++)
-		*pframe++=0x00; //Y
-		for(j=0; j<width*height/2; j++)
+		int ret = jpeg_decode_context(vd->jpeg_scaled_ctx, frame->yuv_scaled_frame,
+			frame->raw_frame, frame->raw_frame_size);
+		if(ret < 0)
 		{
-			*pframe++=0x80; //U V
+			fprintf(stderr, "V4L2_CORE: (jpeg decoder) reduced size decoding failed (%i)\n", ret);
+			return E_DECODE_ERR;
 		}
+
+		frame->scaled_decoded = scale;
+		return E_OK;
 	}
-	return (ret);
+
+	/*decode at full size (or wait for a decode in progress) and downscale*/
+	if(decode_v4l2_frame(vd, frame) != E_OK)
+		return E_DECODE_ERR;
+
+	yu12_downscale(frame->yuv_scaled_frame, pack_yuv_frame(frame), width, height, scale);
+	frame->scaled_decoded = scale;
+
+	return E_OK;
 }
 
 /*
@@ -332,23 +966,54 @@ void clean_v4l2_frames(v4l2_dev_t *vd)
 			vd->frame_queue[i].tmp_buffer = NULL;
 		}
 
-		if(vd->frame_queue[i].h264_frame)
+		if(vd->frame_queue[i].h264_buffer)
+		{
+			free(vd->frame_queue[i].h264_buffer);
+			vd->frame_queue[i].h264_buffer = NULL;
+		}
+		vd->frame_queue[i].h264_frame = NULL;
+
+		if(vd->frame_queue[i].h264_nals)
+		{
+			h264_nal_index_free(vd->frame_queue[i].h264_nals);
+			free(vd->frame_queue[i].h264_nals);
+			vd->frame_queue[i].h264_nals = NULL;
+		}
+
+		if(vd->frame_queue[i].yuv_buffer)
+		{
+			free(vd->frame_queue[i].yuv_buffer);
+			vd->frame_queue[i].yuv_buffer = NULL;
+		}
+		vd->frame_queue[i].yuv_frame = NULL;
+
+		if(vd->frame_queue[i].stride_buffer)
 		{
-			free(vd->frame_queue[i].h264_frame);
-			vd->frame_queue[i].h264_frame = NULL;
+			free(vd->frame_queue[i].stride_buffer);
+			vd->frame_queue[i].stride_buffer = NULL;
 		}
+		vd->frame_queue[i].stride_buffer_max_size = 0;
 
-		if(vd->frame_queue[i].yuv_frame)
+		if(vd->frame_queue[i].yuv_scaled_frame)
 		{
-			free(vd->frame_queue[i].yuv_frame);
-			vd->frame_queue[i].yuv_frame = NULL;
+			free(vd->frame_queue[i].yuv_scaled_frame);
+			vd->frame_queue[i].yuv_scaled_frame = NULL;
 		}
+		vd->frame_queue[i].yuv_scaled_max_size = 0;
+		vd->frame_queue[i].scaled_decoded = -1;
+	}
+
+	if(vd->jpeg_scaled_ctx)
+	{
+		jpeg_destroy_context(vd->jpeg_scaled_ctx);
+		vd->jpeg_scaled_ctx = NULL;
 	}
 
 	if(vd->h264_last_IDR)
 	{
 		free(vd->h264_last_IDR);
 		vd->h264_last_IDR = NULL;
+		vd->h264_last_IDR_max_size = 0;
 	}
 
 	if(vd->h264_SPS)
@@ -364,110 +1029,50 @@ void clean_v4l2_frames(v4l2_dev_t *vd)
 	}
 
 	if(vd->requested_fmt == V4L2_PIX_FMT_H264)
-		h264_close_decoder();
+		h264_close_decoder(vd);
 
 	if(vd->requested_fmt == V4L2_PIX_FMT_JPEG ||
 	   vd->requested_fmt == V4L2_PIX_FMT_MJPEG)
-		jpeg_close_decoder();
-}
-
-/*
- * check buff (*buff) of size (size) for NALU type (type)
- * args:
- *    type - NALU type
- *    buff - buffer with MJPG uvc frame containing h264 data
- *    size - buffer size
- *
- * asserts:
- *    buff is not null
- *
- * returns: buffer pointer to NALU type data if found
- *          NULL if not found
- */
-static uint8_t* check_NALU(uint8_t type, uint8_t *buff, int size)
-{
-	/*asserts*/
-	assert(buff != NULL);
-
-	uint8_t *sp = buff;
-	uint8_t *nal = NULL;
-	//search for NALU of type
-	for(sp = buff; sp < buff + size - 5; ++sp)
-	{
-		if(sp[0] == 0x00 &&
-		   sp[1] == 0x00 &&
-		   sp[2] == 0x00 &&
-		   sp[3] == 0x01 &&
-		   (sp[4] & 0x1F) == type)
-		{
-			/*found it*/
-			nal = sp + 4;
-			break;
-		}
-	}
-
-	return nal;
+		jpeg_close_decoder(vd);
 }
 
 /*
- * parses a buff (*buff) of size (size) for NALU type (type)
+ * copy the first NALU of type (type) from a h264 frame
  * args:
+ *    nals - pointer to frame NAL unit index
+ *    buff - pointer to indexed h264 frame
  *    type - NALU type
- *    NALU - pointer to pointer to NALU data
- *    buff - pointer to buffer containing h264 data muxed in MJPG container
- *    size - buff size
+ *    NALU - pointer to pointer to NALU data (allocated)
  *
  * asserts:
+ *    nals is not null
  *    buff is not null
  *
  * returns: NALU size and sets pointer (NALU) to NALU data
  *          -1 if no NALU found
  */
-static int parse_NALU(uint8_t type, uint8_t **NALU, uint8_t *buff, int size)
+static int store_NALU(h264_nal_index_t *nals, uint8_t *buff, uint8_t type, uint8_t **NALU)
 {
 	/*asserts*/
+	assert(nals != NULL);
 	assert(buff != NULL);
 
-	int nal_size = 0;
-	uint8_t *sp = NULL;
-
-	//search for NALU of type
-	uint8_t *nal = check_NALU(type, buff, size);
-	if(nal == NULL)
+	const h264_nal_t *nal = h264_nal_index_find(nals, type);
+	if(nal == NULL || nal->size <= 0)
 	{
 		fprintf(stderr, "V4L2_CORE: (uvc H264) could not find NALU of type %i in buffer\n", type);
 		return -1;
 	}
 
-	//search for end of NALU
-	for(sp = nal; sp < buff + size - 4; ++sp)
-	{
-		if(sp[0] == 0x00 &&
-		   sp[1] == 0x00 &&
-		   sp[2] == 0x00 &&
-		   sp[3] == 0x01)
-		{
-			nal_size = sp - nal;
-			break;
-		}
-	}
-
-	if(!nal_size)
-		nal_size = buff + size - nal;
-
-	*NALU = calloc(nal_size, sizeof(uint8_t));
+	*NALU = calloc(nal->size, sizeof(uint8_t));
 	if(*NALU == NULL)
 	{
-		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (parse_NALU): %s\n", strerror(errno));
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (store_NALU): %s\n", strerror(errno));
 		exit(-1);
 	}
-	memcpy(*NALU, nal, nal_size);
-
-	//char test_filename2[20];
-	//snprintf(test_filename2, 20, "frame_nalu-%i.raw", type);
-	//SaveBuff (test_filename2, nal_size, *NALU);
+	memcpy(*NALU, buff + nal->offset, nal->size);
 
-	return nal_size;
+	return nal->size;
 }
 
 /*
@@ -496,16 +1101,25 @@ static int demux_uvcH264(uint8_t *h264_data, uint8_t *buff, int size, int h264_m
 	uint8_t *header = NULL;
 	uint8_t *ph264 = h264_data;
 	
-	//search for first APP4 marker
+	//search for first APP4 marker (memchr skips to the next 0xFF)
 	for(sp = buff; sp < buff + size - 2; ++sp)
 	{
-		if(sp[0] == 0xFF &&
-		   sp[1] == 0xE4)
+		sp = memchr(sp, 0xFF, buff + size - 2 - sp);
+		if(sp == NULL)
+			break;
+
+		if(sp[1] == 0xE4)
 		{
 			spl = sp + 2; //exclude APP4 marker
 			break;
 		}
 	}
+
+	if(spl == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: no APP4 marker found (demux_uvcH264)\n");
+		return 0;
+	}
 	
 	/*(in big endian) 
 	 *includes payload size + header + 6 bytes(2 length + 4 payload size)
@@ -602,7 +1216,7 @@ static int demux_uvcH264(uint8_t *h264_data, uint8_t *buff, int size, int h264_m
  * Store the SPS and PPS NALUs of uvc H264 stream
  * args:
  *    vd - pointer to device data
- *    frame - pointer to frame buffer
+ *    frame - pointer to frame buffer (NAL units indexed)
  *
  * asserts:
  *    vd is not null
@@ -616,9 +1230,7 @@ static int store_extra_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 
 	if(vd->h264_SPS == NULL)
 	{
-		vd->h264_SPS_size = parse_NALU( 7, &vd->h264_SPS,
-			frame->h264_frame,
-			(int) frame->h264_frame_size);
+		vd->h264_SPS_size = store_NALU(frame->h264_nals, frame->h264_frame, 7, &vd->h264_SPS);
 
 		if(vd->h264_SPS_size <= 0 || vd->h264_SPS == NULL)
 		{
@@ -632,9 +1244,7 @@ static int store_extra_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 
 	if(vd->h264_PPS == NULL)
 	{
-		vd->h264_PPS_size = parse_NALU( 8, &vd->h264_PPS,
-			frame->h264_frame,
-			(int) frame->h264_frame_size);
+		vd->h264_PPS_size = store_NALU(frame->h264_nals, frame->h264_frame, 8, &vd->h264_PPS);
 
 		if(vd->h264_PPS_size <= 0 || vd->h264_PPS == NULL)
 		{
@@ -653,7 +1263,7 @@ static int store_extra_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
  * check/store the last IDR frame
  * args:
  *    vd - pointer to device data
- *    frame - pointer to frame buffer
+ *    frame - pointer to frame buffer (NAL units indexed)
  *
  * asserts:
  *    vd is not NULL
@@ -664,8 +1274,20 @@ static int store_extra_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 static uint8_t is_h264_keyframe (v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 {
 	//check for a IDR frame type
-	if(check_NALU(5, frame->h264_frame, frame->h264_frame_size) != NULL)
+	if(h264_nal_index_find(frame->h264_nals, 5) != NULL)
 	{
+		/*non muxed frames are not clipped (can exceed the initial buffer size)*/
+		if((int) frame->h264_frame_size > vd->h264_last_IDR_max_size)
+		{
+			uint8_t *last_IDR = realloc(vd->h264_last_IDR, frame->h264_frame_size);
+			if(last_IDR == NULL)
+			{
+				fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (is_h264_keyframe): %s\n", strerror(errno));
+				exit(-1);
+			}
+			vd->h264_last_IDR = last_IDR;
+			vd->h264_last_IDR_max_size = (int) frame->h264_frame_size;
+		}
 		memcpy(vd->h264_last_IDR, frame->h264_frame, frame->h264_frame_size);
 		vd->h264_last_IDR_size = frame->h264_frame_size;
 		if(verbosity > 1)
@@ -678,51 +1300,163 @@ static uint8_t is_h264_keyframe (v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 }
 
 /*
- * demux h264 data from muxed frame
+ * get the h264 frame (demuxed or raw) of a dequeued frame
+ *  non muxed frames are not copied (h264_frame aliases raw_frame)
  * args:
- *    h264_data - pointer to demuxed h264 data
- *    buffer - pointer to muxed h264 data
- *    size - buffer size
- *    h264_max_size - maximum size allowed by h264_data buffer
+ *    vd - pointer to v4l2 device handler
+ *    frame - pointer to frame buffer
  *
  * asserts:
- *    h264_data is not null
- *    buffer is not null
+ *    vd is not null
+ *    frame is not null
  *
- * return: demuxed h264 frame data size
+ * return: h264 frame data size (sets frame->h264_frame)
  */
-static int demux_h264(uint8_t* h264_data, uint8_t* buffer, int size, int h264_max_size)
+static int demux_h264(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 {
 	/*asserts*/
-	assert(h264_data != NULL);
-	assert(buffer != NULL);
+	assert(vd != NULL);
+	assert(frame != NULL);
+
+	int size = (int) frame->raw_frame_size;
+	int h264_max_size = (int) frame->h264_frame_max_size;
+
+	frame->h264_frame = NULL;
 
 	/*
 	 * if h264 is not supported return 0 (empty frame)
 	 */
-	if(h264_get_support() == H264_NONE)
+	if(h264_get_support(vd) == H264_NONE)
 		return 0;
 
 	/*
 	 * if it's a muxed stream we must demux it first
 	 */
-	if(h264_get_support() == H264_MUXED)
+	if(h264_get_support(vd) == H264_MUXED)
 	{
-		return demux_uvcH264(h264_data, buffer, size, h264_max_size);
+		if(frame->h264_buffer == NULL)
+			return 0;
+
+		frame->h264_frame = frame->h264_buffer;
+		return demux_uvcH264(frame->h264_frame, frame->raw_frame, size, h264_max_size);
 	}
 
 	/*
-	 * (H264_FRAME) store the raw frame in h264 frame buffer
+	 * (H264_FRAME) use the raw frame as it is (not copied, so not clipped)
+	 */
+	frame->h264_frame = frame->raw_frame;
+	return size;
+
+}
+
+/*
+ * prepare a dequeued frame for consumers that don't need the
+ *  decoded image (demux h264, store SPS/PPS and flag keyframes)
+ *  the yuv frame is only decoded on demand (v4l2core_frame_get_yuv)
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *
+ * asserts:
+ *    vd is not null
+ *    frame is not null
+ *
+ * returns: error code ( 0 - E_OK)
+ */
+int prepare_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(frame != NULL);
+
+	frame->isKeyframe = 0; /*reset*/
+
+	/*
+	 * use the requested format since it may differ
+	 * from format.fmt.pix.pixelformat (muxed H264)
+	 */
+	if(vd->requested_fmt != V4L2_PIX_FMT_H264)
+		return E_OK;
+
+	/*reset (h264_frame may alias a previous raw frame)*/
+	frame->h264_frame = NULL;
+	frame->h264_frame_size = 0;
+
+	if(!frame->raw_frame || frame->raw_frame_size == 0)
+		return E_DECODE_ERR;
+
+	/*
+	 * get the h264 frame (demuxed or aliased)
+	 */
+	frame->h264_frame_size = demux_h264(vd, frame);
+	if(frame->h264_frame == NULL || frame->h264_frame_size == 0)
+		return E_DECODE_ERR;
+
+	/*
+	 * index the NAL units once (shared by the checks below)
+	 */
+	h264_nal_index_build(frame->h264_nals, frame->h264_frame, (int) frame->h264_frame_size);
+
+	/*
+	 * store SPS and PPS info (usually the first two NALU)
+	 * and check/store the last IDR frame
 	 */
-	if(size > h264_max_size)
+	store_extra_data(vd, frame);
+
+	/*
+	 * check for keyframe and store it
+	 */
+	frame->isKeyframe = is_h264_keyframe(vd, frame);
+
+	return E_OK;
+}
+
+/*
+ * alias the yuv frame planes to a raw frame already in yu12, yv12 or nv12
+ * args:
+ *    frame - pointer to frame buffer
+ *    format - raw frame pixel format
+ *    planes - raw frame planes
+ *
+ * asserts:
+ *    none
+ *
+ * returns: 1 if the raw frame is used as yuv frame, 0 otherwise
+ */
+static int passthrough_yuv_frame(v4l2_frame_buff_t *frame, uint32_t format, raw_plane_t planes[3])
+{
+	int luma_size = planes[0].lines * planes[0].stride;
+	int chroma_size = planes[1].lines * planes[1].stride;
+
+	switch(format)
 	{
-		fprintf(stderr, "V4L2_CORE: (uvc H264) h264 data exceeds max of %i cliping\n",
-			h264_max_size);
-		size = h264_max_size;
+		case V4L2_PIX_FMT_YUV420:
+			frame->yuv_offset[1] = luma_size;
+			frame->yuv_offset[2] = luma_size + chroma_size;
+			break;
+
+		case V4L2_PIX_FMT_YVU420:
+			frame->yuv_offset[1] = luma_size + chroma_size;
+			frame->yuv_offset[2] = luma_size;
+			break;
+
+		case V4L2_PIX_FMT_NV12:
+			frame->yuv_offset[1] = luma_size;
+			frame->yuv_offset[2] = luma_size;
+			frame->yuv_format = V4L2_PIX_FMT_NV12;
+			break;
+
+		default:
+			return 0;
 	}
-	memcpy(h264_data, buffer, size);
-	return size;
 
+	frame->yuv_offset[0] = 0;
+	frame->yuv_stride[0] = planes[0].stride;
+	frame->yuv_stride[1] = planes[1].stride;
+	frame->yuv_stride[2] = planes[1].stride;
+	frame->yuv_frame = frame->raw_frame;
+
+	return 1;
 }
 
 /*
@@ -741,6 +1475,23 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 	/*asserts*/
 	assert(vd != NULL);
 
+	return decode_v4l2_frame_ctx(vd, frame, vd->jpeg_ctx);
+}
+
+/*
+ * decode the raw frame data (the caller owns the decode - FRAME_BUSY)
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *    jpeg_ctx - pointer to (m)jpeg decoder context
+ *
+ * asserts:
+ *    none
+ *
+ * returns: error code ( 0 - E_OK)
+*/
+static int decode_frame_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, jpeg_decoder_context_t *jpeg_ctx)
+{
 	if(!frame->raw_frame || frame->raw_frame_size == 0)
 	{
 		fprintf(stderr, "V4L2_CORE: not decoding empty raw frame (frame of size %i at 0x%p)\n", (int) frame->raw_frame_size, frame->raw_frame);
@@ -756,43 +1507,80 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 	int width = vd->format.fmt.pix.width;
 	int height = vd->format.fmt.pix.height;
 
-	frame->isKeyframe = 0; /*reset*/
-
 	/*
 	 * use the requested format since it may differ
 	 * from format.fmt.pix.pixelformat (muxed H264)
 	 */
 	int format = vd->requested_fmt;
 
+	/*decode to the frame buffer (undo any previous passthrough)*/
+	frame->yuv_frame = frame->yuv_buffer;
+	frame->yuv_format = V4L2_PIX_FMT_YUV420;
+	set_yuv_frame_layout(frame, width, height, frame->yuv_buffer_align);
+
+	/*yuv frame planes*/
+	uint8_t *out[3];
+	int i = 0;
+	for(i = 0; i < 3; ++i)
+		out[i] = frame->yuv_frame + frame->yuv_offset[i];
+
+	/*
+	 * raw frame layout - honor the driver line size (bytesperline)
+	 * unless the frame is too small for it (use packed lines)
+	 * bayer data in yuyv frames (logitech) has no yuyv line size
+	 */
+	raw_plane_t planes[3];
+	int nplanes = 0;
+	if(format != V4L2_PIX_FMT_YUYV || vd->isbayer <= 0)
+		nplanes = get_raw_layout(format, width, height, frame->raw_stride, planes);
+	if(nplanes > 0 && frame->raw_frame_size < get_raw_layout_size(planes, nplanes, 0))
+		nplanes = get_raw_layout(format, width, height, 0, planes);
+
+	int raw_complete = (nplanes > 0 &&
+		frame->raw_frame_size >= get_raw_layout_size(planes, nplanes, 0));
+
+	/*no copy for frames already in yu12, yv12 or nv12*/
+	if(raw_complete && vd->yuv_passthrough &&
+		passthrough_yuv_frame(frame, format, planes))
+		return E_OK;
+
+	/*stride aware converters write directly to the yuv frame planes*/
+	if(raw_complete &&
+		raw_to_yu12_stride(out, frame->yuv_stride, frame->raw_frame,
+			planes[0].stride, width, height, format,
+			vd->yuv_matrix, vd->demosaic_mode) == E_OK)
+		return E_OK;
+
+	/*other converters expect packed lines*/
+	uint8_t *raw_frame = frame->raw_frame;
+	if(nplanes > 0 && planes[0].stride > planes[0].line_size)
+		raw_frame = repack_raw_frame(frame, planes, nplanes);
+
 	int framesizeIn =(width * height << 1);//2 bytes per pixel
 	switch (format)
 	{
 		case V4L2_PIX_FMT_H264:
-			/*
-			 * get the h264 frame in the tmp_buffer
-			 */
-			frame->h264_frame_size = demux_h264(
-				frame->h264_frame,
-				frame->raw_frame,
-				frame->raw_frame_size,
-				frame->h264_frame_max_size);
-
-			/*
-			 * store SPS and PPS info (usually the first two NALU)
-			 * and check/store the last IDR frame
-			 */
-			store_extra_data(vd, frame);
-
-			/*
-			 * check for keyframe and store it
-			 */
-			frame->isKeyframe = is_h264_keyframe(vd, frame);
+			/*h264 frame was demuxed by prepare_v4l2_frame*/
 
 			//decode if we already have a IDR frame
-			if(vd->h264_last_IDR_size > 0)
+			if(vd->h264_last_IDR_size > 0 && frame->h264_frame_size > 0)
 			{
+				/*
+				 * frames that were not decoded (lazy decoding) break
+				 * the reference chain, resync with the last IDR frame
+				 */
+				if(!frame->isKeyframe &&
+					(vd->h264_last_decoded_seq < 0 ||
+					 (uint32_t) (vd->h264_last_decoded_seq + 1) != frame->sequence))
+				{
+					if(verbosity > 2)
+						printf("V4L2_CORE: (uvc H264) resync decoder with last IDR frame\n");
+					h264_decode(vd, frame->yuv_frame, vd->h264_last_IDR, vd->h264_last_IDR_size);
+				}
+
 				/*no need to convert output*/
-				h264_decode(frame->yuv_frame, frame->h264_frame, frame->h264_frame_size);
+				h264_decode(vd, frame->yuv_frame, frame->h264_frame, frame->h264_frame_size);
+				vd->h264_last_decoded_seq = frame->sequence;
 			}
 			break;
 
@@ -806,7 +1594,7 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 				return (ret);
 			}
 
-			ret = jpeg_decode(frame->yuv_frame, frame->raw_frame, frame->raw_frame_size);
+			ret = jpeg_decode_context(jpeg_ctx, frame->yuv_frame, frame->raw_frame, frame->raw_frame_size);
 
 			//memcpy(frame->tmp_buffer, frame->raw_frame, frame->raw_frame_size);
 			//ret = jpeg_decode(&frame->yuv_frame, frame->tmp_buffer, width, height);
@@ -821,166 +1609,177 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 			break;
 
 		case V4L2_PIX_FMT_UYVY:
-			uyvy_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			uyvy_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_VYUY:
-			vyuy_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			vyuy_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YVYU:
-			yvyu_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			yvyu_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YYUV:
-			yyuv_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			yyuv_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YUV444:
-			y444_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			y444_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YUV555:
-			yuvo_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			yuvo_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YUV565:
-			yuvp_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			yuvp_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YUV32:
-			yuv4_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			yuv4_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YUV420:
 			if(frame->raw_frame_size > (width * height * 3/2))
 				frame->raw_frame_size = width * height * 3/2;
-			memcpy(frame->yuv_frame, frame->raw_frame, frame->raw_frame_size);
+			memcpy(frame->yuv_frame, raw_frame, frame->raw_frame_size);
 			break;
 
 		case V4L2_PIX_FMT_YUV422P:
-			yuv422p_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			yuv422p_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YVU420:
-			yv12_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			yv12_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_NV12:
-			nv12_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			nv12_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_NV21:
-			nv21_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			nv21_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_NV16:
-			nv16_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			nv16_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_NV61:
-			nv61_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			nv61_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_NV24:
-			nv24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			nv24_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 	case V4L2_PIX_FMT_NV42:
-			nv42_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			nv42_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_Y41P:
-			y41p_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			y41p_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_GREY:
-			grey_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			grey_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_Y10BPACK:
-			y10b_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			y10b_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 	    case V4L2_PIX_FMT_Y16:
-			y16_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			y16_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 #ifdef V4L2_PIX_FMT_Y16_BE
 		case V4L2_PIX_FMT_Y16_BE:
-			y16x_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			y16x_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 #endif
 		case V4L2_PIX_FMT_SPCA501:
-			s501_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			s501_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_SPCA505:
-			s505_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			s505_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_SPCA508:
-			s508_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			s508_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
 		case V4L2_PIX_FMT_YUYV:
 			if(vd->isbayer>0)
 			{
-				if (!(frame->tmp_buffer))
-				{
-					/* rgb buffer for decoding bayer data*/
-					frame->tmp_buffer_max_size = width * height * 3;
-					frame->tmp_buffer = calloc(frame->tmp_buffer_max_size, sizeof(uint8_t));
-					if(frame->tmp_buffer == NULL)
-					{
-						fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (v4l2core_frame_decode): %s\n", strerror(errno));
-						exit(-1);
-					}
-				}
-				/*convert raw bayer to iyuv*/
-				bayer_to_rgb24 (frame->raw_frame, frame->tmp_buffer, width, height, vd->bayer_pix_order);
-				rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
+				/*convert raw bayer to iyuv (packed planes)*/
+				uint8_t *packed[3];
+				int packed_stride[3];
+				yu12_get_planes(frame->yuv_frame, width, height, packed, packed_stride);
+				bayer_to_yu12_stride(packed, packed_stride, raw_frame, width,
+					width, height, vd->bayer_pix_order, BAYER_SAMPLE_8,
+					vd->yuv_matrix, vd->demosaic_mode);
 			}
 			else
-				yuyv_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+				yuyv_to_yu12(frame->yuv_frame, raw_frame, width, height);
 			break;
 
-		case V4L2_PIX_FMT_SGBRG8: //0
-			bayer_to_rgb24 (frame->raw_frame, frame->tmp_buffer, width, height, 0);
-			rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
-			break;
-
-		case V4L2_PIX_FMT_SGRBG8: //1
-			bayer_to_rgb24 (frame->raw_frame, frame->tmp_buffer, width, height, 1);
-			rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
-			break;
-
-		case V4L2_PIX_FMT_SBGGR8: //2
-			bayer_to_rgb24 (frame->raw_frame, frame->tmp_buffer, width, height, 2);
-			rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
-			break;
-		case V4L2_PIX_FMT_SRGGB8: //3
-			bayer_to_rgb24 (frame->raw_frame, frame->tmp_buffer, width, height, 3);
-			rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
+		case V4L2_PIX_FMT_SGBRG8:
+		case V4L2_PIX_FMT_SGRBG8:
+		case V4L2_PIX_FMT_SBGGR8:
+		case V4L2_PIX_FMT_SRGGB8:
+		case V4L2_PIX_FMT_SGBRG10:
+		case V4L2_PIX_FMT_SGRBG10:
+		case V4L2_PIX_FMT_SBGGR10:
+		case V4L2_PIX_FMT_SRGGB10:
+		case V4L2_PIX_FMT_SGBRG12:
+		case V4L2_PIX_FMT_SGRBG12:
+		case V4L2_PIX_FMT_SBGGR12:
+		case V4L2_PIX_FMT_SRGGB12:
+		case V4L2_PIX_FMT_SBGGR16:
+#ifdef V4L2_PIX_FMT_SGBRG16
+		case V4L2_PIX_FMT_SGBRG16:
+		case V4L2_PIX_FMT_SGRBG16:
+		case V4L2_PIX_FMT_SRGGB16:
+#endif
+#ifdef V4L2_PIX_FMT_SBGGR10P
+		case V4L2_PIX_FMT_SGBRG10P:
+		case V4L2_PIX_FMT_SGRBG10P:
+		case V4L2_PIX_FMT_SBGGR10P:
+		case V4L2_PIX_FMT_SRGGB10P:
+#endif
+#ifdef V4L2_PIX_FMT_SBGGR12P
+		case V4L2_PIX_FMT_SGBRG12P:
+		case V4L2_PIX_FMT_SGRBG12P:
+		case V4L2_PIX_FMT_SBGGR12P:
+		case V4L2_PIX_FMT_SRGGB12P:
+#endif
+			/*complete bayer frames are demosaiced by raw_to_yu12_stride*/
+			if(verbosity > 1)
+				printf("V4L2_CORE: incomplete bayer frame (%lu bytes) - dropping\n",
+					(unsigned long) frame->raw_frame_size);
+			ret = E_DECODE_ERR;
 			break;
 
 		case V4L2_PIX_FMT_RGB24:
-			rgb24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			rgb24_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_BGR24:
-			bgr24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			bgr24_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_RGB332:
-			rgb1_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			rgb1_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_RGB565:
-			rgbp_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			rgbp_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_RGB565X:
-			rgbr_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			rgbr_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_RGB444:
@@ -988,7 +1787,7 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 		case V4L2_PIX_FMT_ARGB444:
 		case V4L2_PIX_FMT_XRGB444: //same as above but without alpha channel
 #endif
-			ar12_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			ar12_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_RGB555:
@@ -996,7 +1795,7 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 		case V4L2_PIX_FMT_ARGB555:
 		case V4L2_PIX_FMT_XRGB555: //same as above but without alpha channel
 #endif
-			ar15_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			ar15_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_RGB555X:
@@ -1004,11 +1803,11 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 		case V4L2_PIX_FMT_ARGB555X:
 		case V4L2_PIX_FMT_XRGB555X: //same as above but without alpha channel
 #endif
-			ar15x_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			ar15x_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_BGR666:
-			bgrh_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			bgrh_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_BGR32:
@@ -1016,7 +1815,7 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 		case V4L2_PIX_FMT_ABGR32:
 		case V4L2_PIX_FMT_XBGR32: //same as above but without alpha channel
 #endif
-			ar24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			ar24_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		case V4L2_PIX_FMT_RGB32:
@@ -1024,7 +1823,7 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 		case V4L2_PIX_FMT_ARGB32:
 		case V4L2_PIX_FMT_XRGB32: //same as above but without alpha channel
 #endif
-			ba24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
+			ba24_to_yu12(frame->yuv_frame, raw_frame, width, height, vd->yuv_matrix);
 			break;
 
 		default:
@@ -1033,5 +1832,82 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 			break;
 	}
 
+	/*the decoders above write packed lines*/
+	if(ret == E_OK && !is_yuv_frame_packed(frame, width, height))
+		unpack_yuv_frame(frame, width, height);
+
+	return ret;
+}
+
+/*
+ * wait for a decode in progress (FRAME_BUSY) on the frame to finish
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *
+ * asserts:
+ *    vd is not null
+ *    frame is not null
+ *
+ * returns: frame status after the wait (never FRAME_BUSY)
+ */
+int wait_v4l2_frame_decoded(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(frame != NULL);
+
+	int status = __atomic_load_n(&frame->status, __ATOMIC_ACQUIRE);
+	if(status != FRAME_BUSY)
+		return status;
+
+	__LOCK_MUTEX( &(vd->mutex) );
+	while((status = __atomic_load_n(&frame->status, __ATOMIC_ACQUIRE)) == FRAME_BUSY)
+		__COND_WAIT(&vd->decode_cond, &(vd->mutex));
+	__UNLOCK_MUTEX( &(vd->mutex) );
+
+	return status;
+}
+
+/*
+ * decode video stream using the given (m)jpeg decoder context
+ *  frames with different contexts can be decoded concurrently
+ *  (except for H264 that depends on the previous frames)
+ *  the first caller claims the decode (FRAME_BUSY), others wait for
+ *  it to finish, FRAME_DONE (or FRAME_DONE_ERR) is only set after it
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *    jpeg_ctx - pointer to (m)jpeg decoder context
+ *
+ * asserts:
+ *    vd is not null
+ *    frame is not null
+ *
+ * returns: error code ( 0 - E_OK)
+*/
+int decode_v4l2_frame_ctx(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, jpeg_decoder_context_t *jpeg_ctx)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(frame != NULL);
+
+	int status = FRAME_DECODING;
+	if(!__atomic_compare_exchange_n(&frame->status, &status, FRAME_BUSY,
+		0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		/*already decoded or being decoded by another thread*/
+		status = wait_v4l2_frame_decoded(vd, frame);
+		return (status == FRAME_DONE) ? E_OK : E_DECODE_ERR;
+	}
+
+	int ret = decode_frame_data(vd, frame, jpeg_ctx);
+
+	/*publish the result (broken frames are not retried)*/
+	__LOCK_MUTEX( &(vd->mutex) );
+	__atomic_store_n(&frame->status, (ret == E_OK) ? FRAME_DONE : FRAME_DONE_ERR, __ATOMIC_RELEASE);
+	__COND_BCAST(&vd->decode_cond);
+	__UNLOCK_MUTEX( &(vd->mutex) );
+
 	return ret;
 }
@@ -26,6 +26,7 @@
 
 #include "gviewv4l2core.h"
 #include "v4l2_core.h"
+#include "jpeg_decoder.h"
 
 /*
  * Alloc image buffers for decoding video stream
@@ -39,6 +40,22 @@
  */
 int alloc_v4l2_frames(v4l2_dev_t *vd);
 
+/*
+ * prepare a dequeued frame for consumers that don't need the
+ *  decoded image (demux h264, store SPS/PPS and flag keyframes)
+ *  the yuv frame is only decoded on demand (v4l2core_frame_get_yuv)
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *
+ * asserts:
+ *    vd is not null
+ *    frame is not null
+ *
+ * returns: error code (E_OK)
+ */
+int prepare_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
+
 /*
  * decode video stream ( from raw_frame to frame buffer (yuyv format))
  * args:
@@ -51,6 +68,80 @@ int alloc_v4l2_frames(v4l2_dev_t *vd);
  */
 int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
 
+/*
+ * wait for a decode in progress (FRAME_BUSY) on the frame to finish
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *
+ * asserts:
+ *    vd is not null
+ *    frame is not null
+ *
+ * returns: frame status after the wait (never FRAME_BUSY)
+ */
+int wait_v4l2_frame_decoded(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
+
+/*
+ * decode video stream using the given (m)jpeg decoder context
+ *  frames with different contexts can be decoded concurrently
+ *  (except for H264 that depends on the previous frames)
+ *  the first caller claims the decode, others wait for it to finish
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *    jpeg_ctx - pointer to (m)jpeg decoder context
+ *
+ * asserts:
+ *    vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int decode_v4l2_frame_ctx(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, jpeg_decoder_context_t *jpeg_ctx);
+
+/*
+ * decode a reduced size (yu12) image of the frame
+ *  (m)jpeg frames are downscaled in the DCT domain, other
+ *  formats are decoded at full size and box filtered
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *    scale - requested scale (DECODE_SCALE_1_2 to DECODE_SCALE_1_8)
+ *
+ * asserts:
+ *    vd is not null
+ *    frame is not null
+ *
+ * returns: error code (E_OK)
+ */
+int decode_v4l2_frame_scaled(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, int scale);
+
+/*
+ * get the decoded (yu12) frame tightly packed
+ *  (frames with aligned line sizes are copied to the stride buffer)
+ * args:
+ *    frame - pointer to (decoded) frame buffer
+ *
+ * asserts:
+ *    frame is not null
+ *
+ * returns: pointer to packed yu12 frame data
+ */
+uint8_t *pack_yuv_frame(v4l2_frame_buff_t *frame);
+
+/*
+ * make the decoded (yu12) frame writable
+ *  (passthrough frames are copied from the raw frame to the frame buffer)
+ * args:
+ *    frame - pointer to (decoded) frame buffer
+ *
+ * asserts:
+ *    frame is not null
+ *
+ * returns: pointer to yu12 frame data (frame buffer)
+ */
+uint8_t *own_yuv_frame(v4l2_frame_buff_t *frame);
+
 /*
  * free image buffers for decoding video stream
  * args:
@@ -0,0 +1,193 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  lock-free bounded ring of frame queue indexes (multi producer/consumer)      #
+#                                                                               #
+#  each cell carries a sequence number: a producer may write a cell when        #
+#  seq == pos and a consumer may read it when seq == pos + 1, so push and       #
+#  pop only need a compare and swap on their own position.                      #
+#                                                                               #
+********************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "gviewv4l2core.h"
+#include "frame_ring.h"
+
+/*
+ * init the ring (empty)
+ * args:
+ *   ring - pointer to ring
+ *   size - minimum number of entries (rounded up to a power of 2)
+ *
+ * asserts:
+ *   ring is not null
+ *   size > 0
+ *
+ * returns: error code (E_OK)
+ */
+int frame_ring_init(frame_ring_t *ring, int size)
+{
+	/*assertions*/
+	assert(ring != NULL);
+	assert(size > 0);
+
+	uint32_t ring_size = 1;
+	while(ring_size < (uint32_t) size)
+		ring_size <<= 1;
+
+	ring->cells = calloc(ring_size, sizeof(frame_ring_cell_t));
+	if(ring->cells == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (frame_ring_init): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	uint32_t i = 0;
+	for(i = 0; i < ring_size; ++i)
+	{
+		ring->cells[i].seq = i;
+		ring->cells[i].index = -1;
+	}
+
+	ring->mask = ring_size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+
+	return E_OK;
+}
+
+/*
+ * free the ring data
+ * args:
+ *   ring - pointer to ring
+ *
+ * asserts:
+ *   ring is not null
+ *
+ * returns: none
+ */
+void frame_ring_clean(frame_ring_t *ring)
+{
+	/*assertions*/
+	assert(ring != NULL);
+
+	if(ring->cells)
+		free(ring->cells);
+	ring->cells = NULL;
+	ring->mask = 0;
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+/*
+ * push an index into the ring (lock-free, any thread)
+ * args:
+ *   ring - pointer to ring
+ *   index - frame queue index
+ *
+ * asserts:
+ *   ring is not null
+ *
+ * returns: 0 on success, -1 if ring is full
+ */
+int frame_ring_push(frame_ring_t *ring, int index)
+{
+	/*assertions*/
+	assert(ring != NULL);
+
+	frame_ring_cell_t *cell = NULL;
+	uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+	for(;;)
+	{
+		cell = &ring->cells[pos & ring->mask];
+		uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		int32_t diff = (int32_t) (seq - pos);
+
+		if(diff == 0)
+		{
+			/*cell is free - claim it*/
+			if(__atomic_compare_exchange_n(&ring->head, &pos, pos + 1,
+				1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(diff < 0)
+			return -1; /*full*/
+		else
+			pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	}
+
+	cell->index = index;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/*
+ * pop an index from the ring (lock-free, any thread)
+ * args:
+ *   ring - pointer to ring
+ *
+ * asserts:
+ *   ring is not null
+ *
+ * returns: frame queue index or -1 if ring is empty
+ */
+int frame_ring_pop(frame_ring_t *ring)
+{
+	/*assertions*/
+	assert(ring != NULL);
+
+	frame_ring_cell_t *cell = NULL;
+	uint32_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+	for(;;)
+	{
+		cell = &ring->cells[pos & ring->mask];
+		uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		int32_t diff = (int32_t) (seq - (pos + 1));
+
+		if(diff == 0)
+		{
+			/*cell has data - claim it*/
+			if(__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1,
+				1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(diff < 0)
+			return -1; /*empty*/
+		else
+			pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	}
+
+	int index = cell->index;
+	/*free the cell for the next turn*/
+	__atomic_store_n(&cell->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+
+	return index;
+}
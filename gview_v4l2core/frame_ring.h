@@ -0,0 +1,106 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  lock-free bounded ring of frame queue indexes (multi producer/consumer)      #
+#                                                                               #
+********************************************************************************/
+
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <inttypes.h>
+#include <sys/types.h>
+
+/*
+ * ring cell: sequence number and stored frame index
+ */
+typedef struct _frame_ring_cell_t
+{
+	uint32_t seq;   //cell sequence (turn) number
+	int index;      //stored frame queue index
+} frame_ring_cell_t;
+
+/*
+ * bounded ring (size is a power of 2)
+ */
+typedef struct _frame_ring_t
+{
+	frame_ring_cell_t *cells; //ring cells
+	uint32_t mask;            //ring size - 1
+	/*keep producer and consumer positions in separate cache lines*/
+	uint32_t head __attribute__((aligned(64))); //push position
+	uint32_t tail __attribute__((aligned(64))); //pop position
+} frame_ring_t;
+
+/*
+ * init the ring (empty)
+ * args:
+ *   ring - pointer to ring
+ *   size - minimum number of entries (rounded up to a power of 2)
+ *
+ * asserts:
+ *   ring is not null
+ *   size > 0
+ *
+ * returns: error code (E_OK)
+ */
+int frame_ring_init(frame_ring_t *ring, int size);
+
+/*
+ * free the ring data
+ * args:
+ *   ring - pointer to ring
+ *
+ * asserts:
+ *   ring is not null
+ *
+ * returns: none
+ */
+void frame_ring_clean(frame_ring_t *ring);
+
+/*
+ * push an index into the ring (lock-free, any thread)
+ * args:
+ *   ring - pointer to ring
+ *   index - frame queue index
+ *
+ * asserts:
+ *   ring is not null
+ *
+ * returns: 0 on success, -1 if ring is full
+ */
+int frame_ring_push(frame_ring_t *ring, int index);
+
+/*
+ * pop an index from the ring (lock-free, any thread)
+ * args:
+ *   ring - pointer to ring
+ *
+ * asserts:
+ *   ring is not null
+ *
+ * returns: frame queue index or -1 if ring is empty
+ */
+int frame_ring_pop(frame_ring_t *ring);
+
+#endif
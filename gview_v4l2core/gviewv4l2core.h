@@ -88,6 +88,7 @@ __BEGIN_DECLS
 #define E_WRONG_MARKER_ERR        (-29)
 #define E_NO_EOI_ERR              (-30)
 #define E_FILE_IO_ERR             (-31)
+#define E_EXPBUF_ERR              (-32)
 #define E_UNKNOWN_ERR    		  (-40)
 
 /*
@@ -100,15 +101,50 @@ __BEGIN_DECLS
 /*
  * IO methods
  */
-#define IO_MMAP 1
-#define IO_READ 2
+#define IO_MMAP    1
+#define IO_READ    2
+#define IO_USERPTR 3 /*buffers from a page aligned user pool*/
+#define IO_DMABUF  4 /*mmap buffers also exported as dmabuf fds*/
 
 /*
  * Frame status
  */
-#define FRAME_READY (0)
-#define FRAME_DECODING (1)
-#define FRAME_DONE (2)
+#define FRAME_READY (0)      /*free (in the driver queue)*/
+#define FRAME_DECODING (1)   /*dequeued, not decoded yet*/
+#define FRAME_DONE (2)       /*decoded*/
+#define FRAME_BUSY (3)       /*decode in progress*/
+#define FRAME_DONE_ERR (4)   /*decoded with errors (not retried)*/
+
+/*
+ * reduced size decoding scale (v4l2core_frame_get_yuv_scaled)
+ */
+#define DECODE_SCALE_1_1 (0)
+#define DECODE_SCALE_1_2 (1)
+#define DECODE_SCALE_1_4 (2)
+#define DECODE_SCALE_1_8 (3)
+
+/*
+ * rgb to yuv matrix for rgb formats (v4l2core_set_yuv_matrix)
+ */
+#define YUV_MATRIX_BT601 (0)
+#define YUV_MATRIX_BT709 (1)
+
+/*
+ * demosaic filter for bayer formats (v4l2core_set_demosaic_mode)
+ *  bilinear - 3x3 interpolation (fast)
+ *  mhc - Malvar-He-Cutler 5x5 gradient corrected interpolation
+ */
+#define DEMOSAIC_BILINEAR (0)
+#define DEMOSAIC_MHC      (1)
+
+/*
+ * libavcodec decoder threading (v4l2core_set_codec_threads)
+ *  slice - slices of a frame are decoded in parallel (h264)
+ *  frame - consecutive frames are decoded in parallel (mjpeg, h264),
+ *          the output is delayed by one frame per extra thread
+ */
+#define CODEC_THREAD_SLICE (1)
+#define CODEC_THREAD_FRAME (2)
 
 /*
  * software autofocus sort method
@@ -132,7 +168,8 @@ __BEGIN_DECLS
 
 
 /*
- * buffer number (for driver mmap ops)
+ * default buffer number (for driver mmap ops)
+ * can be changed with v4l2core_set_buffer_count
  */
 #define NB_BUFFER 4
 
@@ -233,6 +270,11 @@ typedef struct _v4l2_ctrl_t
     int menu_entries;
     char **menu_entry; /*gettext translated menu entry name*/
 
+    /*last value read from or written to the device (unchanged values are not written)*/
+    int32_t device_value;
+    int64_t device_value64;
+    int device_value_valid;
+
     //next control in the list
     struct _v4l2_ctrl_t *next;
 } v4l2_ctrl_t;
@@ -255,16 +297,51 @@ typedef struct _v4l2_frame_buff_t
 	size_t h264_frame_size; // h264 frame size (bytes)
 	size_t h264_frame_max_size; //size limit for h264 frame (bytes)
 	size_t tmp_buffer_max_size; //maximum size for temp buffer (bytes)
+	size_t stride_buffer_max_size; //maximum size for stride buffer (bytes)
 
-	uint64_t timestamp; // captured frame timestamp
+	int raw_stride; //line size of the first raw frame plane (driver bytesperline, 0 if unknown)
+	int yuv_stride[3]; //line sizes of the yuv frame y, u and v planes (bytes)
+	int yuv_offset[3]; //offsets of the yuv frame y, u and v planes (bytes)
+	uint32_t yuv_format; //yuv frame planes format (V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_NV12 passthrough)
+	size_t yuv_frame_size; //allocated size of yuv buffer (bytes)
+	int yuv_buffer_align; //line size alignment of yuv buffer (bytes)
+
+	uint64_t timestamp; // captured frame timestamp (monotonic ns)
+	uint32_t sequence; // driver frame sequence number
 	
 	uint8_t *raw_frame; // pointer to raw frame
-	uint8_t *yuv_frame; // pointer to decoded yuv frame
+	uint8_t *yuv_frame; // pointer to decoded yuv frame (use v4l2core_frame_get_yuv)
+	uint8_t *yuv_buffer; // allocated yuv frame (yuv_frame aliases raw_frame on passthrough)
 	uint8_t *h264_frame; // pointer to regular or demultiplexed h264 frame
+	uint8_t *h264_buffer; // allocated demux buffer (h264_frame aliases raw_frame on non muxed h264)
+	struct _h264_nal_index_t *h264_nals; // NAL unit index of h264 frame (built on dequeue)
 	uint8_t *tmp_buffer; //temporary buffer used in decoding
+	uint8_t *stride_buffer; //repacked raw frame or packed yuv frame (padded lines only)
+
+	int dmabuf_fd; //exported dmabuf fd for raw frame (IO_DMABUF) or -1
+
+	uint8_t *yuv_scaled_frame; //reduced size yu12 frame (use v4l2core_frame_get_yuv_scaled)
+	size_t yuv_scaled_max_size; //allocated size for reduced size frame (bytes)
+	int scaled_decoded; //scale of yuv_scaled_frame (-1 if not decoded)
+	int scaled_width; //reduced size frame width
+	int scaled_height; //reduced size frame height
+
+	struct _v4l2_dev_t *vd; //device owning the frame (for on demand decoding)
 
 } v4l2_frame_buff_t;
 
+/*
+ * stream statistics struct
+ */
+typedef struct _v4l2_stream_stats_t
+{
+	uint64_t frames; //number of frames dequeued since stream start
+	uint64_t dropped; //frames lost by the driver (gaps in buffer sequence)
+	uint64_t late; //frames dequeued more than two frame periods after capture
+	uint64_t duplicate; //frames with a repeated sequence or timestamp
+	int driver_timestamps; //1 if driver monotonic timestamps are in use
+} v4l2_stream_stats_t;
+
 /*
  * v4l2 device system data
  */
@@ -280,11 +357,15 @@ typedef struct _v4l2_dev_sys_data_t
 	int current;
 	uint64_t busnum;
 	uint64_t devnum;
+	uint32_t firmware; //usb bcdDevice (device firmware version)
 } v4l2_dev_sys_data_t;
 
 /* v4l2 device handler - opaque data structure*/
 typedef struct _v4l2_dev_t v4l2_dev_t;
 
+/* frame ready callback (v4l2core_dispatch_devices)*/
+typedef void (*v4l2core_frame_ready_callback)(v4l2_dev_t *vd, void *data);
+
 /*
  * ioctl with a number of retries in the case of I/O failure
  * args:
@@ -311,6 +392,106 @@ int xioctl(int fd, int IOCTL_X, void *arg);
  */
 void v4l2core_set_verbosity(int level);
 
+/*
+ * set frame queue size (set before v4l2core_init_dev)
+ * args:
+ *   size - size in frames of frame queue
+ *
+ * asserts:
+ *   none
+ *
+ * returns void
+ */
+void v4l2core_set_frame_queue_size(int size);
+
+/*
+ * set the rgb to yuv matrix used when decoding rgb formats
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   matrix - YUV_MATRIX_BT601 (default) or YUV_MATRIX_BT709
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns void
+ */
+void v4l2core_set_yuv_matrix(v4l2_dev_t *vd, int matrix);
+
+/*
+ * set the demosaic filter used when decoding bayer formats
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   mode - DEMOSAIC_BILINEAR (default) or DEMOSAIC_MHC
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns void
+ */
+void v4l2core_set_demosaic_mode(v4l2_dev_t *vd, int mode);
+
+/*
+ * set the number of threads used for frame conversions
+ *  (colorspace conversions are split in row bands processed
+ *   by a thread pool private to the v4l2core library, the calling
+ *   thread included - each gview library has its own pool)
+ *  must not be called while a conversion is running
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - no worker threads)
+ *
+ * asserts:
+ *   none
+ *
+ * returns void
+ */
+void v4l2core_set_worker_threads(int nthreads);
+
+/*
+ * set the threads used by the libavcodec decoders (mjpeg and h264)
+ *  takes effect on the next decoder init (format change), every
+ *  decoder context (see v4l2core_set_decoder_threads) gets its own threads
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - no threading)
+ *   type - allowed threading (CODEC_THREAD_ flags,
+ *          default CODEC_THREAD_SLICE - no added latency)
+ *
+ * asserts:
+ *   none
+ *
+ * returns void
+ */
+void v4l2core_set_codec_threads(int nthreads, int type);
+
+/*
+ * enable or disable the device enumeration cache
+ *  (enabled by default - set before v4l2core_init_dev)
+ *  cached formats, frame sizes, frame rates and controls
+ *  skip the full device probe on the next init
+ * args:
+ *   enable - 1 to enable, 0 to disable
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_set_enum_cache(int enable);
+
+/*
+ * remove the enumeration cache of a device
+ *  (the next v4l2core_init_dev does a full device probe)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_invalidate_enum_cache(v4l2_dev_t *vd);
+
 /*
  * define fps values
  * args:
@@ -471,11 +652,78 @@ uint32_t v4l2core_fourcc_2_v4l2_pixelformat(const char *fourcc);
  */
 double v4l2core_get_realfps(v4l2_dev_t *vd);
 
+/*
+ * wait for frames on a set of devices
+ *  ready devices are flagged so that the next v4l2core_get_frame
+ *  on them doesn't block (check with v4l2core_is_frame_ready)
+ * args:
+ *   devs - array of device handlers (streaming)
+ *   n - number of devices in array
+ *   timeout_ms - wait timeout in ms (-1 blocks until a frame is ready)
+ *
+ * asserts:
+ *   devs is not null
+ *
+ * returns: number of devices with a frame ready (0 on timeout)
+ *          or error code (< 0)
+ */
+int v4l2core_poll_devices(v4l2_dev_t **devs, int n, int timeout_ms);
+
+/*
+ * wait for frames on a set of devices and dispatch
+ *  the ready callback for each device with a frame ready
+ * args:
+ *   devs - array of device handlers (streaming)
+ *   n - number of devices in array
+ *   timeout_ms - wait timeout in ms (-1 blocks until a frame is ready)
+ *   callback - function called for each ready device
+ *   data - user data passed to callback
+ *
+ * asserts:
+ *   devs is not null
+ *   callback is not null
+ *
+ * returns: number of dispatched devices (0 on timeout)
+ *          or error code (< 0)
+ */
+int v4l2core_dispatch_devices(v4l2_dev_t **devs, int n, int timeout_ms,
+	v4l2core_frame_ready_callback callback, void *data);
+
+/*
+ * check if a frame was flagged ready by v4l2core_poll_devices
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: 1 if a frame is ready, 0 otherwise
+ */
+int v4l2core_is_frame_ready(v4l2_dev_t *vd);
+
+/*
+ * get stream statistics (frame drops, late and duplicate frames)
+ *  counters are reset on each v4l2core_start_stream
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   stats - pointer to stats struct to fill
+ *
+ * asserts:
+ *   vd is not null
+ *   stats is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_get_stream_stats(v4l2_dev_t *vd, v4l2_stream_stats_t *stats);
+
 /*
  * set v4l2 capture method to use
+ *  with IO_USERPTR and IO_DMABUF the raw frame (and dmabuf_fd) can be
+ *  used in place until v4l2core_release_frame requeues the buffer,
+ *  consumers that keep it longer (e.g. the encoder ring) must copy it
  * args:
  *   vd - pointer to v4l2 device handler
- *   method - capture method (IO_READ or IO_MMAP)
+ *   method - capture method (IO_READ, IO_MMAP, IO_USERPTR or IO_DMABUF)
  *
  * asserts:
  *   vd is not null
@@ -484,6 +732,82 @@ double v4l2core_get_realfps(v4l2_dev_t *vd);
 */
 void v4l2core_set_capture_method(v4l2_dev_t *vd, int method);
 
+/*
+ * set the number of driver buffers to request
+ *  (takes effect on the next v4l2core_update_current_format)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   count - number of buffers to request from the driver
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_set_buffer_count(v4l2_dev_t *vd, int count);
+
+/*
+ * get the number of driver buffers in use
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: number of buffers granted by the driver (VIDIOC_REQBUFS)
+ */
+int v4l2core_get_buffer_count(v4l2_dev_t *vd);
+
+/*
+ * set the number of decoder threads used by v4l2core_get_decoded_frame
+ *  (set while not capturing; frames in flight are limited by the frame
+ *   queue size - 1 and the driver buffer count - 1)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   nthreads - number of decoder threads (< 2 decodes in the calling thread)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_decoder_threads(v4l2_dev_t *vd, int nthreads);
+
+/*
+ * set the line size alignment of the decoded (yu12) frames
+ *  (takes effect on the next format change, v4l2core_update_current_format)
+ *  with an alignment > 1 the planes of v4l2core_frame_get_yuv are padded:
+ *  use v4l2core_frame_get_yuv_plane for the plane line sizes or
+ *  v4l2core_frame_get_yuv_packed for a tightly packed copy
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   align - line size alignment in bytes (power of 2, 1 - tightly packed)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_frame_alignment(v4l2_dev_t *vd, int align);
+
+/*
+ * set yuv passthrough: frames already in yu12, yv12 or nv12 are not
+ *  copied, the yuv frame planes alias the raw (driver) frame
+ *  consumers must use the frame planes (v4l2core_frame_get_yuv_plane)
+ *  and check frame->yuv_format (nv12 has a single uv plane),
+ *  v4l2core_frame_get_yuv_packed always returns packed yu12 and
+ *  v4l2core_frame_get_yuv_writable must be used for in place changes
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   enable - 1 enable; 0 disable (default)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_set_yuv_passthrough(v4l2_dev_t *vd, int enable);
+
 /*
  * Initiate video device handler with default values
  * args:
@@ -582,6 +906,33 @@ void v4l2core_set_pan_step(v4l2_dev_t *vd, int step);
  */
 void v4l2core_set_tilt_step(v4l2_dev_t *vd, int step);
 
+/*
+ * Initiate the device list (with udev monitoring)
+ *  device nodes are probed concurrently; the list is also
+ *  initiated on first use (e.g. v4l2core_get_num_devices)
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_init_device_list();
+
+/*
+ * set the device probe timeout (set before the device list is initiated)
+ *  device nodes that don't answer in time are left out of the list
+ * args:
+ *   timeout_ms - timeout in ms for each device node (def. 2000)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_set_device_probe_timeout(int timeout_ms);
+
 /*
  * get the number of available v4l2 devices
  * args:
@@ -703,6 +1054,20 @@ int v4l2core_get_frame_width(v4l2_dev_t *vd);
  */
 int v4l2core_get_frame_height(v4l2_dev_t *vd);
 
+/*
+ * get the reduced size decoding scale usable with the current frame size
+ *  (v4l2core_frame_get_yuv_scaled returns frame width/height >> scale)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   scale - requested scale (DECODE_SCALE_1_1 to DECODE_SCALE_1_8)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: largest scale <= requested scale that fits the frame size
+ */
+int v4l2core_get_decode_scale(v4l2_dev_t *vd, int scale);
+
 /* get frame format index from format list
  * args:
  *   vd - pointer to v4l2 device handler
@@ -797,6 +1162,7 @@ int v4l2core_update_current_format(v4l2_dev_t *vd);
 
 /*
  * gets the next video frame (must be released after processing)
+ *  the yuv image is only decoded on demand (v4l2core_frame_get_yuv)
  * args:
  *   vd - pointer to v4l2 device handler
  *
@@ -807,6 +1173,84 @@ int v4l2core_update_current_format(v4l2_dev_t *vd);
  */
 v4l2_frame_buff_t *v4l2core_get_frame(v4l2_dev_t *vd);
 
+/*
+ * get the decoded (yu12) image of a frame
+ *  frames from v4l2core_get_frame are decoded on the first call
+ *  (consumers of the raw data only never pay for decoding)
+ * args:
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   frame is not null
+ *
+ * returns: pointer to yu12 frame data (planes at yuv_offset with yuv_stride line sizes)
+ */
+uint8_t *v4l2core_frame_get_yuv(v4l2_frame_buff_t *frame);
+
+/*
+ * get a plane of the decoded (yu12) image of a frame
+ *  frames from v4l2core_get_frame are decoded on the first call
+ * args:
+ *   frame - pointer to frame buffer
+ *   plane - plane index (0 - y, 1 - u (uv for nv12), 2 - v)
+ *   stride - pointer to plane line size in bytes (to be filled, can be NULL)
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to plane data (NULL on error or plane 2 of nv12 frames)
+ */
+uint8_t *v4l2core_frame_get_yuv_plane(v4l2_frame_buff_t *frame, int plane, int *stride);
+
+/*
+ * get the decoded (yu12) image of a frame tightly packed
+ *  (frames with aligned line sizes are copied to the frame stride buffer)
+ * args:
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to packed yu12 frame data
+ */
+uint8_t *v4l2core_frame_get_yuv_packed(v4l2_frame_buff_t *frame);
+
+/*
+ * get the decoded (yu12) image of a frame for in place changes (fx, osd)
+ *  passthrough frames are copied from the raw frame to the frame buffer
+ * args:
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to yu12 frame data (planes at yuv_offset with yuv_stride line sizes)
+ */
+uint8_t *v4l2core_frame_get_yuv_writable(v4l2_frame_buff_t *frame);
+
+/*
+ * get a reduced size decoded (yu12) image of a frame (e.g. for preview)
+ *  mjpeg frames are downscaled in the DCT domain (1:8 is DC only)
+ *  other formats are decoded at full size and box filtered
+ *  the scale is reduced if the frame size is not a multiple of it
+ * args:
+ *   frame - pointer to frame buffer
+ *   scale - DECODE_SCALE_1_1, DECODE_SCALE_1_2, DECODE_SCALE_1_4 or DECODE_SCALE_1_8
+ *   width - pointer to output width (to be filled, can be NULL)
+ *   height - pointer to output height (to be filled, can be NULL)
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to yu12 frame data (NULL on error)
+ */
+uint8_t *v4l2core_frame_get_yuv_scaled(v4l2_frame_buff_t *frame, int scale,
+	int *width, int *height);
+
 /*
  * releases the video frame (so that it can be reused by the driver)
  * args:
@@ -947,6 +1391,25 @@ v4l2_ctrl_t* v4l2core_get_control_by_id(v4l2_dev_t *vd, int id);
  */
 int v4l2core_set_control_value_by_id(v4l2_dev_t *vd, int id);
 
+/*
+ * sets the values of a set of controls in the device
+ *  controls are grouped by class in single VIDIOC_S_EXT_CTRLS calls
+ *  and only controls with changed values are written
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   ids - array of control ids
+ *   values - array of control values (NULL to use the current control values)
+ *   n - number of controls
+ *
+ * asserts:
+ *   vd is not null
+ *   ids is not null
+ *
+ * returns: number of controls that failed to set (0 - E_OK)
+ *          or error code (< 0)
+ */
+int v4l2core_set_controls_batch(v4l2_dev_t *vd, const int *ids, const int32_t *values, int n);
+
 /*
  * updates the value for control id from the device
  * also updates control flags
@@ -1014,26 +1477,26 @@ int v4l2core_soft_autofocus_run(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
 /*
  * sets a focus loop while autofocus is on
  * args:
- *    none
+ *    vd - pointer to v4l2 device handler
  *
  * asserts:
- *    none
+ *    vd is not null
  *
  * returns: none
  */
-void v4l2core_soft_autofocus_set_focus();
+void v4l2core_soft_autofocus_set_focus(v4l2_dev_t *vd);
 
 /*
  * close and clean software autofocus
  * args:
- *   none
+ *   vd - pointer to v4l2 device handler
  *
  * asserts:
- *   none
+ *   vd is not null
  *
  * returns: none
  */
-void v4l2core_soft_autofocus_close();
+void v4l2core_soft_autofocus_close(v4l2_dev_t *vd);
 
 /*
  * save the device control values into a profile file
@@ -1048,8 +1511,25 @@ void v4l2core_soft_autofocus_close();
  */
 int v4l2core_save_control_profile(v4l2_dev_t *vd, const char *filename);
 
+/*
+ * save the device control values into a binary profile file
+ *  stores the device identity, a checksum and only the
+ *  controls with non default values
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   filename - profile filename
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (0 -E_OK)
+ */
+int v4l2core_save_control_profile_binary(v4l2_dev_t *vd, const char *filename);
+
 /*
  * load the device control values from a profile file
+ *  binary profiles only write the controls that differ
+ *  from the current values (auto modes first)
  * args:
  *   vd - pointer to v4l2 device handler
  *   filename - profile filename
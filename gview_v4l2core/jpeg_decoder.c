@@ -38,13 +38,20 @@
 #include <assert.h>
 
 #include "gviewv4l2core.h"
+#include "v4l2_core.h"
 #include "colorspaces.h"
+#include "colorspaces_simd.h"
 #include "jpeg_decoder.h"
+#include "thread_pool.h"
 #include "gview.h"
 #include "../config.h"
 
 extern int verbosity;
 
+/*libavcodec decoders threading (set_codec_threads)*/
+static int codec_threads = 0;
+static int codec_thread_type = CODEC_THREAD_SLICE;
+
 /* default Huffman table*/
 #define JPG_HUFFMAN_TABLE_LENGTH 0x01A0
 
@@ -110,19 +117,20 @@ const uint8_t jpeg_huffman_table[JPG_HUFFMAN_TABLE_LENGTH] =
 	0xF9, 0xFA
 };
 
-typedef struct _jpeg_decoder_context_t
+struct _jpeg_decoder_context_t
 {
 	void *codec_data;
 
 	int width;
 	int height;
 	int pic_size;
+	int scale; //output size is width >> scale x height >> scale
 	
 	uint8_t *tmp_frame; //temp frame buffer
+	uint8_t *tmp_u; //scaled u plane at luma resolution (builtin scaled decoding)
+	uint8_t *tmp_v; //scaled v plane at luma resolution (builtin scaled decoding)
 	
-} jpeg_decoder_context_t;
-
-static jpeg_decoder_context_t *jpeg_ctx = NULL;
+};
 
 #if MJPG_BUILTIN //use internal jpeg decoder
 
@@ -135,6 +143,12 @@ static jpeg_decoder_context_t *jpeg_ctx = NULL;
 #endif
 
 /* special markers */
+/*minimum number of mcus per thread pool band (restart segments decoding)*/
+#define JPEG_MIN_BAND_MCUS (256)
+
+/*bytes after the jpeg data that the bit reader may load*/
+#define JPEG_INPUT_PADDING (8)
+
 #define M_BADHUFF	-1
 #define M_EOF		0x80
 
@@ -153,28 +167,7 @@ static jpeg_decoder_context_t *jpeg_ctx = NULL;
 #define M_EOI   0xd9
 #define M_COM   0xfe
 
-/*
- * IDCT data
- */
-#define IMULT(a, b) (((a) * (b)) >> ISHIFT)
-#define ITOINT(a) ((a) >> ISHIFT)
-
-#define S22 ((PREC)IFIX(2 * 0.382683432))
-#define C22 ((PREC)IFIX(2 * 0.923879532))
-#define IC4 ((PREC)IFIX(1 / 0.707106781))
-
-/*zigzag order used by idct*/
-static unsigned char zig2[64] = {
-    0, 2, 3, 9, 10, 20, 21, 35,
-    14, 16, 25, 31, 39, 46, 50, 57,
-    5, 7, 12, 18, 23, 33, 37, 48,
-    27, 29, 41, 44, 52, 55, 59, 62,
-    15, 26, 30, 40, 45, 51, 56, 58,
-    1, 4, 8, 11, 19, 22, 34, 36,
-    28, 42, 43, 53, 54, 60, 61, 63,
-    6, 13, 17, 24, 32, 38, 47, 49
-};
-
+/*zigzag index of each coefficient (natural order)*/
 static uint8_t zig[64] = {
     0, 1, 5, 6, 14, 15, 27, 28,
     2, 4, 7, 13, 16, 26, 29, 42,
@@ -186,12 +179,16 @@ static uint8_t zig[64] = {
     35, 36, 48, 49, 57, 58, 62, 63
 };
 
-/*coef used in idct*/
-static PREC aaidct[8] = {
-    IFIX(0.3535533906), IFIX(0.4903926402),
-    IFIX(0.4619397663), IFIX(0.4157348062),
-    IFIX(0.3535533906), IFIX(0.2777851165),
-    IFIX(0.1913417162), IFIX(0.0975451610)
+/*natural order index of each coefficient (zigzag order)*/
+static uint8_t unzig[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10,
+    17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
 };
 
 /*
@@ -201,25 +198,24 @@ struct jpeg_decdata
 {
 	int dcts[6 * 64 + 16];
 	int out[64 * 6];
-	int dquant[3][64];
 };
 
 struct in
 {
 	uint8_t *p;
-	uint32_t bits;
+	uint64_t bits;   /* bit reservoir (the left lower bits are valid) */
 	int left;
 	int marker;
 	int (*func) __P((void *));
 	void *data;
 };
 
-#define LEBI_DCL	int le, bi
+#define LEBI_DCL	int le; uint64_t bi
 #define LEBI_GET(in)	(le = in->left, bi = in->bits)
 #define LEBI_PUT(in)	(in->left = le, in->bits = bi)
 
 /*********************************/
-#define DECBITS 10		/* seems to be the optimum */
+#define DECBITS 11		/* run/size and value in one lookup for most codes */
 
 struct dec_hufftbl
 {
@@ -268,17 +264,28 @@ struct jpginfo
 	int rm;			/* next restart marker */
 };
 
-static struct jpginfo info;
-static struct comp comps[MAXCOMP];
+/*
+ * builtin decoder data (jpeg_ctx->codec_data)
+ */
+typedef struct _codec_data_t
+{
+	struct jpginfo info;
+	struct comp comps[MAXCOMP];
+	struct scan dscans[MAXCOMP];
+	uint8_t quant[4][64];
+	struct dec_hufftbl dhuff[4];
 
-static struct scan dscans[MAXCOMP];
+	uint8_t *datap;  /* pointer to pixel data */
+	struct in inp;   /* input structure (in) */
 
-static uint8_t quant[4][64];
+	uint8_t **segments; /* restart segments entropy data (parallel decoding) */
+	int segments_max;   /* allocated segments */
 
-static struct dec_hufftbl dhuff[4];
+	int huffman_default; /* dhuff has the default (MJPG) tables */
+} codec_data_t;
 
-#define dec_huffdc (dhuff + 0)
-#define dec_huffac (dhuff + 2)
+#define dec_huffdc(cd) ((cd)->dhuff + 0)
+#define dec_huffac(cd) ((cd)->dhuff + 2)
 
 /*
  * build huffman data
@@ -354,15 +361,19 @@ static void dec_makehuff(struct dec_hufftbl *hu, int *hufflen, uint8_t *huffvals
 /*
  * huffman decoder initialization
  * args:
- *    none
+ *    codec_data - pointer to decoder data
  *
  * asserts:
- *    none
+ *    codec_data is not null
  *
  * returns: error code (0 - OK)
  */
-static int huffman_init(void)
+static int huffman_init(codec_data_t *codec_data)
 {
+	/*asserts*/
+	assert(codec_data != NULL);
+
+
 	uint8_t *ptr= (uint8_t *) jpeg_huffman_table ;
 	int i, j, l;
 	l = JPG_HUFFMAN_TABLE_LENGTH ;
@@ -387,13 +398,34 @@ static int huffman_init(void)
 				huffvals[k++] = *ptr++;
 			l -= hufflen[i];
 		}
-		dec_makehuff(dhuff + tt, hufflen, huffvals);
+		dec_makehuff(codec_data->dhuff + tt, hufflen, huffvals);
 	}
 	return 0;
 }
 
 /*
- * fillbits
+ * load 8 bytes of entropy coded data (big endian)
+ * args:
+ *    p - pointer to data
+ *
+ * asserts:
+ *    none
+ *
+ * returns: 64 bit word
+ */
+static inline uint64_t load_be64(const uint8_t *p)
+{
+	uint64_t w;
+	memcpy(&w, p, sizeof(uint64_t));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	w = __builtin_bswap64(w);
+#endif
+	return w;
+}
+
+/*
+ * fillbits_slow - refill the bit reservoir one byte at a time
+ *  (0xff stuffing, markers and M_EOF callback)
  * args:
  *    inp - pointer to struct in
  *    le - left
@@ -402,24 +434,24 @@ static int huffman_init(void)
  * asserts:
  *    inp not null
  *
- * returns: error code (0 - OK)
+ * returns: number of valid bits in reservoir (left)
  */
-static int fillbits(struct in *inp, int le, unsigned int bi)
+static int fillbits_slow(struct in *inp, int le, uint64_t bi)
 {
 	/*asserts*/
 	assert(inp != NULL);
-	
+
 	if (inp->marker)
 	{
 		if (le <= 16)
 			inp->bits = bi << 16, le += 16;
 		return le;
 	}
-	while (le <= 24)
+	while (le <= 56)
 	{
 		int b = *inp->p++;
 		int m = 0;
-		
+
 		if (b == 0xff && (m = *inp->p++) != 0)
 		{
 			if (m == M_EOF)
@@ -439,6 +471,42 @@ static int fillbits(struct in *inp, int le, unsigned int bi)
 	return le;
 }
 
+/*
+ * fillbits - refill the 64 bit reservoir (at least 57 valid bits
+ *  unless a marker is found)
+ *  the next 8 bytes are loaded at once if none is 0xff (no stuffing
+ *  or marker), otherwise falls back to fillbits_slow
+ * args:
+ *    inp - pointer to struct in
+ *    le - left
+ *    bi - bits
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of valid bits in reservoir (left)
+ */
+static inline int fillbits(struct in *inp, int le, uint64_t bi)
+{
+	/*reservoir already full (w >> 64 below is undefined)*/
+	if (le > 56)
+	{
+		inp->bits = bi;
+		return le;
+	}
+
+	uint64_t w = load_be64(inp->p);
+	uint64_t t = ~w;
+
+	if (inp->marker || ((t - 0x0101010101010101ULL) & ~t & 0x8080808080808080ULL))
+		return fillbits_slow(inp, le, bi);
+
+	int n = (64 - le) >> 3; /*bytes that fit in the reservoir*/
+	inp->bits = (n == 8) ? w : (bi << (n * 8)) | (w >> (64 - (n * 8)));
+	inp->p += n;
+	return le + (n * 8);
+}
+
 static int dec_rec2
 __P((struct in *, struct dec_hufftbl *, int *, int, int));
 
@@ -452,7 +520,19 @@ __P((struct in *, struct dec_hufftbl *, int *, int, int));
   le += (n)			\
 )
 
-#define DEC_REC(in, hu, r, i)	 (	\
+/* receive and extend a s bit value */
+#define DEC_RECEIVE(in, s, c) (		\
+  c = GETBITS(in, s),			\
+  c < (1 << ((s) - 1)) ? c + (-1 << (s)) + 1 : c	\
+)
+
+/*
+ * decode run/size and value with a single table lookup:
+ *  value known - done
+ *  size known - receive the value bits inline
+ *  code longer than DECBITS - dec_rec2
+ */
+#define DEC_REC(in, hu, r, i, v)	 (	\
   r = GETBITS(in, DECBITS),		\
   i = hu->llvals[r],			\
   i & 128 ?				\
@@ -461,6 +541,13 @@ __P((struct in *, struct dec_hufftbl *, int *, int, int));
       r = i >> 8 & 15,			\
       i >> 16				\
     )					\
+  : i ?					\
+    (					\
+      UNGETBITS(in, i & 127),		\
+      r = i >> 8 & 15,			\
+      i >>= 16,				\
+      DEC_RECEIVE(in, i, v)		\
+    )					\
   :					\
     (					\
       LEBI_PUT(in),			\
@@ -487,7 +574,7 @@ __P((struct in *, struct dec_hufftbl *, int *, int, int));
 static void decode_mcus(struct in *inp, int *dct, int n, struct scan *sc, int *maxp)
 {
 	struct dec_hufftbl *hu;
-	int r = 0, t = 0;
+	int r = 0, t = 0, v = 0;
 	LEBI_DCL;
 
 	memset(dct, 0, n * 64 * sizeof(*dct));
@@ -495,14 +582,14 @@ static void decode_mcus(struct in *inp, int *dct, int n, struct scan *sc, int *m
 	while (n-- > 0)
 	{
 		hu = sc->hudc.dhuff;
-		*dct++ = (sc->dc += DEC_REC(inp, hu, r, t));
+		*dct++ = (sc->dc += DEC_REC(inp, hu, r, t, v));
 
 		hu = sc->huac.dhuff;
 		int i = 63;
 		
 		while (i > 0)
 		{
-			t = DEC_REC(inp, hu, r, t);
+			t = DEC_REC(inp, hu, r, t, v);
 			if (t == 0 && r == 0)
 			{
 				dct += i;
@@ -566,224 +653,315 @@ static void setinput(struct in *inp, uint8_t *p)
 	inp->marker = 0;
 }
 
+/****************************************************************/
+/**************             idct                  ***************/
+/****************************************************************/
+
 /*
- * IDCT quantization table
+ * 8 point inverse dct (islow algorithm - jidctint.c from the IJG libjpeg)
+ *  this is the reference for the SIMD kernels in colorspaces_simd.c
+ * args:
+ *   s - pointer to the 8 inputs
+ *   o - pointer to the 8 outputs (scaled by 2^IDCT_CONST_BITS)
+ *   bias - rounding bias (added to the outputs)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
  */
-static void idctqtab(uint8_t *qin, PREC *qout)
+inline static void idct_1d(const int *s, int *o, int bias)
 {
-	int i, j;
-
-	for (i = 0; i < 8; i++)
-		for (j = 0; j < 8; j++)
-			qout[zig[i * 8 + j]] = qin[zig[i * 8 + j]] *
-				IMULT(aaidct[i], aaidct[j]);
+	/*even part*/
+	int z1 = (s[2] + s[6]) * IDCT_FIX_0_541196100;
+	int t2 = z1 - s[6] * IDCT_FIX_1_847759065;
+	int t3 = z1 + s[2] * IDCT_FIX_0_765366865;
+	int t0 = (s[0] + s[4]) * (1 << IDCT_CONST_BITS) + bias;
+	int t1 = (s[0] - s[4]) * (1 << IDCT_CONST_BITS) + bias;
+
+	int x0 = t0 + t3;
+	int x3 = t0 - t3;
+	int x1 = t1 + t2;
+	int x2 = t1 - t2;
+
+	/*odd part*/
+	int z3 = s[7] + s[3];
+	int z4 = s[5] + s[1];
+	int z5 = (z3 + z4) * IDCT_FIX_1_175875602;
+	int p1 = z5 - (s[7] + s[1]) * IDCT_FIX_0_899976223;
+	int p2 = z5 - (s[5] + s[3]) * IDCT_FIX_2_562915447;
+	z3 *= -IDCT_FIX_1_961570560;
+	z4 *= -IDCT_FIX_0_390180644;
+
+	int y0 = s[7] * IDCT_FIX_0_298631336 + p1 + z3;
+	int y1 = s[5] * IDCT_FIX_2_053119869 + p2 + z4;
+	int y2 = s[3] * IDCT_FIX_3_072711026 + p2 + z3;
+	int y3 = s[1] * IDCT_FIX_1_501321110 + p1 + z4;
+
+	o[0] = x0 + y3;
+	o[7] = x0 - y3;
+	o[1] = x1 + y2;
+	o[6] = x1 - y2;
+	o[2] = x2 + y1;
+	o[5] = x2 - y1;
+	o[3] = x3 + y0;
+	o[4] = x3 - y0;
 }
 
-/****************************************************************/
-/**************             idct                  ***************/
-/****************************************************************/
-
 /*
  * inverse dct for jpeg decoding
  * args:
- *   in -  pointer to input data ( mcu - after huffman decoding)
- *   out - pointer to data with output of idct (to be filled)
- *   quant - pointer to quantization data tables
- *   off - offset value (128.5 or 0.5)
- *   max - maximum input mcu index?
+ *   coef - pointer to dequantized coefficients (natural order)
+ *   out - pointer to output block (level shifted and clipped samples)
+ *   stride - output line size in bytes
  *
  * asserts:
  *   none
  *
  * returns: none
  */
-inline static void idct(int *inp, int *out, int *quant, long off, int max)
+static void idct(const int16_t *coef, uint8_t *out, int stride)
 {
-	long t0, t1, t2, t3, t4, t5, t6, t7;	// t ;
-	long tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6;
-	long tmp[64], *tmpp;
-	int i, j, te;
-	uint8_t *zig2p;
-
-	t0 = off;
-	if (max == 1) //single color mcu
-	{
-		t0 += inp[0] * quant[0];     //only DC available
-		for (i = 0; i < 64; i++)    // fill mcu with DC value
-			out[i] = ITOINT(t0);
-		return;
-	}
-	zig2p = zig2;
-	tmpp = tmp;
-	for (i = 0; i < 8; i++) //apply quantization table in zigzag order
+	int tmp[64];
+	int s[8];
+	int o[8];
+	int i = 0, j = 0;
+
+	/*columns (2 extra bits of precision)*/
+	for (i = 0; i < 8; i++)
 	{
-		j = *zig2p++;
-		t0 += inp[j] * (long) quant[j];
-		j = *zig2p++;
-		t5 = inp[j] * (long) quant[j];
-		j = *zig2p++;
-		t2 = inp[j] * (long) quant[j];
-		j = *zig2p++;
-		t7 = inp[j] * (long) quant[j];
-		j = *zig2p++;
-		t1 = inp[j] * (long) quant[j];
-		j = *zig2p++;
-		t4 = inp[j] * (long) quant[j];
-		j = *zig2p++;
-		t3 = inp[j] * (long) quant[j];
-		j = *zig2p++;
-		t6 = inp[j] * (long) quant[j];
-
-
-		if ((t1 | t2 | t3 | t4 | t5 | t6 | t7) == 0)
+		const int16_t *c = coef + i;
+		if ((c[8] | c[16] | c[24] | c[32] | c[40] | c[48] | c[56]) == 0)
 		{
-			tmpp[0 * 8] = t0; //DC
-			tmpp[1 * 8] = t0;
-			tmpp[2 * 8] = t0;
-			tmpp[3 * 8] = t0;
-			tmpp[4 * 8] = t0;
-			tmpp[5 * 8] = t0;
-			tmpp[6 * 8] = t0;
-			tmpp[7 * 8] = t0;
-
-			tmpp++;
-			t0 = 0;
+			/*dc only column*/
+			for (j = 0; j < 8; j++)
+				tmp[j * 8 + i] = c[0] * (1 << (IDCT_CONST_BITS - IDCT_PASS1_SHIFT));
 			continue;
 		}
-		//IDCT;
-		tmp0 = t0 + t1;
-		t1 = t0 - t1;
-		tmp2 = t2 - t3;
-		t3 = t2 + t3;
-		tmp2 = IMULT(tmp2, IC4) - t3;
-		tmp3 = tmp0 + t3;
-		t3 = tmp0 - t3;
-		tmp1 = t1 + tmp2;
-		tmp2 = t1 - tmp2;
-		tmp4 = t4 - t7;
-		t7 = t4 + t7;
-		tmp5 = t5 + t6;
-		t6 = t5 - t6;
-		tmp6 = tmp5 - t7;
-		t7 = tmp5 + t7;
-		tmp5 = IMULT(tmp6, IC4);
-		tmp6 = IMULT((tmp4 + t6), S22);
-		tmp4 = IMULT(tmp4, (C22 - S22)) + tmp6;
-		t6 = IMULT(t6, (C22 + S22)) - tmp6;
-		t6 = t6 - t7;
-		t5 = tmp5 - t6;
-		t4 = tmp4 - t5;
-
-		tmpp[0 * 8] = tmp3 + t7;        //t0;
-		tmpp[1 * 8] = tmp1 + t6;        //t1;
-		tmpp[2 * 8] = tmp2 + t5;        //t2;
-		tmpp[3 * 8] = t3 + t4;          //t3;
-		tmpp[4 * 8] = t3 - t4;          //t4;
-		tmpp[5 * 8] = tmp2 - t5;        //t5;
-		tmpp[6 * 8] = tmp1 - t6;        //t6;
-		tmpp[7 * 8] = tmp3 - t7;        //t7;
-		tmpp++;
-		t0 = 0;
+
+		for (j = 0; j < 8; j++)
+			s[j] = c[j * 8];
+		idct_1d(s, o, 1 << (IDCT_PASS1_SHIFT - 1));
+		for (j = 0; j < 8; j++)
+			tmp[j * 8 + i] = o[j] >> IDCT_PASS1_SHIFT;
 	}
-	for (i = 0, j = 0; i < 8; i++)
+
+	/*rows (level shift by 128)*/
+	for (i = 0; i < 8; i++, out += stride)
 	{
-		t0 = tmp[j + 0];
-		t1 = tmp[j + 1];
-		t2 = tmp[j + 2];
-		t3 = tmp[j + 3];
-		t4 = tmp[j + 4];
-		t5 = tmp[j + 5];
-		t6 = tmp[j + 6];
-		t7 = tmp[j + 7];
-		if ((t1 | t2 | t3 | t4 | t5 | t6 | t7) == 0)
-		{
-			te = ITOINT(t0);
-			out[j + 0] = te;
-			out[j + 1] = te;
-			out[j + 2] = te;
-			out[j + 3] = te;
-			out[j + 4] = te;
-			out[j + 5] = te;
-			out[j + 6] = te;
-			out[j + 7] = te;
-			j += 8;
-			continue;
-		}
-		//IDCT;
-		tmp0 = t0 + t1;
-		t1 = t0 - t1;
-		tmp2 = t2 - t3;
-		t3 = t2 + t3;
-		tmp2 = IMULT(tmp2, IC4) - t3;
-		tmp3 = tmp0 + t3;
-		t3 = tmp0 - t3;
-		tmp1 = t1 + tmp2;
-		tmp2 = t1 - tmp2;
-		tmp4 = t4 - t7;
-		t7 = t4 + t7;
-		tmp5 = t5 + t6;
-		t6 = t5 - t6;
-		tmp6 = tmp5 - t7;
-		t7 = tmp5 + t7;
-		tmp5 = IMULT(tmp6, IC4);
-		tmp6 = IMULT((tmp4 + t6), S22);
-		tmp4 = IMULT(tmp4, (C22 - S22)) + tmp6;
-		t6 = IMULT(t6, (C22 + S22)) - tmp6;
-		t6 = t6 - t7;
-		t5 = tmp5 - t6;
-		t4 = tmp4 - t5;
-
-		out[j + 0] = ITOINT(tmp3 + t7);
-		out[j + 1] = ITOINT(tmp1 + t6);
-		out[j + 2] = ITOINT(tmp2 + t5);
-		out[j + 3] = ITOINT(t3 + t4);
-		out[j + 4] = ITOINT(t3 - t4);
-		out[j + 5] = ITOINT(tmp2 - t5);
-		out[j + 6] = ITOINT(tmp1 - t6);
-		out[j + 7] = ITOINT(tmp3 - t7);
-		j += 8;
+		idct_1d(tmp + i * 8, o, (1 << (IDCT_PASS2_SHIFT - 1)) + (128 << IDCT_PASS2_SHIFT));
+		for (j = 0; j < 8; j++)
+			out[j] = CLIP(o[j] >> IDCT_PASS2_SHIFT);
 	}
 }
 
-/*********************************/
-//static void col221111 __P((int *, unsigned char *, int));
+/*
+ * dequantize and inverse dct a block into the output picture
+ * args:
+ *   kernel - SIMD idct kernel (NULL for the scalar idct)
+ *   inp - pointer to block coefficients (zigzag order - after huffman decoding)
+ *   quant - pointer to quantization table (zigzag order)
+ *   max - number of decoded coefficients (1 for a single color block)
+ *   out - pointer to output block
+ *   stride - output line size in bytes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void idct_block(idct_kernel_t kernel, int *inp, uint8_t *quant, int max,
+	uint8_t *out, int stride)
+{
+	int16_t coef[64];
+	int i = 0;
 
-typedef void (*ftopict) (int * out, uint8_t *pic, int width) ;
+	if (max <= 1)
+	{
+		/*single color block (same result as the full idct)*/
+		int dc = CLIP(((inp[0] * quant[0] + 4) >> 3) + 128);
+		for (i = 0; i < 8; i++, out += stride)
+			memset(out, dc, 8);
+		return;
+	}
+
+	if (max > 64) /*corrupted run lengths*/
+		max = 64;
+
+	memset(coef, 0, sizeof(coef));
+	for (i = 0; i < max; i++)
+		coef[unzig[i]] = (int16_t) (inp[i] * quant[i]);
+
+	if (kernel)
+		kernel(out, stride, coef);
+	else
+		idct(coef, out, stride);
+}
+
+/*
+ * reduced idct coeficients (N point idct of the N lowest frequencies)
+ *  idct_redN[x * N + u] = C(u)/2 * cos((2x + 1) * u * PI / 2N)
+ */
+static PREC idct_red1[1] = {
+	IFIX(0.3535533906)
+};
+
+static PREC idct_red2[4] = {
+	IFIX(0.3535533906), IFIX(0.3535533906),
+	IFIX(0.3535533906), IFIX(-0.3535533906)
+};
+
+static PREC idct_red4[16] = {
+	IFIX(0.3535533906), IFIX(0.4619397663), IFIX(0.3535533906), IFIX(0.1913417162),
+	IFIX(0.3535533906), IFIX(0.1913417162), IFIX(-0.3535533906), IFIX(-0.4619397663),
+	IFIX(0.3535533906), IFIX(-0.1913417162), IFIX(-0.3535533906), IFIX(0.4619397663),
+	IFIX(0.3535533906), IFIX(-0.4619397663), IFIX(0.3535533906), IFIX(-0.1913417162)
+};
 
-/*********************************/
 /*
- * pointer to pixel data
+ * reduced inverse dct (DCT domain downscaling)
+ *  only the n x n lowest frequencies are used, n = 1 is DC only
+ * args:
+ *   in -  pointer to input data ( mcu - after huffman decoding)
+ *   out - pointer to n x n output block (to be filled)
+ *   quant - pointer to quantization table (zigzag order)
+ *   off - offset value (128.5 or 0.5)
+ *   n - output block size (1, 2 or 4)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
  */
-static uint8_t *datap;
+static void idct_scaled(int *inp, int *out, uint8_t *quant, long off, int n)
+{
+	long coef[16];
+	long tmp[16];
+	int u = 0, v = 0, x = 0, y = 0;
+
+	PREC *ctab = idct_red4;
+	if(n == 1)
+		ctab = idct_red1;
+	else if(n == 2)
+		ctab = idct_red2;
+
+	for (v = 0; v < n; v++)
+		for (u = 0; u < n; u++)
+		{
+			int k = zig[v * 8 + u];
+			coef[v * n + u] = inp[k] * (long) quant[k];
+		}
+
+	/*rows (keep the fixed point precision for the second pass)*/
+	for (v = 0; v < n; v++)
+		for (x = 0; x < n; x++)
+		{
+			long t = 0;
+			for (u = 0; u < n; u++)
+				t += ctab[x * n + u] * coef[v * n + u];
+			tmp[v * n + x] = t;
+		}
+
+	/*columns*/
+	for (y = 0; y < n; y++)
+		for (x = 0; x < n; x++)
+		{
+			long t = off << ISHIFT;
+			for (v = 0; v < n; v++)
+				t += ctab[y * n + v] * tmp[v * n + x];
+			out[y * n + x] = (int) (t >> (2 * ISHIFT));
+		}
+}
 
 /*
- * input structure (in)
+ * store a reduced size mcu in the output image
+ *  y goes directly to the yu12 buffer, u and v are stored at
+ *  luma resolution and subsampled once the frame is complete
+ * args:
+ *   jpeg_ctx - pointer to decoder context
+ *   out - pointer to reduced idct output (n x n blocks: yyyy u v)
+ *   pic - pointer to yu12 picture buffer
+ *   mx - mcu column
+ *   my - mcu row
+ *   hv - luma sampling factors (0x22, 0x21 or 0x11)
+ *   nc - number of color blocks (0 for grayscale)
+ *   n - reduced block size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
  */
-static struct in inp;
+static void put_scaled_mcu(jpeg_decoder_context_t *jpeg_ctx, int *out, uint8_t *pic,
+	int mx, int my, int hv, int nc, int n)
+{
+	int width = jpeg_ctx->width >> jpeg_ctx->scale;
+	int height = jpeg_ctx->height >> jpeg_ctx->scale;
+	int mw = (hv >> 4) * n; /*mcu width*/
+	int mh = (hv & 15) * n; /*mcu height*/
+	int x0 = mx * mw;
+	int y0 = my * mh;
+	int nb = (hv >> 4) * (hv & 15); /*luma blocks*/
+	int b = 0, x = 0, y = 0;
+
+	for (b = 0; b < nb; b++)
+	{
+		int *blk = out + b * 64;
+		int bx = x0 + (b & 1) * n;
+		int by = y0 + (b >> 1) * n;
+		uint8_t *py = pic + by * width + bx;
+		/*clip partial mcus at the right and bottom edges*/
+		for (y = 0; y < n && by + y < height; y++, py += width)
+			for (x = 0; x < n && bx + x < width; x++)
+				py[x] = CLIP(blk[y * n + x]);
+	}
 
+	int hs = mw / n; /*chroma horizontal replication*/
+	int vs = mh / n; /*chroma vertical replication*/
+	for (y = 0; y < mh && y0 + y < height; y++)
+	{
+		uint8_t *pu = jpeg_ctx->tmp_u + (y0 + y) * width + x0;
+		uint8_t *pv = jpeg_ctx->tmp_v + (y0 + y) * width + x0;
+		for (x = 0; x < mw && x0 + x < width; x++)
+		{
+			if(nc)
+			{
+				int ind = (y / vs) * n + x / hs;
+				pu[x] = CLIP(128 + out[256 + ind]);
+				pv[x] = CLIP(128 + out[320 + ind]);
+			}
+			else
+			{
+				pu[x] = 128;
+				pv[x] = 128;
+			}
+		}
+	}
+}
 
 /*
- * get byte (8 bit) from datap
+ * get byte (8 bit) from codec_data->datap
  */
-static int getbyte(void)
+static int getbyte(codec_data_t *codec_data)
 {
-	return *datap++;
+	return *codec_data->datap++;
 }
 
 /*
- * get word (16 bit) from datap
+ * get word (16 bit) from codec_data->datap
  */
-static int getword(void)
+static int getword(codec_data_t *codec_data)
 {
 	int c1, c2;
-	c1 = *datap++;
-	c2 = *datap++;
+	c1 = *codec_data->datap++;
+	c2 = *codec_data->datap++;
 	return c1 << 8 | c2;
 }
 
 /*
  * read jpeg tables (huffman and quantization)
  * args:
+ *    codec_data - pointer to decoder data
  *    till - Marker (frame - SOF0   scan - SOS)
  *    isDHT - flag indicating the presence of huffman tables (if 0 must use default ones - MJPG frame)
  * asserts:
@@ -791,19 +969,19 @@ static int getword(void)
  *
  * returns: error code (0 - OK)
  */
-static int readtables(int till, int *isDHT)
+static int readtables(codec_data_t *codec_data, int till, int *isDHT)
 {
 	int l, i, j, lq, pq, tq;
 	int tc, th, tt;
 
 	for (;;)
 	{
-		if (getbyte() != 0xff)
+		if (getbyte(codec_data) != 0xff)
 			return -1;
 		
 		int m = 0;
 
-		if ((m = getbyte()) == till)
+		if ((m = getbyte(codec_data)) == till)
 			break;
 
 		switch (m)
@@ -812,10 +990,10 @@ static int readtables(int till, int *isDHT)
 				return 0;
 			/*read quantization tables (Lqt and Cqt)*/
 			case M_DQT:
-				lq = getword();
+				lq = getword(codec_data);
 				while (lq > 2)
 				{
-					pq = getbyte();
+					pq = getbyte(codec_data);
 					/*Lqt=0x00   Cqt=0x01*/
 					tq = pq & 15;
 					if (tq > 3)
@@ -824,19 +1002,19 @@ static int readtables(int till, int *isDHT)
 					if (pq != 0)
 					return -1;
 					for (i = 0; i < 64; i++)
-						quant[tq][i] = getbyte();
+						codec_data->quant[tq][i] = getbyte(codec_data);
 					lq -= 64 + 1;
 				}
 				break;
 			/*read huffman table*/
 			case M_DHT:
-				l = getword();
+				l = getword(codec_data);
 				while (l > 2)
 				{
 					int hufflen[16], k;
 					uint8_t huffvals[256];
 
-					tc = getbyte();
+					tc = getbyte(codec_data);
 					th = tc & 15;
 					tc >>= 4;
 					tt = tc * 2 + th;
@@ -844,30 +1022,31 @@ static int readtables(int till, int *isDHT)
 					return -1;
 
 					for (i = 0; i < 16; i++)
-						hufflen[i] = getbyte();
+						hufflen[i] = getbyte(codec_data);
 					l -= 1 + 16;
 					k = 0;
 					for (i = 0; i < 16; i++)
 					{
 						for (j = 0; j < hufflen[i]; j++)
-							huffvals[k++] = getbyte();
+							huffvals[k++] = getbyte(codec_data);
 						l -= hufflen[i];
 					}
-					dec_makehuff(dhuff + tt, hufflen, huffvals);
+					dec_makehuff(codec_data->dhuff + tt, hufflen, huffvals);
 				}
 				/* has huffman tables defined (JPEG)*/
 				*isDHT= 1;
+				codec_data->huffman_default = 0;
 				break;
 			/*restart interval*/
 			case M_DRI:
-				l = getword();
-				info.dri = getword();
+				l = getword(codec_data);
+				codec_data->info.dri = getword(codec_data);
 				break;
 
 			default:
-				l = getword();
+				l = getword(codec_data);
 				while (l-- > 2)
-					getbyte();
+					getbyte(codec_data);
 				break;
 		}
 	}
@@ -877,43 +1056,43 @@ static int readtables(int till, int *isDHT)
 /*
  * init dscans
  * args:
- *    none
+ *    codec_data - pointer to decoder data
  *
  * asserts:
  *    none
  *
  * returns: none
  */
-static void dec_initscans(void)
+static void dec_initscans(codec_data_t *codec_data)
 {
 	int i;
 
-	info.nm = info.dri + 1;
-	info.rm = M_RST0;
-	for (i = 0; i < info.ns; i++)
-		dscans[i].dc = 0;
+	codec_data->info.nm = codec_data->info.dri + 1;
+	codec_data->info.rm = M_RST0;
+	for (i = 0; i < codec_data->info.ns; i++)
+		codec_data->dscans[i].dc = 0;
 }
 
 /*
  * check markers
  * args:
- *    none
+ *    codec_data - pointer to decoder data
  *
  * asserts:
  *    none
  *
  * returns: error code (0 - OK)
  */
-static int dec_checkmarker(void)
+static int dec_checkmarker(codec_data_t *codec_data)
 {
 	int i;
 
-	if (dec_readmarker(&inp) != info.rm)
+	if (dec_readmarker(&codec_data->inp) != codec_data->info.rm)
 		return -1;
-	info.nm = info.dri;
-	info.rm = (info.rm + 1) & ~0x08;
-	for (i = 0; i < info.ns; i++)
-		dscans[i].dc = 0;
+	codec_data->info.nm = codec_data->info.dri;
+	codec_data->info.rm = (codec_data->info.rm + 1) & ~0x08;
+	for (i = 0; i < codec_data->info.ns; i++)
+		codec_data->dscans[i].dc = 0;
 	return 0;
 }
 
@@ -965,7 +1144,258 @@ static int dec_rec2(struct in *inp, struct dec_hufftbl *hu, int *runp, int c, in
 }
 
 /*
- * init (m)jpeg decoder context
+ * mcu decoding job (shared by all the restart segments of a frame)
+ */
+typedef struct _mcu_job_t
+{
+	jpeg_decoder_context_t *jpeg_ctx;
+	codec_data_t *codec_data;
+	uint8_t *quant[3];  //quantization tables of each component (zigzag order)
+	idct_kernel_t idct; //SIMD idct kernel (NULL for the scalar idct)
+	uint8_t *out_buf;   //yu12 output (y plane)
+	uint8_t *out_u;     //u plane (full size decoding)
+	uint8_t *out_v;     //v plane (full size decoding)
+	int mb;             //blocks per mcu
+	int mcusx;          //mcus per line
+	int nmcus;          //mcus in frame
+	int pitch;          //luma line size (full size decoding)
+	int n;              //output block size (reduced size decoding)
+	int nluma;          //luma blocks in mcu (reduced size decoding)
+	int hv;             //mcu sampling (reduced size decoding)
+	uint8_t **segments; //entropy data of each restart segment
+} mcu_job_t;
+
+/*
+ * store a chroma block subsampled to the yu12 chroma resolution
+ * args:
+ *    blk - pointer to 8x8 chroma block
+ *    out - pointer to chroma plane (mcu position)
+ *    stride - chroma line size
+ *    hs - horizontal subsampling (1 - 4:2:2 mcu, 2 - 4:4:4 mcu)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void put_chroma_block(const uint8_t *blk, uint8_t *out, int stride, int hs)
+{
+	int x = 0, y = 0;
+
+	for (y = 0; y < 4; y++, blk += 16, out += stride)
+	{
+		if (hs == 1)
+			for (x = 0; x < 8; x++)
+				out[x] = (blk[x] + blk[x + 8] + 1) >> 1;
+		else
+			for (x = 0; x < 4; x++)
+				out[x] = (blk[2 * x] + blk[2 * x + 1] +
+					blk[2 * x + 8] + blk[2 * x + 9] + 2) >> 2;
+	}
+}
+
+/*
+ * decode a mcu and write it to the output
+ * args:
+ *    job - pointer to mcu decoding job
+ *    inp - pointer to struct in (entropy data)
+ *    dscans - pointer to struct scan (dc predictors)
+ *    dcts - pointer to dct coeficients buffer (6 * 64 + 16)
+ *    out - pointer to idct output buffer (6 * 64 - reduced size decoding)
+ *    max - pointer to mcu blocks max index (6)
+ *    mcu - mcu index (raster order)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void decode_mcu(mcu_job_t *job, struct in *inp, struct scan *dscans,
+	int *dcts, int *out, int *max, int mcu)
+{
+	int mx = mcu % job->mcusx;
+	int my = mcu / job->mcusx;
+	int j = 0;
+
+	decode_mcus(inp, dcts, job->mb, dscans, max);
+
+	if(job->jpeg_ctx->scale > 0)
+	{
+		for (j = 0; j < job->nluma; j++)
+			idct_scaled(dcts + j * 64, out + j * 64,
+				job->quant[0], IFIX(128.5), job->n);
+		if (job->mb > 1)
+		{
+			idct_scaled(dcts + job->nluma * 64, out + 256,
+				job->quant[1], IFIX(0.5), job->n);
+			idct_scaled(dcts + (job->nluma + 1) * 64, out + 320,
+				job->quant[2], IFIX(0.5), job->n);
+		}
+
+		put_scaled_mcu(job->jpeg_ctx, out, job->out_buf, mx, my, job->hv, job->mb > 1, job->n);
+		return;
+	}
+
+	/*the idct writes straight to the yu12 planes*/
+	int pitch = job->pitch;
+	int cpitch = pitch / 2;
+	uint8_t chroma[2][64];
+	uint8_t *py = NULL;
+	int coff = 0;
+
+	switch (job->mb)
+	{
+		case 6: /*16x16 mcu - 4:2:0 chroma blocks are stored as they are*/
+			py = job->out_buf + (my * 16) * pitch + mx * 16;
+			coff = (my * 8) * cpitch + mx * 8;
+			idct_block(job->idct, dcts, job->quant[0], max[0], py, pitch);
+			idct_block(job->idct, dcts + 64, job->quant[0], max[1], py + 8, pitch);
+			idct_block(job->idct, dcts + 128, job->quant[0], max[2], py + 8 * pitch, pitch);
+			idct_block(job->idct, dcts + 192, job->quant[0], max[3], py + 8 * pitch + 8, pitch);
+			idct_block(job->idct, dcts + 256, job->quant[1], max[4], job->out_u + coff, cpitch);
+			idct_block(job->idct, dcts + 320, job->quant[2], max[5], job->out_v + coff, cpitch);
+			break;
+
+		case 4: /*16x8 mcu - 4:2:2 chroma is subsampled vertically*/
+			py = job->out_buf + (my * 8) * pitch + mx * 16;
+			coff = (my * 4) * cpitch + mx * 8;
+			idct_block(job->idct, dcts, job->quant[0], max[0], py, pitch);
+			idct_block(job->idct, dcts + 64, job->quant[0], max[1], py + 8, pitch);
+			idct_block(job->idct, dcts + 128, job->quant[1], max[2], chroma[0], 8);
+			idct_block(job->idct, dcts + 192, job->quant[2], max[3], chroma[1], 8);
+			put_chroma_block(chroma[0], job->out_u + coff, cpitch, 1);
+			put_chroma_block(chroma[1], job->out_v + coff, cpitch, 1);
+			break;
+
+		case 3: /*8x8 mcu - 4:4:4 chroma is subsampled in both directions*/
+			py = job->out_buf + (my * 8) * pitch + mx * 8;
+			coff = (my * 4) * cpitch + mx * 4;
+			idct_block(job->idct, dcts, job->quant[0], max[0], py, pitch);
+			idct_block(job->idct, dcts + 64, job->quant[1], max[1], chroma[0], 8);
+			idct_block(job->idct, dcts + 128, job->quant[2], max[2], chroma[1], 8);
+			put_chroma_block(chroma[0], job->out_u + coff, cpitch, 2);
+			put_chroma_block(chroma[1], job->out_v + coff, cpitch, 2);
+			break;
+
+		case 1: /*grayscale (chroma planes are set once per frame)*/
+			py = job->out_buf + (my * 8) * pitch + mx * 8;
+			idct_block(job->idct, dcts, job->quant[0], max[0], py, pitch);
+			break;
+	}
+}
+
+/*
+ * index the restart segments of the entropy coded data
+ *  (quick scan for the RSTn markers, up to EOI)
+ * args:
+ *    codec_data - pointer to decoder data (datap at the start of the scan data)
+ *    end - pointer to the end of the jpeg data
+ *    nsegments - expected number of restart segments
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of segments (0 if the markers don't match
+ *          the restart interval - use serial decoding)
+ */
+static int index_restart_segments(codec_data_t *codec_data, uint8_t *end, int nsegments)
+{
+	if(codec_data->segments_max < nsegments)
+	{
+		codec_data->segments = realloc(codec_data->segments, nsegments * sizeof(uint8_t *));
+		if(codec_data->segments == NULL)
+		{
+			fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (index_restart_segments): %s\n", strerror(errno));
+			exit(-1);
+		}
+		codec_data->segments_max = nsegments;
+	}
+
+	uint8_t *p = codec_data->datap;
+	int n = 0;
+	codec_data->segments[n++] = p;
+
+	while (p + 1 < end)
+	{
+		p = memchr(p, 0xff, end - p - 1);
+		if(p == NULL)
+			break;
+
+		int m = p[1];
+		if (m == 0) /*stuffed byte*/
+		{
+			p += 2;
+			continue;
+		}
+		if (m == 0xff) /*fill byte*/
+		{
+			p++;
+			continue;
+		}
+		if (m == M_EOI)
+			return (n == nsegments) ? n : 0;
+
+		/*restart markers must follow the modulo 8 sequence*/
+		if (m != M_RST0 + ((n - 1) & 7) || n >= nsegments)
+			return 0;
+
+		p += 2;
+		codec_data->segments[n++] = p;
+	}
+
+	return 0; /*no EOI*/
+}
+
+/*
+ * decode a band of restart segments
+ *  each segment starts with reset dc predictors and has
+ *  its own bit reader, so bands are independent
+ * args:
+ *    data - pointer to mcu decoding job (mcu_job_t)
+ *    seg_start - first segment of the band
+ *    seg_end - last segment of the band (not included)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void decode_restart_segments(void *data, int seg_start, int seg_end)
+{
+	mcu_job_t *job = (mcu_job_t *) data;
+
+	int dcts[6 * 64 + 16];
+	int out[64 * 6];
+	int max[6] = {0, 0, 0, 0, 0, 0};
+	struct scan dscans[MAXCOMP];
+	struct in inp;
+
+	int dri = job->codec_data->info.dri;
+	int seg = 0;
+
+	for (seg = seg_start; seg < seg_end; seg++)
+	{
+		int i = 0;
+		memcpy(dscans, job->codec_data->dscans, sizeof(dscans));
+		for (i = 0; i < MAXCOMP; i++)
+			dscans[i].dc = 0;
+
+		memset(&inp, 0, sizeof(struct in));
+		setinput(&inp, job->segments[seg]);
+
+		int mcu = seg * dri;
+		int last = mcu + dri;
+		if (last > job->nmcus)
+			last = job->nmcus;
+
+		for (; mcu < last; mcu++)
+			decode_mcu(job, &inp, dscans, dcts, out, max, mcu);
+	}
+}
+
+/*
+ * create a (m)jpeg decoder context
+ *  (each thread decoding concurrently needs its own context)
  * args:
  *    width - image width
  *    height - image height
@@ -973,65 +1403,86 @@ static int dec_rec2(struct in *inp, struct dec_hufftbl *hu, int *runp, int c, in
  * asserts:
  *    none
  *
- * returns: error code (0 - E_OK)
+ * returns: pointer to decoder context (NULL on error)
  */
-int jpeg_init_decoder(int width, int height)
+jpeg_decoder_context_t *jpeg_create_scaled_context(int width, int height, int scale)
 {
-	if(jpeg_ctx != NULL)
-		jpeg_close_decoder();
-
-	jpeg_ctx = calloc(1, sizeof(jpeg_decoder_context_t));
+	jpeg_decoder_context_t *jpeg_ctx = calloc(1, sizeof(jpeg_decoder_context_t));
 	if(jpeg_ctx == NULL)
 	{
-		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_init_decoder): %s\n", strerror(errno));
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_create_context): %s\n", strerror(errno));
 		exit(-1);
 	}
 	
 	jpeg_ctx->width = width;
 	jpeg_ctx->height = height;
+	jpeg_ctx->scale = jpeg_clamp_scale(width, height, scale);
 	jpeg_ctx->pic_size = width * height * 2; //yuyv
-	jpeg_ctx->codec_data = NULL;
+
+	if(jpeg_ctx->scale > 0)
+	{
+		int scaled_size = (width >> jpeg_ctx->scale) * (height >> jpeg_ctx->scale);
+		jpeg_ctx->tmp_u = calloc(scaled_size, sizeof(uint8_t));
+		jpeg_ctx->tmp_v = calloc(scaled_size, sizeof(uint8_t));
+		if(jpeg_ctx->tmp_u == NULL || jpeg_ctx->tmp_v == NULL)
+		{
+			fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_create_context): %s\n", strerror(errno));
+			exit(-1);
+		}
+	}
+
+	jpeg_ctx->codec_data = calloc(1, sizeof(codec_data_t));
+	if(jpeg_ctx->codec_data == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_create_context): %s\n", strerror(errno));
+		exit(-1);
+	}
 	
-	jpeg_ctx->tmp_frame = calloc(jpeg_ctx->pic_size, sizeof(uint8_t));
+	/*padding for the 8 byte loads of the bit reader*/
+	jpeg_ctx->tmp_frame = calloc(jpeg_ctx->pic_size + JPEG_INPUT_PADDING, sizeof(uint8_t));
 	if(jpeg_ctx->tmp_frame == NULL)
 	{
-		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_init_decoder): %s\n", strerror(errno));
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_create_context): %s\n", strerror(errno));
 		exit(-1);
 	}
-	
-	return E_OK;
+
+	return jpeg_ctx;
 }
 
 /*
  * jpeg decode
  * args:
- *   out_buf -  pointer to picture data ( decoded image - yuyv format)
+ *   jpeg_ctx - pointer to decoder context
+ *   out_buf -  pointer to picture data ( decoded image - yu12 format)
  *   in_buf -  pointer to input data ( compressed jpeg )
  *   size - picture size
  *
  * asserts:
+ *   jpeg_ctx is not null
  *   out_buf not null
  *   in_buf not null
  *
  * returns: error code (0 - OK)
  */
 //int jpeg_decode(uint8_t **pic, uint8_t *buf, int width, int height)
-int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
+int jpeg_decode_context(jpeg_decoder_context_t *jpeg_ctx, uint8_t *out_buf, uint8_t *in_buf, int size)
 {
 	/*asserts*/
+	assert(jpeg_ctx != NULL);
 	assert(in_buf != NULL);
 	assert(out_buf != NULL);
+
+	codec_data_t *codec_data = (codec_data_t *) jpeg_ctx->codec_data;
 	
 	memcpy(jpeg_ctx->tmp_frame, in_buf, size);
 
 	struct jpeg_decdata *decdata;
 	int i=0, j=0, m=0, tac=0, tdc=0;
 	int intwidth=0, intheight=0;
-	int mcusx=0, mcusy=0, mx=0, my=0;
-	int ypitch=0 ,xpitch=0,bpp=0,pitch=0,x=0,y=0;
+	int mcusx=0, mcusy=0;
+	int x=0, y=0;
 	int mb=0;
 	int max[6];
-	ftopict convert;
 	int err = 0;
 	int isInitHuffman = 0;
 	decdata = calloc(1, sizeof(struct jpeg_decdata));
@@ -1050,84 +1501,84 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
 		goto error;
 	}
 
-	datap = jpeg_ctx->tmp_frame;
+	codec_data->datap = jpeg_ctx->tmp_frame;
 	/*check SOI (0xFFD8)*/
-	if (getbyte() != 0xff)
+	if (getbyte(codec_data) != 0xff)
 	{
 		err = E_NO_SOI_ERR;
 		goto error;
 	}
-	if (getbyte() != M_SOI)
+	if (getbyte(codec_data) != M_SOI)
 	{
 		err = E_NO_SOI_ERR;
 		goto error;
 	}
 	/*read tables - if exist, up to start frame marker (0xFFC0)*/
-	if (readtables(M_SOF0, &isInitHuffman))
+	if (readtables(codec_data, M_SOF0, &isInitHuffman))
 	{
 		err = E_BAD_TABLES_ERR;
 		goto error;
 	}
-	getword();     /*header lenght*/
-	i = getbyte(); /*precision (8 bit)*/
+	getword(codec_data);     /*header lenght*/
+	i = getbyte(codec_data); /*precision (8 bit)*/
 	if (i != 8)
 	{
 		err = E_NOT_8BIT_ERR;
 		goto error;
 	}
-	intheight = getword(); /*height*/
-	intwidth = getword();  /*width */
+	intheight = getword(codec_data); /*height*/
+	intwidth = getword(codec_data);  /*width */
 
 	if ((intheight & 7) || (intwidth & 7)) /*must be even*/
 	{
 		err = E_BAD_WIDTH_OR_HEIGHT_ERR;
 		goto error;
 	}
-	info.nc = getbyte(); /*number of components*/
-	if (info.nc > MAXCOMP)
+	codec_data->info.nc = getbyte(codec_data); /*number of components*/
+	if (codec_data->info.nc > MAXCOMP)
 	{
 		err = E_TOO_MANY_COMPPS_ERR;
 		goto error;
 	}
 	/*for each component*/
-	for (i = 0; i < info.nc; i++)
+	for (i = 0; i < codec_data->info.nc; i++)
 	{
 		int h, v;
-		comps[i].cid = getbyte(); /*component id*/
-		comps[i].hv = getbyte();
-		v = comps[i].hv & 15; /*vertical sampling   */
-		h = comps[i].hv >> 4; /*horizontal sampling */
-		comps[i].tq = getbyte(); /*quantization table used*/
+		codec_data->comps[i].cid = getbyte(codec_data); /*component id*/
+		codec_data->comps[i].hv = getbyte(codec_data);
+		v = codec_data->comps[i].hv & 15; /*vertical sampling   */
+		h = codec_data->comps[i].hv >> 4; /*horizontal sampling */
+		codec_data->comps[i].tq = getbyte(codec_data); /*quantization table used*/
 		if (h > 3 || v > 3)
 		{
 			err = E_ILLEGAL_HV_ERR;
 			goto error;
 		}
-		if (comps[i].tq > 3)
+		if (codec_data->comps[i].tq > 3)
 		{
 			err = E_QUANT_TBL_SEL_ERR;
 			goto error;
 		}
 	}
 	/*read tables - if exist, up to start of scan marker (0xFFDA)*/
-	if (readtables(M_SOS,&isInitHuffman))
+	if (readtables(codec_data, M_SOS,&isInitHuffman))
 	{
 		err = E_BAD_TABLES_ERR;
 		goto error;
 	}
-	getword(); /* header lenght */
-	info.ns = getbyte(); /* number of scans */
-	if (!info.ns)
+	getword(codec_data); /* header lenght */
+	codec_data->info.ns = getbyte(codec_data); /* number of scans */
+	if (!codec_data->info.ns)
 	{
-		printf("V4L2_CORE: (jpeg decoder) info ns %d/n",info.ns);
+		printf("V4L2_CORE: (jpeg decoder) info ns %d/n",codec_data->info.ns);
 		err = E_NOT_YCBCR_ERR;
 		goto error;
 	}
 	/*for each scan*/
-	for (i = 0; i < info.ns; i++)
+	for (i = 0; i < codec_data->info.ns; i++)
 	{
-		dscans[i].cid = getbyte(); /*component id*/
-		tdc = getbyte();
+		codec_data->dscans[i].cid = getbyte(codec_data); /*component id*/
+		tdc = getbyte(codec_data);
 		tac = tdc & 15; /*ac table*/
 		tdc >>= 4;      /*dc table*/
 		if (tdc > 1 || tac > 1)
@@ -1135,43 +1586,44 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
 			err = E_QUANT_TBL_SEL_ERR;
 			goto error;
 		}
-		for (j = 0; j < info.nc; j++)
-			if (comps[j].cid == dscans[i].cid)
+		for (j = 0; j < codec_data->info.nc; j++)
+			if (codec_data->comps[j].cid == codec_data->dscans[i].cid)
 				break;
-		if (j == info.nc)
+		if (j == codec_data->info.nc)
 		{
 			err = E_UNKNOWN_CID_ERR;
 			goto error;
 		}
-		dscans[i].hv = comps[j].hv;
-		dscans[i].tq = comps[j].tq;
-		dscans[i].hudc.dhuff = dec_huffdc + tdc;
-		dscans[i].huac.dhuff = dec_huffac + tac;
+		codec_data->dscans[i].hv = codec_data->comps[j].hv;
+		codec_data->dscans[i].tq = codec_data->comps[j].tq;
+		codec_data->dscans[i].hudc.dhuff = dec_huffdc(codec_data) + tdc;
+		codec_data->dscans[i].huac.dhuff = dec_huffac(codec_data) + tac;
 	}
 
-	i = getbyte(); /*0 */
-	j = getbyte(); /*63*/
-	m = getbyte(); /*0 */
+	i = getbyte(codec_data); /*0 */
+	j = getbyte(codec_data); /*63*/
+	m = getbyte(codec_data); /*0 */
 
 	if (i != 0 || j != 63 || m != 0)
 	{
 		fprintf(stderr, "V4L2_CORE: (jpeg decoder) FW error,not seq DCT ??\n");
 	}
 
-	/*build huffman tables*/
-	if(!isInitHuffman)
+	/*build huffman tables (default tables are kept between frames)*/
+	if(!isInitHuffman && !codec_data->huffman_default)
 	{
-		if(huffman_init() < 0)
+		if(huffman_init(codec_data) < 0)
 			return E_BAD_TABLES_ERR;
+		codec_data->huffman_default = 1;
 	}
 	/*
-	if (dscans[0].cid != 1 || dscans[1].cid != 2 || dscans[2].cid != 3)
+	if (codec_data->dscans[0].cid != 1 || codec_data->dscans[1].cid != 2 || codec_data->dscans[2].cid != 3)
 	{
 		err = ERR_NOT_YCBCR_221111;
 		goto error;
 	}
 
-	if (dscans[1].hv != 0x11 || dscans[2].hv != 0x11)
+	if (codec_data->dscans[1].hv != 0x11 || codec_data->dscans[2].hv != 0x11)
 	{
 		err = ERR_NOT_YCBCR_221111;
 		goto error;
@@ -1196,45 +1648,25 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
 	//	}
 	//}
 
-	switch (dscans[0].hv)
+	switch (codec_data->dscans[0].hv)
 	{
-		case 0x22: // 411
+		case 0x22: // 420
 			mb=6;
 			mcusx = jpeg_ctx->width >> 4;
 			mcusy = jpeg_ctx->height >> 4;
-			bpp=2;
-			xpitch = 16 * bpp;
-			pitch = jpeg_ctx->width * bpp; // YUYV out
-			ypitch = 16 * pitch;
-			convert = yuv420pto422; //choose the right conversion function
 			break;
 		case 0x21: //422
 			mb=4;
 			mcusx = jpeg_ctx->width >> 4;
 			mcusy = jpeg_ctx->height >> 3;
-			bpp=2;
-			xpitch = 16 * bpp;
-			pitch = jpeg_ctx->width * bpp; // YUYV out
-			ypitch = 8 * pitch;
-			convert = yuv422pto422; //choose the right conversion function
 			break;
 		case 0x11: //444
 			mcusx = jpeg_ctx->width >> 3;
 			mcusy = jpeg_ctx->height >> 3;
-			bpp=2;
-			xpitch = 8 * bpp;
-			pitch = jpeg_ctx->width * bpp; // YUYV out
-			ypitch = 8 * pitch;
-			if (info.ns==1)
-			{
-				mb = 1;
-				convert = yuv400pto422; //choose the right conversion function
-			}
+			if (codec_data->info.ns==1)
+				mb = 1; //grayscale
 			else
-			{
 				mb=3;
-				convert = yuv444pto422; //choose the right conversion function
-			}
 			break;
 		default:
 			err = E_NOT_YCBCR_ERR;
@@ -1242,81 +1674,102 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
 			break;
 	}
 
-	idctqtab(quant[dscans[0].tq], decdata->dquant[0]);
-	idctqtab(quant[dscans[1].tq], decdata->dquant[1]);
-	idctqtab(quant[dscans[2].tq], decdata->dquant[2]);
-	setinput(&inp, datap);
-	dec_initscans();
+	setinput(&codec_data->inp, codec_data->datap);
+	dec_initscans(codec_data);
+
+	codec_data->dscans[0].next = 2;
+	codec_data->dscans[1].next = 1;
+	codec_data->dscans[2].next = 0;	/* 4xx encoding */
+
+	mcu_job_t job;
+	memset(&job, 0, sizeof(mcu_job_t));
+	job.jpeg_ctx = jpeg_ctx;
+	job.codec_data = codec_data;
+	job.quant[0] = codec_data->quant[codec_data->dscans[0].tq];
+	job.quant[1] = codec_data->quant[codec_data->dscans[1].tq];
+	job.quant[2] = codec_data->quant[codec_data->dscans[2].tq];
+	job.idct = get_idct_kernel();
+	job.out_buf = out_buf;
+	job.out_u = out_buf + jpeg_ctx->width * jpeg_ctx->height;
+	job.out_v = job.out_u + (jpeg_ctx->width * jpeg_ctx->height) / 4;
+	job.mb = mb;
+	job.mcusx = mcusx;
+	job.nmcus = mcusx * mcusy;
+	job.pitch = jpeg_ctx->width;
+
+	if(jpeg_ctx->scale > 0)
+	{
+		/*reduced size decoding (DCT domain downscaling)*/
+		job.n = 8 >> jpeg_ctx->scale;
+		job.nluma = (mb == 1) ? 1 : mb - 2; /*luma blocks in mcu*/
+		job.hv = (mb == 1) ? 0x11 : codec_data->dscans[0].hv;
+	}
+	else if (mb == 1)
+	{
+		/*grayscale: neutral chroma*/
+		memset(job.out_u, 128, (jpeg_ctx->width * jpeg_ctx->height) / 2);
+	}
+
+	/*
+	 * restart segments are independent (dc predictors are reset and
+	 * the entropy data is byte aligned at each RSTn marker):
+	 * index the markers and decode the segments in parallel
+	 */
+	int nsegments = 0;
+	if (codec_data->info.dri > 0 && thread_pool_get_threads() > 1)
+		nsegments = index_restart_segments(codec_data, jpeg_ctx->tmp_frame + size,
+			(job.nmcus + codec_data->info.dri - 1) / codec_data->info.dri);
 
-	dscans[0].next = 2;
-	dscans[1].next = 1;
-	dscans[2].next = 0;	/* 4xx encoding */
-	for (my = 0,y=0; my < mcusy; my++,y+=ypitch)
+	if (nsegments > 1)
 	{
-		for (mx = 0,x=0; mx < mcusx; mx++,x+=xpitch)
+		int min_segments = JPEG_MIN_BAND_MCUS / codec_data->info.dri;
+		if (min_segments < 1)
+			min_segments = 1;
+
+		job.segments = codec_data->segments;
+		parallel_for_rows(nsegments, 1, min_segments, decode_restart_segments, &job);
+	}
+	else
+	{
+		for (i = 0; i < job.nmcus; i++)
 		{
-			if (info.dri && !--info.nm)
-				if (dec_checkmarker())
+			if (codec_data->info.dri && !--codec_data->info.nm)
+				if (dec_checkmarker(codec_data))
 				{
 					err = E_WRONG_MARKER_ERR;
 					goto error;
 				}
-			switch (mb)
-			{
-				case 6:
-					decode_mcus(&inp, decdata->dcts, mb, dscans, max);
-					idct(decdata->dcts, decdata->out, decdata->dquant[0],
-						IFIX(128.5), max[0]);
-					idct(decdata->dcts + 64, decdata->out + 64,
-						decdata->dquant[0], IFIX(128.5), max[1]);
-					idct(decdata->dcts + 128, decdata->out + 128,
-						decdata->dquant[0], IFIX(128.5), max[2]);
-					idct(decdata->dcts + 192, decdata->out + 192,
-						decdata->dquant[0], IFIX(128.5), max[3]);
-					idct(decdata->dcts + 256, decdata->out + 256,
-						decdata->dquant[1], IFIX(0.5), max[4]);
-					idct(decdata->dcts + 320, decdata->out + 320,
-						decdata->dquant[2], IFIX(0.5), max[5]);
-					break;
-
-				case 4:
-					decode_mcus(&inp, decdata->dcts, mb, dscans, max);
-					idct(decdata->dcts, decdata->out, decdata->dquant[0],
-						IFIX(128.5), max[0]);
-					idct(decdata->dcts + 64, decdata->out + 64,
-						decdata->dquant[0], IFIX(128.5), max[1]);
-					idct(decdata->dcts + 128, decdata->out + 256,
-							decdata->dquant[1], IFIX(0.5), max[4]);
-					idct(decdata->dcts + 192, decdata->out + 320,
-						decdata->dquant[2], IFIX(0.5), max[5]);
-					break;
-
-				case 3:
-					decode_mcus(&inp, decdata->dcts, mb, dscans, max);
-					idct(decdata->dcts, decdata->out, decdata->dquant[0],
-						IFIX(128.5), max[0]);
-					idct(decdata->dcts + 64, decdata->out + 256,
-						decdata->dquant[1], IFIX(0.5), max[4]);
-					idct(decdata->dcts + 128, decdata->out + 320,
-						decdata->dquant[2], IFIX(0.5), max[5]);
-					break;
-
-				case 1:
-					decode_mcus(&inp, decdata->dcts, mb, dscans, max);
-					idct(decdata->dcts, decdata->out, decdata->dquant[0],
-						IFIX(128.5), max[0]);
-					break;
-			} // switch enc411
-			convert(decdata->out, out_buf+y+x, pitch); //convert to 422
+
+			decode_mcu(&job, &codec_data->inp, codec_data->dscans, decdata->dcts, decdata->out, max, i);
+		}
+
+		m = dec_readmarker(&codec_data->inp);
+		if (m != M_EOI)
+		{
+			err = E_NO_EOI_ERR;
+			goto error;
 		}
 	}
 
-	m = dec_readmarker(&inp);
-	if (m != M_EOI)
+	if(jpeg_ctx->scale > 0)
 	{
-		err = E_NO_EOI_ERR;
-		goto error;
+		/*subsample u and v (2x2 average) to yu12*/
+		int ow = jpeg_ctx->width >> jpeg_ctx->scale;
+		int oh = jpeg_ctx->height >> jpeg_ctx->scale;
+		uint8_t *pu = out_buf + ow * oh;
+		uint8_t *pv = pu + (ow * oh) / 4;
+		for (y = 0; y < oh; y += 2)
+		{
+			uint8_t *u0 = jpeg_ctx->tmp_u + y * ow;
+			uint8_t *v0 = jpeg_ctx->tmp_v + y * ow;
+			for (x = 0; x < ow; x += 2)
+			{
+				*pu++ = (u0[x] + u0[x + 1] + u0[x + ow] + u0[x + ow + 1] + 2) >> 2;
+				*pv++ = (v0[x] + v0[x + 1] + v0[x + ow] + v0[x + ow + 1] + 2) >> 2;
+			}
+		}
 	}
+
 	free(decdata);
 	return 0;
 error:
@@ -1325,24 +1778,27 @@ error:
 }
 
 /*
- * close (m)jpeg decoder context
+ * free a (m)jpeg decoder context
  * args:
- *    none
+ *    jpeg_ctx - pointer to decoder context (can be null)
  *
  * asserts:
  *    none
  *
  * returns: none
  */
-void jpeg_close_decoder()
+void jpeg_destroy_context(jpeg_decoder_context_t *jpeg_ctx)
 {
 	if(jpeg_ctx == NULL)
 		return;
 	
 	free(jpeg_ctx->tmp_frame);
+	free(jpeg_ctx->tmp_u);
+	free(jpeg_ctx->tmp_v);
+	if(jpeg_ctx->codec_data)
+		free(((codec_data_t *) jpeg_ctx->codec_data)->segments);
+	free(jpeg_ctx->codec_data);
 	free(jpeg_ctx);
-
-	jpeg_ctx = NULL;
 }
 
 #else  //use libavcodec to decode mjpeg data
@@ -1366,6 +1822,22 @@ void jpeg_close_decoder()
 	#define AV_CODEC_ID_MJPEG CODEC_ID_MJPEG
 #endif
 
+#define LIBAVUTIL_VER_AT_LEAST(major,minor)  (LIBAVUTIL_VERSION_MAJOR > major || \
+                                              (LIBAVUTIL_VERSION_MAJOR == major && \
+                                               LIBAVUTIL_VERSION_MINOR >= minor))
+
+#if !LIBAVUTIL_VER_AT_LEAST(52,0)
+	#define AV_PIX_FMT_YUV420P  PIX_FMT_YUV420P
+	#define AV_PIX_FMT_YUVJ420P PIX_FMT_YUVJ420P
+	#define AV_PIX_FMT_YUV422P  PIX_FMT_YUV422P
+	#define AV_PIX_FMT_YUVJ422P PIX_FMT_YUVJ422P
+	#define AV_PIX_FMT_YUV444P  PIX_FMT_YUV444P
+	#define AV_PIX_FMT_YUVJ444P PIX_FMT_YUVJ444P
+	#define AV_PIX_FMT_YUV440P  PIX_FMT_YUV440P
+	#define AV_PIX_FMT_YUVJ440P PIX_FMT_YUVJ440P
+	#define AV_PIX_FMT_GRAY8    PIX_FMT_GRAY8
+#endif
+
 typedef struct _codec_data_t
 {
 	AVCodec *codec;
@@ -1374,7 +1846,76 @@ typedef struct _codec_data_t
 } codec_data_t;
 
 /*
- * init (m)jpeg decoder context
+ * convert a decoded picture to yu12 straight from the picture planes
+ *  (honors the picture line sizes, 4:2:0 planes are copied as they are)
+ * args:
+ *    picture - pointer to decoded picture
+ *    pix_fmt - decoded picture pixel format
+ *    out_buf - pointer to yu12 output buffer
+ *    width - picture width
+ *    height - picture height
+ *
+ * asserts:
+ *    none
+ *
+ * returns: error code (E_OK, E_FORMAT_ERR for unsupported pixel formats)
+ */
+static int picture_to_yu12(AVFrame *picture, int pix_fmt, uint8_t *out_buf, int width, int height)
+{
+	uint8_t *out[3];
+	int out_stride[3];
+	yu12_get_planes(out_buf, width, height, out, out_stride);
+
+	int hshift = 1; /*chroma subsampling (log2)*/
+	int vshift = 1;
+
+	switch(pix_fmt)
+	{
+		case AV_PIX_FMT_YUV420P:
+		case AV_PIX_FMT_YUVJ420P:
+			break;
+
+		case AV_PIX_FMT_YUV422P:
+		case AV_PIX_FMT_YUVJ422P:
+			vshift = 0;
+			break;
+
+		case AV_PIX_FMT_YUV444P:
+		case AV_PIX_FMT_YUVJ444P:
+			hshift = 0;
+			vshift = 0;
+			break;
+
+		case AV_PIX_FMT_YUV440P:
+		case AV_PIX_FMT_YUVJ440P:
+			hshift = 0;
+			break;
+
+		case AV_PIX_FMT_GRAY8:
+		{
+			int line = 0;
+			for(line = 0; line < height; ++line)
+				memcpy(out[0] + (line * out_stride[0]),
+					picture->data[0] + (line * picture->linesize[0]), width);
+			/*neutral chroma*/
+			memset(out[1], 128, (width * height) / 2);
+			return E_OK;
+		}
+
+		default:
+			fprintf(stderr, "V4L2_CORE: (jpeg decoder) unsupported output pixel format (%i)\n", pix_fmt);
+			return E_FORMAT_ERR;
+	}
+
+	yuv_planar_to_yu12_stride(out, out_stride, picture->data, picture->linesize,
+		width, height, hshift, vshift);
+
+	return E_OK;
+}
+
+/*
+ * create a (m)jpeg decoder context
+ *  (each thread decoding concurrently needs its own context)
  * args:
  *    width - image width
  *    height - image height
@@ -1382,9 +1923,9 @@ typedef struct _codec_data_t
  * asserts:
  *    none
  *
- * returns: error code (0 - E_OK)
+ * returns: pointer to decoder context (NULL on error)
  */
-int jpeg_init_decoder(int width, int height)
+jpeg_decoder_context_t *jpeg_create_scaled_context(int width, int height, int scale)
 {
 #if !LIBAVCODEC_VER_AT_LEAST(53,34)
 	avcodec_init();
@@ -1396,20 +1937,17 @@ int jpeg_init_decoder(int width, int height)
 	avcodec_register_all();
 	av_log_set_level(AV_LOG_PANIC);
 
-	if(jpeg_ctx != NULL)
-		jpeg_close_decoder();
-
-	jpeg_ctx = calloc(1, sizeof(jpeg_decoder_context_t));
+	jpeg_decoder_context_t *jpeg_ctx = calloc(1, sizeof(jpeg_decoder_context_t));
 	if(jpeg_ctx == NULL)
 	{
-		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_init_decoder): %s\n", strerror(errno));
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_create_context): %s\n", strerror(errno));
 		exit(-1);
 	}
 	
 	codec_data_t *codec_data = calloc(1, sizeof(codec_data_t));
 	if(codec_data == NULL)
 	{
-		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_init_decoder): %s\n", strerror(errno));
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_create_context): %s\n", strerror(errno));
 		exit(-1);
 	}
 	
@@ -1419,8 +1957,7 @@ int jpeg_init_decoder(int width, int height)
 		fprintf(stderr, "V4L2_CORE: (mjpeg decoder) codec not found\n");
 		free(jpeg_ctx);
 		free(codec_data);
-		jpeg_ctx = NULL;
-		return E_NO_CODEC;
+		return NULL;
 	}
 
 #if LIBAVCODEC_VER_AT_LEAST(53,6)
@@ -1439,8 +1976,20 @@ int jpeg_init_decoder(int width, int height)
 	codec_data->context->pix_fmt = PIX_FMT_YUV422P;
 	codec_data->context->width = width;
 	codec_data->context->height = height;
+	/*reduced size decoding (DCT domain downscaling)*/
+	jpeg_ctx->scale = jpeg_clamp_scale(width, height, scale);
+	codec_data->context->lowres = jpeg_ctx->scale;
 	//jpeg_ctx->context->dsp_mask = (FF_MM_MMX | FF_MM_MMXEXT | FF_MM_SSE);
 
+#if LIBAVCODEC_VER_AT_LEAST(53,6)
+	/*decoder threads (0 - one per online cpu)*/
+	int thread_type = 0;
+	codec_data->context->thread_count = get_codec_threads(&thread_type);
+	codec_data->context->thread_type =
+		((thread_type & CODEC_THREAD_SLICE) ? FF_THREAD_SLICE : 0) |
+		((thread_type & CODEC_THREAD_FRAME) ? FF_THREAD_FRAME : 0);
+#endif
+
 #if LIBAVCODEC_VER_AT_LEAST(53,6)
 	if (avcodec_open2(codec_data->context, codec_data->codec, NULL) < 0)
 #else
@@ -1452,8 +2001,7 @@ int jpeg_init_decoder(int width, int height)
 		free(codec_data->context);
 		free(codec_data);
 		free(jpeg_ctx);
-		jpeg_ctx = NULL;
-		return E_NO_CODEC;
+		return NULL;
 	}
 
 #if LIBAVCODEC_VER_AT_LEAST(55,28)
@@ -1464,25 +2012,19 @@ int jpeg_init_decoder(int width, int height)
 	avcodec_get_frame_defaults(codec_data->picture);
 #endif
 
-	/*alloc temp buffer*/
-	jpeg_ctx->tmp_frame = calloc(width*height*2, sizeof(uint8_t));
-	if(jpeg_ctx->tmp_frame == NULL)
-	{
-		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (jpeg_init_decoder): %s\n", strerror(errno));
-		exit(-1);
-	}
-	
-	jpeg_ctx->pic_size = avpicture_get_size(codec_data->context->pix_fmt, width, height);
+	/*yu12 output (converted from the decoded picture planes)*/
+	jpeg_ctx->pic_size = ((width >> jpeg_ctx->scale) * (height >> jpeg_ctx->scale) * 3) / 2;
 	jpeg_ctx->width = width;
 	jpeg_ctx->height = height;
 	jpeg_ctx->codec_data = codec_data;
 
-	return E_OK;
+	return jpeg_ctx;
 }
 
 /*
  * decode (m)jpeg frame
  * args:
+ *    jpeg_ctx - pointer to decoder context
  *    out_buf - pointer to decoded data
  *    in_buf - pointer to h264 data
  *    size - in_buf size
@@ -1494,7 +2036,7 @@ int jpeg_init_decoder(int width, int height)
  *
  * returns: decoded data size
  */
-int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
+int jpeg_decode_context(jpeg_decoder_context_t *jpeg_ctx, uint8_t *out_buf, uint8_t *in_buf, int size)
 {
 	/*asserts*/
 	assert(jpeg_ctx != NULL);
@@ -1521,29 +2063,31 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
 
 	if(got_picture)
 	{
-		avpicture_layout((AVPicture *) codec_data->picture, codec_data->context->pix_fmt, 
-			jpeg_ctx->width, jpeg_ctx->height, jpeg_ctx->tmp_frame, jpeg_ctx->pic_size);
-		/* libavcodec output is in yuv422p */
-        yuv422p_to_yu12(out_buf, jpeg_ctx->tmp_frame, jpeg_ctx->width, jpeg_ctx->height);
-	
+		int ow = jpeg_ctx->width >> jpeg_ctx->scale;
+		int oh = jpeg_ctx->height >> jpeg_ctx->scale;
+		int ret = picture_to_yu12(codec_data->picture, codec_data->context->pix_fmt,
+			out_buf, ow, oh);
+		if(ret != E_OK)
+			return ret;
+
 		return jpeg_ctx->pic_size;
 	}
 	else
-		return 0;
+		return 0; /*no picture yet (frame threading delay)*/
 
 }
 
 /*
- * close (m)jpeg decoder context
+ * free a (m)jpeg decoder context
  * args:
- *    none
+ *    jpeg_ctx - pointer to decoder context (can be null)
  *
  * asserts:
  *    none
  *
  * returns: none
  */
-void jpeg_close_decoder()
+void jpeg_destroy_context(jpeg_decoder_context_t *jpeg_ctx)
 {
 	if(jpeg_ctx == NULL)
 		return;
@@ -1569,10 +2113,178 @@ void jpeg_close_decoder()
 		
 	free(codec_data);
 	free(jpeg_ctx);
-
-	jpeg_ctx = NULL;
 }
 
 #endif
 
+/*
+ * set the libavcodec decoders threading (mjpeg and h264)
+ * args:
+ *    nthreads - number of threads (0 - one per online cpu, 1 - no threading)
+ *    type - allowed threading (CODEC_THREAD_ flags)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void set_codec_threads(int nthreads, int type)
+{
+	codec_threads = (nthreads < 0) ? 0 : nthreads;
+	codec_thread_type = type & (CODEC_THREAD_SLICE | CODEC_THREAD_FRAME);
+}
+
+/*
+ * get the libavcodec decoders threading (mjpeg and h264)
+ * args:
+ *    type - pointer to allowed threading (CODEC_THREAD_ flags - to be filled)
+ *
+ * asserts:
+ *    type is not null
+ *
+ * returns: number of threads (0 - one per online cpu)
+ */
+int get_codec_threads(int *type)
+{
+	/*asserts*/
+	assert(type != NULL);
+
+	*type = codec_thread_type;
+	return codec_threads;
+}
+
+/*
+ * get the usable reduced size decoding scale for a frame size
+ *  (scaled width and height must be even and exact)
+ * args:
+ *    width - image width
+ *    height - image height
+ *    scale - requested scale (0 - 1:1, 1 - 1:2, 2 - 1:4, 3 - 1:8)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: largest scale <= requested scale that fits the frame size
+ */
+int jpeg_clamp_scale(int width, int height, int scale)
+{
+	if(scale > 3)
+		scale = 3;
+
+	while(scale > 0 &&
+		((width & ((2 << scale) - 1)) || (height & ((2 << scale) - 1))))
+		scale--;
+
+	return (scale < 0) ? 0 : scale;
+}
+
+/*
+ * create a (m)jpeg decoder context
+ *  (each thread decoding concurrently needs its own context)
+ * args:
+ *    width - image width
+ *    height - image height
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to decoder context (NULL on error)
+ */
+jpeg_decoder_context_t *jpeg_create_context(int width, int height)
+{
+	return jpeg_create_scaled_context(width, height, 0);
+}
+
+/*
+ * get the decoder output size
+ * args:
+ *    jpeg_ctx - pointer to decoder context
+ *    width - pointer to output width (to be filled)
+ *    height - pointer to output height (to be filled)
+ *
+ * asserts:
+ *    jpeg_ctx is not null
+ *
+ * returns: none
+ */
+void jpeg_get_output_size(jpeg_decoder_context_t *jpeg_ctx, int *width, int *height)
+{
+	/*asserts*/
+	assert(jpeg_ctx != NULL);
+
+	if(width)
+		*width = jpeg_ctx->width >> jpeg_ctx->scale;
+	if(height)
+		*height = jpeg_ctx->height >> jpeg_ctx->scale;
+}
+
+/*
+ * init (m)jpeg decoder context
+ * args:
+ *    vd - pointer to v4l2 device handler
+ *    width - image width
+ *    height - image height
+ *
+ * asserts:
+ *    vd is not null
+ *
+ * returns: error code (0 - E_OK)
+ */
+int jpeg_init_decoder(v4l2_dev_t *vd, int width, int height)
+{
+	/*asserts*/
+	assert(vd != NULL);
+
+	if(vd->jpeg_ctx != NULL)
+		jpeg_close_decoder(vd);
+
+	vd->jpeg_ctx = jpeg_create_context(width, height);
+	if(vd->jpeg_ctx == NULL)
+		return E_NO_CODEC;
+
+	return E_OK;
+}
+
+/*
+ * jpeg decode
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   out_buf -  pointer to picture data ( decoded image - yu12 format)
+ *   in_buf -  pointer to input data ( compressed jpeg )
+ *   size - picture size
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->jpeg_ctx is not null
+ *   out_buf not null
+ *   in_buf not null
+ *
+ * returns: error code (0 - OK)
+ */
+int jpeg_decode(v4l2_dev_t *vd, uint8_t *out_buf, uint8_t *in_buf, int size)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(vd->jpeg_ctx != NULL);
 
+	return jpeg_decode_context(vd->jpeg_ctx, out_buf, in_buf, size);
+}
+
+/*
+ * close (m)jpeg decoder context
+ * args:
+ *    vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *    vd is not null
+ *
+ * returns: none
+ */
+void jpeg_close_decoder(v4l2_dev_t *vd)
+{
+	/*asserts*/
+	assert(vd != NULL);
+
+	jpeg_destroy_context(vd->jpeg_ctx);
+	vd->jpeg_ctx = NULL;
+}
@@ -28,6 +28,8 @@
 #ifndef JPEG_DECODER_H
 #define JPEG_DECODER_H
 
+#include "gviewv4l2core.h"
+
 #define HEADERFRAME1 0xaf
 
 /*******Error codes *******/
@@ -47,8 +49,11 @@
 #define ERR_BAD_TABLES 14
 #define ERR_DEPTH_MISMATCH 15
 
+typedef struct _jpeg_decoder_context_t jpeg_decoder_context_t;
+
 /*
- * init (m)jpeg decoder context
+ * create a (m)jpeg decoder context
+ *  (each thread decoding concurrently needs its own context)
  * args:
  *    width - image width
  *    height - image height
@@ -56,36 +61,153 @@
  * asserts:
  *    none
  *
+ * returns: pointer to decoder context (NULL on error)
+ */
+jpeg_decoder_context_t *jpeg_create_context(int width, int height);
+
+/*
+ * create a reduced size (m)jpeg decoder context
+ *  decodes to width >> scale x height >> scale using
+ *  DCT domain downscaling (1:8 is DC only)
+ * args:
+ *    width - image width
+ *    height - image height
+ *    scale - output scale (0 - 1:1, 1 - 1:2, 2 - 1:4, 3 - 1:8)
+ *            clamped with jpeg_clamp_scale
+ *
+ * asserts:
+ *    none
+ *
+ * returns: pointer to decoder context (NULL on error)
+ */
+jpeg_decoder_context_t *jpeg_create_scaled_context(int width, int height, int scale);
+
+/*
+ * set the libavcodec decoders threading (mjpeg and h264)
+ * args:
+ *    nthreads - number of threads (0 - one per online cpu, 1 - no threading)
+ *    type - allowed threading (CODEC_THREAD_ flags)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void set_codec_threads(int nthreads, int type);
+
+/*
+ * get the libavcodec decoders threading (mjpeg and h264)
+ * args:
+ *    type - pointer to allowed threading (CODEC_THREAD_ flags - to be filled)
+ *
+ * asserts:
+ *    type is not null
+ *
+ * returns: number of threads (0 - one per online cpu)
+ */
+int get_codec_threads(int *type);
+
+/*
+ * get the usable reduced size decoding scale for a frame size
+ *  (scaled width and height must be even and exact)
+ * args:
+ *    width - image width
+ *    height - image height
+ *    scale - requested scale (0 - 1:1, 1 - 1:2, 2 - 1:4, 3 - 1:8)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: largest scale <= requested scale that fits the frame size
+ */
+int jpeg_clamp_scale(int width, int height, int scale);
+
+/*
+ * get the decoder output size
+ * args:
+ *    jpeg_ctx - pointer to decoder context
+ *    width - pointer to output width (to be filled)
+ *    height - pointer to output height (to be filled)
+ *
+ * asserts:
+ *    jpeg_ctx is not null
+ *
+ * returns: none
+ */
+void jpeg_get_output_size(jpeg_decoder_context_t *jpeg_ctx, int *width, int *height);
+
+/*
+ * jpeg decode
+ * args:
+ *   jpeg_ctx - pointer to decoder context
+ *   out_buf -  pointer to picture data ( decoded image - yu12 format)
+ *   in_buf -  pointer to input data ( compressed jpeg )
+ *   size - picture size
+ *
+ * asserts:
+ *   jpeg_ctx is not null
+ *   out_buf not null
+ *   in_buf not null
+ *
+ * returns: error code (0 - OK)
+ */
+int jpeg_decode_context(jpeg_decoder_context_t *jpeg_ctx, uint8_t *out_buf, uint8_t *in_buf, int size);
+
+/*
+ * free a (m)jpeg decoder context
+ * args:
+ *    jpeg_ctx - pointer to decoder context (can be null)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+void jpeg_destroy_context(jpeg_decoder_context_t *jpeg_ctx);
+
+/*
+ * init (m)jpeg decoder context
+ * args:
+ *    vd - pointer to v4l2 device handler
+ *    width - image width
+ *    height - image height
+ *
+ * asserts:
+ *    vd is not null
+ *
  * returns: error code (0 - E_OK)
  */
-int jpeg_init_decoder(int width, int height);
+int jpeg_init_decoder(v4l2_dev_t *vd, int width, int height);
 
 /*
  * jpeg decode
  * args:
- *   out_buf -  pointer to picture data ( decoded image - yuyv format)
+ *   vd - pointer to v4l2 device handler
+ *   out_buf -  pointer to picture data ( decoded image - yu12 format)
  *   in_buf -  pointer to input data ( compressed jpeg )
  *   size - picture size
  *
  * asserts:
+ *   vd is not null
+ *   vd->jpeg_ctx is not null
  *   out_buf not null
  *   in_buf not null
  *
  * returns: error code (0 - OK)
  */
-int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size);
+int jpeg_decode(v4l2_dev_t *vd, uint8_t *out_buf, uint8_t *in_buf, int size);
 
 /*
  * close (m)jpeg decoder context
  * args:
- *    none
+ *    vd - pointer to v4l2 device handler
  *
  * asserts:
- *    none
+ *    vd is not null
  *
  * returns: none
  */
-void jpeg_close_decoder();
+void jpeg_close_decoder(v4l2_dev_t *vd);
 
 #endif
 
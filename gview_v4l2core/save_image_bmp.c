@@ -160,7 +160,7 @@ int save_image_bmp(v4l2_frame_buff_t *frame, const char *filename)
 		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (save_img_bmp): %s\n", strerror(errno));
 		exit(-1);
 	}
-	yu12_to_dib24(bmp, frame->yuv_frame, width, height);
+	yu12_to_dib24(bmp, v4l2core_frame_get_yuv_packed(frame), width, height);
 
 	ret = save_bmp(filename, bmp, width, height, 24);
 	free(bmp);
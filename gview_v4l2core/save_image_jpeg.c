@@ -1058,7 +1058,7 @@ int save_image_jpeg(v4l2_frame_buff_t *frame, const char *filename)
 	/* Initialization of Quantization Tables  */
 	initialize_quantization_tables (jpeg_ctx);
 
-	int jpeg_size = encode_jpeg(frame->yuv_frame, jpeg, jpeg_ctx, 1);
+	int jpeg_size = encode_jpeg(v4l2core_frame_get_yuv_packed(frame), jpeg, jpeg_ctx, 1);
 
 	if(v4l2core_save_data_to_file(filename, jpeg, jpeg_size))
 	{
@@ -234,7 +234,7 @@ int save_image_png(v4l2_frame_buff_t *frame, const char *filename)
 		exit(-1);
 	}
 
-	yu12_to_rgb24(rgb, frame->yuv_frame, width, height);
+	yu12_to_rgb24(rgb, v4l2core_frame_get_yuv_packed(frame), width, height);
 
 	int ret = save_png(filename, width, height, rgb);
 
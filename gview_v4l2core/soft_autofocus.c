@@ -79,11 +79,9 @@ typedef struct _focus_ctx_t
 	int setFocus;
 	int focus_wait;
 	int last_focus;
+	double sumAC[64];
 } focus_ctx_t;
 
-static focus_ctx_t *focus_ctx = NULL;
-
-static double sumAC[64];
 static int ACweight[64] = {
 	0,1,2,3,4,5,6,7,
 	1,1,2,3,4,5,6,7,
@@ -100,17 +98,21 @@ static int sort_method = AUTOF_SORT_INSERT; /* 1 - Quick sort   2 - Shell sort
 /*
  * sets a focus loop while autofocus is on
  * args:
- *    none
+ *    vd - pointer to device data
  *
  * asserts:
- *    focus_ctx is not null
+ *    vd is not null
+ *    vd->focus_ctx is not null
  *
  * returns: none
  */
-void v4l2core_soft_autofocus_set_focus()
+void v4l2core_soft_autofocus_set_focus(v4l2_dev_t *vd)
 {
 	/*asserts*/
-	assert(focus_ctx != NULL);
+	assert(vd != NULL);
+	assert(vd->focus_ctx != NULL);
+
+	focus_ctx_t *focus_ctx = vd->focus_ctx;
 
 	focus_ctx->setFocus = 1;
 
@@ -157,10 +159,11 @@ int soft_autofocus_init (v4l2_dev_t *vd)
 		return (E_UNKNOWN_CID_ERR);
 	}
 
-	if(focus_ctx != NULL)
-		free(focus_ctx);
+	if(vd->focus_ctx != NULL)
+		free(vd->focus_ctx);
 
-	focus_ctx = calloc(1, sizeof(focus_ctx_t));
+	focus_ctx_t *focus_ctx = calloc(1, sizeof(focus_ctx_t));
+	vd->focus_ctx = focus_ctx;
 	if(focus_ctx == NULL)
 	{
 		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (v4l2core_soft_autofocus_init): %s\n", strerror(errno));
@@ -173,7 +176,7 @@ int soft_autofocus_init (v4l2_dev_t *vd)
 	{
 		fprintf(stderr, "V4L2_CORE: couldn't load focus control for id %x\n", vd->has_focus_control_id);
 		free(focus_ctx);
-		focus_ctx = NULL;
+		vd->focus_ctx = NULL;
 		return(E_UNKNOWN_CID_ERR);
 	}
 
@@ -195,7 +198,7 @@ int soft_autofocus_init (v4l2_dev_t *vd)
 	if (focus_ctx->last_focus < 0)
 		focus_ctx->last_focus = focus_ctx->f_max;
 
-	memset(sumAC, 0, 64*sizeof(*sumAC)); /*reset array to 0*/
+	memset(focus_ctx->sumAC, 0, 64*sizeof(*focus_ctx->sumAC)); /*reset array to 0*/
 
 	return (E_OK);
 }
@@ -204,6 +207,7 @@ int soft_autofocus_init (v4l2_dev_t *vd)
  * quick sort
  * (the fastest and more complex - recursive, doesn't do well on almost sorted data)
  * args:
+ *   focus_ctx - pointer to focus context
  *   left -
  *   right -
  *
@@ -212,7 +216,7 @@ int soft_autofocus_init (v4l2_dev_t *vd)
  *
  * returns: none
  */
-static void q_sort(int left, int right)
+static void q_sort(focus_ctx_t *focus_ctx, int left, int right)
 {
 	/*asserts*/
 	assert(focus_ctx != NULL);
@@ -245,8 +249,8 @@ static void q_sort(int left, int right)
 	focus_ctx->arr_foc[left] = temp;
 	pivot = left;
 
-	if (l_hold < pivot) q_sort(l_hold, pivot-1);
-	if (r_hold > pivot) q_sort(pivot+1, r_hold);
+	if (l_hold < pivot) q_sort(focus_ctx, l_hold, pivot-1);
+	if (r_hold > pivot) q_sort(focus_ctx, pivot+1, r_hold);
 }
 
 /*
@@ -254,6 +258,7 @@ static void q_sort(int left, int right)
  * (based on insert sort, but with some optimization)
  * for small arrays insert sort is still faster
  * args:
+ *    focus_ctx - pointer to focus context
  *    size -
  *
  * asserts:
@@ -261,7 +266,7 @@ static void q_sort(int left, int right)
  *
  * returns: none
  */
-static void s_sort(int size)
+static void s_sort(focus_ctx_t *focus_ctx, int size)
 {
 	/*asserts*/
 	assert(focus_ctx != NULL);
@@ -285,6 +290,7 @@ static void s_sort(int size)
  * insert sort
  * (fastest for small arrays, around 15 elements)
  * args:
+ *    focus_ctx - pointer to focus context
  *    size -
  *
  * asserts:
@@ -292,7 +298,7 @@ static void s_sort(int size)
  *
  * returns: none
  */
-static void i_sort (int size)
+static void i_sort (focus_ctx_t *focus_ctx, int size)
 {
 	/*asserts*/
 	assert(focus_ctx != NULL);
@@ -315,6 +321,7 @@ static void i_sort (int size)
  * it did better than shell or quick sort since focus data is almost
  * sorted)
  * args:
+ *    focus_ctx - pointer to focus context
  *    size -
  *
  * asserts:
@@ -322,7 +329,7 @@ static void i_sort (int size)
  *
  * returns: none
  */
-static void b_sort (int size)
+static void b_sort (focus_ctx_t *focus_ctx, int size)
 {
 	int i, temp, swapped;
 
@@ -345,11 +352,12 @@ static void b_sort (int size)
 /*
  * sort focus values
  * args:
+ *    focus_ctx - pointer to focus context
  *    size - focus array size
  *
  * returns: best focus value
  */
-static int focus_sort(int size)
+static int focus_sort(focus_ctx_t *focus_ctx, int size)
 {
 	if (size>=20)
 	{
@@ -360,20 +368,20 @@ static int focus_sort(int size)
 	switch(sort_method)
 	{
 		case AUTOF_SORT_QUICK:
-			q_sort(0, size);
+			q_sort(focus_ctx, 0, size);
 			break;
 
 		case AUTOF_SORT_SHELL:
-			s_sort(size);
+			s_sort(focus_ctx, size);
 			break;
 
 		case AUTOF_SORT_BUBBLE:
-			b_sort(size);
+			b_sort(focus_ctx, size);
 			break;
 
 		default:
 		case AUTOF_SORT_INSERT:
-			i_sort(size);
+			i_sort(focus_ctx, size);
 			break;
 	}
 
@@ -410,14 +418,14 @@ static int16_t *focus_extract_Y (uint8_t *frame, int16_t *dataY, int width, int
 /*
  * check focus
  * args:
- *    none
+ *    focus_ctx - pointer to focus context
  *
  * asserts:
  *    focus_ctx is not null
  *
  * returns: focus code
  */
-static int checkFocus()
+static int checkFocus(focus_ctx_t *focus_ctx)
 {
 	/*asserts*/
 	assert(focus_ctx != NULL);
@@ -479,6 +487,7 @@ static int checkFocus()
 /*
  * measure sharpness in MCU
  * args:
+ *    focus_ctx - pointer to focus context
  *    data - MCU data [8x8]
  *    weight - MCU weight for sharpness measure.
  *
@@ -487,7 +496,7 @@ static int checkFocus()
  *
  * returns: none
  */
-static void getSharpnessMCU (int16_t *data, double weight)
+static void getSharpnessMCU (focus_ctx_t *focus_ctx, int16_t *data, double weight)
 {
 
 	int i=0;
@@ -500,7 +509,7 @@ static void getSharpnessMCU (int16_t *data, double weight)
 	{
 		for(j=0;j<8;j++)
 		{
-			sumAC[i*8+j]+=data[i*8+j]*data[i*8+j]*weight;
+			focus_ctx->sumAC[i*8+j]+=data[i*8+j]*data[i*8+j]*weight;
 		}
 	}
 }
@@ -508,18 +517,26 @@ static void getSharpnessMCU (int16_t *data, double weight)
 /*
  * sharpness in focus window
  * args:
+ *    vd - pointer to device data
  *    frame - pointer to image frame
  *    width - frame width
  *    height - frame height
  *    t - highest order coef
  *
  * asserts:
- *    none
+ *    vd is not null
+ *    vd->focus_ctx is not null
  *
  * returns: sharpness value
  */
-int soft_autofocus_get_sharpness (uint8_t *frame, int width, int height, int t)
+int soft_autofocus_get_sharpness (v4l2_dev_t *vd, uint8_t *frame, int width, int height, int t)
 {
+	/*asserts*/
+	assert(vd != NULL);
+	assert(vd->focus_ctx != NULL);
+
+	focus_ctx_t *focus_ctx = vd->focus_ctx;
+
 	float res=0;
 	int numMCUx = width/(8*2); /*covers 1/2 of width - width should be even*/
 	int numMCUy = height/(8*2); /*covers 1/2 of height- height should be even*/
@@ -567,7 +584,7 @@ int soft_autofocus_get_sharpness (uint8_t *frame, int width, int height, int t)
 						+(((width-(numMCUx-(xp*2))*8)>>1)+j)];
 				}
 			}
-			getSharpnessMCU(data,weight);
+			getSharpnessMCU(focus_ctx, data, weight);
 			cnt2++;
 		}
 	}
@@ -578,8 +595,8 @@ int soft_autofocus_get_sharpness (uint8_t *frame, int width, int height, int t)
 	{
 		for(j=0;j<t;j++)
 		{
-			sumAC[i*8+j]/=(double) (cnt2); /*average = mean*/
-			res+=sumAC[i*8+j]*ACweight[i*8+j];
+			focus_ctx->sumAC[i*8+j]/=(double) (cnt2); /*average = mean*/
+			res+=focus_ctx->sumAC[i*8+j]*ACweight[i*8+j];
 		}
 	}
 	return (roundf(res*10)); /*round to int (4 digit precision)*/
@@ -588,15 +605,22 @@ int soft_autofocus_get_sharpness (uint8_t *frame, int width, int height, int t)
 /*
  * get focus value
  * args:
- *    none
+ *    vd - pointer to device data
  *
  * asserts:
- *    focus_ctx is not null
+ *    vd is not null
+ *    vd->focus_ctx is not null
  *
  * returns: focus code
  */
-int soft_autofocus_get_focus_value()
+int soft_autofocus_get_focus_value(v4l2_dev_t *vd)
 {
+	/*asserts*/
+	assert(vd != NULL);
+	assert(vd->focus_ctx != NULL);
+
+	focus_ctx_t *focus_ctx = vd->focus_ctx;
+
 	int step = focus_ctx->i_step * 2;
 	int step2 = focus_ctx->i_step / 2;
 	if (step2 <= 0 ) step2 = 1;
@@ -617,7 +641,7 @@ int soft_autofocus_get_focus_value()
 			/*reached max focus value*/
 			if (focus_ctx->focus >= focus_ctx->right )
 			{	/*get left and right from arr_sharp*/
-				focus = focus_sort(focus_ctx->ind);
+				focus = focus_sort(focus_ctx, focus_ctx->ind);
 				/*get a window around the best value*/
 				focus_ctx->left = (focus- step/2);
 				focus_ctx->right = (focus + step/2);
@@ -641,7 +665,7 @@ int soft_autofocus_get_focus_value()
 			/*reached window max focus*/
 			if (focus_ctx->focus >= focus_ctx->right )
 			{	/*get left and right from arr_sharp*/
-				focus = focus_sort(focus_ctx->ind);
+				focus = focus_sort(focus_ctx, focus_ctx->ind);
 				/*get the best value*/
 				focus_ctx->focus = focus;
 				focus_ctx->focus_sharpness = focus_ctx->arr_sharp[focus_ctx->ind];
@@ -689,7 +713,7 @@ int soft_autofocus_get_focus_value()
 			/*track focus*/
 			focus_ctx->sharpLeft=focus_ctx->sharpness;
 			int ret=0;
-			ret = checkFocus();
+			ret = checkFocus(focus_ctx);
 
 			switch (ret)
 			{
@@ -770,6 +794,9 @@ int soft_autofocus_run(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 {
 	/*asserts*/
 	assert(vd != NULL);
+	assert(vd->focus_ctx != NULL);
+
+	focus_ctx_t *focus_ctx = vd->focus_ctx;
 
 	if (focus_ctx->focus < 0)
 	{
@@ -790,7 +817,8 @@ int soft_autofocus_run(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 		if (focus_ctx->focus_wait == 0)
 		{
 			focus_ctx->sharpness = soft_autofocus_get_sharpness (
-				frame->yuv_frame,
+				vd,
+				v4l2core_frame_get_yuv_packed(frame),
 				vd->format.fmt.pix.width,
 				vd->format.fmt.pix.height,
 				5);
@@ -805,7 +833,7 @@ int soft_autofocus_run(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 					focus_ctx->ind,
 					focus_ctx->flag);
 
-			focus_ctx->focus = soft_autofocus_get_focus_value();
+			focus_ctx->focus = soft_autofocus_get_focus_value(vd);
 
 			if ((focus_ctx->focus != focus_ctx->last_focus))
 			{
@@ -835,16 +863,19 @@ int soft_autofocus_run(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 /*
  * close and clean software autofocus
  * args:
- *   none
+ *   vd - pointer to device data
  *
  * asserts:
- *   none
+ *   vd is not null
  *
  * returns: none
  */
-void v4l2core_soft_autofocus_close()
+void v4l2core_soft_autofocus_close(v4l2_dev_t *vd)
 {
-	if(focus_ctx != NULL)
-		free(focus_ctx);
-	focus_ctx = NULL;
+	/*asserts*/
+	assert(vd != NULL);
+
+	if(vd->focus_ctx != NULL)
+		free(vd->focus_ctx);
+	vd->focus_ctx = NULL;
 }
@@ -63,28 +63,31 @@ int soft_autofocus_run(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
 /*
  * sharpness in focus window
  * args:
+ *    vd - pointer to device data
  *    frame - pointer to image frame
  *    width - frame width
  *    height - frame height
  *    t - highest order coef
  *
  * asserts:
- *    none
+ *    vd is not null
+ *    vd->focus_ctx is not null
  *
  * returns: sharpness value
  */
-int soft_autofocus_get_sharpness (uint8_t *frame, int width, int height, int t);
+int soft_autofocus_get_sharpness (v4l2_dev_t *vd, uint8_t *frame, int width, int height, int t);
 
 /*
  * get focus value
  * args:
- *    none
+ *    vd - pointer to device data
  *
  * asserts:
- *    focus_ctx is not null
+ *    vd is not null
+ *    vd->focus_ctx is not null
  *
  * returns: focus code
  */
-int soft_autofocus_get_focus_value ();
+int soft_autofocus_get_focus_value (v4l2_dev_t *vd);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - SIMD inverse dct test (make check)                       #
+#                                                                               #
+#  The islow idct kernel dispatched for the running cpu is checked bit exact    #
+#  against the scalar idct of the builtin MJPEG decoder (idct in                #
+#  jpeg_decoder.c) on blocks of quantized random and saturated samples, sparse  #
+#  and dc only blocks.                                                          #
+#                                                                               #
+********************************************************************************/
+
+/*the scalar idct is static - build it in this test*/
+#include "jpeg_decoder.c"
+
+#include <math.h>
+
+int verbosity = 0;
+
+#if MJPG_BUILTIN
+
+#define TEST_BLOCKS  (20000)
+#define TEST_STRIDE  (24) /*output line size: the kernel must only write 8 bytes*/
+#define GUARD_BYTE   (0xA5)
+
+/*
+ * forward dct of a block of samples, quantized and dequantized
+ *  (coefficients of an 8 bit jpeg image)
+ * args:
+ *    samples - pointer to 64 samples
+ *    quant - quantization step (>= 1)
+ *    coef - pointer to 64 dequantized coefficients (natural order)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void fdct_quant(const uint8_t *samples, int quant, int16_t *coef)
+{
+	int u = 0, v = 0, x = 0, y = 0;
+	for(v = 0; v < 8; v++)
+		for(u = 0; u < 8; u++)
+		{
+			double sum = 0;
+			for(y = 0; y < 8; y++)
+				for(x = 0; x < 8; x++)
+					sum += (samples[y * 8 + x] - 128) *
+						cos((2 * x + 1) * u * M_PI / 16) *
+						cos((2 * y + 1) * v * M_PI / 16);
+
+			sum *= ((u ? 1 : M_SQRT1_2) * (v ? 1 : M_SQRT1_2)) / 4;
+			coef[v * 8 + u] = (int16_t) (lrint(sum / quant) * quant);
+		}
+}
+
+/*
+ * build a test block
+ * args:
+ *    type - block type (0 - random samples, 1 - saturated samples,
+ *           2 - sparse, 3 - dc only)
+ *    coef - pointer to 64 dequantized coefficients (natural order)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void test_block(int type, int16_t *coef)
+{
+	uint8_t samples[64];
+	int i = 0;
+
+	switch(type)
+	{
+		case 0:
+			for(i = 0; i < 64; i++)
+				samples[i] = rand() & 0xff;
+			fdct_quant(samples, 1 + rand() % 64, coef);
+			break;
+
+		case 1:
+			/*large coefficients: the output overshoots and clips*/
+			for(i = 0; i < 64; i++)
+				samples[i] = (rand() & 1) ? 0xff : 0;
+			fdct_quant(samples, 1 + rand() % 64, coef);
+			break;
+
+		case 2:
+			memset(coef, 0, 64 * sizeof(int16_t));
+			for(i = 0; i < 1 + rand() % 6; i++)
+				coef[rand() % 64] = (int16_t) ((rand() % 1024) - 512);
+			break;
+
+		default:
+			memset(coef, 0, 64 * sizeof(int16_t));
+			coef[0] = (int16_t) ((rand() % 2048) - 1024);
+			break;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *types[] = {"random", "saturated", "sparse", "dc only"};
+
+	idct_kernel_t kernel = get_idct_kernel();
+
+	if(kernel == NULL)
+	{
+		printf("SKIP: no idct SIMD kernel for this cpu\n");
+		return 77; /*automake skip*/
+	}
+
+	srand(argc > 1 ? atoi(argv[1]) : 4242);
+
+	int fail = 0;
+	int t = 0;
+	for(t = 0; t < (int) (sizeof(types) / sizeof(types[0])); t++)
+	{
+		int tfail = 0;
+		int n = 0;
+		for(n = 0; n < TEST_BLOCKS && !tfail; n++)
+		{
+			int16_t coef[64];
+			uint8_t ref[8 * TEST_STRIDE];
+			uint8_t out[8 * TEST_STRIDE];
+
+			test_block(t, coef);
+
+			memset(ref, GUARD_BYTE, sizeof(ref));
+			memset(out, GUARD_BYTE, sizeof(out));
+
+			idct(coef, ref, TEST_STRIDE);
+			kernel(out, TEST_STRIDE, coef);
+
+			if(memcmp(ref, out, sizeof(ref)) != 0)
+			{
+				int j = 0;
+				while(ref[j] == out[j])
+					j++;
+				fprintf(stderr, "FAIL: %s block %i: sample %i,%i is %i (reference %i)\n",
+					types[t], n, j % TEST_STRIDE, j / TEST_STRIDE, out[j], ref[j]);
+				tfail++;
+			}
+		}
+
+		printf("%s: %s idct blocks (%i blocks, bit exact)\n",
+			tfail ? "FAIL" : "PASS", types[t], n);
+		fail += tfail;
+	}
+
+	return fail ? 1 : 0;
+}
+
+#else /*!MJPG_BUILTIN*/
+
+int main(int argc, char *argv[])
+{
+	printf("SKIP: the builtin MJPEG decoder is disabled (configure --enable-builtin-mjpg)\n");
+	return 77; /*automake skip*/
+}
+
+#endif
@@ -0,0 +1,246 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - packed 4:2:2 to yu12 SIMD kernels test (make check)      #
+#                                                                               #
+#  Every kernel supported by the running cpu (not only the dispatched one) is   #
+#  checked bit exact against the scalar reference (the loop of                  #
+#  packed422_to_yu12_rows in colorspaces.c) for yuyv, yvyu, uyvy and vyuy on    #
+#  random widths, so that the scalar tail is also exercised.                    #
+#                                                                               #
+********************************************************************************/
+
+/*the kernels are static - build them in this test*/
+#include "colorspaces_simd.c"
+
+#include <string.h>
+
+int verbosity = 0;
+
+#define TEST_MAX_WIDTH (1920 + 62)
+#define TEST_WIDTHS    (200)
+#define GUARD_SIZE     (64)
+#define GUARD_BYTE     (0xA5)
+
+typedef struct _test_kernel_t
+{
+	const char *name;
+	packed422_kernel_t kernel;
+} test_kernel_t;
+
+typedef struct _test_layout_t
+{
+	const char *name;
+	int layout;
+} test_layout_t;
+
+static const test_layout_t layouts[] =
+{
+	{"yuyv", 0},
+	{"yvyu", PACKED422_V_FIRST},
+	{"uyvy", PACKED422_Y_ODD},
+	{"vyuy", PACKED422_Y_ODD | PACKED422_V_FIRST},
+};
+
+/*
+ * scalar packed 4:2:2 to yu12 for a pair of lines (reference)
+ * args:
+ *    see packed422_kernel_t
+ *    w - first pixel to convert
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void packed422_scalar(uint8_t *py1, uint8_t *py2,
+	uint8_t *pu, uint8_t *pv,
+	const uint8_t *in1, const uint8_t *in2,
+	int w, int width, int layout)
+{
+	int y0 = (layout & PACKED422_Y_ODD) ? 1 : 0; //first luma byte
+	int c0 = 1 - y0; //first chroma byte
+	int u0 = (layout & PACKED422_V_FIRST) ? c0 + 2 : c0; //u byte
+	int v0 = (layout & PACKED422_V_FIRST) ? c0 : c0 + 2; //v byte
+
+	for(; w < width; w+=2)
+	{
+		const uint8_t *s1 = in1 + (w * 2);
+		const uint8_t *s2 = in2 + (w * 2);
+
+		py1[w] = s1[y0];
+		py1[w + 1] = s1[y0 + 2];
+		py2[w] = s2[y0];
+		py2[w + 1] = s2[y0 + 2];
+		pu[w / 2] = (s1[u0] + s2[u0]) /2;
+		pv[w / 2] = (s1[v0] + s2[v0]) /2;
+	}
+}
+
+/*
+ * check that a buffer guard was not overwritten
+ * args:
+ *    buff - pointer to guard bytes
+ *
+ * asserts:
+ *    none
+ *
+ * returns: 1 if guard is intact, 0 otherwise
+ */
+static int guard_intact(const uint8_t *buff)
+{
+	int i = 0;
+	for(i = 0; i < GUARD_SIZE; ++i)
+		if(buff[i] != GUARD_BYTE)
+			return 0;
+
+	return 1;
+}
+
+/*
+ * run a kernel against the scalar reference for a layout and width
+ * args:
+ *    kernel - pointer to test kernel
+ *    layout - pointer to test layout
+ *    width - line width in pixels (even)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of failures
+ */
+static int test_kernel(const test_kernel_t *kernel, const test_layout_t *layout, int width)
+{
+	static uint8_t in1[TEST_MAX_WIDTH * 2];
+	static uint8_t in2[TEST_MAX_WIDTH * 2];
+	/*output planes (reference and kernel) with trailing guard*/
+	static uint8_t ref[4][TEST_MAX_WIDTH + GUARD_SIZE];
+	static uint8_t out[4][TEST_MAX_WIDTH + GUARD_SIZE];
+
+	int i = 0;
+	for(i = 0; i < width * 2; ++i)
+	{
+		in1[i] = rand() & 0xff;
+		in2[i] = rand() & 0xff;
+	}
+
+	int plane_size[4] = {width, width, width / 2, width / 2};
+	for(i = 0; i < 4; ++i)
+	{
+		memset(ref[i], GUARD_BYTE, sizeof(ref[i]));
+		memset(out[i], GUARD_BYTE, sizeof(out[i]));
+	}
+
+	packed422_scalar(ref[0], ref[1], ref[2], ref[3], in1, in2, 0, width, layout->layout);
+
+	int w = kernel->kernel(out[0], out[1], out[2], out[3], in1, in2, width, layout->layout);
+	if(w < 0 || w > width || (w & 1))
+	{
+		fprintf(stderr, "FAIL: %s %s width %i: kernel returned %i\n",
+			kernel->name, layout->name, width, w);
+		return 1;
+	}
+	/*the caller converts the remaining pixels*/
+	packed422_scalar(out[0], out[1], out[2], out[3], in1, in2, w, width, layout->layout);
+
+	int fail = 0;
+	for(i = 0; i < 4; ++i)
+	{
+		if(memcmp(ref[i], out[i], plane_size[i]) != 0)
+		{
+			int j = 0;
+			while(ref[i][j] == out[i][j])
+				j++;
+			fprintf(stderr, "FAIL: %s %s width %i: plane %i differs at %i (%i != %i)\n",
+				kernel->name, layout->name, width, i, j, out[i][j], ref[i][j]);
+			fail++;
+		}
+		if(!guard_intact(out[i] + plane_size[i]))
+		{
+			fprintf(stderr, "FAIL: %s %s width %i: plane %i written past the line end\n",
+				kernel->name, layout->name, width, i);
+			fail++;
+		}
+	}
+
+	return fail;
+}
+
+int main(int argc, char *argv[])
+{
+	test_kernel_t kernels[4];
+	int nkernels = 0;
+
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse2"))
+	{
+		kernels[nkernels].name = "sse2";
+		kernels[nkernels++].kernel = packed422_to_yu12_sse2;
+	}
+	if(__builtin_cpu_supports("avx2"))
+	{
+		kernels[nkernels].name = "avx2";
+		kernels[nkernels++].kernel = packed422_to_yu12_avx2;
+	}
+#endif
+
+#ifdef SIMD_NEON
+	kernels[nkernels].name = "neon";
+	kernels[nkernels++].kernel = packed422_to_yu12_neon;
+#endif
+
+	if(nkernels == 0)
+	{
+		printf("SKIP: no packed 4:2:2 SIMD kernel for this cpu\n");
+		return 77; /*automake skip*/
+	}
+
+	srand(argc > 1 ? atoi(argv[1]) : 4242);
+
+	/*widths: every tail length of the widest kernel, then random*/
+	int widths[64 + TEST_WIDTHS];
+	int nwidths = 0;
+	int i = 0;
+	for(i = 2; i <= 128; i += 2)
+		widths[nwidths++] = i;
+	for(i = 0; i < TEST_WIDTHS; ++i)
+		widths[nwidths++] = 2 + 2 * (rand() % ((TEST_MAX_WIDTH - 2) / 2));
+
+	int fail = 0;
+	int k = 0;
+	for(k = 0; k < nkernels; ++k)
+	{
+		int kfail = 0;
+		int l = 0;
+		for(l = 0; l < (int) (sizeof(layouts) / sizeof(layouts[0])); ++l)
+			for(i = 0; i < nwidths; ++i)
+				kfail += test_kernel(&kernels[k], &layouts[l], widths[i]);
+
+		printf("%s: %s packed 4:2:2 to yu12 (%i widths x 4 layouts)\n",
+			kfail ? "FAIL" : "PASS", kernels[k].name, nwidths);
+		fail += kfail;
+	}
+
+	return fail ? 1 : 0;
+}
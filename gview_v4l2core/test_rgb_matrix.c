@@ -0,0 +1,286 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - rgb to yu12 fixed point matrix test (make check)         #
+#                                                                               #
+#  The rgb to yu12 converters (SIMD kernels for the running cpu and the scalar  #
+#  tail) are checked against the floating point code they replaced, for the    #
+#  BT.601 and BT.709 matrices. Chroma blocks where the old code clipped a       #
+#  pixel pair before averaging (the fixed point code clips once, after          #
+#  averaging the 2x2 block) are checked against a separate, wider bound.        #
+#                                                                               #
+********************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "gview.h"
+#include "gviewv4l2core.h"
+#include "colorspaces.h"
+
+/*
+ * maximum error (in 8 bit levels) against the floating point code
+ *  the old code truncated (the fixed point code rounds), chroma was
+ *  truncated twice (pixel pairs and their average)
+ */
+#define MAX_LUMA_ERROR   (1)
+#define MAX_CHROMA_ERROR (2)
+
+/*
+ * maximum chroma error for the blocks where the old code clipped a pixel pair:
+ *  a v pair can exceed the 0-255 range by up to ~30 levels with both matrices
+ *  (e.g. BT.601 pure red: 128 + 0.615 * 127 + 0.515 * 128 + 0.100 * 128 = 285),
+ *  the old code dropped that excess before averaging the two pairs, so its
+ *  block average can differ by up to half of it (plus the rounding error)
+ */
+#define MAX_CLIPPED_CHROMA_ERROR (15 + MAX_CHROMA_ERROR)
+
+int verbosity = 0;
+
+/*
+ * floating point rgb to yuv coefficients (previous code)
+ */
+typedef struct _float_matrix_t
+{
+	const char *name;
+	int matrix;     //YUV_MATRIX_
+	double y[3];
+	double u[3];
+	double v[3];
+} float_matrix_t;
+
+static const float_matrix_t matrices[] =
+{
+	{
+		"BT.601", YUV_MATRIX_BT601,
+		{  0.299,    0.587,    0.114  },
+		{ -0.147,   -0.289,    0.436  },
+		{  0.615,   -0.515,   -0.100  }
+	},
+	{
+		"BT.709", YUV_MATRIX_BT709,
+		{  0.2126,   0.7152,   0.0722 },
+		{ -0.09991, -0.33609,  0.436  },
+		{  0.615,   -0.55861, -0.05639 }
+	},
+};
+
+/*
+ * packed rgb layouts under test
+ */
+typedef struct _test_format_t
+{
+	const char *name;
+	int bpp;          //bytes per pixel
+	int offset[3];    //r, g and b byte offsets
+	void (*convert)(uint8_t *out, uint8_t *in, int width, int height, int matrix);
+} test_format_t;
+
+static const test_format_t formats[] =
+{
+	{"rgb24", 3, {0, 1, 2}, rgb24_to_yu12},
+	{"bgr24", 3, {2, 1, 0}, bgr24_to_yu12},
+	{"ar24",  4, {2, 1, 0}, ar24_to_yu12},
+	{"ba24",  4, {1, 2, 3}, ba24_to_yu12},
+};
+
+/*
+ * floating point component of a pixel (previous code, not clipped)
+ * args:
+ *    c - coefficients
+ *    px - pointer to pixel
+ *    offset - r, g and b byte offsets
+ *
+ * asserts:
+ *    none
+ *
+ * returns: component value
+ */
+static double float_component(const double c[3], const uint8_t *px, const int offset[3])
+{
+	return c[0] * (px[offset[0]] - 128) + c[1] * (px[offset[1]] - 128) +
+		c[2] * (px[offset[2]] - 128) + 128;
+}
+
+/*
+ * floating point chroma of a pixel pair (previous code)
+ * args:
+ *    c - coefficients
+ *    px - pointer to first pixel
+ *    bpp - bytes per pixel
+ *    offset - r, g and b byte offsets
+ *    clipped - set to 1 if the pair value was clipped
+ *
+ * asserts:
+ *    none
+ *
+ * returns: clipped chroma value
+ */
+static int float_pair_chroma(const double c[3], const uint8_t *px, int bpp,
+	const int offset[3], int *clipped)
+{
+	double val = (float_component(c, px, offset) + float_component(c, px + bpp, offset)) / 2;
+	if(val < 0 || val > 255)
+		*clipped = 1;
+	return CLIP(val);
+}
+
+/*
+ * convert a random frame and compare it with the previous floating point code
+ * args:
+ *    saturated - if set the components are only 0 or 255 (clips the chroma)
+ *    format - pointer to test format
+ *    matrix - pointer to floating point matrix
+ *    width - frame width (even)
+ *    height - frame height (even)
+ *    max_error - maximum errors found for y, u and v (updated)
+ *    max_clipped_error - maximum chroma error in clipped blocks (updated)
+ *    clipped_blocks - number of clipped chroma blocks (updated)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: none
+ */
+static void test_frame(int saturated, const test_format_t *format, const float_matrix_t *matrix,
+	int width, int height, int max_error[3], int *max_clipped_error, int *clipped_blocks)
+{
+	int linesize = width * format->bpp;
+	uint8_t *in = malloc(linesize * height);
+	uint8_t *out = malloc((width * height * 3) / 2);
+	if(in == NULL || out == NULL)
+	{
+		fprintf(stderr, "FATAL memory allocation failure (test_frame)\n");
+		exit(-1);
+	}
+
+	int i = 0;
+	for(i = 0; i < linesize * height; ++i)
+		in[i] = saturated ? ((rand() & 1) ? 255 : 0) : rand() & 0xff;
+
+	format->convert(out, in, width, height, matrix->matrix);
+
+	uint8_t *py = out;
+	uint8_t *pu = py + (width * height);
+	uint8_t *pv = pu + ((width * height) / 4);
+
+	int h = 0;
+	int w = 0;
+	for(h = 0; h < height; ++h)
+	{
+		for(w = 0; w < width; ++w)
+		{
+			uint8_t ref = CLIP(float_component(matrix->y, in + (h * linesize) + (w * format->bpp), format->offset));
+			int err = abs(py[(h * width) + w] - ref);
+			if(err > max_error[0])
+				max_error[0] = err;
+		}
+	}
+
+	for(h = 0; h < height; h += 2)
+	{
+		uint8_t *in1 = in + (h * linesize);
+		uint8_t *in2 = in1 + linesize;
+
+		for(w = 0; w < width; w += 2)
+		{
+			int clipped = 0;
+			int u1 = float_pair_chroma(matrix->u, in1 + (w * format->bpp), format->bpp, format->offset, &clipped);
+			int u2 = float_pair_chroma(matrix->u, in2 + (w * format->bpp), format->bpp, format->offset, &clipped);
+			int v1 = float_pair_chroma(matrix->v, in1 + (w * format->bpp), format->bpp, format->offset, &clipped);
+			int v2 = float_pair_chroma(matrix->v, in2 + (w * format->bpp), format->bpp, format->offset, &clipped);
+
+			int c = ((h / 2) * (width / 2)) + (w / 2);
+			int err_u = abs(pu[c] - (u1 + u2) / 2);
+			int err_v = abs(pv[c] - (v1 + v2) / 2);
+
+			if(clipped)
+			{
+				(*clipped_blocks)++;
+				if(err_u > *max_clipped_error)
+					*max_clipped_error = err_u;
+				if(err_v > *max_clipped_error)
+					*max_clipped_error = err_v;
+				continue;
+			}
+
+			if(err_u > max_error[1])
+				max_error[1] = err_u;
+			if(err_v > max_error[2])
+				max_error[2] = err_v;
+		}
+	}
+
+	free(in);
+	free(out);
+}
+
+int main(int argc, char *argv[])
+{
+	/*frame sizes: SIMD widths, odd tails and a full frame*/
+	static const int sizes[][2] =
+	{
+		{  2,   2}, { 14,   6}, { 16,  16}, { 30,   8}, { 34,  10},
+		{ 62,   4}, {178, 144}, {642, 482}, {1920, 1080},
+	};
+
+	srand(argc > 1 ? atoi(argv[1]) : 4242);
+
+	int fail = 0;
+	int m = 0;
+	for(m = 0; m < (int) (sizeof(matrices) / sizeof(matrices[0])); ++m)
+	{
+		int f = 0;
+		for(f = 0; f < (int) (sizeof(formats) / sizeof(formats[0])); ++f)
+		{
+			int max_error[3] = {0, 0, 0};
+			int max_clipped_error = 0;
+			int clipped_blocks = 0;
+
+			/*random and saturated colour frames*/
+			int i = 0;
+			for(i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); ++i)
+			{
+				test_frame(0, &formats[f], &matrices[m], sizes[i][0], sizes[i][1],
+					max_error, &max_clipped_error, &clipped_blocks);
+				test_frame(1, &formats[f], &matrices[m], sizes[i][0], sizes[i][1],
+					max_error, &max_clipped_error, &clipped_blocks);
+			}
+
+			int ffail = (max_error[0] > MAX_LUMA_ERROR ||
+				max_error[1] > MAX_CHROMA_ERROR ||
+				max_error[2] > MAX_CHROMA_ERROR ||
+				max_clipped_error > MAX_CLIPPED_CHROMA_ERROR);
+
+			printf("%s: %s %s max error y=%i u=%i v=%i (%i clipped chroma blocks: max error %i)\n",
+				ffail ? "FAIL" : "PASS", matrices[m].name, formats[f].name,
+				max_error[0], max_error[1], max_error[2], clipped_blocks, max_clipped_error);
+
+			fail += ffail;
+		}
+	}
+
+	return fail ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - yu12 to rgb SIMD kernel test (make check)                #
+#                                                                               #
+#  The yu12 to rgb kernel dispatched for the running cpu is checked against the #
+#  scalar reference (yu12_to_rgb_line in colorspaces.c) for the 4 output        #
+#  layouts on random lines and on lines with saturated chroma, at every tail    #
+#  length of the kernel and on random widths.                                   #
+#                                                                               #
+********************************************************************************/
+
+/*the scalar reference is static - build it in this test*/
+#include "colorspaces.c"
+
+#include <string.h>
+
+int verbosity = 0;
+
+/*
+ * maximum error (in 8 bit levels) against the scalar reference
+ *  the kernels use the same Q14 coefficients and rounding, so they are
+ *  expected to be bit exact; a 1 level rounding difference in the chroma
+ *  offsets is tolerated (the alpha byte must always be 0xFF)
+ */
+#define MAX_RGB_ERROR  (1)
+
+#define TEST_MAX_WIDTH (1920 + 62)
+#define TEST_WIDTHS    (200)
+#define GUARD_SIZE     (64)
+#define GUARD_BYTE     (0xA5)
+
+typedef struct _test_layout_t
+{
+	const char *name;
+	int layout;
+	int bpp;
+} test_layout_t;
+
+static const test_layout_t layouts[] =
+{
+	{"rgb24", RGB_LAYOUT_RGB24, 3},
+	{"bgr24", RGB_LAYOUT_BGR24, 3},
+	{"rgba32", RGB_LAYOUT_RGBA32, 4},
+	{"bgra32", RGB_LAYOUT_BGRA32, 4},
+};
+
+/*
+ * check that a buffer guard was not overwritten
+ * args:
+ *    buff - pointer to guard bytes
+ *
+ * asserts:
+ *    none
+ *
+ * returns: 1 if guard is intact, 0 otherwise
+ */
+static int guard_intact(const uint8_t *buff)
+{
+	int i = 0;
+	for(i = 0; i < GUARD_SIZE; ++i)
+		if(buff[i] != GUARD_BYTE)
+			return 0;
+
+	return 1;
+}
+
+/*
+ * run the kernel against the scalar reference for a layout and width
+ * args:
+ *    kernel - yu12 to rgb kernel
+ *    layout - pointer to test layout
+ *    width - line width in pixels (even)
+ *    saturated - chroma samples are 0 or 255 (rgb components clip)
+ *    max_error - pointer to maximum error (updated)
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of failures
+ */
+static int test_kernel(yu12_to_rgb_kernel_t kernel, const test_layout_t *layout,
+	int width, int saturated, int *max_error)
+{
+	static uint8_t py[TEST_MAX_WIDTH];
+	static uint8_t pu[TEST_MAX_WIDTH / 2];
+	static uint8_t pv[TEST_MAX_WIDTH / 2];
+	/*output lines (reference and kernel) with trailing guard*/
+	static uint8_t ref[TEST_MAX_WIDTH * 4 + GUARD_SIZE];
+	static uint8_t out[TEST_MAX_WIDTH * 4 + GUARD_SIZE];
+
+	int i = 0;
+	for(i = 0; i < width; ++i)
+		py[i] = rand() & 0xff;
+	for(i = 0; i < width / 2; ++i)
+	{
+		pu[i] = saturated ? ((rand() & 1) ? 0xff : 0) : (rand() & 0xff);
+		pv[i] = saturated ? ((rand() & 1) ? 0xff : 0) : (rand() & 0xff);
+	}
+
+	int size = width * layout->bpp;
+	memset(ref, GUARD_BYTE, sizeof(ref));
+	memset(out, GUARD_BYTE, sizeof(out));
+
+	yu12_to_rgb_line(ref, py, pu, pv, 0, width, layout->layout);
+
+	int w = kernel(out, py, pu, pv, width, layout->layout);
+	if(w < 0 || w > width || (w & 1))
+	{
+		fprintf(stderr, "FAIL: %s width %i: kernel returned %i\n",
+			layout->name, width, w);
+		return 1;
+	}
+	/*the caller converts the remaining pixels*/
+	yu12_to_rgb_line(out, py, pu, pv, w, width, layout->layout);
+
+	int fail = 0;
+	for(i = 0; i < size; ++i)
+	{
+		int error = abs(out[i] - ref[i]);
+		if(error > *max_error)
+			*max_error = error;
+
+		/*alpha byte is exact*/
+		if(layout->bpp == 4 && (i & 3) == 3 && error)
+			error = MAX_RGB_ERROR + 1;
+
+		if(error > MAX_RGB_ERROR)
+		{
+			fprintf(stderr, "FAIL: %s width %i: pixel %i component %i is %i (reference %i)\n",
+				layout->name, width, i / layout->bpp, i % layout->bpp, out[i], ref[i]);
+			fail++;
+			break;
+		}
+	}
+	if(!guard_intact(out + size))
+	{
+		fprintf(stderr, "FAIL: %s width %i: written past the line end\n",
+			layout->name, width);
+		fail++;
+	}
+
+	return fail;
+}
+
+int main(int argc, char *argv[])
+{
+	yu12_to_rgb_kernel_t kernel = get_yu12_to_rgb_kernel();
+
+	if(kernel == NULL)
+	{
+		printf("SKIP: no yu12 to rgb SIMD kernel for this cpu\n");
+		return 77; /*automake skip*/
+	}
+
+	srand(argc > 1 ? atoi(argv[1]) : 4242);
+
+	/*widths: every tail length of the kernel, then random*/
+	int widths[64 + TEST_WIDTHS];
+	int nwidths = 0;
+	int i = 0;
+	for(i = 2; i <= 128; i += 2)
+		widths[nwidths++] = i;
+	for(i = 0; i < TEST_WIDTHS; ++i)
+		widths[nwidths++] = 2 + 2 * (rand() % ((TEST_MAX_WIDTH - 2) / 2));
+
+	int fail = 0;
+	int l = 0;
+	for(l = 0; l < (int) (sizeof(layouts) / sizeof(layouts[0])); ++l)
+	{
+		int max_error = 0;
+		int lfail = 0;
+		for(i = 0; i < nwidths; ++i)
+		{
+			lfail += test_kernel(kernel, &layouts[l], widths[i], 0, &max_error);
+			lfail += test_kernel(kernel, &layouts[l], widths[i], 1, &max_error);
+		}
+
+		printf("%s: yu12 to %s (%i widths, random and saturated chroma) max error %i (tolerance %i)\n",
+			lfail ? "FAIL" : "PASS", layouts[l].name, nwidths, max_error, MAX_RGB_ERROR);
+		fail += lfail;
+	}
+
+	return fail ? 1 : 0;
+}
@@ -60,6 +60,8 @@
 
 #include "uvc_h264.h"
 #include "v4l2_formats.h"
+#include "jpeg_decoder.h"
+#include "colorspaces.h"
 
 // GUID of the UVC H.264 extension unit: {A29E7641-DE04-47E3-8B2B-F4341AFF003B}
 #define GUID_UVCX_H264_XU {0x41, 0x76, 0x9E, 0xA2, 0x04, 0xDE, 0xE3, 0x47, 0x8B, 0x2B, 0xF4, 0x34, 0x1A, 0xFF, 0x00, 0x3B}
@@ -78,11 +80,6 @@ typedef struct _h264_decoder_context_t
 
 } h264_decoder_context_t;
 
-static h264_decoder_context_t *h264_ctx = NULL;
-
-/*h264 support type*/
-static int h264_support = H264_NONE; /*none by default*/
-
 /*
  * request a IDR frame from the H264 encoder
  * args:
@@ -101,16 +98,19 @@ void h264_request_idr(v4l2_dev_t *vd)
 /*
  * get h264 support type
  * args:
- *    none
+ *    vd - pointer to video device data
  *
  * asserts:
- *    none
+ *    vd is not null
  *
  * returns: support type (H264_NONE; H264_MUXED; H264_FRAME)
  */
-int h264_get_support()
+int h264_get_support(v4l2_dev_t *vd)
 {
-	return h264_support;
+	/*assertions*/
+	assert(vd != NULL);
+
+	return vd->h264_support;
 }
 
 /*
@@ -345,7 +345,7 @@ void add_h264_format(v4l2_dev_t *vd)
 		if(verbosity > 0)
 			printf("V4L2_CORE: H264 format already in list\n");
 
-		h264_support = H264_FRAME;
+		vd->h264_support = H264_FRAME;
 		/*check the h264 unit id (if any) */
 		get_uvc_h624_unit_id(vd);
 
@@ -354,13 +354,13 @@ void add_h264_format(v4l2_dev_t *vd)
 
 	if(get_uvc_h624_unit_id(vd) <= 0)
 	{
-		h264_support = H264_NONE;
+		vd->h264_support = H264_NONE;
 		return; /*no unit id found for h264*/
 	}
 
 	if(!check_h264_support(vd))
 	{
-		h264_support = H264_NONE;
+		vd->h264_support = H264_NONE;
 		return; /*no XU support for h264*/
 	}
 
@@ -373,7 +373,7 @@ void add_h264_format(v4l2_dev_t *vd)
 		printf("V4L2_CORE: adding muxed H264 format\n");
 
 	/*if we got here then muxed h264 is supported*/
-	h264_support = H264_MUXED;
+	vd->h264_support = H264_MUXED;
 
 	vd->numb_formats++; /*increment number of formats*/
 	int fmtind = vd->numb_formats;
@@ -984,16 +984,20 @@ int h264_probe_config_probe_req(
 /*
  * init h264 decoder context
  * args:
+ *    vd - pointer to video device data
  *    width - image width
  *    height - image height
  *
  * asserts:
- *    none
+ *    vd is not null
  *
  * returns: error code (0 - E_OK)
  */
-int h264_init_decoder(int width, int height)
+int h264_init_decoder(v4l2_dev_t *vd, int width, int height)
 {
+	/*assertions*/
+	assert(vd != NULL);
+
 #if !LIBAVCODEC_VER_AT_LEAST(53,34)
 	avcodec_init();
 #endif
@@ -1003,10 +1007,10 @@ int h264_init_decoder(int width, int height)
 	 */
 	avcodec_register_all();
 	
-	if(h264_ctx != NULL)
-		h264_close_decoder();
+	if(vd->h264_ctx != NULL)
+		h264_close_decoder(vd);
 	
-	h264_ctx = calloc(1, sizeof(h264_decoder_context_t));
+	h264_decoder_context_t *h264_ctx = calloc(1, sizeof(h264_decoder_context_t));
 	if(h264_ctx == NULL)
 	{
 		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (h264_init_decoder): %s\n", strerror(errno));
@@ -1018,7 +1022,6 @@ int h264_init_decoder(int width, int height)
 	{
 		fprintf(stderr, "V4L2_CORE: (H264 decoder) codec not found (please install libavcodec-extra for H264 support)\n");
 		free(h264_ctx);
-		h264_ctx = NULL;
 		return E_NO_CODEC;
 	}
 	
@@ -1041,6 +1044,15 @@ int h264_init_decoder(int width, int height)
 	h264_ctx->context->height = height;
 	//h264_ctx->context->dsp_mask = (FF_MM_MMX | FF_MM_MMXEXT | FF_MM_SSE);
 
+#if LIBAVCODEC_VER_AT_LEAST(53,6)
+	/*decoder threads (0 - one per online cpu)*/
+	int thread_type = 0;
+	h264_ctx->context->thread_count = get_codec_threads(&thread_type);
+	h264_ctx->context->thread_type =
+		((thread_type & CODEC_THREAD_SLICE) ? FF_THREAD_SLICE : 0) |
+		((thread_type & CODEC_THREAD_FRAME) ? FF_THREAD_FRAME : 0);
+#endif
+
 #if LIBAVCODEC_VER_AT_LEAST(53,6)
 	if (avcodec_open2(h264_ctx->context, h264_ctx->codec, NULL) < 0)
 #else
@@ -1051,7 +1063,6 @@ int h264_init_decoder(int width, int height)
 		avcodec_close(h264_ctx->context);
 		free(h264_ctx->context);
 		free(h264_ctx);
-		h264_ctx = NULL;
 		return E_NO_CODEC;
 	}
 	
@@ -1067,30 +1078,37 @@ int h264_init_decoder(int width, int height)
 	h264_ctx->width = width;
 	h264_ctx->height = height;
 
+	vd->h264_ctx = h264_ctx;
+
 	return E_OK;
 }
 
 /*
  * decode h264 frame
  * args:
+ *    vd - pointer to video device data
  *    out_buf - pointer to decoded data
  *    in_buf - pointer to h264 data
  *    size - in_buf size
  *
  * asserts:
- *    h264_ctx is not null
+ *    vd is not null
+ *    vd->h264_ctx is not null
  *    in_buf is not null
  *    out_buf is not null
  *
  * returns: decoded data size
  */
-int h264_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
+int h264_decode(v4l2_dev_t *vd, uint8_t *out_buf, uint8_t *in_buf, int size)
 {
 	/*asserts*/
-	assert(h264_ctx != NULL);
+	assert(vd != NULL);
+	assert(vd->h264_ctx != NULL);
 	assert(in_buf != NULL);
 	assert(out_buf != NULL);
 
+	h264_decoder_context_t *h264_ctx = vd->h264_ctx;
+
 	AVPacket avpkt;
 
 	av_init_packet(&avpkt);
@@ -1109,8 +1127,19 @@ int h264_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
 
 	if(got_picture)
 	{
-		avpicture_layout((AVPicture *) h264_ctx->picture, h264_ctx->context->pix_fmt, 
-			h264_ctx->width, h264_ctx->height, out_buf, h264_ctx->pic_size);
+		if(h264_ctx->context->pix_fmt == PIX_FMT_YUV420P ||
+			h264_ctx->context->pix_fmt == PIX_FMT_YUVJ420P)
+		{
+			/*copy the planes straight from the picture (honoring line sizes)*/
+			uint8_t *out[3];
+			int out_stride[3];
+			yu12_get_planes(out_buf, h264_ctx->width, h264_ctx->height, out, out_stride);
+			yu12_copy_planes(out, out_stride, h264_ctx->picture->data,
+				h264_ctx->picture->linesize, h264_ctx->width, h264_ctx->height);
+		}
+		else
+			avpicture_layout((AVPicture *) h264_ctx->picture, h264_ctx->context->pix_fmt,
+				h264_ctx->width, h264_ctx->height, out_buf, h264_ctx->pic_size);
 		return len;
 	}
 	else
@@ -1121,15 +1150,20 @@ int h264_decode(uint8_t *out_buf, uint8_t *in_buf, int size)
 /*
  * close h264 decoder context
  * args:
- *    none
+ *    vd - pointer to video device data
  *
  * asserts:
- *    none
+ *    vd is not null
  *
  * returns: none
  */
-void h264_close_decoder()
+void h264_close_decoder(v4l2_dev_t *vd)
 {
+	/*assertions*/
+	assert(vd != NULL);
+
+	h264_decoder_context_t *h264_ctx = vd->h264_ctx;
+
 	if(h264_ctx == NULL)
 		return;
 
@@ -1149,5 +1183,5 @@ void h264_close_decoder()
 
 	free(h264_ctx);
 
-	h264_ctx = NULL;
+	vd->h264_ctx = NULL;
 }
@@ -0,0 +1,700 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - device enumeration cache                                 #
+#                                                                               #
+********************************************************************************/
+
+/*
+ * The cache file holds the result of the format, frame size, frame interval
+ * and control enumeration (plus the probed xu unit ids) for a single device.
+ * Files are named after the device bus location, usb VID:PID and firmware
+ * version and also store the full key (with card name and driver version),
+ * so a different camera, a firmware update or a driver update never reuse
+ * stale data. On load the cached pixel formats are checked against a quick
+ * VIDIOC_ENUM_FMT pass and the control list boundaries with two
+ * VIDIOC_QUERYCTRL calls; any mismatch or corrupted file removes the cache
+ * and the device is probed again.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "gviewv4l2core.h"
+#include "v4l2_core.h"
+#include "v4l2_cache.h"
+#include "v4l2_controls.h"
+#include "v4l2_devices.h"
+#include "v4l2_formats.h"
+#include "uvc_h264.h"
+
+#define ENUM_CACHE_MAGIC   "GVENUMC"
+#define ENUM_CACHE_VERSION (1)
+#define ENUM_CACHE_END     (0x454e4421) /*end of file marker*/
+#define ENUM_CACHE_KEY_LEN (256)
+
+extern int verbosity;
+
+static int enum_cache_enabled = 1; /*enabled by default*/
+
+/*
+ * cache file header
+ */
+typedef struct _enum_cache_header_t
+{
+	char magic[8];                  //ENUM_CACHE_MAGIC
+	uint32_t version;               //ENUM_CACHE_VERSION
+	uint32_t queryctrl_size;        //sizeof(struct v4l2_queryctrl)
+	uint32_t querymenu_size;        //sizeof(struct v4l2_querymenu)
+	char key[ENUM_CACHE_KEY_LEN];   //device key
+} enum_cache_header_t;
+
+/*
+ * get the device usb data (vendor, product and firmware version)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to device system data (NULL if device is not in list)
+ */
+static v4l2_dev_sys_data_t *get_dev_sys_data(v4l2_dev_t *vd)
+{
+	v4l2_device_list_t *device_list = get_device_list();
+
+	if(device_list == NULL || device_list->list_devices == NULL)
+		return NULL;
+
+	int i = 0;
+	for(i = 0; i < device_list->num_devices; ++i)
+	{
+		if(device_list->list_devices[i].device &&
+			strcmp(device_list->list_devices[i].device, vd->videodevice) == 0)
+			return &device_list->list_devices[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * build the cache key and file name for the device
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   key - pointer to key buffer (ENUM_CACHE_KEY_LEN) to be filled
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to newly allocated file name (NULL if not cacheable)
+ */
+static char *get_cache_filename(v4l2_dev_t *vd, char *key)
+{
+	if(!enum_cache_enabled)
+		return NULL;
+
+	v4l2_dev_sys_data_t *sys_data = get_dev_sys_data(vd);
+	if(sys_data == NULL || vd->cap.bus_info[0] == 0)
+	{
+		if(verbosity > 1)
+			printf("V4L2_CORE: (enum cache) no usb data for %s - cache disabled\n", vd->videodevice);
+		return NULL;
+	}
+
+	memset(key, 0, ENUM_CACHE_KEY_LEN);
+	snprintf(key, ENUM_CACHE_KEY_LEN, "%s|%04x:%04x|%04x|%s|%s|%u",
+		(char *) vd->cap.bus_info,
+		sys_data->vendor, sys_data->product, sys_data->firmware,
+		(char *) vd->cap.card, (char *) vd->cap.driver, vd->cap.version);
+
+	/*sanitized bus location (file name)*/
+	char location[64];
+	int i = 0;
+	for(i = 0; i < (int) sizeof(location) - 1 && vd->cap.bus_info[i]; ++i)
+		location[i] = isalnum(vd->cap.bus_info[i]) ? vd->cap.bus_info[i] : '_';
+	location[i] = 0;
+
+	char cache_dir[256];
+	const char *xdg_cache = getenv("XDG_CACHE_HOME");
+	if(xdg_cache && xdg_cache[0] == '/')
+		snprintf(cache_dir, sizeof(cache_dir), "%s/guvcview", xdg_cache);
+	else if(getenv("HOME"))
+	{
+		snprintf(cache_dir, sizeof(cache_dir), "%s/.cache", getenv("HOME"));
+		mkdir(cache_dir, 0700);
+		strncat(cache_dir, "/guvcview", sizeof(cache_dir) - strlen(cache_dir) - 1);
+	}
+	else
+		return NULL;
+
+	mkdir(cache_dir, 0700);
+
+	char *filename = calloc(strlen(cache_dir) + strlen(location) + 32, sizeof(char));
+	if(filename == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (get_cache_filename): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	sprintf(filename, "%s/%s-%04x_%04x_%04x.enum", cache_dir, location,
+		sys_data->vendor, sys_data->product, sys_data->firmware);
+
+	return filename;
+}
+
+/*
+ * read data from cache file
+ * args:
+ *   fp - pointer to FILE
+ *   data - pointer to data buffer
+ *   size - data size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int read_data(FILE *fp, void *data, size_t size)
+{
+	if(size == 0)
+		return 0;
+
+	return (fread(data, size, 1, fp) == 1) ? 0 : -1;
+}
+
+/*
+ * read an int32 from cache file and check its range
+ * args:
+ *   fp - pointer to FILE
+ *   value - pointer to value to be filled
+ *   max - maximum allowed value
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int read_int(FILE *fp, int32_t *value, int32_t max)
+{
+	if(read_data(fp, value, sizeof(int32_t)) != 0)
+		return -1;
+
+	return (*value < 0 || *value > max) ? -1 : 0;
+}
+
+/*
+ * check the cached pixel formats against the device
+ *  (single VIDIOC_ENUM_FMT pass - no frame size or interval queries)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 if formats match, -1 otherwise
+ */
+static int check_cached_formats(v4l2_dev_t *vd)
+{
+	int numb_formats = vd->numb_formats;
+	/*muxed h264 is added by the core (not enumerated)*/
+	if(vd->h264_support == H264_MUXED)
+		numb_formats--;
+
+	struct v4l2_fmtdesc fmt;
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+	while (xioctl(vd->fd, VIDIOC_ENUM_FMT, &fmt) == 0)
+	{
+		if((int) fmt.index >= numb_formats ||
+			vd->list_stream_formats[fmt.index].format != (int) fmt.pixelformat)
+			return -1;
+		fmt.index++;
+	}
+
+	return ((int) fmt.index == numb_formats) ? 0 : -1;
+}
+
+/*
+ * check the cached control list boundaries against the device
+ *  (catches controls added by xu mappings after the cache was stored)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 if the first and last controls match, -1 otherwise
+ */
+static int check_cached_controls(v4l2_dev_t *vd)
+{
+	if(vd->list_device_controls == NULL)
+		return 0;
+
+	v4l2_ctrl_t *last = vd->list_device_controls;
+	while(last->next != NULL)
+		last = last->next;
+
+	struct v4l2_queryctrl queryctrl;
+	memset(&queryctrl, 0, sizeof(struct v4l2_queryctrl));
+	queryctrl.id = V4L2_CTRL_FLAG_NEXT_CTRL;
+
+	/*no V4L2_CTRL_FLAG_NEXT_CTRL support - can't check*/
+	if(xioctl(vd->fd, VIDIOC_QUERYCTRL, &queryctrl) != 0)
+		return 0;
+
+	if(queryctrl.id != vd->list_device_controls->control.id &&
+		!(queryctrl.flags & V4L2_CTRL_FLAG_DISABLED))
+		return -1;
+
+	memset(&queryctrl, 0, sizeof(struct v4l2_queryctrl));
+	queryctrl.id = last->control.id | V4L2_CTRL_FLAG_NEXT_CTRL;
+
+	/*there should be no controls after the last cached one*/
+	while(xioctl(vd->fd, VIDIOC_QUERYCTRL, &queryctrl) == 0)
+	{
+		if(!(queryctrl.flags & V4L2_CTRL_FLAG_DISABLED))
+			return -1;
+		queryctrl.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
+	}
+
+	return 0;
+}
+
+/*
+ * load the device formats, controls and xu unit ids from the
+ * enumeration cache (skips the full device probe)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid ( > 0 )
+ *   vd->list_stream_formats is null
+ *   vd->list_device_controls is null
+ *
+ * returns: error code (E_OK if the cache was valid and loaded)
+ */
+int load_enum_cache(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+	assert(vd->fd > 0);
+	assert(vd->list_stream_formats == NULL);
+	assert(vd->list_device_controls == NULL);
+
+	char key[ENUM_CACHE_KEY_LEN];
+	char *filename = get_cache_filename(vd, key);
+	if(filename == NULL)
+		return E_FILE_IO_ERR;
+
+	FILE *fp = fopen(filename, "rb");
+	if(fp == NULL)
+	{
+		if(verbosity > 0)
+			printf("V4L2_CORE: (enum cache) no cache for %s\n", vd->videodevice);
+		free(filename);
+		return E_FILE_IO_ERR;
+	}
+
+	enum_cache_header_t header;
+	int32_t value = 0;
+	int i = 0, j = 0;
+
+	/*check the header*/
+	if(read_data(fp, &header, sizeof(enum_cache_header_t)) != 0 ||
+		memcmp(header.magic, ENUM_CACHE_MAGIC, sizeof(ENUM_CACHE_MAGIC)) != 0 ||
+		header.version != ENUM_CACHE_VERSION ||
+		header.queryctrl_size != sizeof(struct v4l2_queryctrl) ||
+		header.querymenu_size != sizeof(struct v4l2_querymenu) ||
+		memcmp(header.key, key, ENUM_CACHE_KEY_LEN) != 0)
+		goto invalid;
+
+	/*frame formats*/
+	if(read_int(fp, &value, 256) != 0 || value == 0)
+		goto invalid;
+
+	vd->list_stream_formats = calloc(value, sizeof(v4l2_stream_formats_t));
+	if(vd->list_stream_formats == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (load_enum_cache): %s\n", strerror(errno));
+		exit(-1);
+	}
+	vd->numb_formats = value;
+
+	for(i = 0; i < vd->numb_formats; ++i)
+	{
+		v4l2_stream_formats_t *format = &vd->list_stream_formats[i];
+
+		int32_t pixfmt = 0;
+		if(read_data(fp, &format->dec_support, sizeof(uint8_t)) != 0 ||
+			read_data(fp, &pixfmt, sizeof(int32_t)) != 0 ||
+			read_data(fp, format->fourcc, sizeof(format->fourcc)) != 0 ||
+			read_data(fp, format->description, sizeof(format->description)) != 0 ||
+			read_int(fp, &value, 4096) != 0)
+			goto invalid;
+
+		format->format = pixfmt;
+		format->fourcc[4] = 0;
+		format->description[31] = 0;
+
+		if(value == 0)
+			continue;
+
+		format->list_stream_cap = calloc(value, sizeof(v4l2_stream_cap_t));
+		if(format->list_stream_cap == NULL)
+		{
+			fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (load_enum_cache): %s\n", strerror(errno));
+			exit(-1);
+		}
+		format->numb_res = value;
+
+		for(j = 0; j < format->numb_res; ++j)
+		{
+			v4l2_stream_cap_t *cap = &format->list_stream_cap[j];
+			int32_t width = 0, height = 0;
+
+			if(read_int(fp, &width, 65535) != 0 ||
+				read_int(fp, &height, 65535) != 0 ||
+				read_int(fp, &value, 4096) != 0)
+				goto invalid;
+
+			cap->width = width;
+			cap->height = height;
+
+			if(value == 0)
+				continue;
+
+			cap->framerate_num = calloc(value, sizeof(int));
+			cap->framerate_denom = calloc(value, sizeof(int));
+			if(cap->framerate_num == NULL || cap->framerate_denom == NULL)
+			{
+				fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (load_enum_cache): %s\n", strerror(errno));
+				exit(-1);
+			}
+			cap->numb_frates = value;
+
+			if(read_data(fp, cap->framerate_num, value * sizeof(int)) != 0 ||
+				read_data(fp, cap->framerate_denom, value * sizeof(int)) != 0)
+				goto invalid;
+		}
+	}
+
+	/*xu unit ids*/
+	int32_t h264_support = 0;
+	if(read_data(fp, &h264_support, sizeof(int32_t)) != 0 ||
+		read_data(fp, &vd->h264_unit_id, sizeof(uint8_t)) != 0 ||
+		read_data(fp, &vd->pantilt_unit_id, sizeof(uint8_t)) != 0)
+		goto invalid;
+	vd->h264_support = h264_support;
+
+	/*quick check of the device formats (before touching the controls)*/
+	if(check_cached_formats(vd) != 0)
+	{
+		if(verbosity > 0)
+			printf("V4L2_CORE: (enum cache) device formats changed\n");
+		goto invalid;
+	}
+
+	/*controls*/
+	int32_t num_controls = 0;
+	if(read_int(fp, &num_controls, 1024) != 0)
+		goto invalid;
+
+	v4l2_ctrl_t *current = NULL;
+	int n = 0;
+	for(i = 0; i < num_controls; ++i)
+	{
+		struct v4l2_queryctrl queryctrl;
+		struct v4l2_querymenu *menu = NULL;
+		int32_t menu_entries = 0;
+		int32_t has_menu = 0;
+
+		if(read_data(fp, &queryctrl, sizeof(struct v4l2_queryctrl)) != 0 ||
+			read_int(fp, &has_menu, 1) != 0 ||
+			read_int(fp, &menu_entries, 1024) != 0)
+			goto invalid;
+
+		if(has_menu)
+		{
+			/*menu entries plus the last (NULL name) entry*/
+			menu = calloc(menu_entries + 1, sizeof(struct v4l2_querymenu));
+			if(menu == NULL)
+			{
+				fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (load_enum_cache): %s\n", strerror(errno));
+				exit(-1);
+			}
+
+			if(read_data(fp, menu, (menu_entries + 1) * sizeof(struct v4l2_querymenu)) != 0)
+			{
+				free(menu);
+				goto invalid;
+			}
+		}
+
+		if(add_control_data(vd, &queryctrl, menu, menu_entries, &current, &(vd->list_device_controls)) != NULL)
+			n++;
+	}
+	vd->num_controls = n;
+
+	value = 0;
+	if(read_data(fp, &value, sizeof(int32_t)) != 0 || value != ENUM_CACHE_END)
+		goto invalid;
+
+	if(check_cached_controls(vd) != 0)
+	{
+		if(verbosity > 0)
+			printf("V4L2_CORE: (enum cache) device controls changed\n");
+		goto invalid;
+	}
+
+	fclose(fp);
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: (enum cache) loaded %i formats and %i controls from %s\n",
+			vd->numb_formats, vd->num_controls, filename);
+
+	free(filename);
+	return E_OK;
+
+invalid:
+	fclose(fp);
+
+	fprintf(stderr, "V4L2_CORE: (enum cache) invalid cache file %s - removing it\n", filename);
+	unlink(filename);
+	free(filename);
+
+	/*clean any partially loaded data*/
+	if(vd->list_stream_formats)
+		free_frame_formats(vd);
+	vd->numb_formats = 0;
+	free_v4l2_control_list(vd);
+	vd->num_controls = 0;
+	vd->h264_support = H264_NONE;
+	vd->h264_unit_id = 0;
+	vd->pantilt_unit_id = 0;
+	vd->has_focus_control_id = 0;
+	vd->has_pantilt_control_id = 0;
+
+	return E_FILE_IO_ERR;
+}
+
+/*
+ * store the device formats, controls and xu unit ids
+ * in the enumeration cache
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int save_enum_cache(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	if(vd->list_stream_formats == NULL || vd->numb_formats <= 0)
+		return E_FILE_IO_ERR;
+
+	char key[ENUM_CACHE_KEY_LEN];
+	char *filename = get_cache_filename(vd, key);
+	if(filename == NULL)
+		return E_FILE_IO_ERR;
+
+	/*write to a temp file and rename it (never leave a partial cache)*/
+	char *tmp_filename = calloc(strlen(filename) + 16, sizeof(char));
+	if(tmp_filename == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (save_enum_cache): %s\n", strerror(errno));
+		exit(-1);
+	}
+	sprintf(tmp_filename, "%s.%i", filename, (int) getpid());
+
+	FILE *fp = fopen(tmp_filename, "wb");
+	if(fp == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: (enum cache) couldn't open %s for write: %s\n",
+			tmp_filename, strerror(errno));
+		free(tmp_filename);
+		free(filename);
+		return E_FILE_IO_ERR;
+	}
+
+	enum_cache_header_t header;
+	memset(&header, 0, sizeof(enum_cache_header_t));
+	memcpy(header.magic, ENUM_CACHE_MAGIC, sizeof(ENUM_CACHE_MAGIC));
+	header.version = ENUM_CACHE_VERSION;
+	header.queryctrl_size = sizeof(struct v4l2_queryctrl);
+	header.querymenu_size = sizeof(struct v4l2_querymenu);
+	memcpy(header.key, key, ENUM_CACHE_KEY_LEN);
+
+	int32_t value = 0;
+	int i = 0, j = 0;
+
+	fwrite(&header, sizeof(enum_cache_header_t), 1, fp);
+
+	/*frame formats*/
+	value = vd->numb_formats;
+	fwrite(&value, sizeof(int32_t), 1, fp);
+	for(i = 0; i < vd->numb_formats; ++i)
+	{
+		v4l2_stream_formats_t *format = &vd->list_stream_formats[i];
+
+		int32_t pixfmt = format->format;
+		fwrite(&format->dec_support, sizeof(uint8_t), 1, fp);
+		fwrite(&pixfmt, sizeof(int32_t), 1, fp);
+		fwrite(format->fourcc, sizeof(format->fourcc), 1, fp);
+		fwrite(format->description, sizeof(format->description), 1, fp);
+
+		value = format->list_stream_cap ? format->numb_res : 0;
+		fwrite(&value, sizeof(int32_t), 1, fp);
+
+		for(j = 0; j < value; ++j)
+		{
+			v4l2_stream_cap_t *cap = &format->list_stream_cap[j];
+			int32_t width = cap->width;
+			int32_t height = cap->height;
+			int32_t numb_frates = (cap->framerate_num && cap->framerate_denom) ? cap->numb_frates : 0;
+
+			fwrite(&width, sizeof(int32_t), 1, fp);
+			fwrite(&height, sizeof(int32_t), 1, fp);
+			fwrite(&numb_frates, sizeof(int32_t), 1, fp);
+			if(numb_frates > 0)
+			{
+				fwrite(cap->framerate_num, sizeof(int), numb_frates, fp);
+				fwrite(cap->framerate_denom, sizeof(int), numb_frates, fp);
+			}
+		}
+	}
+
+	/*xu unit ids*/
+	value = vd->h264_support;
+	fwrite(&value, sizeof(int32_t), 1, fp);
+	fwrite(&vd->h264_unit_id, sizeof(uint8_t), 1, fp);
+	fwrite(&vd->pantilt_unit_id, sizeof(uint8_t), 1, fp);
+
+	/*controls*/
+	value = vd->num_controls;
+	fwrite(&value, sizeof(int32_t), 1, fp);
+
+	v4l2_ctrl_t *current = vd->list_device_controls;
+	for(i = 0; i < vd->num_controls && current != NULL; ++i, current = current->next)
+	{
+		int32_t has_menu = current->menu ? 1 : 0;
+		/*menu_entries is only set for V4L2_CTRL_TYPE_MENU - count the list*/
+		int32_t menu_entries = 0;
+		if(has_menu)
+			while(current->menu[menu_entries].index <= (uint32_t) current->control.maximum &&
+				menu_entries < current->control.maximum - current->control.minimum + 1)
+				menu_entries++;
+
+		fwrite(&current->control, sizeof(struct v4l2_queryctrl), 1, fp);
+		fwrite(&has_menu, sizeof(int32_t), 1, fp);
+		fwrite(&menu_entries, sizeof(int32_t), 1, fp);
+		if(has_menu)
+			fwrite(current->menu, sizeof(struct v4l2_querymenu), menu_entries + 1, fp);
+	}
+
+	value = ENUM_CACHE_END;
+	fwrite(&value, sizeof(int32_t), 1, fp);
+
+	int ret = E_OK;
+	if(ferror(fp) || i != vd->num_controls)
+		ret = E_FILE_IO_ERR;
+
+	if(fclose(fp) != 0)
+		ret = E_FILE_IO_ERR;
+
+	if(ret == E_OK && rename(tmp_filename, filename) != 0)
+		ret = E_FILE_IO_ERR;
+
+	if(ret != E_OK)
+	{
+		fprintf(stderr, "V4L2_CORE: (enum cache) couldn't write %s: %s\n", filename, strerror(errno));
+		unlink(tmp_filename);
+	}
+	else if(verbosity > 0)
+		printf("V4L2_CORE: (enum cache) stored device enumeration in %s\n", filename);
+
+	free(tmp_filename);
+	free(filename);
+	return ret;
+}
+
+/*
+ * enable or disable the device enumeration cache
+ *  (enabled by default - set before v4l2core_init_dev)
+ * args:
+ *   enable - 1 to enable, 0 to disable
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_set_enum_cache(int enable)
+{
+	enum_cache_enabled = enable;
+}
+
+/*
+ * remove the enumeration cache of a device
+ *  (the next v4l2core_init_dev does a full device probe)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_invalidate_enum_cache(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	char key[ENUM_CACHE_KEY_LEN];
+	char *filename = get_cache_filename(vd, key);
+	if(filename == NULL)
+		return E_FILE_IO_ERR;
+
+	int ret = E_OK;
+	if(unlink(filename) != 0 && errno != ENOENT)
+	{
+		fprintf(stderr, "V4L2_CORE: (enum cache) couldn't remove %s: %s\n", filename, strerror(errno));
+		ret = E_FILE_IO_ERR;
+	}
+
+	free(filename);
+	return ret;
+}
@@ -0,0 +1,63 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - device enumeration cache                                 #
+#                                                                               #
+********************************************************************************/
+
+#ifndef V4L2_CACHE_H
+#define V4L2_CACHE_H
+
+#include "gviewv4l2core.h"
+#include "v4l2_core.h"
+
+/*
+ * load the device formats, controls and xu unit ids from the
+ * enumeration cache (skips the full device probe)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid ( > 0 )
+ *   vd->list_stream_formats is null
+ *   vd->list_device_controls is null
+ *
+ * returns: error code (E_OK if the cache was valid and loaded)
+ */
+int load_enum_cache(v4l2_dev_t *vd);
+
+/*
+ * store the device formats, controls and xu unit ids
+ * in the enumeration cache
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int save_enum_cache(v4l2_dev_t *vd);
+
+#endif
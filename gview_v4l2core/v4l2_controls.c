@@ -355,7 +355,6 @@ static v4l2_ctrl_t *add_control(v4l2_dev_t *vd, struct v4l2_queryctrl* queryctrl
 	assert(queryctrl != NULL);
 	int menu_entries = 0;
 
-	v4l2_ctrl_t *control = NULL;
 	struct v4l2_querymenu* menu = NULL; //menu list
 	struct v4l2_querymenu* old_menu = menu; //temp menu list pointer
 	
@@ -428,6 +427,44 @@ static v4l2_ctrl_t *add_control(v4l2_dev_t *vd, struct v4l2_queryctrl* queryctrl
 		menu_entries = i;
     }
 
+	/*check for pan/tilt control*/
+	if(queryctrl->id == V4L2_CID_TILT_RELATIVE ||
+		queryctrl->id == V4L2_CID_PAN_RELATIVE)
+	{
+		/*get unit id for logitech pan_tilt V3 if any*/
+		vd->pantilt_unit_id = get_logitech_peripheral_unit_id(vd);
+	}
+
+	return add_control_data(vd, queryctrl, menu, menu_entries, current, first);
+}
+
+/*
+ * add control to control list from already queried data
+ *  (also used for controls loaded from the enumeration cache)
+ * args:
+ *   vd - pointer to video device data
+ *   queryctrl - pointer to v4l2_queryctrl data
+ *   menu - menu list (NULL if not a menu) - owned by the control
+ *   menu_entries - number of menu entries (not counting the last NULL entry)
+ *   current - pointer to pointer of current control from control list
+ *   first - pointer to pointer of first control from control list
+ *
+ * asserts:
+ *   vd is not null
+ *   queryctrl is not null
+ *
+ * returns: pointer to newly added control
+ */
+v4l2_ctrl_t *add_control_data(v4l2_dev_t *vd, struct v4l2_queryctrl* queryctrl,
+	struct v4l2_querymenu* menu, int menu_entries,
+	v4l2_ctrl_t **current, v4l2_ctrl_t **first)
+{
+	/*assertions*/
+	assert(vd != NULL);
+	assert(queryctrl != NULL);
+
+	v4l2_ctrl_t *control = NULL;
+
     /*check for focus control to enable software autofocus*/
     if(queryctrl->id == V4L2_CID_FOCUS_LOGITECH ||
        queryctrl->id == V4L2_CID_FOCUS_ABSOLUTE)
@@ -435,11 +472,8 @@ static v4l2_ctrl_t *add_control(v4l2_dev_t *vd, struct v4l2_queryctrl* queryctrl
 	/*check for pan/tilt control*/
 	else if(queryctrl->id == V4L2_CID_TILT_RELATIVE ||
 			queryctrl->id == V4L2_CID_PAN_RELATIVE)
-	{
-		/*get unit id for logitech pan_tilt V3 if any*/
 		vd->has_pantilt_control_id = 1;
-		vd->pantilt_unit_id = get_logitech_peripheral_unit_id(vd);
-	}
+
     // Add the control to the linked list
     control = calloc (1, sizeof(v4l2_ctrl_t));
     if(control == NULL)
@@ -647,11 +681,11 @@ static void update_ctrl_flags(v4l2_dev_t *vd, int id)
                             ctrl_that = v4l2core_get_control_by_id(
                                 vd, V4L2_CID_IRIS_ABSOLUTE );
                             if (ctrl_that)
-                                ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                                ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                             ctrl_that = v4l2core_get_control_by_id(
                                 vd, V4L2_CID_IRIS_RELATIVE );
                             if (ctrl_that)
-                                ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                                ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                         }
                         break;
 
@@ -669,7 +703,7 @@ static void update_ctrl_flags(v4l2_dev_t *vd, int id)
                             ctrl_that = v4l2core_get_control_by_id(
                                 vd, V4L2_CID_EXPOSURE_ABSOLUTE );
                             if (ctrl_that)
-                                ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                                ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                         }
                         break;
 
@@ -678,15 +712,15 @@ static void update_ctrl_flags(v4l2_dev_t *vd, int id)
                             v4l2_ctrl_t *ctrl_that = v4l2core_get_control_by_id(
                                 vd, V4L2_CID_EXPOSURE_ABSOLUTE );
                             if (ctrl_that)
-                                ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                                ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                             ctrl_that = v4l2core_get_control_by_id(
                                 vd, V4L2_CID_IRIS_ABSOLUTE );
                             if (ctrl_that)
-                                ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                                ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                             ctrl_that = v4l2core_get_control_by_id(
                                 vd, V4L2_CID_IRIS_RELATIVE );
                             if (ctrl_that)
-                                ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                                ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                         }
                         break;
                 }
@@ -715,12 +749,12 @@ static void update_ctrl_flags(v4l2_dev_t *vd, int id)
                     v4l2_ctrl_t *ctrl_that = v4l2core_get_control_by_id(
                         vd, V4L2_CID_FOCUS_ABSOLUTE);
                     if (ctrl_that)
-                        ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                        ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
 
                     ctrl_that = v4l2core_get_control_by_id(
                         vd, V4L2_CID_FOCUS_RELATIVE);
                     if (ctrl_that)
-                        ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                        ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                 }
             }
             break;
@@ -742,7 +776,7 @@ static void update_ctrl_flags(v4l2_dev_t *vd, int id)
                     v4l2_ctrl_t *ctrl_that = v4l2core_get_control_by_id(
                         vd, V4L2_CID_HUE);
                     if (ctrl_that)
-                        ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                        ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                 }
             }
             break;
@@ -773,15 +807,15 @@ static void update_ctrl_flags(v4l2_dev_t *vd, int id)
                     v4l2_ctrl_t *ctrl_that = v4l2core_get_control_by_id(
                         vd, V4L2_CID_WHITE_BALANCE_TEMPERATURE);
                     if (ctrl_that)
-                        ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                        ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                     ctrl_that = v4l2core_get_control_by_id(
                         vd, V4L2_CID_BLUE_BALANCE);
                     if (ctrl_that)
-                        ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                        ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                     ctrl_that = v4l2core_get_control_by_id(
                         vd, V4L2_CID_RED_BALANCE);
                     if (ctrl_that)
-                        ctrl_that->control.flags &= !(V4L2_CTRL_FLAG_GRABBED);
+                        ctrl_that->control.flags &= ~(V4L2_CTRL_FLAG_GRABBED);
                 }
             }
             break;
@@ -836,6 +870,247 @@ void disable_special_auto (v4l2_dev_t *vd, int id)
     }
 }
 
+/*
+ * store the control value as the current device value
+ * args:
+ *   control - pointer to control
+ *
+ * asserts:
+ *   none
+ *
+ * returns: void
+ */
+static void store_device_value(v4l2_ctrl_t *control)
+{
+	control->device_value = control->value;
+	control->device_value64 = control->value64;
+	control->device_value_valid = 1;
+}
+
+/*
+ * check if the control value differs from the device value
+ * args:
+ *   control - pointer to control
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if the control must be written, 0 otherwise
+ */
+static int control_value_changed(v4l2_ctrl_t *control)
+{
+	if(!control->device_value_valid)
+		return 1;
+
+	/*action controls (buttons, relative moves) are always written*/
+	if(control->control.type == V4L2_CTRL_TYPE_BUTTON ||
+		(control->control.flags & V4L2_CTRL_FLAG_WRITE_ONLY))
+		return 1;
+#ifdef V4L2_CTRL_FLAG_VOLATILE
+	if(control->control.flags & V4L2_CTRL_FLAG_VOLATILE)
+		return 1;
+#endif
+
+	switch(control->control.type)
+	{
+		case V4L2_CTRL_TYPE_STRING:
+			return 1; /*no device copy of strings*/
+		case V4L2_CTRL_TYPE_INTEGER64:
+			return (control->value64 != control->device_value64);
+		default:
+			return (control->value != control->device_value);
+	}
+}
+
+/*
+ * read the values of a group of controls of the same class
+ *  (single VIDIOC_G_EXT_CTRLS call with fallback to single controls)
+ * args:
+ *   vd - pointer to video device data
+ *   cclass - control class
+ *   clist - ext control list (ids set, strings allocated)
+ *   cl - controls matching clist entries
+ *   count - number of controls
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of controls that failed
+ */
+static int read_control_class(v4l2_dev_t *vd, int32_t cclass,
+	struct v4l2_ext_control *clist, v4l2_ctrl_t **cl, int count)
+{
+	int ret = 0;
+	int failed = 0;
+	int i = 0;
+	uint8_t ok[count];
+	memset(ok, 1, count);
+
+	struct v4l2_ext_controls ctrls = {0};
+	ctrls.ctrl_class = cclass;
+	ctrls.count = count;
+	ctrls.controls = clist;
+	ret = xioctl(vd->fd, VIDIOC_G_EXT_CTRLS, &ctrls);
+	if(ret)
+	{
+		fprintf(stderr, "V4L2_CORE: (VIDIOC_G_EXT_CTRLS) failed\n");
+		/*get the controls one by one*/
+		for(i=0; i < count; i++)
+		{
+			if( cclass == V4L2_CTRL_CLASS_USER
+				&& cl[i]->control.type != V4L2_CTRL_TYPE_STRING
+				&& cl[i]->control.type != V4L2_CTRL_TYPE_INTEGER64)
+			{
+				struct v4l2_control ctrl;
+				ctrl.id = clist[i].id;
+				ctrl.value = 0;
+				ret = xioctl(vd->fd, VIDIOC_G_CTRL, &ctrl);
+				if(ret == 0)
+					clist[i].value = ctrl.value;
+			}
+			else
+			{
+				ctrls.count = 1;
+				ctrls.controls = &clist[i];
+				ret = xioctl(vd->fd, VIDIOC_G_EXT_CTRLS, &ctrls);
+				if(ret)
+					fprintf(stderr, "V4L2_CORE: control id: 0x%08x failed to get (error %i)\n",
+						clist[i].id, ret);
+			}
+
+			if(ret)
+			{
+				ok[i] = 0;
+				failed++;
+			}
+		}
+	}
+
+	//fill in the values on the control list
+	for(i=0; i<count; i++)
+	{
+		v4l2_ctrl_t *ctrl = cl[i];
+
+		switch(ctrl->control.type)
+		{
+			case V4L2_CTRL_TYPE_STRING:
+			{
+				/*
+				 * string gets set on VIDIOC_G_EXT_CTRLS
+				 * add the maximum size to value
+				 */
+				if(ok[i])
+				{
+					unsigned len = strlen(clist[i].string);
+					unsigned max_len = ctrl->control.maximum;
+
+					strncpy(ctrl->string, clist[i].string, max_len + 1);
+					if(len > max_len)
+					{
+						ctrl->string[max_len] = 0; //Null terminated
+						fprintf(stderr, "V4L2_CORE: control (0x%08x) returned string size of %d when max is %d\n",
+							ctrl->control.id, len, max_len);
+					}
+				}
+
+				/*clean up*/
+				free(clist[i].string);
+				clist[i].string = NULL;
+				break;
+			}
+			case V4L2_CTRL_TYPE_INTEGER64:
+				if(ok[i])
+					ctrl->value64 = clist[i].value64;
+				break;
+			default:
+				if(ok[i])
+					ctrl->value = clist[i].value;
+				break;
+		}
+
+		if(ok[i])
+			store_device_value(ctrl);
+		else
+			ctrl->device_value_valid = 0;
+	}
+
+	return failed;
+}
+
+/*
+ * read the values of a set of controls from the device
+ *  controls are grouped by class (one ioctl per class)
+ * args:
+ *   vd - pointer to video device data
+ *   list - array of controls
+ *   n - number of controls in array
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid
+ *
+ * returns: number of controls that failed
+ */
+static int get_controls_batched(v4l2_dev_t *vd, v4l2_ctrl_t **list, int n)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(vd->fd > 0);
+
+	if(n <= 0)
+		return 0;
+
+	struct v4l2_ext_control clist[n];
+	v4l2_ctrl_t *cl[n];
+	uint8_t grouped[n];
+	memset(grouped, 0, n);
+
+	int failed = 0;
+	int i = 0, j = 0;
+
+	for(i = 0; i < n; i++)
+	{
+		if(grouped[i])
+			continue;
+
+		int32_t cclass = list[i]->cclass;
+		int count = 0;
+
+		for(j = i; j < n; j++)
+		{
+			if(grouped[j] || list[j]->cclass != cclass)
+				continue;
+
+			grouped[j] = 1;
+			v4l2_ctrl_t *control = list[j];
+
+			if(control->control.flags & V4L2_CTRL_FLAG_WRITE_ONLY)
+				continue;
+
+			memset(&clist[count], 0, sizeof(struct v4l2_ext_control));
+			clist[count].id = control->control.id;
+			clist[count].size = 0;
+			if(control->control.type == V4L2_CTRL_TYPE_STRING)
+			{
+				clist[count].size = control->control.maximum + 1;
+				clist[count].string = (char *) calloc(clist[count].size,  sizeof(char));
+				if(clist[count].string == NULL)
+				{
+					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (get_controls_batched): %s\n", strerror(errno));
+					exit(-1);
+				}
+			}
+			cl[count] = control;
+			count++;
+		}
+
+		if(count > 0)
+			failed += read_control_class(vd, cclass, clist, cl, count);
+	}
+
+	return failed;
+}
+
 /*
  * goes trough the control list and updates/retrieves current values
  * args:
@@ -859,123 +1134,14 @@ void get_v4l2_control_values (v4l2_dev_t *vd)
 		return;
 	}
 
-    int ret = 0;
-    struct v4l2_ext_control clist[vd->num_controls];
+    v4l2_ctrl_t *list[vd->num_controls];
     v4l2_ctrl_t *current = vd->list_device_controls;
+    int n = 0;
 
-    int count = 0;
-    int i = 0;
-
-    for(; current != NULL; current = current->next)
-    {
-        if(current->control.flags & V4L2_CTRL_FLAG_WRITE_ONLY)
-             continue;
-
-        clist[count].id = current->control.id;
-        clist[count].size = 0;
-        if(current->control.type == V4L2_CTRL_TYPE_STRING)
-        {
-            clist[count].size = current->control.maximum + 1;
-            clist[count].string = (char *) calloc(clist[count].size,  sizeof(char));
-            if(clist[count].string == NULL)
-			{
-				fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (get_v4l2_control_values): %s\n", strerror(errno));
-				exit(-1);
-			}
-        }
-        count++;
-
-        if((current->next == NULL) || (current->next->cclass != current->cclass))
-        {
-            struct v4l2_ext_controls ctrls = {0};
-            ctrls.ctrl_class = current->cclass;
-            ctrls.count = count;
-            ctrls.controls = clist;
-            ret = xioctl(vd->fd, VIDIOC_G_EXT_CTRLS, &ctrls);
-            if(ret)
-            {
-                fprintf(stderr, "V4L2_CORE: (VIDIOC_G_EXT_CTRLS) failed\n");
-                struct v4l2_control ctrl;
-                /*get the controls one by one*/
-                if( current->cclass == V4L2_CTRL_CLASS_USER
-					&& current->control.type != V4L2_CTRL_TYPE_STRING
-					&& current->control.type != V4L2_CTRL_TYPE_INTEGER64)
-                {
-                    fprintf(stderr, "V4L2_CORE: using VIDIOC_G_CTRL for user class controls\n");
-                    for(i=0; i < count; i++)
-                    {
-                        ctrl.id = clist[i].id;
-                        ctrl.value = 0;
-                        ret = xioctl(vd->fd, VIDIOC_G_CTRL, &ctrl);
-                        if(ret)
-                            continue;
-                        clist[i].value = ctrl.value;
-                    }
-                }
-                else
-                {
-                    fprintf(stderr, "V4L2_CORE: using VIDIOC_G_EXT_CTRLS on single controls for class: 0x%08x\n",
-                        current->cclass);
-                    for(i=0;i < count; i++)
-                    {
-                        ctrls.count = 1;
-                        ctrls.controls = &clist[i];
-                        ret = xioctl(vd->fd, VIDIOC_G_EXT_CTRLS, &ctrls);
-                        if(ret)
-                            fprintf(stderr, "V4L2_CORE: control id: 0x%08x failed to get (error %i)\n",
-                                clist[i].id, ret);
-                    }
-                }
-            }
-
-            //fill in the values on the control list
-            for(i=0; i<count; i++)
-            {
-                v4l2_ctrl_t *ctrl = v4l2core_get_control_by_id(vd, clist[i].id);
-                if(!ctrl)
-                {
-                    fprintf(stderr, "V4L2_CORE: couldn't get control for id: %i\n", clist[i].id);
-                    continue;
-                }
-                switch(ctrl->control.type)
-                {
+    for(; current != NULL && n < vd->num_controls; current = current->next)
+        list[n++] = current;
 
-                    case V4L2_CTRL_TYPE_STRING:
-                    {
-                        /*
-                         * string gets set on VIDIOC_G_EXT_CTRLS
-                         * add the maximum size to value
-                         */
-                        unsigned len = strlen(clist[i].string);
-						unsigned max_len = ctrl->control.maximum;
-
-						strncpy(ctrl->string, clist[i].string, max_len + 1);
-						if(len > max_len)
-						{
-							ctrl->string[max_len + 1] = 0; //Null terminated
-							fprintf(stderr, "V4L2_CORE: control (0x%08x) returned string size of %d when max is %d\n",
-								ctrl->control.id, len, max_len);
-						}
-
-						/*clean up*/
-						free(clist[i].string);
-						clist[i].string = NULL;
-                        break;
-                    }
-                    case V4L2_CTRL_TYPE_INTEGER64:
-                        ctrl->value64 = clist[i].value64;
-                        break;
-                    default:
-                        ctrl->value = clist[i].value;
-                        //printf("V4L2_CORE: control %i [0x%08x] = %i\n",
-                        //    i, clist[i].id, clist[i].value);
-                        break;
-                }
-            }
-
-            count = 0;
-        }
-    }
+    get_controls_batched(vd, list, n);
 
     update_ctrl_list_flags(vd);
 }
@@ -1100,13 +1266,238 @@ int get_control_value_by_id (v4l2_dev_t *vd, int id)
         }
     }
 
+    if(ret)
+        control->device_value_valid = 0;
+    else
+        store_device_value(control);
+
     update_ctrl_flags(vd, id);
 
     return (ret);
 }
 
+/*
+ * fill the ext control data for setting a control value
+ * args:
+ *   control - pointer to control
+ *   ext - pointer to ext control data (to be filled)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: void (string controls get a newly allocated string)
+ */
+static void fill_set_ext_control(v4l2_ctrl_t *control, struct v4l2_ext_control *ext)
+{
+	memset(ext, 0, sizeof(struct v4l2_ext_control));
+	ext->id = control->control.id;
+
+	switch (control->control.type)
+	{
+		case V4L2_CTRL_TYPE_STRING:
+		{
+			unsigned len = strlen(control->string);
+			unsigned max_len = control->control.maximum;
+
+			if(len > max_len)
+			{
+				ext->size = max_len + 1;
+				ext->string = (char *) calloc(max_len + 1, sizeof(char));
+				if(ext->string == NULL)
+				{
+					fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (set_v4l2_control_values): %s\n", strerror(errno));
+					exit(-1);
+				}
+				ext->string = strncpy(ext->string, control->string, max_len);
+				ext->string[max_len] = 0; /*NULL terminated*/
+				fprintf(stderr, "V4L2_CORE: control (0x%08x) trying to set string size of %d when max is %d (clip)\n",
+					control->control.id, len, max_len);
+			}
+			else
+			{
+				ext->size = len + 1;
+				ext->string = (char *) strdup(control->string);
+			}
+			break;
+		}
+		case V4L2_CTRL_TYPE_INTEGER64:
+			ext->value64 = control->value64;
+			break;
+		default:
+			ext->value = control->value;
+			break;
+	}
+}
+
+/*
+ * write the values of a group of controls of the same class
+ *  (single VIDIOC_S_EXT_CTRLS call with fallback to single controls)
+ * args:
+ *   vd - pointer to video device data
+ *   cclass - control class
+ *   clist - ext control list (filled with fill_set_ext_control)
+ *   cl - controls matching clist entries
+ *   count - number of controls
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of controls that failed
+ */
+static int write_control_class(v4l2_dev_t *vd, int32_t cclass,
+	struct v4l2_ext_control *clist, v4l2_ctrl_t **cl, int count)
+{
+	int ret = 0;
+	int failed = 0;
+	int i = 0;
+
+	struct v4l2_ext_controls ctrls = {0};
+	ctrls.ctrl_class = cclass;
+	ctrls.count = count;
+	ctrls.controls = clist;
+	ret = xioctl(vd->fd, VIDIOC_S_EXT_CTRLS, &ctrls);
+	if(ret == 0)
+	{
+		for(i = 0; i < count; i++)
+			store_device_value(cl[i]);
+	}
+	else
+	{
+		fprintf(stderr, "V4L2_CORE: VIDIOC_S_EXT_CTRLS for multiple controls failed (error %i)\n", ret);
+		/*set the controls one by one*/
+		for(i=0;i < count; i++)
+		{
+			if( cclass == V4L2_CTRL_CLASS_USER
+				&& cl[i]->control.type != V4L2_CTRL_TYPE_STRING
+				&& cl[i]->control.type != V4L2_CTRL_TYPE_INTEGER64)
+			{
+				struct v4l2_control ctrl;
+				ctrl.id = clist[i].id;
+				ctrl.value = clist[i].value;
+				ret = xioctl(vd->fd, VIDIOC_S_CTRL, &ctrl);
+			}
+			else
+			{
+				ctrls.count = 1;
+				ctrls.controls = &clist[i];
+				ret = xioctl(vd->fd, VIDIOC_S_EXT_CTRLS, &ctrls);
+			}
+
+			if(ret)
+			{
+				fprintf(stderr, "V4L2_CORE: control(0x%08x) \"%s\" failed to set (error %i)\n",
+					clist[i].id, cl[i]->control.name, ret);
+				cl[i]->device_value_valid = 0;
+				failed++;
+			}
+			else
+				store_device_value(cl[i]);
+		}
+	}
+
+	for(i = 0; i < count; i++)
+	{
+		if(cl[i]->control.type == V4L2_CTRL_TYPE_STRING)
+		{
+			free(clist[i].string); //free allocated string
+			clist[i].string = NULL;
+		}
+	}
+
+	return failed;
+}
+
+/*
+ * write the values of a set of controls to the device
+ *  controls are grouped by class (one ioctl per class)
+ * args:
+ *   vd - pointer to video device data
+ *   list - array of controls
+ *   n - number of controls in array
+ *   changed_only - only write controls with values that differ
+ *                  from the last value read from/written to the device
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid
+ *
+ * returns: number of controls that failed
+ */
+int set_controls_batched(v4l2_dev_t *vd, v4l2_ctrl_t **list, int n, int changed_only)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(vd->fd > 0);
+
+	if(n <= 0)
+		return 0;
+
+	struct v4l2_ext_control clist[n];
+	v4l2_ctrl_t *cl[n];
+	uint8_t grouped[n];
+	memset(grouped, 0, n);
+
+	int failed = 0;
+	int written = 0;
+	int i = 0, j = 0;
+
+	for(i = 0; i < n; i++)
+	{
+		if(grouped[i])
+			continue;
+
+		int32_t cclass = list[i]->cclass;
+		int count = 0;
+
+		for(j = i; j < n; j++)
+		{
+			if(grouped[j] || list[j]->cclass != cclass)
+				continue;
+
+			grouped[j] = 1;
+			v4l2_ctrl_t *control = list[j];
+
+			if(control->control.flags & V4L2_CTRL_FLAG_READ_ONLY)
+				continue;
+
+			if(changed_only && !control_value_changed(control))
+				continue;
+
+			if(verbosity > 0)
+				printf("\tcontrol[0x%08x] = %i\n", control->control.id, control->value);
+
+			/*use raw xu control for pan/tilt - prevents uvcvideo cache bug*/
+			if((control->control.id == V4L2_CID_PAN_RELATIVE ||
+				control->control.id == V4L2_CID_TILT_RELATIVE) &&
+				vd->pantilt_unit_id > 0)
+			{
+				if(set_control_value_by_id(vd, control->control.id))
+					failed++;
+				written++;
+				continue;
+			}
+
+			fill_set_ext_control(control, &clist[count]);
+			cl[count] = control;
+			count++;
+		}
+
+		if(count > 0)
+		{
+			failed += write_control_class(vd, cclass, clist, cl, count);
+			written += count;
+		}
+	}
+
+	if(verbosity > 1)
+		printf("V4L2_CORE: wrote %i of %i controls (%i failed)\n", written, n, failed);
+
+	return failed;
+}
+
 /*
  * goes trough the control list and sets values in device
+ *  (only controls with changed values are written)
  * args:
  *   vd - pointer to video device data
  *
@@ -1128,128 +1519,196 @@ void set_v4l2_control_values (v4l2_dev_t *vd)
 		return;
 	}
 
-    int ret = 0;
-    struct v4l2_ext_control clist[vd->num_controls];
+	if(verbosity > 0)
+		printf("V4L2_CORE: setting control values\n");
+
+    v4l2_ctrl_t *list[vd->num_controls];
     v4l2_ctrl_t *current = vd->list_device_controls;
+    int n = 0;
 
-    int count = 0;
-    int i = 0;
+    for(; current != NULL && n < vd->num_controls; current = current->next)
+        list[n++] = current;
 
-	if(verbosity > 0)
-		printf("V4L2_CORE: setting control values\n");
+    set_controls_batched(vd, list, n, 1);
+}
 
-    for(; current != NULL; current = current->next)
-    {
-        if(current->control.flags & V4L2_CTRL_FLAG_READ_ONLY)
-            continue;
+/*
+ * sets the values of a set of controls in the device
+ *  (batched by control class, unchanged values are not written)
+ * args:
+ *   vd - pointer to video device data
+ *   ids - array of control ids
+ *   values - array of control values (NULL to use the current control values)
+ *   n - number of controls
+ *
+ * asserts:
+ *   vd is not null
+ *   ids is not null
+ *
+ * returns: number of controls that failed to set (0 - E_OK)
+ *          or error code (< 0)
+ */
+int set_control_values_by_id(v4l2_dev_t *vd, const int *ids, const int32_t *values, int n)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(ids != NULL);
 
-        clist[count].id = current->control.id;
-        switch (current->control.type)
-        {
-            case V4L2_CTRL_TYPE_STRING:
-            {
-				unsigned len = strlen(current->string);
-				unsigned max_len = current->control.maximum;
+	if(n <= 0)
+		return E_OK;
 
-				if(len > max_len)
-				{
-					clist[count].size = max_len + 1;
-					clist[count].string = (char *) calloc(max_len + 1, sizeof(char));
-					if(clist[count].string == NULL)
-					{
-						fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (set_v4l2_control_values): %s\n", strerror(errno));
-						exit(-1);
-					}
-					clist[count].string = strncpy(clist[count].string, current->string, max_len);
-					clist[count].string[max_len + 1] = 0; /*NULL terminated*/
-					fprintf(stderr, "V4L2_CORE: control (0x%08x) trying to set string size of %d when max is %d (clip)\n",
-						current->control.id, len, max_len);
-				}
-				else
-				{
-					clist[count].size = len + 1;
-					clist[count].string = (char *) strdup(current->string);
-				}
-                break;
-            }
-            case V4L2_CTRL_TYPE_INTEGER64:
-                clist[count].value64 = current->value64;
-                break;
-            default:
-				if(verbosity > 0)
-					printf("\tcontrol[%i] = %i\n", count, current->value);
-                clist[count].value = current->value;
-                break;
-        }
-        count++;
+	v4l2_ctrl_t *list[n];
+	int count = 0;
+	int i = 0;
 
-        if((current->next == NULL) || (current->next->cclass != current->cclass))
-        {
-            struct v4l2_ext_controls ctrls = {0};
-            ctrls.ctrl_class = current->cclass;
-            ctrls.count = count;
-            ctrls.controls = clist;
-            ret = xioctl(vd->fd, VIDIOC_S_EXT_CTRLS, &ctrls);
-            if(ret)
-            {
-                fprintf(stderr, "V4L2_CORE: VIDIOC_S_EXT_CTRLS for multiple controls failed (error %i)\n", ret);
-                struct v4l2_control ctrl;
-                /*set the controls one by one*/
-                if( current->cclass == V4L2_CTRL_CLASS_USER
-					&& current->control.type != V4L2_CTRL_TYPE_STRING
-					&& current->control.type != V4L2_CTRL_TYPE_INTEGER64)
-                {
-                    fprintf(stderr, "V4L2_CORE: using VIDIOC_S_CTRL for user class controls\n");
-                    for(i=0;i < count; i++)
-                    {
-                        ctrl.id = clist[i].id;
-                        ctrl.value = clist[i].value;
-                        ret = xioctl(vd->fd, VIDIOC_S_CTRL, &ctrl);
-                        if(ret)
-                        {
-                            v4l2_ctrl_t *ctrl = v4l2core_get_control_by_id(vd, clist[i].id);
-                            if(ctrl)
-                                fprintf(stderr, "V4L2_CORE: control(0x%08x) \"%s\" failed to set (error %i)\n",
-                                    clist[i].id, ctrl->control.name, ret);
-                            else
-								fprintf(stderr, "V4L2_CORE: control(0x%08x) failed to set (error %i)\n",
-                                    clist[i].id, ret);
-                        }
-                    }
-                }
-                else
-                {
-                    fprintf(stderr, "V4L2_CORE: using VIDIOC_S_EXT_CTRLS on single controls for class: 0x%08x\n",
-                        current->cclass);
-                    for(i=0;i < count; i++)
-                    {
-                        ctrls.count = 1;
-                        ctrls.controls = &clist[i];
-                        ret = xioctl(vd->fd, VIDIOC_S_EXT_CTRLS, &ctrls);
+	for(i = 0; i < n; i++)
+	{
+		v4l2_ctrl_t *control = get_control_by_id(vd, ids[i]);
+		if(control == NULL)
+		{
+			fprintf(stderr, "V4L2_CORE: (set controls batch) unknown control id 0x%08x\n", ids[i]);
+			return E_UNKNOWN_CID_ERR;
+		}
 
-                        v4l2_ctrl_t *ctrl = v4l2core_get_control_by_id(vd, clist[i].id);
+		if(values)
+		{
+			if(control->control.type == V4L2_CTRL_TYPE_INTEGER64)
+				control->value64 = values[i];
+			else
+				control->value = values[i];
+		}
 
-                        if(ret)
-                        {
-                            if(ctrl)
-                                fprintf(stderr, "V4L2_CORE: control(0x%08x) \"%s\" failed to set (error %i)\n",
-                                    clist[i].id, ctrl->control.name, ret);
-                            else
-								fprintf(stderr, "V4L2_CORE: control(0x%08x) failed to set (error %i)\n",
-                                    clist[i].id, ret);
-                        }
-                        if(ctrl && ctrl->control.type == V4L2_CTRL_TYPE_STRING)
-                        {
-							free(clist[i].string); //free allocated string
-							clist[i].string = NULL;
-						}
-                    }
-                }
-            }
-            count = 0;
-        }
-    }
+		list[count++] = control;
+	}
+
+	int failed = set_controls_batched(vd, list, count, 1);
+
+	/*update the real values and flags (one read per class)*/
+	get_controls_batched(vd, list, count);
+	update_ctrl_list_flags(vd);
+
+	return failed;
+}
+
+/*
+ * check if control id is an auto mode control
+ *  (auto modes must be set before their manual counterparts)
+ * args:
+ *   id - control id
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if auto mode control, 0 otherwise
+ */
+static int is_auto_control(int id)
+{
+	switch(id)
+	{
+		case V4L2_CID_EXPOSURE_AUTO:
+		case V4L2_CID_EXPOSURE_AUTO_PRIORITY:
+		case V4L2_CID_FOCUS_AUTO:
+		case V4L2_CID_HUE_AUTO:
+		case V4L2_CID_AUTO_WHITE_BALANCE:
+		case V4L2_CID_AUTOGAIN:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/*
+ * write the changed values of a set of controls to the device
+ *  in dependency order: auto modes first, then the manual
+ *  controls not grabbed by the new auto modes (grabbed controls
+ *  are read back from the device)
+ * args:
+ *   vd - pointer to video device data
+ *   list - array of controls (with the new values set)
+ *   n - number of controls in array
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid
+ *
+ * returns: number of controls that failed
+ */
+int set_control_values_ordered(v4l2_dev_t *vd, v4l2_ctrl_t **list, int n)
+{
+	/*asserts*/
+	assert(vd != NULL);
+	assert(vd->fd > 0);
+
+	if(n <= 0)
+		return 0;
+
+	v4l2_ctrl_t *auto_list[n];
+	v4l2_ctrl_t *manual_list[n];
+	v4l2_ctrl_t *written[n];
+	int n_auto = 0;
+	int n_manual = 0;
+	int n_written = 0;
+	int failed = 0;
+	int i = 0;
+
+	for(i = 0; i < n; i++)
+	{
+		v4l2_ctrl_t *control = list[i];
+
+		if((control->control.flags & V4L2_CTRL_FLAG_READ_ONLY) ||
+			!control_value_changed(control))
+			continue;
+
+		if(!is_auto_control(control->control.id))
+		{
+			manual_list[n_manual++] = control;
+			continue;
+		}
+
+		/*special auto controls have higher ids than their manual counterparts*/
+		if(control->value == 0 &&
+			(control->control.id == V4L2_CID_FOCUS_AUTO ||
+			 control->control.id == V4L2_CID_HUE_AUTO))
+		{
+			disable_special_auto(vd, control->control.id);
+			continue;
+		}
+
+		auto_list[n_auto++] = control;
+		written[n_written++] = control;
+	}
+
+	failed += set_controls_batched(vd, auto_list, n_auto, 1);
+
+	/*flag the manual controls grabbed by the new auto modes*/
+	update_ctrl_list_flags(vd);
+
+	/*
+	 * grabbed controls are not written but are still read back below,
+	 * so that their value matches the device again (not the target value)
+	 */
+	int count = 0;
+	for(i = 0; i < n_manual; i++)
+	{
+		written[n_written++] = manual_list[i];
+
+		if(manual_list[i]->control.flags & V4L2_CTRL_FLAG_GRABBED)
+			continue;
+
+		manual_list[count++] = manual_list[i];
+	}
+
+	failed += set_controls_batched(vd, manual_list, count, 1);
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: (ordered set) %i auto and %i manual controls changed\n",
+			n_auto, count);
+
+	/*update the real values and flags (one read per class)*/
+	get_controls_batched(vd, written, n_written);
+	update_ctrl_list_flags(vd);
 
+	return failed;
 }
 
 /*
@@ -39,6 +39,27 @@
  */
 int enumerate_v4l2_control(v4l2_dev_t *vd);
 
+/*
+ * add control to control list from already queried data
+ *  (also used for controls loaded from the enumeration cache)
+ * args:
+ *   vd - pointer to video device data
+ *   queryctrl - pointer to v4l2_queryctrl data
+ *   menu - menu list (NULL if not a menu) - owned by the control
+ *   menu_entries - number of menu entries (not counting the last NULL entry)
+ *   current - pointer to pointer of current control from control list
+ *   first - pointer to pointer of first control from control list
+ *
+ * asserts:
+ *   vd is not null
+ *   queryctrl is not null
+ *
+ * returns: pointer to newly added control
+ */
+v4l2_ctrl_t *add_control_data(v4l2_dev_t *vd, struct v4l2_queryctrl* queryctrl,
+	struct v4l2_querymenu* menu, int menu_entries,
+	v4l2_ctrl_t **current, v4l2_ctrl_t **first);
+
 /*
  * subscribe for v4l2 control events
  * args:
@@ -130,6 +151,58 @@ void get_v4l2_control_values (v4l2_dev_t *vd);
  */
 void set_v4l2_control_values (v4l2_dev_t *vd);
 
+/*
+ * write the values of a set of controls to the device
+ *  controls are grouped by class (one ioctl per class)
+ * args:
+ *   vd - pointer to video device data
+ *   list - array of controls
+ *   n - number of controls in array
+ *   changed_only - only write controls with changed values
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid
+ *
+ * returns: number of controls that failed
+ */
+int set_controls_batched(v4l2_dev_t *vd, v4l2_ctrl_t **list, int n, int changed_only);
+
+/*
+ * sets the values of a set of controls in the device
+ *  (batched by control class, unchanged values are not written)
+ * args:
+ *   vd - pointer to video device data
+ *   ids - array of control ids
+ *   values - array of control values (NULL to use the current control values)
+ *   n - number of controls
+ *
+ * asserts:
+ *   vd is not null
+ *   ids is not null
+ *
+ * returns: number of controls that failed to set (0 - E_OK)
+ *          or error code (< 0)
+ */
+int set_control_values_by_id(v4l2_dev_t *vd, const int *ids, const int32_t *values, int n);
+
+/*
+ * write the changed values of a set of controls to the device
+ *  in dependency order: auto modes first, then the manual
+ *  controls not grabbed by the new auto modes
+ * args:
+ *   vd - pointer to video device data
+ *   list - array of controls (with the new values set)
+ *   n - number of controls in array
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid
+ *
+ * returns: number of controls that failed
+ */
+int set_control_values_ordered(v4l2_dev_t *vd, v4l2_ctrl_t **list, int n);
+
 /*
  * goes trough the control list and sets values in device to default
  * args:
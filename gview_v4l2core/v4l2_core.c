@@ -50,35 +50,39 @@
 #include "core_time.h"
 #include "uvc_h264.h"
 #include "frame_decoder.h"
+#include "jpeg_decoder.h"
+#include "decode_pool.h"
+#include "v4l2_cache.h"
 #include "control_profile.h"
 #include "v4l2_formats.h"
 #include "v4l2_controls.h"
 #include "v4l2_devices.h"
+#include "colorspaces.h"
+#include "thread_pool.h"
 #include "../config.h"
 
 #ifndef GETTEXT_PACKAGE_V4L2CORE
 #define GETTEXT_PACKAGE_V4L2CORE "gview_v4l2core"
 #endif
 
+#ifndef V4L2_BUF_FLAG_TIMESTAMP_MASK
+#define V4L2_BUF_FLAG_TIMESTAMP_MASK      0x0000e000
+#define V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC 0x00002000
+#endif
+
 #define __PMUTEX &(vd->mutex)
 
 /*verbosity (global scope)*/
 int verbosity = 0;
 
-/*requested format data*/
-static int my_pixelformat = 0;
-static int my_width = 0;
-static int my_height = 0;
-
-static uint64_t fps_ref_ts = 0;
-static uint32_t fps_frame_count = 0;
-
-static uint8_t flag_fps_change = 0; /*set to 1 to request a fps change*/
-
 static uint8_t disable_libv4l2 = 0; /*set to 1 to disable libv4l2 calls*/
 
 static int frame_queue_size = 1; /*just one frame in queue (enough for a single thread)*/
 
+static uint32_t dev_serial_count = 0; /*device serial counter (see v4l2_poll.c)*/
+
+static int open_dev_count = 0; /*open device handlers (the thread pool is closed with the last one)*/
+
 /*
  * ioctl with a number of retries in the case of I/O failure
  * args:
@@ -122,9 +126,12 @@ int xioctl(int fd, int IOCTL_X, void *arg)
  */
 void __attribute__ ((constructor)) v4l2core_init()
 {
-	//initialize device list (with udev monitoring)
-	v4l2core_init_device_list();
-	
+	/*
+	 * the device list (with udev monitoring) is initiated on first
+	 * use or with v4l2core_init_device_list - linking the library
+	 * doesn't probe the devices
+	 */
+
 	/*set defaults*/
 	frame_queue_size = 1;
 	disable_libv4l2 = 0;
@@ -201,19 +208,26 @@ static int check_v4l2_dev(v4l2_dev_t *vd)
 	if(verbosity > 0)
 		printf("V4L2_CORE: Init. %s (location: %s)\n", vd->cap.card, vd->cap.bus_info);
 
-	/*enumerate frame formats supported by device*/
-	int ret = enum_frame_formats(vd);
-	if(ret != E_OK)
+	/*try the enumeration cache first (skips the full device probe)*/
+	if(load_enum_cache(vd) != E_OK)
 	{
-		fprintf(stderr, "V4L2_CORE: no valid frame formats (with valid sizes) found for device\n");
-		return ret;
-	}	
+		/*enumerate frame formats supported by device*/
+		int ret = enum_frame_formats(vd);
+		if(ret != E_OK)
+		{
+			fprintf(stderr, "V4L2_CORE: no valid frame formats (with valid sizes) found for device\n");
+			return ret;
+		}	
+
+		/*add h264 (uvc muxed) to format list if supported by device*/
+		add_h264_format(vd);
 
-	/*add h264 (uvc muxed) to format list if supported by device*/
-	add_h264_format(vd);
+		/*enumerate device controls*/
+		enumerate_v4l2_control(vd);
+
+		save_enum_cache(vd);
+	}
 
-	/*enumerate device controls*/
-	enumerate_v4l2_control(vd);
 	/*gets the current control values and sets their flags*/
 	get_v4l2_control_values(vd);
 
@@ -227,6 +241,103 @@ static int check_v4l2_dev(v4l2_dev_t *vd)
 	return E_OK;
 }
 
+/*
+ * get the v4l2 memory type for the current capture method
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: v4l2 memory type (V4L2_MEMORY_MMAP or V4L2_MEMORY_USERPTR)
+ */
+static uint32_t get_v4l2_memory(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	/*dmabuf fds are exported from mmap buffers*/
+	if(vd->cap_meth == IO_USERPTR)
+		return V4L2_MEMORY_USERPTR;
+
+	return V4L2_MEMORY_MMAP;
+}
+
+/*
+ * free the driver buffer arrays
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+static void free_buff_arrays(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	if(vd->mem)
+		free(vd->mem);
+	vd->mem = NULL;
+	if(vd->buff_length)
+		free(vd->buff_length);
+	vd->buff_length = NULL;
+	if(vd->buff_offset)
+		free(vd->buff_offset);
+	vd->buff_offset = NULL;
+	if(vd->dmabuf_fd)
+		free(vd->dmabuf_fd);
+	vd->dmabuf_fd = NULL;
+
+	vd->buff_count = 0;
+}
+
+/*
+ * alloc the driver buffer arrays (buffers must be unmapped)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   count - number of driver buffers
+ *
+ * asserts:
+ *   vd is not null
+ *   count > 0
+ *
+ * returns: error code  (0- E_OK)
+ */
+static int alloc_buff_arrays(v4l2_dev_t *vd, int count)
+{
+	/*assertions*/
+	assert(vd != NULL);
+	assert(count > 0);
+
+	free_buff_arrays(vd);
+
+	vd->mem = calloc(count, sizeof(void *));
+	vd->buff_length = calloc(count, sizeof(uint32_t));
+	vd->buff_offset = calloc(count, sizeof(uint32_t));
+	vd->dmabuf_fd = calloc(count, sizeof(int));
+
+	if(vd->mem == NULL || vd->buff_length == NULL ||
+		vd->buff_offset == NULL || vd->dmabuf_fd == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_buff_arrays): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	vd->buff_count = count;
+
+	int i = 0;
+	for (i = 0; i < vd->buff_count; i++)
+	{
+		vd->mem[i] = MAP_FAILED; /*not mmaped yet*/
+		vd->dmabuf_fd[i] = -1; /*not exported yet*/
+	}
+
+	return E_OK;
+}
+
 /*
  * unmaps v4l2 buffers
  * args:
@@ -252,8 +363,29 @@ static int unmap_buff(v4l2_dev_t *vd)
 		case IO_READ:
 			break;
 
+		case IO_USERPTR:
+			for (i = 0; i < vd->buff_count; i++)
+			{
+				// free user pointer buffer
+				if((vd->mem[i] != MAP_FAILED) && (vd->mem[i] != NULL))
+					free(vd->mem[i]);
+				vd->mem[i] = MAP_FAILED;
+				vd->buff_length[i] = 0;
+			}
+			break;
+
+		case IO_DMABUF:
+			for (i = 0; i < vd->buff_count; i++)
+			{
+				// close exported dmabuf
+				if(vd->dmabuf_fd[i] >= 0)
+					close(vd->dmabuf_fd[i]);
+				vd->dmabuf_fd[i] = -1;
+			}
+			/*fall through*/
 		case IO_MMAP:
-			for (i = 0; i < NB_BUFFER; i++)
+		default:
+			for (i = 0; i < vd->buff_count; i++)
 			{
 				// unmap old buffer
 				if((vd->mem[i] != MAP_FAILED) && vd->buff_length[i])
@@ -261,11 +393,53 @@ static int unmap_buff(v4l2_dev_t *vd)
 					{
 						fprintf(stderr, "V4L2_CORE: couldn't unmap buff: %s\n", strerror(errno));
 					}
+				vd->mem[i] = MAP_FAILED;
 			}
 	}
 	return ret;
 }
 
+/*
+ * exports mmaped v4l2 buffers as dmabuf fds
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code  (0- E_OK)
+ */
+static int export_buff(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	if(verbosity > 2)
+		printf("V4L2_CORE: exporting v4l2 buffers\n");
+
+	int i = 0;
+	for (i = 0; i < vd->buff_count; i++)
+	{
+		struct v4l2_exportbuffer expbuf;
+		memset(&expbuf, 0, sizeof(struct v4l2_exportbuffer));
+		expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		expbuf.index = i;
+		expbuf.flags = O_RDONLY | O_CLOEXEC;
+
+		if(xioctl(vd->fd, VIDIOC_EXPBUF, &expbuf) < 0)
+		{
+			fprintf(stderr, "V4L2_CORE: (VIDIOC_EXPBUF) Unable to export buffer[%i]: %s\n", i, strerror(errno));
+			return E_EXPBUF_ERR;
+		}
+		vd->dmabuf_fd[i] = expbuf.fd;
+
+		if(verbosity > 1)
+			printf("V4L2_CORE: exported buffer[%i] as dmabuf fd %i\n", i, vd->dmabuf_fd[i]);
+	}
+
+	return E_OK;
+}
+
 /*
  * maps v4l2 buffers
  * args:
@@ -286,7 +460,7 @@ static int map_buff(v4l2_dev_t *vd)
 
 	int i = 0;
 	// map new buffer
-	for (i = 0; i < NB_BUFFER; i++)
+	for (i = 0; i < vd->buff_count; i++)
 	{
 		vd->mem[i] = v4l2_mmap( NULL, // start anywhere
 			vd->buff_length[i],
@@ -306,9 +480,63 @@ static int map_buff(v4l2_dev_t *vd)
 				vd->mem[i]);
 	}
 
+	/*dmabuf capture also exports the mapped buffers*/
+	if(vd->cap_meth == IO_DMABUF)
+		return export_buff(vd);
+
 	return (E_OK);
 }
 
+/*
+ * allocates the user pointer buffer pool (page aligned)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code  (0- E_OK)
+ */
+static int alloc_userptr_buff(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	if(verbosity > 2)
+		printf("V4L2_CORE: allocating user pointer buffers\n");
+
+	size_t page_size = (size_t) getpagesize();
+	size_t buff_size = vd->format.fmt.pix.sizeimage;
+	if(buff_size == 0)
+		buff_size = (vd->format.fmt.pix.width) * (vd->format.fmt.pix.height) * 3; //worst case (rgb)
+	/*round up to the page size*/
+	buff_size = (buff_size + page_size - 1) & ~(page_size - 1);
+
+	int i = 0;
+	for (i = 0; i < vd->buff_count; i++)
+	{
+		void *ptr = NULL;
+		if(posix_memalign(&ptr, page_size, buff_size) != 0)
+		{
+			fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (alloc_userptr_buff): %s\n", strerror(errno));
+			exit(-1);
+		}
+		vd->mem[i] = ptr;
+		vd->buff_length[i] = buff_size;
+		vd->buff_offset[i] = 0;
+
+		if(verbosity > 1)
+			printf("V4L2_CORE: allocated user buffer[%i] with length %i at pos %p\n",
+				i,
+				vd->buff_length[i],
+				vd->mem[i]);
+	}
+
+	vd->buf.length = buff_size;
+
+	return E_OK;
+}
+
 /*
  * Query and map buffers
  * args:
@@ -335,8 +563,15 @@ static int query_buff(v4l2_dev_t *vd)
 		case IO_READ:
 			break;
 
+		case IO_USERPTR:
+			/*no driver buffers to query, use our own pool*/
+			ret = alloc_userptr_buff(vd);
+			break;
+
 		case IO_MMAP:
-			for (i = 0; i < NB_BUFFER; i++)
+		case IO_DMABUF:
+		default:
+			for (i = 0; i < vd->buff_count; i++)
 			{
 				memset(&vd->buf, 0, sizeof(struct v4l2_buffer));
 				vd->buf.index = i;
@@ -402,8 +637,10 @@ static int queue_buff(v4l2_dev_t *vd)
 			break;
 
 		case IO_MMAP:
+		case IO_USERPTR:
+		case IO_DMABUF:
 		default:
-			for (i = 0; i < NB_BUFFER; ++i)
+			for (i = 0; i < vd->buff_count; ++i)
 			{
 				memset(&vd->buf, 0, sizeof(struct v4l2_buffer));
 				vd->buf.index = i;
@@ -412,7 +649,12 @@ static int queue_buff(v4l2_dev_t *vd)
 				//vd->buf.timecode = vd->timecode;
 				//vd->buf.timestamp.tv_sec = 0;
 				//vd->buf.timestamp.tv_usec = 0;
-				vd->buf.memory = V4L2_MEMORY_MMAP;
+				vd->buf.memory = get_v4l2_memory(vd);
+				if(vd->cap_meth == IO_USERPTR)
+				{
+					vd->buf.m.userptr = (unsigned long) vd->mem[i];
+					vd->buf.length = vd->buff_length[i];
+				}
 				ret = xioctl(vd->fd, VIDIOC_QBUF, &vd->buf);
 				if (ret < 0)
 				{
@@ -510,6 +752,9 @@ static int set_v4l2_framerate (v4l2_dev_t *vd)
 			break;
 
 		case IO_MMAP:
+		case IO_USERPTR:
+		case IO_DMABUF:
+		default:
 			if(stream_status == STRM_OK)
 			{
 				/*unmap the buffers*/
@@ -522,7 +767,7 @@ static int set_v4l2_framerate (v4l2_dev_t *vd)
 			 * since we are restarting the video stream and codec values will be reset
 			 * commit the codec data again
 			 */
-			if(vd->requested_fmt == V4L2_PIX_FMT_H264 && h264_get_support() == H264_MUXED)
+			if(vd->requested_fmt == V4L2_PIX_FMT_H264 && h264_get_support(vd) == H264_MUXED)
 			{
 				if(verbosity > 0)
 					printf("V4L2_CORE: setting muxed H264 stream in MJPG container\n");
@@ -533,7 +778,7 @@ static int set_v4l2_framerate (v4l2_dev_t *vd)
 	
 	if(stream_status == STRM_OK)
 	{
-		query_buff(vd); /*also mmaps the buffers*/
+		query_buff(vd); /*also mmaps (or allocs) the buffers*/
 		queue_buff(vd);
 	}
 
@@ -583,14 +828,25 @@ static int check_frame_available(v4l2_dev_t *vd)
 	}
 
 	/*a fps change was requested while streaming*/
-	if(flag_fps_change > 0)
+	if(vd->flag_fps_change > 0)
 	{
 		if(verbosity > 2)
 			printf("V4L2_CORE: fps change request detected\n");
 		set_v4l2_framerate(vd);
-		flag_fps_change = 0;
+		vd->flag_fps_change = 0;
+		/*stream was restarted*/
+		vd->frame_ready = 0;
 	}
 
+	/*frame already signaled by v4l2core_poll_devices*/
+	__LOCK_MUTEX( __PMUTEX );
+	int frame_ready = vd->frame_ready;
+	vd->frame_ready = 0;
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	if(frame_ready)
+		return E_OK;
+
 	FD_ZERO(&rdset);
 	FD_SET(vd->fd, &rdset);
 	timeout.tv_sec = 1; /* 1 sec timeout*/
@@ -646,40 +902,251 @@ void v4l2core_set_frame_queue_size(int size)
 }
 
 /*
- * disable libv4l2 calls
+ * set the rgb to yuv matrix used when decoding rgb formats
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   matrix - YUV_MATRIX_BT601 (default) or YUV_MATRIX_BT709
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns void
+ */
+void v4l2core_set_yuv_matrix(v4l2_dev_t *vd, int matrix)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	vd->yuv_matrix = (matrix == YUV_MATRIX_BT709) ? YUV_MATRIX_BT709 : YUV_MATRIX_BT601;
+}
+
+/*
+ * set the demosaic filter used when decoding bayer formats
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   mode - DEMOSAIC_BILINEAR (default) or DEMOSAIC_MHC
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns void
+ */
+void v4l2core_set_demosaic_mode(v4l2_dev_t *vd, int mode)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	vd->demosaic_mode = (mode == DEMOSAIC_MHC) ? DEMOSAIC_MHC : DEMOSAIC_BILINEAR;
+}
+
+/*
+ * set the number of threads used for frame conversions
+ *  (colorspace conversions are split in row bands processed
+ *   by a thread pool private to the v4l2core library, the calling
+ *   thread included - each gview library has its own pool)
+ *  must not be called while a conversion is running
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - no worker threads)
+ *
+ * asserts:
+ *   none
+ *
+ * returns void
+ */
+void v4l2core_set_worker_threads(int nthreads)
+{
+	thread_pool_set_threads(nthreads);
+}
+
+/*
+ * set the threads used by the libavcodec decoders (mjpeg and h264)
+ *  takes effect on the next decoder init (format change), every
+ *  decoder context (see v4l2core_set_decoder_threads) gets its own threads
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - no threading)
+ *   type - allowed threading (CODEC_THREAD_ flags,
+ *          default CODEC_THREAD_SLICE - no added latency)
+ *
+ * asserts:
+ *   none
+ *
+ * returns void
+ */
+void v4l2core_set_codec_threads(int nthreads, int type)
+{
+	set_codec_threads(nthreads, type);
+}
+
+/*
+ * disable libv4l2 calls
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns void
+ */
+void v4l2core_disable_libv4l2()
+{
+	disable_libv4l2 = 1;
+}
+
+/*
+ * enable libv4l2 calls (default)
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns void
+ */
+void v4l2core_enable_libv4l2()
+{
+	disable_libv4l2 = 0;
+}
+
+/*
+ * set the number of driver buffers to request
+ *  (takes effect on the next v4l2core_update_current_format)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   count - number of buffers to request from the driver
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_set_buffer_count(v4l2_dev_t *vd, int count)
+{
+	/*asserts*/
+	assert(vd != NULL);
+
+	if(count < 1)
+	{
+		fprintf(stderr, "V4L2_CORE: invalid buffer count (%i) using %i\n", count, NB_BUFFER);
+		count = NB_BUFFER;
+	}
+
+	vd->requested_buff_count = count;
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: requesting %i driver buffers\n", vd->requested_buff_count);
+}
+
+/*
+ * get the number of driver buffers in use
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: number of buffers granted by the driver (VIDIOC_REQBUFS)
+ */
+int v4l2core_get_buffer_count(v4l2_dev_t *vd)
+{
+	/*asserts*/
+	assert(vd != NULL);
+
+	return vd->buff_count;
+}
+
+/*
+ * set the number of decoder threads used by v4l2core_get_decoded_frame
+ *  (set while not capturing; frames in flight are limited by the frame
+ *   queue size - 1 and the driver buffer count - 1)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   nthreads - number of decoder threads (< 2 decodes in the calling thread)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_decoder_threads(v4l2_dev_t *vd, int nthreads)
+{
+	/*asserts*/
+	assert(vd != NULL);
+
+	if(nthreads > 1 && vd->frame_queue_size < 3)
+		fprintf(stderr, "V4L2_CORE: frame queue size (%i) too small for pipelined decoding (set it with v4l2core_set_frame_queue_size)\n",
+			vd->frame_queue_size);
+
+	return decode_pool_init(vd, nthreads);
+}
+
+/*
+ * set the line size alignment of the decoded (yu12) frames
+ *  (takes effect on the next format change, v4l2core_update_current_format)
+ *  with an alignment > 1 the planes of v4l2core_frame_get_yuv are padded:
+ *  use v4l2core_frame_get_yuv_plane for the plane line sizes or
+ *  v4l2core_frame_get_yuv_packed for a tightly packed copy
  * args:
- *   none
+ *   vd - pointer to v4l2 device handler
+ *   align - line size alignment in bytes (power of 2, 1 - tightly packed)
  *
  * asserts:
- *   none
+ *   vd is not null
  *
- * returns void
+ * returns: error code (E_OK)
  */
-void v4l2core_disable_libv4l2()
+int v4l2core_set_frame_alignment(v4l2_dev_t *vd, int align)
 {
-	disable_libv4l2 = 1;
+	/*asserts*/
+	assert(vd != NULL);
+
+	if(align < 1 || align > 4096 || (align & (align - 1)))
+	{
+		fprintf(stderr, "V4L2_CORE: invalid frame alignment (%i): must be a power of 2 up to 4096\n", align);
+		return E_FORMAT_ERR;
+	}
+
+	vd->frame_alignment = align;
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: yuv frame line size alignment set to %i bytes\n", vd->frame_alignment);
+
+	return E_OK;
 }
 
 /*
- * enable libv4l2 calls (default)
+ * set yuv passthrough: frames already in yu12, yv12 or nv12 are not
+ *  copied, the yuv frame planes alias the raw (driver) frame
+ *  consumers must use the frame planes (v4l2core_frame_get_yuv_plane)
+ *  and check frame->yuv_format (nv12 has a single uv plane),
+ *  v4l2core_frame_get_yuv_packed always returns packed yu12 and
+ *  v4l2core_frame_get_yuv_writable must be used for in place changes
  * args:
- *   none
+ *   vd - pointer to v4l2 device handler
+ *   enable - 1 enable; 0 disable (default)
  *
  * asserts:
- *   none
+ *   vd is not null
  *
- * returns void
+ * returns: none
  */
-void v4l2core_enable_libv4l2()
+void v4l2core_set_yuv_passthrough(v4l2_dev_t *vd, int enable)
 {
-	disable_libv4l2 = 0;
+	/*asserts*/
+	assert(vd != NULL);
+
+	vd->yuv_passthrough = enable ? 1 : 0;
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: yuv passthrough %s\n", vd->yuv_passthrough ? "enabled" : "disabled");
 }
 
 /*
  * set v4l2 capture method to use
  * args:
  *   vd - pointer to v4l2 device handler
- *   method - capture method (IO_READ or IO_MMAP)
+ *   method - capture method (IO_READ, IO_MMAP, IO_USERPTR or IO_DMABUF)
  *
  * asserts:
  *   vd is not null
@@ -692,6 +1159,9 @@ void v4l2core_set_capture_method(v4l2_dev_t *vd, int method)
 	assert(vd != NULL);
 
 	vd->cap_meth = method;
+
+	if(verbosity > 0)
+		printf("V4L2_CORE: capture method set to %i\n", vd->cap_meth);
 }
 
 /*
@@ -774,6 +1244,36 @@ double v4l2core_get_realfps(v4l2_dev_t *vd)
 	return(vd->real_fps);
 }
 
+/*
+ * get stream statistics (frame drops, late and duplicate frames)
+ *  counters are reset on each v4l2core_start_stream
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   stats - pointer to stats struct to fill
+ *
+ * asserts:
+ *   vd is not null
+ *   stats is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_get_stream_stats(v4l2_dev_t *vd, v4l2_stream_stats_t *stats)
+{
+	/*assertions*/
+	assert(vd != NULL);
+	assert(stats != NULL);
+
+	/*lock the mutex*/
+	__LOCK_MUTEX( __PMUTEX );
+
+	memcpy(stats, &vd->stream_stats, sizeof(v4l2_stream_stats_t));
+
+	/*unlock the mutex*/
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	return E_OK;
+}
+
 /*
  * get videodevice name
  * args:
@@ -979,6 +1479,13 @@ int v4l2core_start_stream(v4l2_dev_t *vd)
 	}
 
 	vd->streaming = STRM_OK;
+
+	vd->frame_ready = 0;
+
+	/*reset stream statistics*/
+	memset(&vd->stream_stats, 0, sizeof(v4l2_stream_stats_t));
+	vd->last_sequence = 0;
+	vd->last_timestamp = 0;
 	
 	if(verbosity > 2)
 		printf("V4L2_CORE: (VIDIOC_STREAMON) stream_status = STRM_OK\n");
@@ -1027,6 +1534,9 @@ int v4l2core_stop_stream(v4l2_dev_t *vd)
 	/*assertions*/
 	assert(vd != NULL);
 
+	/*give back the frames still in the decoder pipeline*/
+	decode_pool_flush(vd);
+
 	int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	int ret=E_OK;
 	switch(vd->cap_meth)
@@ -1055,6 +1565,7 @@ int v4l2core_stop_stream(v4l2_dev_t *vd)
 
 /*
  * get next ready flaged frame from queue
+ *  (pops a free index from the lock-free ring, no status scan)
  * args:
  *    vd - pointer to v4l2 device handler
  *
@@ -1062,14 +1573,56 @@ int v4l2core_stop_stream(v4l2_dev_t *vd)
  */
 static int get_next_ready_frame(v4l2_dev_t *vd)
 {
-	int i = 0;
-	for(i=0; i<vd->frame_queue_size; ++i)
+	return frame_ring_pop(&vd->free_frames);
+}
+
+/*
+ * update stream statistics with a new dequeued frame
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   frame - pointer to the dequeued frame (timestamp and sequence set)
+ *   now - current monotonic time (ns)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void update_stream_stats(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, uint64_t now)
+{
+	vd->stream_stats.frames++;
+
+	if(vd->stream_stats.frames > 1)
+	{
+		int32_t seq_diff = (int32_t) (frame->sequence - vd->last_sequence);
+
+		if(seq_diff <= 0 || frame->timestamp <= vd->last_timestamp)
+		{
+			vd->stream_stats.duplicate++;
+			if(verbosity > 1)
+				fprintf(stderr, "V4L2_CORE: duplicate frame (seq: %u last: %u)\n",
+					frame->sequence, vd->last_sequence);
+		}
+		else if(seq_diff > 1)
+		{
+			vd->stream_stats.dropped += seq_diff - 1;
+			if(verbosity > 1)
+				fprintf(stderr, "V4L2_CORE: dropped %i frame(s) (seq: %u last: %u)\n",
+					seq_diff - 1, frame->sequence, vd->last_sequence);
+		}
+	}
+
+	/*a frame is late if dequeued more than two frame periods after capture*/
+	if(vd->stream_stats.driver_timestamps && vd->fps_denom > 0 && now > frame->timestamp)
 	{
-		if(vd->frame_queue[i].status == FRAME_READY)
-			return (i);
+		uint64_t frame_period = ((uint64_t) vd->fps_num * NSEC_PER_SEC) / vd->fps_denom;
+
+		if(frame_period > 0 && (now - frame->timestamp) > 2 * frame_period)
+			vd->stream_stats.late++;
 	}
-	
-	return -1;
+
+	vd->last_sequence = frame->sequence;
+	vd->last_timestamp = frame->timestamp;
 }
 
 /*
@@ -1094,13 +1647,36 @@ static int process_input_buffer(v4l2_dev_t *vd)
 		return -1; 
 	}
 	
-	vd->frame_queue[qind].status = FRAME_DECODING;
+	__atomic_store_n(&vd->frame_queue[qind].status, FRAME_DECODING, __ATOMIC_RELEASE);
+	vd->frame_queue[qind].scaled_decoded = -1;
 	
+	uint64_t now = ns_time_monotonic();
+
 	/*
-     * driver timestamp is unreliable
-	 * use monotonic system time
+	 * use the driver timestamp if it's taken from the monotonic clock
+	 * (same clock as ns_time_monotonic), otherwise use the system time
 	 */
-	vd->frame_queue[qind].timestamp = ns_time_monotonic();
+	if(vd->cap_meth != IO_READ &&
+		(vd->buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC &&
+		(vd->buf.timestamp.tv_sec > 0 || vd->buf.timestamp.tv_usec > 0))
+	{
+		vd->frame_queue[qind].timestamp = (uint64_t) vd->buf.timestamp.tv_sec * NSEC_PER_SEC +
+			(uint64_t) vd->buf.timestamp.tv_usec * 1000;
+		vd->stream_stats.driver_timestamps = 1;
+	}
+	else
+	{
+		vd->frame_queue[qind].timestamp = now;
+		vd->stream_stats.driver_timestamps = 0;
+	}
+
+	/*read method has no sequence number so just count frames*/
+	if(vd->cap_meth == IO_READ)
+		vd->frame_queue[qind].sequence = (uint32_t) vd->frame_index;
+	else
+		vd->frame_queue[qind].sequence = vd->buf.sequence;
+
+	update_stream_stats(vd, &vd->frame_queue[qind], now);
 	
 	vd->frame_queue[qind].index = vd->buf.index;
 	 
@@ -1115,18 +1691,24 @@ static int process_input_buffer(v4l2_dev_t *vd)
 	
 	/*point vd->raw_frame to current frame buffer*/
 	vd->frame_queue[qind].raw_frame = vd->mem[vd->buf.index];
+
+	/*exported dmabuf for the current frame buffer (if any)*/
+	if(vd->cap_meth == IO_DMABUF)
+		vd->frame_queue[qind].dmabuf_fd = vd->dmabuf_fd[vd->buf.index];
+	else
+		vd->frame_queue[qind].dmabuf_fd = -1;
 	
 	/*determine real fps every 3 sec aprox.*/
-	fps_frame_count++;
+	vd->fps_frame_count++;
 
-	if(vd->frame_queue[qind].timestamp - fps_ref_ts >= (3 * NSEC_PER_SEC))
+	if(vd->frame_queue[qind].timestamp - vd->fps_ref_ts >= (3 * NSEC_PER_SEC))
 	{
 		if(verbosity > 2)
 			printf("V4L2CORE: (fps) ref:%"PRId64" ts:%"PRId64" frames:%i\n",
-				fps_ref_ts, vd->frame_queue[qind].timestamp, fps_frame_count);
-		vd->real_fps = (double) (fps_frame_count * NSEC_PER_SEC) / (double) (vd->frame_queue[qind].timestamp - fps_ref_ts);
-		fps_frame_count = 0;
-		fps_ref_ts = vd->frame_queue[qind].timestamp;
+				vd->fps_ref_ts, vd->frame_queue[qind].timestamp, vd->fps_frame_count);
+		vd->real_fps = (double) (vd->fps_frame_count * NSEC_PER_SEC) / (double) (vd->frame_queue[qind].timestamp - vd->fps_ref_ts);
+		vd->fps_frame_count = 0;
+		vd->fps_ref_ts = vd->frame_queue[qind].timestamp;
 	}
 	
 	return qind;
@@ -1134,6 +1716,7 @@ static int process_input_buffer(v4l2_dev_t *vd)
  
 /*
  * gets the next video frame (must be released after processing)
+ *  the yuv image is only decoded on demand (v4l2core_frame_get_yuv)
  * args:
  *   vd - pointer to v4l2 device handler
  *
@@ -1237,7 +1820,7 @@ v4l2_frame_buff_t *v4l2core_get_frame(v4l2_dev_t *vd)
 				memset(&vd->buf, 0, sizeof(struct v4l2_buffer));
 
 				vd->buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-				vd->buf.memory = V4L2_MEMORY_MMAP;
+				vd->buf.memory = get_v4l2_memory(vd);
 
 				ret = xioctl(vd->fd, VIDIOC_DQBUF, &vd->buf);
 
@@ -1260,10 +1843,169 @@ v4l2_frame_buff_t *v4l2core_get_frame(v4l2_dev_t *vd)
 
 	vd->frame_queue[qind].width = vd->format.fmt.pix.width;
 	vd->frame_queue[qind].height = vd->format.fmt.pix.height;
+
+	/*demux h264 (the yuv frame is decoded on demand)*/
+	prepare_v4l2_frame(vd, &vd->frame_queue[qind]);
 	
 	return &vd->frame_queue[qind];
 }
 
+/*
+ * get the decoded (yu12) image of a frame
+ *  frames from v4l2core_get_frame are decoded on the first call
+ *  (consumers of the raw data only never pay for decoding)
+ * args:
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to yu12 frame data (planes at yuv_offset with yuv_stride line sizes)
+ */
+uint8_t *v4l2core_frame_get_yuv(v4l2_frame_buff_t *frame)
+{
+	/*asserts*/
+	assert(frame != NULL);
+	assert(frame->vd != NULL);
+
+	/*decodes on first use (waits if a decode is in progress)*/
+	if(decode_v4l2_frame(frame->vd, frame) != E_OK)
+		fprintf(stderr, "V4L2_CORE: Error - Couldn't decode frame\n");
+
+	return frame->yuv_frame;
+}
+
+/*
+ * get a plane of the decoded (yu12) image of a frame
+ *  frames from v4l2core_get_frame are decoded on the first call
+ * args:
+ *   frame - pointer to frame buffer
+ *   plane - plane index (0 - y, 1 - u, 2 - v)
+ *   stride - pointer to plane line size in bytes (to be filled, can be NULL)
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to plane data (NULL on error)
+ */
+uint8_t *v4l2core_frame_get_yuv_plane(v4l2_frame_buff_t *frame, int plane, int *stride)
+{
+	/*asserts*/
+	assert(frame != NULL);
+	assert(frame->vd != NULL);
+
+	if(plane < 0 || plane > 2)
+		return NULL;
+
+	uint8_t *yuv = v4l2core_frame_get_yuv(frame);
+	if(yuv == NULL || (plane == 2 && frame->yuv_format == V4L2_PIX_FMT_NV12))
+		return NULL;
+
+	if(stride)
+		*stride = frame->yuv_stride[plane];
+
+	return yuv + frame->yuv_offset[plane];
+}
+
+/*
+ * get the decoded (yu12) image of a frame tightly packed
+ *  (frames with aligned line sizes are copied to the frame stride buffer)
+ * args:
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to packed yu12 frame data
+ */
+uint8_t *v4l2core_frame_get_yuv_packed(v4l2_frame_buff_t *frame)
+{
+	/*asserts*/
+	assert(frame != NULL);
+	assert(frame->vd != NULL);
+
+	v4l2core_frame_get_yuv(frame);
+
+	return pack_yuv_frame(frame);
+}
+
+/*
+ * get the decoded (yu12) image of a frame for in place changes (fx, osd)
+ *  passthrough frames are copied from the raw frame to the frame buffer
+ * args:
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to yu12 frame data (planes at yuv_offset with yuv_stride line sizes)
+ */
+uint8_t *v4l2core_frame_get_yuv_writable(v4l2_frame_buff_t *frame)
+{
+	/*asserts*/
+	assert(frame != NULL);
+	assert(frame->vd != NULL);
+
+	v4l2core_frame_get_yuv(frame);
+
+	return own_yuv_frame(frame);
+}
+
+/*
+ * get a reduced size decoded (yu12) image of a frame (e.g. for preview)
+ *  mjpeg frames are downscaled in the DCT domain (1:8 is DC only)
+ *  other formats are decoded at full size and box filtered
+ *  the scale is reduced if the frame size is not a multiple of it
+ * args:
+ *   frame - pointer to frame buffer
+ *   scale - DECODE_SCALE_1_1, DECODE_SCALE_1_2, DECODE_SCALE_1_4 or DECODE_SCALE_1_8
+ *   width - pointer to output width (to be filled, can be NULL)
+ *   height - pointer to output height (to be filled, can be NULL)
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->vd is not null
+ *
+ * returns: pointer to yu12 frame data (NULL on error)
+ */
+uint8_t *v4l2core_frame_get_yuv_scaled(v4l2_frame_buff_t *frame, int scale,
+	int *width, int *height)
+{
+	/*asserts*/
+	assert(frame != NULL);
+	assert(frame->vd != NULL);
+
+	uint8_t *yuv = NULL;
+
+	if(scale <= DECODE_SCALE_1_1)
+	{
+		/*the scaled frame is tightly packed, so is the full size one*/
+		yuv = v4l2core_frame_get_yuv_packed(frame);
+		if(width)
+			*width = frame->width;
+		if(height)
+			*height = frame->height;
+		return yuv;
+	}
+
+	if(decode_v4l2_frame_scaled(frame->vd, frame, scale) != E_OK)
+	{
+		fprintf(stderr, "V4L2_CORE: Error - Couldn't decode reduced size frame\n");
+		return NULL;
+	}
+
+	if(width)
+		*width = frame->scaled_width;
+	if(height)
+		*height = frame->scaled_height;
+
+	return frame->yuv_scaled_frame;
+}
+
 /*
  * releases the video frame (so that it can be reused by the driver)
  * args:
@@ -1273,37 +2015,72 @@ v4l2_frame_buff_t *v4l2core_get_frame(v4l2_dev_t *vd)
  * asserts:
  *   vd is not null
  *
- * returns: error code (E_OK)
+ * returns: error code (E_OK, E_QBUF_ERR - also if the frame
+ *          was already released)
  */
 int v4l2core_release_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
 {
 	int ret = 0;
-	
-	//match the v4l2_buffer with the correspondig frame
-	vd->buf.index = frame->index;
-	
+
+	/*
+	 * claim the release: only the caller that moves the frame out of
+	 * the dequeued state requeues it and pushes it into the free ring
+	 */
+	int status = wait_v4l2_frame_decoded(vd, frame);
+	do
+	{
+		if(status == FRAME_BUSY)
+			status = wait_v4l2_frame_decoded(vd, frame); /*decode in progress*/
+
+		if(status == FRAME_READY)
+		{
+			fprintf(stderr, "V4L2_CORE: frame queue index %i released twice\n", (int) (frame - vd->frame_queue));
+			return E_QBUF_ERR;
+		}
+	}
+	while(!__atomic_compare_exchange_n(&frame->status, &status, FRAME_READY,
+		0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
 	switch(vd->cap_meth)
 	{
 		case IO_READ:
 			break;
 		
 		case IO_MMAP:
+		case IO_USERPTR:
+		case IO_DMABUF:
 		default:
+		{
+			//match the v4l2_buffer with the correspondig frame
+			struct v4l2_buffer buf;
+			memset(&buf, 0, sizeof(struct v4l2_buffer));
+			buf.index = frame->index;
+			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			buf.memory = get_v4l2_memory(vd);
+			if(vd->cap_meth == IO_USERPTR)
+			{
+				buf.m.userptr = (unsigned long) vd->mem[frame->index];
+				buf.length = vd->buff_length[frame->index];
+			}
+
 			/* queue the buffer */
-			ret = xioctl(vd->fd, VIDIOC_QBUF, &vd->buf);
+			ret = xioctl(vd->fd, VIDIOC_QBUF, &buf);
 
 			if(ret)
 				fprintf(stderr, "V4L2_CORE: (VIDIOC_QBUF) Unable to queue buffer %i: %s\n", frame->index, strerror(errno));
-			break;	
+			break;
+		}
 	}
 	
-	/*lock the mutex*/
-	__LOCK_MUTEX( __PMUTEX );
+	/*
+	 * the frame is owned by the caller until it's pushed back
+	 * into the free ring, so no lock is needed here
+	 */
 	frame->raw_frame = NULL;
 	frame->raw_frame_size = 0;
-	frame->status = FRAME_READY;
-	/*unlock the mutex*/
-	__UNLOCK_MUTEX( __PMUTEX );
+	frame->dmabuf_fd = -1;
+
+	frame_ring_push(&vd->free_frames, (int) (frame - vd->frame_queue));
 	
 	if (ret < 0)
 		return E_QBUF_ERR;
@@ -1320,6 +2097,10 @@ int v4l2core_release_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame)
  */
 v4l2_frame_buff_t *v4l2core_get_decoded_frame(v4l2_dev_t *vd)
 {
+	/*pipelined decoding (in capture order)*/
+	if(vd->decode_pool != NULL)
+		return decode_pool_get_frame(vd);
+
 	v4l2_frame_buff_t *frame = v4l2core_get_frame(vd);
 	if(frame != NULL)
 	{
@@ -1364,7 +2145,7 @@ static int try_video_stream_format(v4l2_dev_t *vd,
 	if(stream_status == STRM_OK)
 		v4l2core_stop_stream(vd);
 
-	if(vd->requested_fmt == V4L2_PIX_FMT_H264 && h264_get_support() == H264_MUXED)
+	if(vd->requested_fmt == V4L2_PIX_FMT_H264 && h264_get_support(vd) == H264_MUXED)
 	{
 		if(verbosity > 0)
 			printf("V4L2_CORE: requested H264 stream is supported through muxed MJPG\n");
@@ -1387,7 +2168,7 @@ static int try_video_stream_format(v4l2_dev_t *vd,
 
 	ret = xioctl(vd->fd, VIDIOC_S_FMT, &vd->format);
 
-	if(!ret && (vd->requested_fmt == V4L2_PIX_FMT_H264) && (h264_get_support() == H264_MUXED))
+	if(!ret && (vd->requested_fmt == V4L2_PIX_FMT_H264) && (h264_get_support(vd) == H264_MUXED))
 	{
 		if(verbosity > 0)
 			printf("V4L2_CORE: setting muxed H264 stream in MJPG container\n");
@@ -1440,12 +2221,14 @@ static int try_video_stream_format(v4l2_dev_t *vd,
 			break;
 
 		case IO_MMAP:
+		case IO_USERPTR:
+		case IO_DMABUF:
 		default:
 			/* request buffers */
 			memset(&vd->rb, 0, sizeof(struct v4l2_requestbuffers));
-			vd->rb.count = NB_BUFFER;
+			vd->rb.count = vd->requested_buff_count;
 			vd->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			vd->rb.memory = V4L2_MEMORY_MMAP;
+			vd->rb.memory = get_v4l2_memory(vd);
 
 			ret = xioctl(vd->fd, VIDIOC_REQBUFS, &vd->rb);
 
@@ -1454,20 +2237,36 @@ static int try_video_stream_format(v4l2_dev_t *vd,
 				fprintf(stderr, "V4L2_CORE: (VIDIOC_REQBUFS) Unable to allocate buffers: %s\n", strerror(errno));
 				return E_REQBUFS_ERR;
 			}
+
+			if (vd->rb.count < 1)
+			{
+				fprintf(stderr, "V4L2_CORE: (VIDIOC_REQBUFS) driver didn't grant any buffers\n");
+				return E_REQBUFS_ERR;
+			}
+
+			/*the driver may grant a different number of buffers*/
+			if(vd->rb.count != (uint32_t) vd->requested_buff_count)
+				fprintf(stderr, "V4L2_CORE: (VIDIOC_REQBUFS) requested %i buffers but driver granted %u\n",
+					vd->requested_buff_count, vd->rb.count);
+			else if(verbosity > 0)
+				printf("V4L2_CORE: (VIDIOC_REQBUFS) driver granted %u buffers\n", vd->rb.count);
+
+			alloc_buff_arrays(vd, vd->rb.count);
 			/* map the buffers */
 			if (query_buff(vd))
 			{
 				fprintf(stderr, "V4L2_CORE: (VIDIOC_QBUFS) Unable to query buffers: %s\n", strerror(errno));
 				/*
 				 * delete requested buffers
-				 * no need to unmap as mmap failed for sure
+				 * unmap anything that may have been mapped
 				 */
 				if(verbosity > 0)
 					printf("V4L2_CORE: cleaning requestbuffers\n");
+				unmap_buff(vd);
 				memset(&vd->rb, 0, sizeof(struct v4l2_requestbuffers));
 				vd->rb.count = 0;
 				vd->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-				vd->rb.memory = V4L2_MEMORY_MMAP;
+				vd->rb.memory = get_v4l2_memory(vd);
 				if(xioctl(vd->fd, VIDIOC_REQBUFS, &vd->rb)<0)
 					fprintf(stderr, "V4L2_CORE: (VIDIOC_REQBUFS) Unable to delete buffers: %s\n", strerror(errno));
 
@@ -1485,7 +2284,7 @@ static int try_video_stream_format(v4l2_dev_t *vd,
 				memset(&vd->rb, 0, sizeof(struct v4l2_requestbuffers));
 				vd->rb.count = 0;
 				vd->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-				vd->rb.memory = V4L2_MEMORY_MMAP;
+				vd->rb.memory = get_v4l2_memory(vd);
 				if(xioctl(vd->fd, VIDIOC_REQBUFS, &vd->rb)<0)
 					fprintf(stderr, "V4L2_CORE: (VIDIOC_REQBUFS) Unable to delete buffers: %s\n", strerror(errno));
 				return E_QBUF_ERR;
@@ -1540,6 +2339,29 @@ int v4l2core_get_frame_height(v4l2_dev_t *vd)
 	return vd->format.fmt.pix.height;
 }
 
+/*
+ * get the reduced size decoding scale usable with the current frame size
+ *  (v4l2core_frame_get_yuv_scaled returns frame width/height >> scale)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   scale - requested scale (DECODE_SCALE_1_1 to DECODE_SCALE_1_8)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: largest scale <= requested scale that fits the frame size
+ */
+int v4l2core_get_decode_scale(v4l2_dev_t *vd, int scale)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	if(scale <= DECODE_SCALE_1_1)
+		return DECODE_SCALE_1_1;
+
+	return jpeg_clamp_scale(vd->format.fmt.pix.width, vd->format.fmt.pix.height, scale);
+}
+
 /*
  * get requested frame format
  * args:
@@ -1579,7 +2401,7 @@ void v4l2core_prepare_new_format(v4l2_dev_t *vd, int new_format)
 	if(format_index < 0)
 		format_index = 0;
 
-	my_pixelformat = vd->list_stream_formats[format_index].format;
+	vd->pending_pixelformat = vd->list_stream_formats[format_index].format;
 }
 
 /*
@@ -1599,7 +2421,7 @@ void v4l2core_prepare_valid_format(v4l2_dev_t *vd)
 
 	int format_index = 0;
 
-	my_pixelformat = vd->list_stream_formats[format_index].format;
+	vd->pending_pixelformat = vd->list_stream_formats[format_index].format;
 }
 
 /*
@@ -1620,7 +2442,7 @@ void v4l2core_prepare_new_resolution(v4l2_dev_t *vd,
 	/*asserts*/
 	assert(vd != NULL);
 
-	int format_index = v4l2core_get_frame_format_index(vd, my_pixelformat);
+	int format_index = v4l2core_get_frame_format_index(vd, vd->pending_pixelformat);
 
 	if(format_index < 0)
 		format_index = 0;
@@ -1631,8 +2453,8 @@ void v4l2core_prepare_new_resolution(v4l2_dev_t *vd,
 	if(resolution_index < 0)
 		resolution_index = 0;
 
-	my_width  = vd->list_stream_formats[format_index].list_stream_cap[resolution_index].width;
-	my_height = vd->list_stream_formats[format_index].list_stream_cap[resolution_index].height;
+	vd->pending_width  = vd->list_stream_formats[format_index].list_stream_cap[resolution_index].width;
+	vd->pending_height = vd->list_stream_formats[format_index].list_stream_cap[resolution_index].height;
 }
 
 /*
@@ -1650,15 +2472,15 @@ void v4l2core_prepare_valid_resolution(v4l2_dev_t *vd)
 	/*asserts*/
 	assert(vd != NULL);
 
-	int format_index = v4l2core_get_frame_format_index(vd, my_pixelformat);
+	int format_index = v4l2core_get_frame_format_index(vd, vd->pending_pixelformat);
 
 	if(format_index < 0)
 		format_index = 0;
 
 	int resolution_index = 0;
 
-	my_width  = vd->list_stream_formats[format_index].list_stream_cap[resolution_index].width;
-	my_height = vd->list_stream_formats[format_index].list_stream_cap[resolution_index].height;
+	vd->pending_width  = vd->list_stream_formats[format_index].list_stream_cap[resolution_index].width;
+	vd->pending_height = vd->list_stream_formats[format_index].list_stream_cap[resolution_index].height;
 }
 
 /*
@@ -1677,7 +2499,7 @@ int v4l2core_update_current_format(v4l2_dev_t *vd)
 	/*asserts*/
 	assert(vd != NULL);
 
-	return(try_video_stream_format(vd, my_width, my_height, my_pixelformat));
+	return(try_video_stream_format(vd, vd->pending_width, vd->pending_height, vd->pending_pixelformat));
 }
 
 /*
@@ -1699,8 +2521,10 @@ static void clean_v4l2_dev(v4l2_dev_t *vd)
 		free(vd->videodevice);
 	vd->videodevice = NULL;
 
+	decode_pool_close(vd);
+
 	if(vd->has_focus_control_id)
-		v4l2core_soft_autofocus_close();
+		v4l2core_soft_autofocus_close(vd);
 
 	if(vd->list_device_controls)
 		free_v4l2_control_list(vd);
@@ -1711,6 +2535,10 @@ static void clean_v4l2_dev(v4l2_dev_t *vd)
 	if(vd->frame_queue)
 		free(vd->frame_queue);
 
+	frame_ring_clean(&vd->free_frames);
+
+	free_buff_arrays(vd);
+
 	/*close descriptor*/
 	if(vd->fd > 0)
 		v4l2_close(vd->fd);
@@ -1753,6 +2581,10 @@ v4l2_dev_t* v4l2core_init_dev(const char *device)
 	
 	/*init the device mutex*/
 	__INIT_MUTEX(__PMUTEX);
+	__INIT_COND(&vd->decode_cond);
+
+	/*unique serial (device handlers may be reused at the same address)*/
+	vd->poll_serial = __sync_add_and_fetch(&dev_serial_count, 1);
 
 	/*MMAP by default*/
 	vd->cap_meth = IO_MMAP;
@@ -1766,8 +2598,20 @@ v4l2_dev_t* v4l2core_init_dev(const char *device)
 	}
 
 	vd->frame_queue_size = frame_queue_size;
+	vd->frame_alignment = 1; /*tightly packed yuv frames*/
+	vd->yuv_passthrough = 0; /*always decode to the frame buffer*/
 	/*alloc frame buffer queue*/
 	vd->frame_queue = calloc(vd->frame_queue_size, sizeof(v4l2_frame_buff_t));
+
+	/*all frames start in the free ring*/
+	frame_ring_init(&vd->free_frames, vd->frame_queue_size);
+	int fq = 0;
+	for(fq = 0; fq < vd->frame_queue_size; ++fq)
+		frame_ring_push(&vd->free_frames, fq);
+
+	/*driver buffers (resized to the granted count on VIDIOC_REQBUFS)*/
+	vd->requested_buff_count = NB_BUFFER;
+	alloc_buff_arrays(vd, vd->requested_buff_count);
 	
 	vd->h264_no_probe_default = 0;
 	vd->h264_SPS = NULL;
@@ -1776,6 +2620,7 @@ v4l2_dev_t* v4l2core_init_dev(const char *device)
 	vd->h264_PPS_size = 0;
 	vd->h264_last_IDR = NULL;
 	vd->h264_last_IDR_size = 0;
+	vd->h264_last_IDR_max_size = 0;
 
 	/*set some defaults*/
 	vd->fps_num = 1;
@@ -1819,11 +2664,15 @@ v4l2_dev_t* v4l2core_init_dev(const char *device)
 	}
 
 	int i = 0;
-	for (i = 0; i < NB_BUFFER; i++)
+	for (i = 0; i < vd->frame_queue_size; i++)
 	{
-		vd->mem[i] = MAP_FAILED; /*not mmaped yet*/
+		vd->frame_queue[i].dmabuf_fd = -1;
+		vd->frame_queue[i].scaled_decoded = -1;
+		vd->frame_queue[i].vd = vd;
 	}
 
+	__sync_add_and_fetch(&open_dev_count, 1);
+
 	return (vd);
 }
 
@@ -1914,6 +2763,11 @@ int v4l2core_check_control_events(v4l2_dev_t *vd)
 				default:
 					control->value = ev.u.ctrl.value;
 			}
+
+			/*the event carries the device value*/
+			control->device_value = control->value;
+			control->device_value64 = control->value64;
+			control->device_value_valid = 1;
 		}
 	}
 
@@ -2061,13 +2915,15 @@ void v4l2core_clean_buffers(v4l2_dev_t *vd)
 			break;
 
 		case IO_MMAP:
+		case IO_USERPTR:
+		case IO_DMABUF:
 		default:
 			//delete requested buffers
 			unmap_buff(vd);
 			memset(&vd->rb, 0, sizeof(struct v4l2_requestbuffers));
 			vd->rb.count = 0;
 			vd->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-			vd->rb.memory = V4L2_MEMORY_MMAP;
+			vd->rb.memory = get_v4l2_memory(vd);
 			if(xioctl(vd->fd, VIDIOC_REQBUFS, &vd->rb)<0)
 			{
 				fprintf(stderr, "V4L2_CORE: (VIDIOC_REQBUFS) Failed to delete buffers: %s (errno %d)\n", strerror(errno), errno);
@@ -2094,9 +2950,14 @@ void v4l2core_close_dev(v4l2_dev_t *vd)
 	__UNLOCK_MUTEX(__PMUTEX);
 	/*destroy the device mutex*/
 	__CLOSE_MUTEX(__PMUTEX);
+	__CLOSE_COND(&vd->decode_cond);
 
 	v4l2core_clean_buffers(vd);
 	clean_v4l2_dev(vd);
+
+	/*last device handler: stop the conversion worker threads*/
+	if(__sync_sub_and_fetch(&open_dev_count, 1) == 0)
+		thread_pool_close();
 }
 
 /*
@@ -2120,7 +2981,7 @@ void v4l2core_request_framerate_update(v4l2_dev_t *vd)
 	 * else change fps immediatly
 	 */
 	if(vd->streaming == STRM_OK)
-		flag_fps_change = 1;
+		vd->flag_fps_change = 1;
 	else
 		set_v4l2_framerate(vd);
 }
@@ -2232,6 +3093,27 @@ int v4l2core_set_control_value_by_id(v4l2_dev_t *vd, int id)
 	return set_control_value_by_id(vd, id);
 }
 
+/*
+ * sets the values of a set of controls in the device
+ *  controls are grouped by class in single VIDIOC_S_EXT_CTRLS calls
+ *  and only controls with changed values are written
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   ids - array of control ids
+ *   values - array of control values (NULL to use the current control values)
+ *   n - number of controls
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of controls that failed to set (0 - E_OK)
+ *          or error code (< 0)
+ */
+int v4l2core_set_controls_batch(v4l2_dev_t *vd, const int *ids, const int32_t *values, int n)
+{
+	return set_control_values_by_id(vd, ids, values, n);
+}
+
 /*
  * save the current frame to file
  * args:
@@ -2656,6 +3538,23 @@ int v4l2core_save_control_profile(v4l2_dev_t *vd, const char *filename)
 	return save_control_profile(vd, filename);
 }
 
+/*
+ * save the device control values into a binary profile file
+ *  (only controls with non default values are stored)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   filename - profile filename
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 -E_OK)
+ */
+int v4l2core_save_control_profile_binary(v4l2_dev_t *vd, const char *filename)
+{
+	return save_control_profile_binary(vd, filename);
+}
+
 /*
  * load the device control values from a profile file
  * args:
@@ -24,6 +24,7 @@
 
 #include "gviewv4l2core.h"
 #include "gview.h"
+#include "frame_ring.h"
 
 /*
  * video device data
@@ -34,8 +35,9 @@ struct _v4l2_dev_t
 	char *videodevice;                  // video device string (default "/dev/video0)"
 	
 	__MUTEX_TYPE mutex;                // device mutex
+	__COND_TYPE decode_cond;            // frame decode finished (FRAME_BUSY -> FRAME_DONE)
 
-	int cap_meth;                       // capture method: IO_READ or IO_MMAP
+	int cap_meth;                       // capture method: IO_READ, IO_MMAP, IO_USERPTR or IO_DMABUF
 	v4l2_stream_formats_t* list_stream_formats; //list of available stream formats
 	int numb_formats;                   //list size
 	//int current_format_index;           //index of current stream format
@@ -49,26 +51,46 @@ struct _v4l2_dev_t
 	struct v4l2_event_subscription evsub;// v4l2 event subscription struct
 
 	int requested_fmt;                  //requested format (may differ from format.fmt.pix.pixelformat)
+	int pending_pixelformat;            //format set by v4l2core_prepare_new_format (applied on format update)
+	int pending_width;                  //width set by v4l2core_prepare_new_resolution
+	int pending_height;                 //height set by v4l2core_prepare_new_resolution
 
 	int fps_num;                        //fps numerator
 	int fps_denom;                      //fps denominator
 	
 	double real_fps;                    //real fps (calculated from number of captured frames)
+	uint64_t fps_ref_ts;                //real fps reference timestamp
+	uint32_t fps_frame_count;           //frames captured since fps_ref_ts
+	uint8_t flag_fps_change;            //set to 1 to request a fps change
 
 	uint8_t streaming;                  // flag device stream : STRM_STOP ; STRM_REQ_STOP; STRM_OK
+	uint8_t frame_ready;                // set by v4l2core_poll_devices if a frame is ready to dequeue
+	uint32_t poll_serial;               // unique device serial (identifies the device in epoll sets)
 	uint64_t frame_index;               // captured frame index from 0 to max(uint64_t)
-	void *mem[NB_BUFFER];               // memory buffers for mmap driver frames
-	uint32_t buff_length[NB_BUFFER];    // memory buffers length as set by VIDIOC_QUERYBUF
-	uint32_t buff_offset[NB_BUFFER];    // memory buffers offset as set by VIDIOC_QUERYBUF
+	v4l2_stream_stats_t stream_stats;   // stream statistics (reset on stream start)
+	uint32_t last_sequence;             // driver sequence number of the last dequeued frame
+	uint64_t last_timestamp;            // timestamp of the last dequeued frame
+	int requested_buff_count;           // number of driver buffers to request (def. NB_BUFFER)
+	int buff_count;                     // number of driver buffers granted by VIDIOC_REQBUFS
+	void **mem;                         // memory buffers for mmap driver frames
+	uint32_t *buff_length;              // memory buffers length as set by VIDIOC_QUERYBUF
+	uint32_t *buff_offset;              // memory buffers offset as set by VIDIOC_QUERYBUF
+	int *dmabuf_fd;                     // dmabuf fds exported with VIDIOC_EXPBUF (IO_DMABUF)
 
 	v4l2_frame_buff_t *frame_queue;     //frame queue
+	frame_ring_t free_frames;           //lock-free ring of free frame queue indexes
 	int frame_queue_size;               //size of frame queue (in frames)
+	int frame_alignment;                //line size alignment of yuv frames (bytes)
+	uint8_t yuv_passthrough;            //flag if yu12, yv12 and nv12 frames alias the raw frame
 
 	uint8_t h264_unit_id;  				// uvc h264 unit id, if <= 0 then uvc h264 is not supported
+	int h264_support;                   // h264 support type: H264_NONE; H264_MUXED; H264_FRAME
 	uint8_t h264_no_probe_default;      // flag core to use the preset h264_config_probe_req data (don't reset to default before commit)
 	uvcx_video_config_probe_commit_t h264_config_probe_req; //probe commit struct for h264 streams
 	uint8_t *h264_last_IDR;             // last IDR frame retrieved from uvc h264 stream
 	int h264_last_IDR_size;             // last IDR frame size
+	int h264_last_IDR_max_size;         // last IDR frame buffer size
+	int64_t h264_last_decoded_seq;      // sequence of the last decoded h264 frame (-1 if none)
 	uint8_t *h264_SPS;                  // h264 SPS info
 	uint16_t h264_SPS_size;             // SPS size
 	uint8_t *h264_PPS;                  // h264 PPS info
@@ -81,6 +103,8 @@ struct _v4l2_dev_t
 
     uint8_t isbayer;                    //flag if we are streaming bayer data in yuyv frame (logitech only)
     uint8_t bayer_pix_order;            //bayer pixel order
+    int yuv_matrix;                     //rgb to yuv matrix for rgb formats (YUV_MATRIX_)
+    int demosaic_mode;                  //demosaic filter for bayer formats (DEMOSAIC_)
 
     int pan_step;                       //pan step for relative pan tilt controls (logitech sphere/orbit/BCC950)
     int tilt_step;                      //tilt step for relative pan tilt controls (logitech sphere/orbit/BCC950)
@@ -88,6 +112,13 @@ struct _v4l2_dev_t
 	int has_focus_control_id;           //it's set to control id if a focus control is available (enables software autofocus)
 	int has_pantilt_control_id;         //it's set to 1 if a pan/tilt control is available
 	uint8_t pantilt_unit_id;            //logitech peripheral V3 unit id (if any)
+
+	struct _jpeg_decoder_context_t *jpeg_ctx; // (m)jpeg decoder context (jpeg_decoder.c)
+	struct _jpeg_decoder_context_t *jpeg_scaled_ctx; // reduced size (m)jpeg decoder context
+	int jpeg_scaled_shift;              // scale of jpeg_scaled_ctx
+	struct _h264_decoder_context_t *h264_ctx; // h264 decoder context (uvc_h264.c)
+	struct _focus_ctx_t *focus_ctx;     // software autofocus context (soft_autofocus.c)
+	struct _decode_pool_t *decode_pool; // decoder worker pool (decode_pool.c)
 };
 
 #endif
@@ -27,16 +27,92 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <time.h>
+#include <pthread.h>
 
+#include "gview.h"
 #include "gviewv4l2core.h"
 #include "v4l2_devices.h"
+#include "core_time.h"
 #include "../config.h"
 
 extern int verbosity;
 
+/*maximum number of concurrent device probe threads*/
+#define DEVICE_PROBE_THREADS (8)
+
+/*device probe status*/
+#define PROBE_PENDING (0)
+#define PROBE_RUNNING (1)
+#define PROBE_OK      (2)
+#define PROBE_FAILED  (3)
+#define PROBE_TIMEOUT (4)
+
+/*
+ * device node probe data
+ */
+typedef struct _probe_node_t
+{
+	char *device;                //device node (e.g: /dev/video0)
+	struct v4l2_capability cap;  //VIDIOC_QUERYCAP result
+	int status;                  //probe status
+	uint64_t start_ns;           //probe start time (monotonic ns)
+} probe_node_t;
+
+/*
+ * device probe set (shared by the probe threads)
+ */
+typedef struct _probe_set_t
+{
+	probe_node_t *nodes;         //device nodes to probe
+	int num_nodes;               //number of device nodes
+	int next;                    //next node to probe
+	int done;                    //number of finished (or timed out) nodes
+	int refcount;                //users of the probe set (caller + running threads)
+	__MUTEX_TYPE mutex;
+	__COND_TYPE cond;            //signaled when a node is done
+} probe_set_t;
+
+/*device probe timeout in ms (per node)*/
+static int device_probe_timeout_ms = 2000;
+
 /* device list structure */
 static v4l2_device_list_t my_device_list;
 
+/*lazy device list initialization*/
+static pthread_once_t device_list_once = PTHREAD_ONCE_INIT;
+static int device_list_init = 0;
+
+/*
+ * initiate the device list on first use
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void device_list_init_once()
+{
+	/* Create a udev object */
+	my_device_list.udev = udev_new();
+	/*start udev device monitoring*/
+	/* Set up a monitor to monitor v4l2 devices */
+	if(my_device_list.udev)
+	{
+		my_device_list.udev_mon = udev_monitor_new_from_netlink(my_device_list.udev, "udev");
+		udev_monitor_filter_add_match_subsystem_devtype(my_device_list.udev_mon, "video4linux", NULL);
+		udev_monitor_enable_receiving(my_device_list.udev_mon);
+		/* Get the file descriptor (fd) for the monitor */
+		my_device_list.udev_fd = udev_monitor_get_fd(my_device_list.udev_mon);
+
+		enum_v4l2_devices();
+	}
+
+	device_list_init = 1;
+}
+
 /*
  * get the device list
  * args:
@@ -49,6 +125,7 @@ static v4l2_device_list_t my_device_list;
  */
 v4l2_device_list_t* get_device_list()
 {
+	v4l2core_init_device_list();
 	return &my_device_list;
 }
 
@@ -64,6 +141,7 @@ v4l2_device_list_t* get_device_list()
  */
 int v4l2core_get_num_devices()
 {
+	v4l2core_init_device_list();
 	return my_device_list.num_devices;
 }
 
@@ -79,6 +157,8 @@ int v4l2core_get_num_devices()
  */
 v4l2_dev_sys_data_t* v4l2core_get_device_sys_data(int index)
 {
+	v4l2core_init_device_list();
+
 	if(index >= v4l2core_get_num_devices())
 	{
 		fprintf(stderr, "V4L2_CORE: invalid device index %i using %i\n",
@@ -122,9 +202,261 @@ static void free_device_list()
 	my_device_list.list_devices = NULL;
 }
  
+/*
+ * create an empty probe set
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to probe set (refcount 1 - the caller)
+ */
+static probe_set_t *new_probe_set()
+{
+	probe_set_t *ps = calloc(1, sizeof(probe_set_t));
+	if(ps == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (new_probe_set): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	__INIT_MUTEX(&ps->mutex);
+
+	/*timed waits use the monotonic clock (same as the node timestamps)*/
+	pthread_condattr_t cond_attr;
+	pthread_condattr_init(&cond_attr);
+	pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&ps->cond, &cond_attr);
+	pthread_condattr_destroy(&cond_attr);
+
+	ps->refcount = 1;
+
+	return ps;
+}
+
+/*
+ * free a probe set
+ * args:
+ *   ps - pointer to probe set
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void free_probe_set(probe_set_t *ps)
+{
+	int i = 0;
+	for(i = 0; i < ps->num_nodes; ++i)
+		free(ps->nodes[i].device);
+	free(ps->nodes);
+
+	__CLOSE_MUTEX(&ps->mutex);
+	__CLOSE_COND(&ps->cond);
+	free(ps);
+}
+
+/*
+ * add a device node to the probe set (before probing starts)
+ * args:
+ *   ps - pointer to probe set
+ *   device - device node (e.g: /dev/video0)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void add_probe_node(probe_set_t *ps, const char *device)
+{
+	ps->nodes = realloc(ps->nodes, (ps->num_nodes + 1) * sizeof(probe_node_t));
+	if(ps->nodes == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (add_probe_node): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	memset(&ps->nodes[ps->num_nodes], 0, sizeof(probe_node_t));
+	ps->nodes[ps->num_nodes].device = strdup(device);
+	ps->nodes[ps->num_nodes].status = PROBE_PENDING;
+	ps->num_nodes++;
+}
+
+/*
+ * probe worker: open, query and close device nodes from the probe set
+ * args:
+ *   data - pointer to probe set
+ *
+ * asserts:
+ *   none
+ *
+ * returns: NULL
+ */
+static void *probe_worker(void *data)
+{
+	probe_set_t *ps = (probe_set_t *) data;
+
+	__LOCK_MUTEX(&ps->mutex);
+	while(ps->next < ps->num_nodes)
+	{
+		probe_node_t *node = &ps->nodes[ps->next++];
+		node->status = PROBE_RUNNING;
+		node->start_ns = ns_time_monotonic();
+		__UNLOCK_MUTEX(&ps->mutex);
+
+		struct v4l2_capability cap;
+		memset(&cap, 0, sizeof(struct v4l2_capability));
+
+		int status = PROBE_FAILED;
+		int fd = v4l2_open(node->device, O_RDWR | O_NONBLOCK, 0);
+		if (fd < 0)
+			fprintf(stderr, "V4L2_CORE: ERROR opening V4L2 interface for %s\n", node->device);
+		else
+		{
+			if (xioctl(fd, VIDIOC_QUERYCAP, &cap) < 0)
+			{
+				fprintf(stderr, "V4L2_CORE: VIDIOC_QUERYCAP error: %s\n", strerror(errno));
+				fprintf(stderr, "V4L2_CORE: couldn't query device %s\n", node->device);
+			}
+			else
+				status = PROBE_OK;
+			v4l2_close(fd);
+		}
+
+		__LOCK_MUTEX(&ps->mutex);
+		/*nodes that timed out were already dropped*/
+		if(node->status == PROBE_RUNNING)
+		{
+			node->cap = cap;
+			node->status = status;
+			ps->done++;
+			__COND_SIGNAL(&ps->cond);
+		}
+	}
+
+	/*last user frees the probe set (main thread may have given up on us)*/
+	int refcount = --ps->refcount;
+	__UNLOCK_MUTEX(&ps->mutex);
+
+	if(refcount == 0)
+		free_probe_set(ps);
+
+	return NULL;
+}
+
+/*
+ * start a detached probe worker
+ * args:
+ *   ps - pointer to probe set (mutex locked)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int start_probe_worker(probe_set_t *ps)
+{
+	__ATTRIB_TYPE attr;
+	__THREAD_TYPE thread;
+
+	__INIT_ATTRIB(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	ps->refcount++;
+	int ret = __THREAD_CREATE_ATTRIB(&thread, &attr, probe_worker, (void *) ps);
+	if(ret != 0)
+	{
+		fprintf(stderr, "V4L2_CORE: couldn't start device probe thread: %s\n", strerror(ret));
+		ps->refcount--;
+	}
+
+	__CLOSE_ATTRIB(&attr);
+	return (ret == 0) ? 0 : -1;
+}
+
+/*
+ * probe device nodes concurrently (open + VIDIOC_QUERYCAP)
+ *  nodes that don't answer within the probe timeout are dropped
+ * args:
+ *   ps - pointer to probe set
+ *
+ * asserts:
+ *   ps is not null
+ *
+ * returns: none (node status is set in the probe set)
+ */
+static void probe_devices(probe_set_t *ps)
+{
+	/*assertions*/
+	assert(ps != NULL);
+
+	int nworkers = ps->num_nodes < DEVICE_PROBE_THREADS ? ps->num_nodes : DEVICE_PROBE_THREADS;
+	uint64_t timeout_ns = (uint64_t) device_probe_timeout_ms * 1000000;
+	int i = 0;
+
+	__LOCK_MUTEX(&ps->mutex);
+
+	for(i = 0; i < nworkers; ++i)
+		if(start_probe_worker(ps) != 0)
+			break;
+
+	if(i == 0)
+	{
+		/*no threads - probe on the calling thread*/
+		ps->refcount++;
+		__UNLOCK_MUTEX(&ps->mutex);
+		probe_worker(ps);
+		__LOCK_MUTEX(&ps->mutex);
+	}
+
+	while(ps->done < ps->num_nodes)
+	{
+		uint64_t now = ns_time_monotonic();
+		uint64_t deadline = now + timeout_ns;
+
+		for(i = 0; i < ps->num_nodes; ++i)
+		{
+			probe_node_t *node = &ps->nodes[i];
+			if(node->status != PROBE_RUNNING)
+				continue;
+
+			if(now - node->start_ns >= timeout_ns)
+			{
+				fprintf(stderr, "V4L2_CORE: device %s didn't answer in %i ms - skipping it\n",
+					node->device, device_probe_timeout_ms);
+				node->status = PROBE_TIMEOUT;
+				ps->done++;
+				/*the stuck worker is lost - replace it if there is work left*/
+				if(ps->next < ps->num_nodes && start_probe_worker(ps) != 0)
+				{
+					/*no more workers - drop the remaining nodes*/
+					for(; ps->next < ps->num_nodes; ps->next++)
+						ps->nodes[ps->next].status = PROBE_FAILED;
+					ps->done = ps->num_nodes;
+				}
+			}
+			else if(node->start_ns + timeout_ns < deadline)
+				deadline = node->start_ns + timeout_ns;
+		}
+
+		if(ps->done >= ps->num_nodes)
+			break;
+
+		struct timespec ts;
+		ts.tv_sec = deadline / 1000000000;
+		ts.tv_nsec = deadline % 1000000000;
+		__COND_TIMED_WAIT(&ps->cond, &ps->mutex, &ts);
+	}
+
+	__UNLOCK_MUTEX(&ps->mutex);
+}
+
 /*
  * enumerate available v4l2 devices
  * and creates list in vd->list_devices
+ *  device nodes are probed concurrently by a bounded
+ *  set of threads with a timeout per node
  * args:
  *   none
  *
@@ -141,7 +473,7 @@ int enum_v4l2_devices()
     struct udev_list_entry *dev_list_entry;
 
     int num_dev = 0;
-    struct v4l2_capability v4l2_cap;
+    int i = 0;
 
     my_device_list.list_devices = calloc(1, sizeof(v4l2_dev_sys_data_t));
     if(my_device_list.list_devices == NULL)
@@ -155,47 +487,66 @@ int enum_v4l2_devices()
     udev_enumerate_add_match_subsystem(enumerate, "video4linux");
     udev_enumerate_scan_devices(enumerate);
     devices = udev_enumerate_get_list_entry(enumerate);
-    /*
-     * For each item enumerated, print out its information.
-     * udev_list_entry_foreach is a macro which expands to
-     * a loop. The loop will be executed for each member in
-     * devices, setting dev_list_entry to a list entry
-     * which contains the device's path in /sys.
-     */
+
+    /*collect the device nodes (udev is only used from this thread)*/
+    probe_set_t *ps = new_probe_set();
+    struct udev_device **udev_devs = NULL;
+
     udev_list_entry_foreach(dev_list_entry, devices)
     {
-        const char *path;
-
         /*
          * Get the filename of the /sys entry for the device
          * and create a udev_device object (dev) representing it
          */
-        path = udev_list_entry_get_name(dev_list_entry);
+        const char *path = udev_list_entry_get_name(dev_list_entry);
         struct udev_device *dev = udev_device_new_from_syspath(my_device_list.udev, path);
+        if(dev == NULL)
+            continue;
 
         /* usb_device_get_devnode() returns the path to the device node
             itself in /dev. */
         const char *v4l2_device = udev_device_get_devnode(dev);
+        if (v4l2_device == NULL)
+        {
+            udev_device_unref(dev);
+            continue;
+        }
+
         if (verbosity > 0)
             printf("V4L2_CORE: Device Node Path: %s\n", v4l2_device);
 
-		int fd = 0;
-        /* open the device and query the capabilities */
-        if ((fd = v4l2_open(v4l2_device, O_RDWR | O_NONBLOCK, 0)) < 0)
+        add_probe_node(ps, v4l2_device);
+
+        udev_devs = realloc(udev_devs, ps->num_nodes * sizeof(struct udev_device *));
+        if(udev_devs == NULL)
         {
-            fprintf(stderr, "V4L2_CORE: ERROR opening V4L2 interface for %s\n", v4l2_device);
-            v4l2_close(fd);
-            continue; /*next dir entry*/
+            fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (enum_v4l2_devices): %s\n", strerror(errno));
+            exit(-1);
         }
+        udev_devs[ps->num_nodes - 1] = dev;
+    }
+
+    /*open and query the device nodes concurrently*/
+    if(ps->num_nodes > 0)
+        probe_devices(ps);
 
-        if (xioctl(fd, VIDIOC_QUERYCAP, &v4l2_cap) < 0)
+    /*build the device list (udev enumeration order)*/
+    for(i = 0; i < ps->num_nodes; ++i)
+    {
+        struct udev_device *dev = udev_devs[i];
+
+        __LOCK_MUTEX(&ps->mutex);
+        int status = ps->nodes[i].status;
+        struct v4l2_capability v4l2_cap = ps->nodes[i].cap;
+        __UNLOCK_MUTEX(&ps->mutex);
+
+        if(status != PROBE_OK)
         {
-            fprintf(stderr, "V4L2_CORE: VIDIOC_QUERYCAP error: %s\n", strerror(errno));
-            fprintf(stderr, "V4L2_CORE: couldn't query device %s\n", v4l2_device);
-            v4l2_close(fd);
+            udev_device_unref(dev);
             continue; /*next dir entry*/
         }
-        v4l2_close(fd);
+
+        const char *v4l2_device = udev_device_get_devnode(dev);
 
         num_dev++;
         /* Update the device list*/
@@ -211,6 +562,11 @@ int enum_v4l2_devices()
         my_device_list.list_devices[num_dev-1].location = strdup((char *) v4l2_cap.bus_info);
         my_device_list.list_devices[num_dev-1].valid = 1;
         my_device_list.list_devices[num_dev-1].current = 0;
+        my_device_list.list_devices[num_dev-1].vendor = 0;
+        my_device_list.list_devices[num_dev-1].product = 0;
+        my_device_list.list_devices[num_dev-1].busnum = 0;
+        my_device_list.list_devices[num_dev-1].devnum = 0;
+        my_device_list.list_devices[num_dev-1].firmware = 0;
 				
         /* The device pointed to by dev contains information about
             the v4l2 device. In order to get information about the
@@ -218,13 +574,14 @@ int enum_v4l2_devices()
             subsystem/devtype pair of "usb"/"usb_device". This will
             be several levels up the tree, but the function will find
             it.*/
-        dev = udev_device_get_parent_with_subsystem_devtype(
+        struct udev_device *usb_dev = udev_device_get_parent_with_subsystem_devtype(
                 dev,
                 "usb",
                 "usb_device");
-        if (!dev)
+        if (!usb_dev)
         {
             fprintf(stderr, "V4L2_CORE: Unable to find parent usb device.");
+            udev_device_unref(dev);
             continue;
         }
 
@@ -238,26 +595,39 @@ int enum_v4l2_devices()
         if (verbosity > 0)
         {
             printf("  VID/PID: %s %s\n",
-                udev_device_get_sysattr_value(dev,"idVendor"),
-                udev_device_get_sysattr_value(dev, "idProduct"));
+                udev_device_get_sysattr_value(usb_dev,"idVendor"),
+                udev_device_get_sysattr_value(usb_dev, "idProduct"));
             printf("  %s\n  %s\n",
-                udev_device_get_sysattr_value(dev,"manufacturer"),
-                udev_device_get_sysattr_value(dev,"product"));
+                udev_device_get_sysattr_value(usb_dev,"manufacturer"),
+                udev_device_get_sysattr_value(usb_dev,"product"));
             printf("  serial: %s\n",
-                udev_device_get_sysattr_value(dev, "serial"));
+                udev_device_get_sysattr_value(usb_dev, "serial"));
             printf("  busnum: %s\n",
-                udev_device_get_sysattr_value(dev, "busnum"));
+                udev_device_get_sysattr_value(usb_dev, "busnum"));
             printf("  devnum: %s\n",
-                udev_device_get_sysattr_value(dev, "devnum"));
+                udev_device_get_sysattr_value(usb_dev, "devnum"));
         }
 
-        my_device_list.list_devices[num_dev-1].vendor = strtoull(udev_device_get_sysattr_value(dev,"idVendor"), NULL, 16);
-        my_device_list.list_devices[num_dev-1].product = strtoull(udev_device_get_sysattr_value(dev, "idProduct"), NULL, 16);
-        my_device_list.list_devices[num_dev-1].busnum = strtoull(udev_device_get_sysattr_value(dev, "busnum"), NULL, 10);
-		my_device_list.list_devices[num_dev-1].devnum = strtoull(udev_device_get_sysattr_value(dev, "devnum"), NULL, 10);
+        my_device_list.list_devices[num_dev-1].vendor = strtoull(udev_device_get_sysattr_value(usb_dev,"idVendor"), NULL, 16);
+        my_device_list.list_devices[num_dev-1].product = strtoull(udev_device_get_sysattr_value(usb_dev, "idProduct"), NULL, 16);
+        my_device_list.list_devices[num_dev-1].busnum = strtoull(udev_device_get_sysattr_value(usb_dev, "busnum"), NULL, 10);
+		my_device_list.list_devices[num_dev-1].devnum = strtoull(udev_device_get_sysattr_value(usb_dev, "devnum"), NULL, 10);
+		const char *bcd_device = udev_device_get_sysattr_value(usb_dev, "bcdDevice");
+		my_device_list.list_devices[num_dev-1].firmware = bcd_device ? strtoul(bcd_device, NULL, 16) : 0;
 
+        /*the parent usb device is owned by dev*/
         udev_device_unref(dev);
     }
+
+    free(udev_devs);
+
+    /*release the probe set (stuck workers keep it alive)*/
+    __LOCK_MUTEX(&ps->mutex);
+    int refcount = --ps->refcount;
+    __UNLOCK_MUTEX(&ps->mutex);
+    if(refcount == 0)
+        free_probe_set(ps);
+
     /* Free the enumerator object */
     udev_enumerate_unref(enumerate);
 
@@ -268,6 +638,8 @@ int enum_v4l2_devices()
 
 /*
  * Initiate the device list (with udev monitoring)
+ *  the list is also initiated on first use, call this
+ *  to choose when the device probe happens
  * args:
  *   none
  * 
@@ -278,21 +650,25 @@ int enum_v4l2_devices()
  */ 
 void v4l2core_init_device_list()
 {
-	/* Create a udev object */
-	my_device_list.udev = udev_new();
-	/*start udev device monitoring*/
-	/* Set up a monitor to monitor v4l2 devices */
-	if(my_device_list.udev)
-	{
-		my_device_list.udev_mon = udev_monitor_new_from_netlink(my_device_list.udev, "udev");
-		udev_monitor_filter_add_match_subsystem_devtype(my_device_list.udev_mon, "video4linux", NULL);
-		udev_monitor_enable_receiving(my_device_list.udev_mon);
-		/* Get the file descriptor (fd) for the monitor */
-		my_device_list.udev_fd = udev_monitor_get_fd(my_device_list.udev_mon);
+	pthread_once(&device_list_once, device_list_init_once);
+}
 
-		enum_v4l2_devices();
-	}
-} 
+/*
+ * set the device probe timeout (set before the device list is initiated)
+ *  device nodes that don't answer in time are left out of the list
+ * args:
+ *   timeout_ms - timeout in ms for each device node
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_set_device_probe_timeout(int timeout_ms)
+{
+	if(timeout_ms > 0)
+		device_probe_timeout_ms = timeout_ms;
+}
 
 /*
  * get the device index in device list
@@ -307,6 +683,8 @@ void v4l2core_init_device_list()
  */ 
 int v4l2core_get_device_index(const char *videodevice)
 {
+	v4l2core_init_device_list();
+
 	if(my_device_list.num_devices > 0 && my_device_list.list_devices != NULL)
 	{
 		int dev_index = 0;
@@ -338,6 +716,8 @@ int v4l2core_get_device_index(const char *videodevice)
  */
 int check_device_list_events(v4l2_dev_t *vd)
 {
+	v4l2core_init_device_list();
+
 	/*assertions*/
 	assert(my_device_list.udev != NULL);
 	assert(my_device_list.udev_fd > 0);
@@ -412,7 +792,12 @@ int check_device_list_events(v4l2_dev_t *vd)
  */
 void v4l2core_close_v4l2_device_list()
 {
-	free_device_list();
+	/*never initiated*/
+	if(!device_list_init)
+		return;
+
+	if(my_device_list.list_devices != NULL)
+		free_device_list();
 	
 	if (my_device_list.udev)
 		udev_unref(my_device_list.udev);
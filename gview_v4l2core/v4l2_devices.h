@@ -37,18 +37,6 @@ typedef struct _v4l2_device_list_t
     int num_devices;                    // number of available v4l2 devices
 } v4l2_device_list_t;
 
-/*
- * Initiate the device list (with udev monitoring)
- * args:
- *   none
- *
- * asserts:
- *   none
- *
- * returns: none
- */
-void v4l2core_init_device_list();
-
 /*
  * get the device list
  * args:
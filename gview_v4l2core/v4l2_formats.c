@@ -84,6 +84,32 @@ static uint32_t decoder_supported_formats[] =
 	V4L2_PIX_FMT_SGRBG8,
 	V4L2_PIX_FMT_SBGGR8,
 	V4L2_PIX_FMT_SRGGB8,
+	V4L2_PIX_FMT_SGBRG10,
+	V4L2_PIX_FMT_SGRBG10,
+	V4L2_PIX_FMT_SBGGR10,
+	V4L2_PIX_FMT_SRGGB10,
+	V4L2_PIX_FMT_SGBRG12,
+	V4L2_PIX_FMT_SGRBG12,
+	V4L2_PIX_FMT_SBGGR12,
+	V4L2_PIX_FMT_SRGGB12,
+	V4L2_PIX_FMT_SBGGR16,
+#ifdef V4L2_PIX_FMT_SGBRG16
+	V4L2_PIX_FMT_SGBRG16,
+	V4L2_PIX_FMT_SGRBG16,
+	V4L2_PIX_FMT_SRGGB16,
+#endif
+#ifdef V4L2_PIX_FMT_SBGGR10P
+	V4L2_PIX_FMT_SGBRG10P,
+	V4L2_PIX_FMT_SGRBG10P,
+	V4L2_PIX_FMT_SBGGR10P,
+	V4L2_PIX_FMT_SRGGB10P,
+#endif
+#ifdef V4L2_PIX_FMT_SBGGR12P
+	V4L2_PIX_FMT_SGBRG12P,
+	V4L2_PIX_FMT_SGRBG12P,
+	V4L2_PIX_FMT_SBGGR12P,
+	V4L2_PIX_FMT_SRGGB12P,
+#endif
 	V4L2_PIX_FMT_RGB24,
 	V4L2_PIX_FMT_BGR24,
 	V4L2_PIX_FMT_RGB332,
@@ -0,0 +1,407 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  V4L2 core library - multi device frame wait (epoll)                          #
+#                                                                               #
+********************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#include "gview.h"
+#include "gviewv4l2core.h"
+#include "v4l2_core.h"
+
+#define __PMUTEX &(vd->mutex)
+
+extern int verbosity;
+
+/*
+ * device registered in the epoll set
+ */
+typedef struct _poll_dev_t
+{
+	v4l2_dev_t *vd;     //registered device
+	int fd;             //device fd at registration time
+	uint32_t serial;    //device serial at registration time
+} poll_dev_t;
+
+/*
+ * epoll set (one per calling thread)
+ */
+typedef struct _poll_set_t
+{
+	int epfd;                   //epoll instance
+	poll_dev_t *list;           //registered devices
+	int list_size;              //number of registered devices
+	int list_max_size;          //allocated list size
+	struct epoll_event *events; //epoll_wait events
+	int events_max_size;        //allocated events size
+} poll_set_t;
+
+static pthread_key_t poll_set_key;
+static pthread_once_t poll_set_once = PTHREAD_ONCE_INIT;
+
+/*
+ * free the thread epoll set (thread exit)
+ * args:
+ *   data - pointer to poll set
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void free_poll_set(void *data)
+{
+	poll_set_t *ps = (poll_set_t *) data;
+
+	if(ps == NULL)
+		return;
+
+	if(ps->epfd >= 0)
+		close(ps->epfd);
+	free(ps->list);
+	free(ps->events);
+	free(ps);
+}
+
+/*
+ * create the poll set thread key
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void create_poll_set_key(void)
+{
+	pthread_key_create(&poll_set_key, free_poll_set);
+}
+
+/*
+ * get the epoll set for the calling thread (create it if needed)
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to poll set (NULL on error)
+ */
+static poll_set_t *get_poll_set(void)
+{
+	pthread_once(&poll_set_once, create_poll_set_key);
+
+	poll_set_t *ps = pthread_getspecific(poll_set_key);
+	if(ps != NULL)
+		return ps;
+
+	ps = calloc(1, sizeof(poll_set_t));
+	if(ps == NULL)
+	{
+		fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (get_poll_set): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	ps->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if(ps->epfd < 0)
+	{
+		fprintf(stderr, "V4L2_CORE: (epoll_create1) couldn't create epoll set: %s\n", strerror(errno));
+		free(ps);
+		return NULL;
+	}
+
+	pthread_setspecific(poll_set_key, ps);
+
+	return ps;
+}
+
+/*
+ * check if a registered entry still matches a device in the list
+ * args:
+ *   entry - pointer to registered entry
+ *   devs - array of device handlers
+ *   n - number of devices in array
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if entry is still valid, 0 otherwise
+ */
+static int poll_entry_valid(poll_dev_t *entry, v4l2_dev_t **devs, int n)
+{
+	int i = 0;
+	for(i = 0; i < n; ++i)
+	{
+		if(devs[i] == entry->vd &&
+			devs[i]->fd == entry->fd &&
+			devs[i]->poll_serial == entry->serial)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * sync the epoll set with the device list
+ *  (only changes to the list cost epoll_ctl calls)
+ * args:
+ *   ps - pointer to poll set
+ *   devs - array of device handlers
+ *   n - number of devices in array
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (E_OK)
+ */
+static int update_poll_set(poll_set_t *ps, v4l2_dev_t **devs, int n)
+{
+	int i = 0;
+	int j = 0;
+
+	/*drop devices no longer requested (or closed/reopened)*/
+	for(i = 0; i < ps->list_size; ++i)
+	{
+		if(poll_entry_valid(&ps->list[i], devs, n))
+		{
+			ps->list[j++] = ps->list[i];
+			continue;
+		}
+
+		/*fd may already be closed - ignore errors*/
+		epoll_ctl(ps->epfd, EPOLL_CTL_DEL, ps->list[i].fd, NULL);
+	}
+	ps->list_size = j;
+
+	/*add new devices*/
+	for(i = 0; i < n; ++i)
+	{
+		for(j = 0; j < ps->list_size; ++j)
+			if(ps->list[j].vd == devs[i])
+				break;
+
+		if(j < ps->list_size)
+			continue; /*already registered*/
+
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(struct epoll_event));
+		ev.events = EPOLLIN;
+		ev.data.fd = devs[i]->fd;
+
+		if(epoll_ctl(ps->epfd, EPOLL_CTL_ADD, devs[i]->fd, &ev) < 0 && errno != EEXIST)
+		{
+			fprintf(stderr, "V4L2_CORE: (epoll_ctl) couldn't add device %s: %s\n",
+				devs[i]->videodevice, strerror(errno));
+			return E_SELECT_ERR;
+		}
+
+		if(ps->list_size >= ps->list_max_size)
+		{
+			ps->list_max_size = ps->list_max_size ? ps->list_max_size * 2 : 8;
+			ps->list = realloc(ps->list, ps->list_max_size * sizeof(poll_dev_t));
+			if(ps->list == NULL)
+			{
+				fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (update_poll_set): %s\n", strerror(errno));
+				exit(-1);
+			}
+		}
+
+		ps->list[ps->list_size].vd = devs[i];
+		ps->list[ps->list_size].fd = devs[i]->fd;
+		ps->list[ps->list_size].serial = devs[i]->poll_serial;
+		ps->list_size++;
+	}
+
+	if(ps->events_max_size < n)
+	{
+		ps->events = realloc(ps->events, n * sizeof(struct epoll_event));
+		if(ps->events == NULL)
+		{
+			fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure (update_poll_set): %s\n", strerror(errno));
+			exit(-1);
+		}
+		ps->events_max_size = n;
+	}
+
+	return E_OK;
+}
+
+/*
+ * wait for frames on a set of devices
+ *  ready devices are flagged so that the next v4l2core_get_frame
+ *  on them doesn't block (check with v4l2core_is_frame_ready)
+ * args:
+ *   devs - array of device handlers (streaming)
+ *   n - number of devices in array
+ *   timeout_ms - wait timeout in ms (-1 blocks until a frame is ready)
+ *
+ * asserts:
+ *   devs is not null
+ *
+ * returns: number of devices with a frame ready (0 on timeout)
+ *          or error code (< 0)
+ */
+int v4l2core_poll_devices(v4l2_dev_t **devs, int n, int timeout_ms)
+{
+	/*assertions*/
+	assert(devs != NULL);
+
+	if(n <= 0)
+		return 0;
+
+	poll_set_t *ps = get_poll_set();
+	if(ps == NULL)
+		return E_SELECT_ERR;
+
+	int ret = update_poll_set(ps, devs, n);
+	if(ret != E_OK)
+		return ret;
+
+	/*
+	 * only report devices that fire in this wait
+	 * (level triggered - unread frames fire again)
+	 */
+	int i = 0;
+	for(i = 0; i < n; ++i)
+	{
+		v4l2_dev_t *vd = devs[i];
+		__LOCK_MUTEX( __PMUTEX );
+		vd->frame_ready = 0;
+		__UNLOCK_MUTEX( __PMUTEX );
+	}
+
+	int nev = epoll_wait(ps->epfd, ps->events, n, timeout_ms);
+	if(nev < 0)
+	{
+		if(errno == EINTR)
+			return 0;
+
+		fprintf(stderr, "V4L2_CORE: (epoll_wait) error: %s\n", strerror(errno));
+		return E_SELECT_ERR;
+	}
+
+	int nready = 0;
+	for(i = 0; i < nev; ++i)
+	{
+		int j = 0;
+		for(j = 0; j < n; ++j)
+		{
+			if(devs[j]->fd != ps->events[i].data.fd)
+				continue;
+
+			v4l2_dev_t *vd = devs[j];
+
+			/*
+			 * errors (e.g. device unplugged) are also flagged
+			 * so that the next get_frame reports them
+			 */
+			__LOCK_MUTEX( __PMUTEX );
+			vd->frame_ready = 1;
+			__UNLOCK_MUTEX( __PMUTEX );
+
+			nready++;
+
+			if(verbosity > 3)
+				printf("V4L2_CORE: (poll) frame ready on %s (events: 0x%x)\n",
+					vd->videodevice, ps->events[i].events);
+			break;
+		}
+	}
+
+	return nready;
+}
+
+/*
+ * wait for frames on a set of devices and dispatch
+ *  the ready callback for each device with a frame ready
+ * args:
+ *   devs - array of device handlers (streaming)
+ *   n - number of devices in array
+ *   timeout_ms - wait timeout in ms (-1 blocks until a frame is ready)
+ *   callback - function called for each ready device
+ *   data - user data passed to callback
+ *
+ * asserts:
+ *   devs is not null
+ *   callback is not null
+ *
+ * returns: number of dispatched devices (0 on timeout)
+ *          or error code (< 0)
+ */
+int v4l2core_dispatch_devices(v4l2_dev_t **devs, int n, int timeout_ms,
+	v4l2core_frame_ready_callback callback, void *data)
+{
+	/*assertions*/
+	assert(devs != NULL);
+	assert(callback != NULL);
+
+	int ret = v4l2core_poll_devices(devs, n, timeout_ms);
+	if(ret <= 0)
+		return ret;
+
+	int dispatched = 0;
+	int i = 0;
+	for(i = 0; i < n; ++i)
+	{
+		if(!v4l2core_is_frame_ready(devs[i]))
+			continue;
+
+		callback(devs[i], data);
+		dispatched++;
+	}
+
+	return dispatched;
+}
+
+/*
+ * check if a frame was flagged ready by v4l2core_poll_devices
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: 1 if a frame is ready, 0 otherwise
+ */
+int v4l2core_is_frame_ready(v4l2_dev_t *vd)
+{
+	/*assertions*/
+	assert(vd != NULL);
+
+	__LOCK_MUTEX( __PMUTEX );
+	int ready = vd->frame_ready;
+	__UNLOCK_MUTEX( __PMUTEX );
+
+	return ready;
+}
@@ -0,0 +1,182 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  gview libraries - shared h264 (Annex B) NAL unit index                       #
+#                                                                               #
+********************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "h264_nal.h"
+
+/*
+ * append a NAL unit to the index
+ * args:
+ *   index - pointer to NAL index
+ *   offset - NAL unit offset in buffer
+ *   type - NAL unit type
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void nal_index_push(h264_nal_index_t *index, int offset, uint8_t type)
+{
+	if(index->count >= index->max_count)
+	{
+		index->max_count = index->max_count ? index->max_count * 2 : 16;
+		index->nal = realloc(index->nal, index->max_count * sizeof(h264_nal_t));
+		if(index->nal == NULL)
+		{
+			fprintf(stderr, "GVIEW: FATAL memory allocation failure (nal_index_push): %s\n", strerror(errno));
+			exit(-1);
+		}
+	}
+
+	index->nal[index->count].offset = offset;
+	index->nal[index->count].size = 0;
+	index->nal[index->count].type = type;
+	index->count++;
+}
+
+/*
+ * index the NAL units of a h264 (Annex B) buffer
+ *  start codes are searched with memchr (one pass over the buffer)
+ * args:
+ *   index - pointer to NAL index (zero initialized before first use)
+ *   buff - pointer to h264 data
+ *   size - buffer size
+ *
+ * asserts:
+ *   index is not null
+ *   buff is not null
+ *
+ * returns: number of NAL units found
+ */
+int h264_nal_index_build(h264_nal_index_t *index, const uint8_t *buff, int size)
+{
+	/*asserts*/
+	assert(index != NULL);
+	assert(buff != NULL);
+
+	index->count = 0;
+
+	const uint8_t *end = buff + size;
+	const uint8_t *sp = buff + 3; /*first possible 0x01 of a start code*/
+
+	while(sp < end)
+	{
+		/*
+		 * the last byte of the start code (00 00 00 01) is the rarest,
+		 * memchr skips everything else (vectorized in libc)
+		 */
+		sp = memchr(sp, 0x01, end - sp);
+		if(sp == NULL)
+			break;
+
+		if(sp[-1] != 0x00 || sp[-2] != 0x00 || sp[-3] != 0x00)
+		{
+			sp++;
+			continue;
+		}
+
+		int offset = (int) (sp + 1 - buff);
+		if(offset >= size)
+			break; /*start code at the end of buffer (empty NAL unit)*/
+
+		/*previous NAL unit ends at this start code*/
+		if(index->count > 0)
+		{
+			h264_nal_t *last = &index->nal[index->count - 1];
+			last->size = offset - 4 - last->offset;
+		}
+
+		nal_index_push(index, offset, buff[offset] & 0x1F);
+
+		/*a start code can't start inside the NAL header*/
+		sp += 4;
+	}
+
+	/*last NAL unit goes to the end of buffer*/
+	if(index->count > 0)
+	{
+		h264_nal_t *last = &index->nal[index->count - 1];
+		last->size = size - last->offset;
+	}
+
+	return index->count;
+}
+
+/*
+ * find the first NAL unit of a given type in an index
+ * args:
+ *   index - pointer to NAL index
+ *   type - NAL unit type
+ *
+ * asserts:
+ *   index is not null
+ *
+ * returns: pointer to NAL unit entry (NULL if not found)
+ */
+const h264_nal_t *h264_nal_index_find(const h264_nal_index_t *index, uint8_t type)
+{
+	/*asserts*/
+	assert(index != NULL);
+
+	int i = 0;
+	for(i = 0; i < index->count; ++i)
+	{
+		if(index->nal[i].type == type)
+			return &index->nal[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * free the NAL index data
+ * args:
+ *   index - pointer to NAL index
+ *
+ * asserts:
+ *   index is not null
+ *
+ * returns: none
+ */
+void h264_nal_index_free(h264_nal_index_t *index)
+{
+	/*asserts*/
+	assert(index != NULL);
+
+	if(index->nal)
+		free(index->nal);
+	index->nal = NULL;
+	index->count = 0;
+	index->max_count = 0;
+}
@@ -0,0 +1,105 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  gview libraries - shared h264 (Annex B) NAL unit index                       #
+#                                                                               #
+********************************************************************************/
+
+#ifndef H264_NAL_H
+#define H264_NAL_H
+
+#include <inttypes.h>
+
+/*
+ * the index code is built into the v4l2core and encoder libraries,
+ *  keep the symbols private so that the two copies don't clash
+ *  when the libraries are loaded together
+ */
+#if defined(__GNUC__) && __GNUC__ >= 4
+  #define H264_NAL_API __attribute__((visibility("hidden")))
+#else
+  #define H264_NAL_API
+#endif
+
+/*
+ * NAL unit in a h264 (Annex B) buffer
+ */
+typedef struct _h264_nal_t
+{
+	int offset;   //NAL unit offset in buffer (after the 00 00 00 01 start code)
+	int size;     //NAL unit size (bytes)
+	uint8_t type; //NAL unit type
+} h264_nal_t;
+
+/*
+ * NAL unit index of a h264 (Annex B) buffer
+ */
+typedef struct _h264_nal_index_t
+{
+	h264_nal_t *nal;   //NAL units in buffer order
+	int count;         //number of NAL units
+	int max_count;     //allocated size of nal
+} h264_nal_index_t;
+
+/*
+ * index the NAL units of a h264 (Annex B) buffer
+ *  start codes are searched with memchr (one pass over the buffer)
+ * args:
+ *   index - pointer to NAL index (zero initialized before first use)
+ *   buff - pointer to h264 data
+ *   size - buffer size
+ *
+ * asserts:
+ *   index is not null
+ *   buff is not null
+ *
+ * returns: number of NAL units found
+ */
+H264_NAL_API int h264_nal_index_build(h264_nal_index_t *index, const uint8_t *buff, int size);
+
+/*
+ * find the first NAL unit of a given type in an index
+ * args:
+ *   index - pointer to NAL index
+ *   type - NAL unit type
+ *
+ * asserts:
+ *   index is not null
+ *
+ * returns: pointer to NAL unit entry (NULL if not found)
+ */
+H264_NAL_API const h264_nal_t *h264_nal_index_find(const h264_nal_index_t *index, uint8_t type);
+
+/*
+ * free the NAL index data
+ * args:
+ *   index - pointer to NAL index
+ *
+ * asserts:
+ *   index is not null
+ *
+ * returns: none
+ */
+H264_NAL_API void h264_nal_index_free(h264_nal_index_t *index);
+
+#endif
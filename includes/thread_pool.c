@@ -0,0 +1,577 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  gview libraries - shared work-stealing thread pool                           #
+#                                                                               #
+********************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "gview.h"
+#include "thread_pool.h"
+
+extern int verbosity;
+
+/*
+ * parallel_for_rows call
+ */
+typedef struct _pool_job_t
+{
+	parallel_rows_func func;
+	void *data;
+	int pending;              //queued bands not done yet
+	__MUTEX_TYPE mutex;
+	__COND_TYPE done_cond;    //all queued bands done
+} pool_job_t;
+
+/*
+ * row band
+ */
+typedef struct _pool_task_t
+{
+	pool_job_t *job;
+	int row_start;
+	int row_end;
+} pool_task_t;
+
+/*
+ * worker task queue
+ *  the owner takes tasks from the back, other threads
+ *  steal from the front
+ */
+typedef struct _pool_queue_t
+{
+	pool_task_t *tasks;       //circular list
+	int first;                //front of the queue
+	int ntasks;               //number of queued tasks
+	int size;                 //allocated list size
+	__MUTEX_TYPE mutex;
+} pool_queue_t;
+
+/*
+ * worker thread data
+ */
+typedef struct _pool_worker_t
+{
+	struct _thread_pool_t *pool;
+	__THREAD_TYPE thread;
+	pool_queue_t queue;
+	int index;
+} pool_worker_t;
+
+typedef struct _thread_pool_t
+{
+	pool_worker_t *workers;
+	int nworkers;
+
+	int queued;               //tasks in all queues
+	int next_queue;           //round robin submission index
+
+	int quit;                 //stop the workers
+
+	__MUTEX_TYPE mutex;
+	__COND_TYPE work_cond;    //new tasks or quit
+} thread_pool_t;
+
+static thread_pool_t *thread_pool = NULL;
+static int pool_threads = 0; /*0 - one per online cpu*/
+static __MUTEX_TYPE pool_mutex = __STATIC_MUTEX_INIT;
+
+/*worker index of the current thread (-1 if not a pool worker)*/
+static __thread int worker_index = -1;
+
+/*
+ * add a task to the back of a queue
+ * args:
+ *   queue - pointer to task queue
+ *   task - pointer to task
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void queue_push(pool_queue_t *queue, pool_task_t *task)
+{
+	__LOCK_MUTEX(&queue->mutex);
+
+	if(queue->ntasks >= queue->size)
+	{
+		int size = queue->size ? queue->size * 2 : 16;
+		pool_task_t *tasks = calloc(size, sizeof(pool_task_t));
+		if(tasks == NULL)
+		{
+			fprintf(stderr, "GVIEW: FATAL memory allocation failure (queue_push): %s\n", strerror(errno));
+			exit(-1);
+		}
+
+		int i = 0;
+		for(i = 0; i < queue->ntasks; ++i)
+			tasks[i] = queue->tasks[(queue->first + i) % queue->size];
+
+		free(queue->tasks);
+		queue->tasks = tasks;
+		queue->first = 0;
+		queue->size = size;
+	}
+
+	queue->tasks[(queue->first + queue->ntasks) % queue->size] = *task;
+	queue->ntasks++;
+
+	__UNLOCK_MUTEX(&queue->mutex);
+}
+
+/*
+ * take a task from a queue
+ * args:
+ *   queue - pointer to task queue
+ *   task - pointer to task to fill
+ *   steal - take from the front (steal) or the back (owner)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if a task was taken, 0 if the queue is empty
+ */
+static int queue_take(pool_queue_t *queue, pool_task_t *task, int steal)
+{
+	int ret = 0;
+
+	__LOCK_MUTEX(&queue->mutex);
+
+	if(queue->ntasks > 0)
+	{
+		if(steal)
+		{
+			*task = queue->tasks[queue->first];
+			queue->first = (queue->first + 1) % queue->size;
+		}
+		else
+			*task = queue->tasks[(queue->first + queue->ntasks - 1) % queue->size];
+
+		queue->ntasks--;
+		ret = 1;
+	}
+
+	__UNLOCK_MUTEX(&queue->mutex);
+
+	return ret;
+}
+
+/*
+ * get the next task for a thread
+ *  workers check their own queue first and then steal
+ *  from the others
+ * args:
+ *   pool - pointer to thread pool
+ *   index - worker index (-1 for non worker threads)
+ *   task - pointer to task to fill
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if a task was taken, 0 if all queues are empty
+ */
+static int get_task(thread_pool_t *pool, int index, pool_task_t *task)
+{
+	if(__atomic_load_n(&pool->queued, __ATOMIC_ACQUIRE) <= 0)
+		return 0;
+
+	int found = 0;
+
+	if(index >= 0)
+		found = queue_take(&pool->workers[index].queue, task, 0);
+
+	int i = 0;
+	for(i = 1; !found && i <= pool->nworkers; ++i)
+	{
+		int victim = (index + i) % pool->nworkers;
+		if(victim == index)
+			continue;
+		found = queue_take(&pool->workers[victim].queue, task, 1);
+	}
+
+	if(found)
+		__atomic_sub_fetch(&pool->queued, 1, __ATOMIC_ACQ_REL);
+
+	return found;
+}
+
+/*
+ * run a task and flag it done
+ * args:
+ *   task - pointer to task
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void run_task(pool_task_t *task)
+{
+	pool_job_t *job = task->job;
+
+	job->func(job->data, task->row_start, task->row_end);
+
+	/*the job is owned by the waiting thread, so don't touch it after unlocking*/
+	__LOCK_MUTEX(&job->mutex);
+	if(__atomic_sub_fetch(&job->pending, 1, __ATOMIC_ACQ_REL) <= 0)
+		__COND_BCAST(&job->done_cond);
+	__UNLOCK_MUTEX(&job->mutex);
+}
+
+/*
+ * worker thread loop
+ * args:
+ *   data - pointer to worker data
+ *
+ * asserts:
+ *   none
+ *
+ * returns: NULL
+ */
+static void *pool_worker_loop(void *data)
+{
+	pool_worker_t *worker = (pool_worker_t *) data;
+	thread_pool_t *pool = worker->pool;
+
+	worker_index = worker->index;
+
+	while(1)
+	{
+		pool_task_t task;
+		if(get_task(pool, worker->index, &task))
+		{
+			run_task(&task);
+			continue;
+		}
+
+		__LOCK_MUTEX(&pool->mutex);
+		while(!pool->quit && __atomic_load_n(&pool->queued, __ATOMIC_ACQUIRE) <= 0)
+			__COND_WAIT(&pool->work_cond, &pool->mutex);
+		int quit = pool->quit;
+		__UNLOCK_MUTEX(&pool->mutex);
+
+		if(quit)
+			break;
+	}
+
+	return NULL;
+}
+
+/*
+ * stop and free a thread pool
+ * args:
+ *   pool - pointer to thread pool
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void pool_destroy(thread_pool_t *pool)
+{
+	if(pool == NULL)
+		return;
+
+	__LOCK_MUTEX(&pool->mutex);
+	pool->quit = 1;
+	__COND_BCAST(&pool->work_cond);
+	__UNLOCK_MUTEX(&pool->mutex);
+
+	int i = 0;
+	for(i = 0; i < pool->nworkers; ++i)
+		__THREAD_JOIN(pool->workers[i].thread);
+
+	for(i = 0; i < pool->nworkers; ++i)
+	{
+		free(pool->workers[i].queue.tasks);
+		__CLOSE_MUTEX(&pool->workers[i].queue.mutex);
+	}
+
+	__CLOSE_COND(&pool->work_cond);
+	__CLOSE_MUTEX(&pool->mutex);
+
+	free(pool->workers);
+	free(pool);
+}
+
+/*
+ * create a thread pool
+ * args:
+ *   nworkers - number of worker threads
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to thread pool (NULL on error)
+ */
+static thread_pool_t *pool_create(int nworkers)
+{
+	thread_pool_t *pool = calloc(1, sizeof(thread_pool_t));
+	if(pool == NULL)
+	{
+		fprintf(stderr, "GVIEW: FATAL memory allocation failure (pool_create): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	pool->workers = calloc(nworkers, sizeof(pool_worker_t));
+	if(pool->workers == NULL)
+	{
+		fprintf(stderr, "GVIEW: FATAL memory allocation failure (pool_create): %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	__INIT_MUTEX(&pool->mutex);
+	__INIT_COND(&pool->work_cond);
+
+	int i = 0;
+	for(i = 0; i < nworkers; ++i)
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i;
+		__INIT_MUTEX(&pool->workers[i].queue.mutex);
+	}
+
+	/*workers only start stealing after all queues are set*/
+	for(i = 0; i < nworkers; ++i)
+	{
+		if(__THREAD_CREATE(&pool->workers[i].thread, pool_worker_loop, &pool->workers[i]))
+		{
+			fprintf(stderr, "GVIEW: couldn't create pool thread %i: %s\n", i, strerror(errno));
+			break;
+		}
+	}
+
+	/*
+	 * nworkers is only read by get_task, which
+	 * returns early while no tasks are queued
+	 */
+	pool->nworkers = i;
+
+	if(pool->nworkers < 1)
+	{
+		pool_destroy(pool);
+		return NULL;
+	}
+
+	if(verbosity > 0)
+		printf("GVIEW: started %i pool threads\n", pool->nworkers);
+
+	return pool;
+}
+
+/*
+ * set the number of threads used by parallel_for_rows
+ *  (including the calling thread)
+ *  must not be called while parallel_for_rows is running
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - run everything in the calling thread)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void thread_pool_set_threads(int nthreads)
+{
+	if(nthreads < 0)
+		nthreads = 1;
+
+	__LOCK_MUTEX(&pool_mutex);
+	if(nthreads != pool_threads)
+	{
+		/*restarted with the new size on the next call*/
+		pool_destroy(thread_pool);
+		thread_pool = NULL;
+		pool_threads = nthreads;
+	}
+	__UNLOCK_MUTEX(&pool_mutex);
+}
+
+/*
+ * get the number of threads used by parallel_for_rows
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of threads (including the calling thread)
+ */
+int thread_pool_get_threads()
+{
+	int nthreads = pool_threads;
+
+	if(nthreads == 0)
+		nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	return nthreads < 1 ? 1 : nthreads;
+}
+
+/*
+ * get the thread pool (create it if needed)
+ * args:
+ *   nthreads - number of threads (including the calling thread)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to thread pool (NULL if not available)
+ */
+static thread_pool_t *get_thread_pool(int nthreads)
+{
+	__LOCK_MUTEX(&pool_mutex);
+	if(thread_pool == NULL)
+		thread_pool = pool_create(nthreads - 1);
+	thread_pool_t *pool = thread_pool;
+	__UNLOCK_MUTEX(&pool_mutex);
+
+	return pool;
+}
+
+/*
+ * split rows [0, height) in bands and process them in parallel
+ *  the calling thread takes part in the work and only returns
+ *  after all bands are done (calls can be nested)
+ * args:
+ *   height - number of rows
+ *   row_align - band size alignment in rows (e.g. 2 for 4:2:0 chroma)
+ *   min_rows - minimum number of rows per band
+ *   func - band function
+ *   data - user data for func
+ *
+ * asserts:
+ *   func is not null
+ *
+ * returns: none
+ */
+void parallel_for_rows(int height, int row_align, int min_rows,
+	parallel_rows_func func, void *data)
+{
+	/*assertions*/
+	assert(func != NULL);
+
+	if(height <= 0)
+		return;
+
+	if(row_align < 1)
+		row_align = 1;
+	if(min_rows < row_align)
+		min_rows = row_align;
+
+	int nthreads = thread_pool_get_threads();
+
+	/*two bands per thread leaves room for stealing*/
+	int units = (height + row_align - 1) / row_align;
+	int nbands = nthreads * 2;
+	if(nbands > height / min_rows)
+		nbands = height / min_rows;
+	if(nbands > units)
+		nbands = units;
+
+	thread_pool_t *pool = NULL;
+	if(nthreads > 1 && nbands > 1)
+		pool = get_thread_pool(nthreads);
+
+	if(pool == NULL)
+	{
+		func(data, 0, height);
+		return;
+	}
+
+	pool_job_t job;
+	job.func = func;
+	job.data = data;
+	job.pending = nbands - 1;
+	__INIT_MUTEX(&job.mutex);
+	__INIT_COND(&job.done_cond);
+
+	/*queue all bands but the first (run by the calling thread)*/
+	int i = 0;
+	for(i = 1; i < nbands; ++i)
+	{
+		pool_task_t task;
+		task.job = &job;
+		task.row_start = ((units * i) / nbands) * row_align;
+		task.row_end = ((units * (i + 1)) / nbands) * row_align;
+		if(task.row_end > height)
+			task.row_end = height;
+
+		int q = __atomic_fetch_add(&pool->next_queue, 1, __ATOMIC_RELAXED);
+		queue_push(&pool->workers[q % pool->nworkers].queue, &task);
+	}
+
+	__atomic_add_fetch(&pool->queued, nbands - 1, __ATOMIC_ACQ_REL);
+
+	__LOCK_MUTEX(&pool->mutex);
+	__COND_BCAST(&pool->work_cond);
+	__UNLOCK_MUTEX(&pool->mutex);
+
+	func(data, 0, (units / nbands) * row_align);
+
+	/*help with queued tasks (any job) until ours are all taken*/
+	while(__atomic_load_n(&job.pending, __ATOMIC_ACQUIRE) > 0)
+	{
+		pool_task_t task;
+		if(!get_task(pool, worker_index, &task))
+			break;
+		run_task(&task);
+	}
+
+	__LOCK_MUTEX(&job.mutex);
+	while(__atomic_load_n(&job.pending, __ATOMIC_ACQUIRE) > 0)
+		__COND_WAIT(&job.done_cond, &job.mutex);
+	__UNLOCK_MUTEX(&job.mutex);
+
+	__CLOSE_COND(&job.done_cond);
+	__CLOSE_MUTEX(&job.mutex);
+}
+
+/*
+ * stop the pool worker threads
+ *  (restarted on the next parallel_for_rows call)
+ *  must not be called while parallel_for_rows is running
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void thread_pool_close()
+{
+	__LOCK_MUTEX(&pool_mutex);
+	pool_destroy(thread_pool);
+	thread_pool = NULL;
+	__UNLOCK_MUTEX(&pool_mutex);
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  gview libraries - shared work-stealing thread pool                           #
+#                                                                               #
+********************************************************************************/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/*
+ * the pool is built into each gview library that uses it
+ *  (each library has its own pool), keep the symbols private
+ *  so that they don't clash when the libraries are loaded together
+ */
+#if defined(__GNUC__) && __GNUC__ >= 4
+  #define THREAD_POOL_API __attribute__((visibility("hidden")))
+#else
+  #define THREAD_POOL_API
+#endif
+
+/*
+ * row band function
+ * args:
+ *   data - user data
+ *   row_start - first row of the band
+ *   row_end - last row of the band (not included)
+ */
+typedef void (*parallel_rows_func)(void *data, int row_start, int row_end);
+
+/*
+ * set the number of threads used by parallel_for_rows
+ *  (including the calling thread)
+ *  must not be called while parallel_for_rows is running
+ * args:
+ *   nthreads - number of threads (0 - one per online cpu (default),
+ *              1 - run everything in the calling thread)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+THREAD_POOL_API void thread_pool_set_threads(int nthreads);
+
+/*
+ * get the number of threads used by parallel_for_rows
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of threads (including the calling thread)
+ */
+THREAD_POOL_API int thread_pool_get_threads();
+
+/*
+ * split rows [0, height) in bands and process them in parallel
+ *  the calling thread takes part in the work and only returns
+ *  after all bands are done (calls can be nested)
+ * args:
+ *   height - number of rows
+ *   row_align - band size alignment in rows (e.g. 2 for 4:2:0 chroma)
+ *   min_rows - minimum number of rows per band
+ *   func - band function
+ *   data - user data for func
+ *
+ * asserts:
+ *   func is not null
+ *
+ * returns: none
+ */
+THREAD_POOL_API void parallel_for_rows(int height, int row_align, int min_rows,
+	parallel_rows_func func, void *data);
+
+/*
+ * stop the pool worker threads
+ *  (restarted on the next parallel_for_rows call)
+ *  must not be called while parallel_for_rows is running
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+THREAD_POOL_API void thread_pool_close();
+
+#endif